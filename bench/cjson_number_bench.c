@@ -0,0 +1,208 @@
+/**
+ * @file cjson_number_bench.c
+ * @brief Benchmark and cross-check of the cJSON number parser over a metrics-like corpus.
+ * @details The corpus mimics the samples read from the monitor FIFO: percentages with two decimals,
+ * integer counters, timings in seconds and full precision doubles as printed by cJSON itself.
+ * Every number is also checked bit for bit against strtod.
+ */
+#include <cJSON.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * @brief Number of documents in the corpus.
+ */
+#define DOCUMENTS 2000
+
+/**
+ * @brief Number of timed passes over the corpus.
+ */
+#define ROUNDS 20
+
+/**
+ * @brief Number of random doubles used for the exhaustive round trip check.
+ */
+#define RANDOM_CHECKS 1000000
+
+/**
+ * @brief Metric keys, the same ones filtered by filtrar_metricas().
+ */
+static const char* metric_keys[] = {"cpu_usage_percentage",   "memory_usage_percentage", "disk_reads",
+                                    "disk_writes",            "disk_read_time_seconds",  "disk_write_time_seconds",
+                                    "network_bandwidth_rx",   "network_bandwidth_tx",    "network_packet_ratio",
+                                    "running_processes_count", "context_switches_total", "memory_fragmentation",
+                                    "policy_counter_first",   "policy_counter_best",     "policy_counter_worst"};
+
+/**
+ * @brief Number of metric keys.
+ */
+#define METRIC_KEYS (sizeof(metric_keys) / sizeof(metric_keys[0]))
+
+/**
+ * @brief Returns a monotonic timestamp in nanoseconds.
+ * @return The timestamp.
+ */
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Small deterministic generator so the corpus is reproducible.
+ * @return A pseudo random 64 bit value.
+ */
+static uint64_t next_random(void)
+{
+    static uint64_t state = 0x9E3779B97F4A7C15ULL;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+/**
+ * @brief Formats the value of the given metric the way a monitor would.
+ * @param buffer The output buffer.
+ * @param size The size of the output buffer.
+ * @param index The metric index.
+ */
+static void format_metric(char* buffer, size_t size, size_t index)
+{
+    uint64_t r = next_random();
+
+    switch (index % 4)
+    {
+    case 0: // Porcentajes con dos decimales
+        snprintf(buffer, size, "%.2f", (double)(r % 10000) / 100.0);
+        break;
+    case 1: // Contadores enteros
+        snprintf(buffer, size, "%llu", (unsigned long long)(r % 100000000000ULL));
+        break;
+    case 2: // Tiempos en segundos
+        snprintf(buffer, size, "%.6f", (double)(r % 100000000) / 1000.0);
+        break;
+    default: // Doubles con precisión completa, como los imprime cJSON
+        snprintf(buffer, size, "%1.17g", (double)(r >> 11) / (double)(1ULL << 40));
+        break;
+    }
+}
+
+/**
+ * @brief Compares the number cJSON parses from a string with the one strtod produces.
+ * @param number The number as a string.
+ * @return true if both are bit-identical.
+ */
+static int check_number(const char* number)
+{
+    cJSON* item = cJSON_Parse(number);
+    double expected = strtod(number, NULL);
+    int ok = item != NULL && cJSON_IsNumber(item) && memcmp(&item->valuedouble, &expected, sizeof(double)) == 0;
+
+    if (!ok)
+    {
+        fprintf(stderr, "Mismatch para %s: %.17g != %.17g\n", number, item ? item->valuedouble : 0.0, expected);
+    }
+    cJSON_Delete(item);
+    return ok;
+}
+
+/**
+ * @brief Main function.
+ * @return EXIT_SUCCESS if every number matched strtod.
+ */
+int main(void)
+{
+    static char numbers[DOCUMENTS * METRIC_KEYS][32];
+    char** documents = malloc(sizeof(char*) * DOCUMENTS);
+    size_t total_numbers = DOCUMENTS * METRIC_KEYS;
+    size_t mismatches = 0;
+    size_t i = 0;
+    size_t k = 0;
+    int round = 0;
+    double sink = 0;
+
+    // Construcción del corpus
+    for (i = 0; i < DOCUMENTS; i++)
+    {
+        char document[2048];
+        size_t length = 0;
+
+        length += (size_t)snprintf(document + length, sizeof(document) - length, "{");
+        for (k = 0; k < METRIC_KEYS; k++)
+        {
+            char* number = numbers[i * METRIC_KEYS + k];
+            format_metric(number, sizeof(numbers[0]), k);
+            length += (size_t)snprintf(document + length, sizeof(document) - length, "%s\"%s\":%s", k ? "," : "",
+                                       metric_keys[k], number);
+        }
+        snprintf(document + length, sizeof(document) - length, "}");
+        documents[i] = strdup(document);
+    }
+
+    // Verificación contra strtod
+    for (i = 0; i < total_numbers; i++)
+    {
+        mismatches += !check_number(numbers[i]);
+    }
+    for (i = 0; i < RANDOM_CHECKS; i++)
+    {
+        char number[40];
+        uint64_t bits = next_random();
+        double value;
+
+        memcpy(&value, &bits, sizeof(value));
+        if (value != value || value - value != 0) // NaN o infinito
+        {
+            continue;
+        }
+        snprintf(number, sizeof(number), (i % 2) ? "%1.17g" : "%1.15g", value);
+        mismatches += !check_number(number);
+    }
+
+    // Parseo de documentos completos
+    uint64_t start = now_ns();
+    for (round = 0; round < ROUNDS; round++)
+    {
+        for (i = 0; i < DOCUMENTS; i++)
+        {
+            cJSON* document = cJSON_Parse(documents[i]);
+            sink += document->child->valuedouble;
+            cJSON_Delete(document);
+        }
+    }
+    uint64_t parse_ns = now_ns() - start;
+
+    // Referencia: copia al buffer temporal + strtod, como hacía parse_number()
+    start = now_ns();
+    for (round = 0; round < ROUNDS; round++)
+    {
+        for (i = 0; i < total_numbers; i++)
+        {
+            char copy[64];
+            size_t length = strlen(numbers[i]);
+            memcpy(copy, numbers[i], length + 1);
+            sink += strtod(copy, NULL);
+        }
+    }
+    uint64_t strtod_ns = now_ns() - start;
+
+    printf("documentos: %d, números: %zu, rondas: %d\n", DOCUMENTS, total_numbers, ROUNDS);
+    printf("cJSON_Parse:        %8.1f ns/documento  %6.1f ns/número\n",
+           (double)parse_ns / (double)(DOCUMENTS * ROUNDS), (double)parse_ns / (double)(total_numbers * ROUNDS));
+    printf("strtod (referencia):                     %6.1f ns/número\n",
+           (double)strtod_ns / (double)(total_numbers * ROUNDS));
+    printf("diferencias con strtod: %zu (checksum %g)\n", mismatches, sink);
+
+    for (i = 0; i < DOCUMENTS; i++)
+    {
+        free(documents[i]);
+    }
+    free(documents);
+
+    return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
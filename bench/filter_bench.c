@@ -0,0 +1,261 @@
+/**
+ * @file filter_bench.c
+ * @brief Benchmark of the builtin filters (set -o builtin-filters) against the grep, wc, head and tail programs.
+ * @details A log of the given size is generated, about 1% of its lines contain "error". Every pipeline runs in a
+ * script that repeats it N times, with and without the option, and the median of several runs is kept. The output
+ * goes to a file, not to /dev/null: GNU grep notices /dev/null and stops at the first match.
+ *
+ * Usage: bench_filters [-m MiB] [-n repetitions] [-r runs] shellter-path
+ * The result is a tab separated table on stdout, the times are per run of the pipeline.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief Maximum number of runs of each script.
+ */
+#define MAX_RUNS 15
+
+/**
+ * @brief The pipelines measured, "%s" is the path of the log.
+ */
+static const char* const pipelines[] = {
+    "grep -c error %s",
+    "grep error %s",
+    "read_file %s | grep error | wc -l",
+    "read_file %s | grep -E err.r | grep -v beta | wc -l",
+    "read_file %s | grep -v ok | head -n 5",
+    "wc -l %s",
+    "tail -n 3 %s",
+};
+
+/**
+ * @brief Returns a monotonic timestamp in nanoseconds.
+ * @return The timestamp.
+ */
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Compares two doubles for qsort.
+ */
+static int compare_doubles(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Writes the log: numbered lines of words, one in a hundred with "error".
+ * @param path The path of the log.
+ * @param mebibytes The size of the log in MiB.
+ * @return 0 on success, -1 on error.
+ */
+static int write_log(const char* path, long mebibytes)
+{
+    static const char* const words[] = {"alpha", "beta", "gamma", "delta", "cache", "miss", "request"};
+    FILE* file = fopen(path, "w");
+    if (!file)
+        return -1;
+
+    long size = 0;
+    for (long line = 0; size < mebibytes * 1024 * 1024; line++)
+    {
+        int written = fprintf(file, "%ld %s %s %s\n", line, words[line % 7], line % 100 == 42 ? "error" : "ok",
+                              words[(line / 7) % 7]);
+        if (written < 0)
+            break;
+        size += written;
+    }
+    return fclose(file);
+}
+
+/**
+ * @brief Writes a script: an optional first line and the same line repeated.
+ * @param path The path of the script.
+ * @param header The first line, NULL for none.
+ * @param count The number of repeated lines.
+ * @param line The repeated line.
+ * @return 0 on success, -1 on error.
+ */
+static int write_script(const char* path, const char* header, long count, const char* line)
+{
+    FILE* file = fopen(path, "w");
+    if (!file)
+        return -1;
+    if (header)
+        fprintf(file, "%s\n", header);
+    for (long i = 0; i < count; i++)
+        fprintf(file, "%s\n", line);
+    return fclose(file);
+}
+
+/**
+ * @brief Runs a script with shellter, stdout sent to a file.
+ * @param shell The shell.
+ * @param script The script.
+ * @param output The file for stdout.
+ * @return The wall time in seconds, a negative number if the shell failed.
+ */
+static double run_script(const char* shell, const char* script, const char* output)
+{
+    uint64_t start = now_ns();
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        int null = open("/dev/null", O_RDONLY);
+        int out = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (null < 0 || out < 0)
+            _exit(127);
+        dup2(null, STDIN_FILENO);
+        dup2(out, STDOUT_FILENO);
+        close(null);
+        close(out);
+        execl(shell, shell, script, (char*)NULL);
+        _exit(127);
+    }
+    if (pid < 0)
+        return -1;
+
+    int status;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+        ;
+
+    double seconds = (double)(now_ns() - start) / 1e9;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? seconds : -1;
+}
+
+/**
+ * @brief Runs a script several times.
+ * @param shell The shell.
+ * @param script The script.
+ * @param output The file for stdout.
+ * @param runs The number of runs.
+ * @return The median wall time in seconds, a negative number if a run failed.
+ */
+static double median_run(const char* shell, const char* script, const char* output, int runs)
+{
+    double times[MAX_RUNS];
+    for (int r = 0; r < runs; r++)
+    {
+        times[r] = run_script(shell, script, output);
+        if (times[r] < 0)
+            return -1;
+    }
+    qsort(times, (size_t)runs, sizeof(double), compare_doubles);
+    return times[runs / 2];
+}
+
+/**
+ * @brief Prints the command line help.
+ * @param program The name of the program.
+ */
+static void usage(const char* program)
+{
+    fprintf(stderr, "Uso: %s [-m MiB] [-n repeticiones] [-r corridas] shellter\n", program);
+}
+
+/**
+ * @brief Main function.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @return EXIT_SUCCESS if every script ran successfully.
+ */
+int main(int argc, char* argv[])
+{
+    long mebibytes = 32;
+    long repetitions = 10;
+    int runs = 3;
+    int option;
+
+    while ((option = getopt(argc, argv, "m:n:r:")) != -1)
+    {
+        switch (option)
+        {
+        case 'm':
+            mebibytes = atol(optarg);
+            break;
+        case 'n':
+            repetitions = atol(optarg);
+            break;
+        case 'r':
+            runs = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (argc - optind != 1 || mebibytes < 1 || repetitions < 1 || runs < 1 || runs > MAX_RUNS)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    const char* shell = argv[optind];
+
+    char directory[] = "/tmp/shellter-filter-bench-XXXXXX";
+    if (!mkdtemp(directory))
+    {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+
+    char log[600];
+    char script[600];
+    char output[600];
+    snprintf(log, sizeof(log), "%s/app.log", directory);
+    snprintf(script, sizeof(script), "%s/filters.sh", directory);
+    snprintf(output, sizeof(output), "%s/out.txt", directory);
+    if (write_log(log, mebibytes) != 0)
+    {
+        perror("Error al escribir el log");
+        return EXIT_FAILURE;
+    }
+
+    int status = EXIT_SUCCESS;
+    printf("pipeline\texternal_ms\tbuiltin_ms\tspeedup\n");
+    for (size_t i = 0; i < sizeof(pipelines) / sizeof(pipelines[0]); i++)
+    {
+        char line[1024];
+        snprintf(line, sizeof(line), pipelines[i], log);
+
+        double times[2];
+        const char* headers[2] = {NULL, "set -o builtin-filters"};
+        for (int mode = 0; mode < 2; mode++)
+        {
+            times[mode] = write_script(script, headers[mode], repetitions, line) == 0
+                              ? median_run(shell, script, output, runs)
+                              : -1;
+        }
+
+        char name[256];
+        snprintf(name, sizeof(name), pipelines[i], "app.log");
+        if (times[0] < 0 || times[1] < 0)
+        {
+            fprintf(stderr, "%s: shellter terminó con error\n", name);
+            status = EXIT_FAILURE;
+            continue;
+        }
+        printf("%s\t%.2f\t%.2f\t%.2fx\n", name, times[0] * 1e3 / (double)repetitions,
+               times[1] * 1e3 / (double)repetitions, times[0] / times[1]);
+    }
+
+    unlink(log);
+    unlink(script);
+    unlink(output);
+    rmdir(directory);
+    return status;
+}
@@ -0,0 +1,408 @@
+/**
+ * @file hot_paths_bench.c
+ * @brief Micro-benchmarks of the hot paths of the shell, reported as JSON.
+ * @details Each benchmark runs a warm-up and then timed batches until it reaches a minimum time. A batch times
+ * several operations at once, so the clock overhead is negligible even for operations of a few nanoseconds; the
+ * percentiles are computed over the per-operation time of the batches. malloc(), calloc() and realloc() are wrapped
+ * to count the allocations (and bytes) of each operation. Inputs are fixed, so two runs measure the same work.
+ *
+ * Usage: bench_hot_paths [substring of the benchmark names]
+ */
+#include "manager.h"
+#include <cJSON.h>
+#include <spawn.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief Minimum timed duration of each benchmark in nanoseconds.
+ */
+#define MIN_TIME_NS 300000000ULL
+
+/**
+ * @brief Duration of the warm-up in nanoseconds.
+ */
+#define WARMUP_NS 50000000ULL
+
+/**
+ * @brief Maximum number of timed batches kept for the percentiles.
+ */
+#define MAX_SAMPLES 100000
+
+/**
+ * @brief Target duration of one batch in nanoseconds.
+ */
+#define BATCH_NS 20000ULL
+
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* pointer, size_t size);
+
+/**
+ * @brief Allocations made since the start of the program.
+ */
+static uint64_t allocation_count = 0;
+
+/**
+ * @brief Bytes requested since the start of the program.
+ */
+static uint64_t allocation_bytes = 0;
+
+void* malloc(size_t size)
+{
+    allocation_count++;
+    allocation_bytes += size;
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size)
+{
+    allocation_count++;
+    allocation_bytes += count * size;
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* pointer, size_t size)
+{
+    allocation_count++;
+    allocation_bytes += size;
+    return __libc_realloc(pointer, size);
+}
+
+/**
+ * @brief A benchmark: an operation run with a context prepared once.
+ */
+typedef struct
+{
+    const char* name;         /**< Name in the report. */
+    void (*run)(void* state); /**< One operation. */
+    void* state;              /**< Context of the operation. */
+    bool silent;              /**< The operation writes to stdout, sent to /dev/null while it runs. */
+} benchmark;
+
+/**
+ * @brief Keeps the results alive, so the compiler does not remove the work.
+ */
+static volatile uint64_t sink = 0;
+
+/**
+ * @brief Returns a monotonic timestamp in nanoseconds.
+ * @return The timestamp.
+ */
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Compares two doubles for qsort.
+ */
+static int compare_doubles(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Returns a percentile of sorted samples.
+ * @param samples The samples, sorted.
+ * @param count The number of samples.
+ * @param percentile The percentile, from 0 to 100.
+ * @return The nearest-rank percentile.
+ */
+static double percentile_of(const double* samples, size_t count, double percentile)
+{
+    size_t rank = (size_t)(percentile / 100.0 * (double)count + 0.5);
+    if (rank > 0)
+        rank--;
+    return samples[rank < count ? rank : count - 1];
+}
+
+/**
+ * @brief Runs a benchmark and adds its results to the report.
+ * @param bench The benchmark.
+ * @param report The JSON array of results.
+ */
+static void run_benchmark(const benchmark* bench, cJSON* report)
+{
+    static double samples[MAX_SAMPLES];
+    int saved_stdout = -1;
+
+    if (bench->silent)
+    {
+        fflush(stdout);
+        saved_stdout = dup(STDOUT_FILENO);
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        close(null);
+    }
+
+    // Calentamiento: caches, páginas y ramas antes de medir, y el tamaño del lote
+    uint64_t warmup_operations = 0;
+    uint64_t start = now_ns();
+    while (now_ns() - start < WARMUP_NS)
+    {
+        bench->run(bench->state);
+        warmup_operations++;
+    }
+    uint64_t batch = warmup_operations * BATCH_NS / WARMUP_NS;
+    if (batch == 0)
+        batch = 1;
+
+    size_t count = 0;
+    uint64_t operations = 0;
+    uint64_t total_ns = 0;
+    uint64_t allocations_before = allocation_count;
+    uint64_t bytes_before = allocation_bytes;
+
+    while ((total_ns < MIN_TIME_NS || count < 10) && count < MAX_SAMPLES)
+    {
+        uint64_t batch_start = now_ns();
+        for (uint64_t i = 0; i < batch; i++)
+            bench->run(bench->state);
+        uint64_t elapsed = now_ns() - batch_start;
+
+        samples[count++] = (double)elapsed / (double)batch;
+        operations += batch;
+        total_ns += elapsed;
+    }
+
+    uint64_t allocations = allocation_count - allocations_before;
+    uint64_t bytes = allocation_bytes - bytes_before;
+
+    if (bench->silent)
+    {
+        fflush(stdout);
+        dup2(saved_stdout, STDOUT_FILENO);
+        close(saved_stdout);
+    }
+
+    qsort(samples, count, sizeof(double), compare_doubles);
+
+    cJSON* result = cJSON_CreateObject();
+    cJSON_AddStringToObject(result, "name", bench->name);
+    cJSON_AddNumberToObject(result, "operations", (double)operations);
+    cJSON_AddNumberToObject(result, "batch", (double)batch);
+    cJSON_AddNumberToObject(result, "ns_per_op", (double)total_ns / (double)operations);
+    cJSON_AddNumberToObject(result, "min_ns", samples[0]);
+    cJSON_AddNumberToObject(result, "p50_ns", percentile_of(samples, count, 50));
+    cJSON_AddNumberToObject(result, "p90_ns", percentile_of(samples, count, 90));
+    cJSON_AddNumberToObject(result, "p99_ns", percentile_of(samples, count, 99));
+    cJSON_AddNumberToObject(result, "max_ns", samples[count - 1]);
+    cJSON_AddNumberToObject(result, "allocs_per_op", (double)allocations / (double)operations);
+    cJSON_AddNumberToObject(result, "bytes_per_op", (double)bytes / (double)operations);
+    cJSON_AddItemToArray(report, result);
+
+    fprintf(stderr, "%-28s %12.1f ns/op  p99 %12.1f ns  %6.2f allocs/op\n", bench->name,
+            (double)total_ns / (double)operations, percentile_of(samples, count, 99),
+            (double)allocations / (double)operations);
+}
+
+/**
+ * @brief A command line, copied before every operation because the shell splits it in place.
+ */
+typedef struct
+{
+    const char* line; /**< The command line. */
+    char buffer[256]; /**< Copy modified by the operation. */
+} command_state;
+
+static void bench_tokenizer(void* state)
+{
+    command_state* command = state;
+    char* args[MAX_ARGS];
+    strcpy(command->buffer, command->line);
+    sink += (uint64_t)tokenizer(command->buffer, args);
+}
+
+static void bench_check_flags(void* state)
+{
+    command_state* command = state;
+    bool background, pipes, input, output;
+    strcpy(command->buffer, command->line);
+    check_flags(command->buffer, &background, &pipes, &input, &output);
+    sink += (uint64_t)(background + pipes + input + output);
+}
+
+static void bench_execute_command(void* state)
+{
+    command_state* command = state;
+    strcpy(command->buffer, command->line);
+    execute_command(command->buffer);
+}
+
+static void bench_builtin_find(void* state)
+{
+    sink += (uint64_t)(builtin_find(state) != NULL);
+}
+
+/**
+ * @brief Synthetic samples of the monitor and the settings to filter them.
+ */
+typedef struct
+{
+    cJSON* settings;     /**< Settings, as in settings.json. */
+    cJSON* sample;       /**< A sample with every metric. */
+    cJSON* filtered;     /**< The sample filtered, for imprimir_metricas(). */
+    char* text;          /**< The sample as the monitor writes it. */
+    cJSON_Writer* writer; /**< Reused output buffer. */
+} metrics_state;
+
+static void bench_filtrar_metricas(void* state)
+{
+    metrics_state* metrics = state;
+    cJSON* filtered = filtrar_metricas(metrics->sample, metrics->settings);
+    sink += (uint64_t)(filtered->child != NULL);
+    cJSON_Delete(filtered);
+}
+
+static void bench_imprimir_metricas(void* state)
+{
+    metrics_state* metrics = state;
+    imprimir_metricas(metrics->filtered);
+}
+
+static void bench_cjson_parse(void* state)
+{
+    metrics_state* metrics = state;
+    cJSON* sample = cJSON_Parse(metrics->text);
+    sink += (uint64_t)sample->child->valuedouble;
+    cJSON_Delete(sample);
+}
+
+static void bench_cjson_print_unformatted(void* state)
+{
+    metrics_state* metrics = state;
+    char* text = cJSON_PrintUnformatted(metrics->sample);
+    sink += (uint64_t)text[0];
+    free(text);
+}
+
+static void bench_cjson_writer_print(void* state)
+{
+    metrics_state* metrics = state;
+    const char* text = cJSON_WriterPrint(metrics->writer, metrics->sample, false);
+    sink += (uint64_t)text[0];
+}
+
+/**
+ * @brief Builds a sample with every metric the monitor reports.
+ * @return The sample.
+ */
+static cJSON* create_sample(void)
+{
+    static const char* const names[] = {
+        "cpu_usage_percentage",    "memory_usage_percentage", "disk_reads",           "disk_writes",
+        "disk_read_time_seconds",  "disk_write_time_seconds", "network_bandwidth_rx", "network_bandwidth_tx",
+        "network_packet_ratio",    "running_processes_count", "context_switches_total", "memory_fragmentation",
+        "policy_counter_first",    "policy_counter_best",     "policy_counter_worst"};
+    static const double values[] = {37.25,      61.5,  1843211, 912004, 12.431207, 7.0015, 125829120,
+                                    9437184,    0.982, 412,     88231904, 0.1875, 1204, 998, 31};
+
+    cJSON* sample = cJSON_CreateObject();
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+        cJSON_AddNumberToObject(sample, names[i], values[i]);
+    return sample;
+}
+
+static void bench_fork_exec(void* state)
+{
+    char* const* argv = state;
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    sink += (uint64_t)status;
+}
+
+static void bench_posix_spawn(void* state)
+{
+    char* const* argv = state;
+    extern char** environ;
+    pid_t pid;
+    if (posix_spawnp(&pid, argv[0], NULL, NULL, argv, environ) == 0)
+    {
+        int status;
+        waitpid(pid, &status, 0);
+        sink += (uint64_t)status;
+    }
+}
+
+/**
+ * @brief Main function.
+ * @param argc The number of arguments.
+ * @param argv The arguments: an optional filter of the benchmark names.
+ * @return EXIT_SUCCESS.
+ */
+int main(int argc, char* argv[])
+{
+    const char* filter = argc > 1 ? argv[1] : NULL;
+    commands_init();
+
+    command_state simple = {.line = "ls -la /tmp"};
+    command_state long_line = {.line = "search_config -name *.json *.config -contains cpu_usage -maxdepth 4 /etc"};
+    command_state complex = {.line = "cat settings.json | grep collect > salida.txt &"};
+    command_state echo = {.line = "echo hola mundo desde el benchmark"};
+    command_state cd = {.line = "cd ."};
+
+    metrics_state metrics = {.sample = create_sample(), .writer = cJSON_CreateWriter(0)};
+    metrics.settings = cJSON_Parse("{\"time_interval\":10,\"collect_cpu\":true,\"collect_memory\":true,"
+                                   "\"collect_disk\":true,\"collect_network\":false,\"collect_process\":false,"
+                                   "\"collect_fragmentation\":true}");
+    metrics.filtered = filtrar_metricas(metrics.sample, metrics.settings);
+    metrics.text = cJSON_PrintUnformatted(metrics.sample);
+
+    char* true_argv[] = {"true", NULL};
+
+    const benchmark benchmarks[] = {
+        {"tokenizer/simple", bench_tokenizer, &simple, false},
+        {"tokenizer/long", bench_tokenizer, &long_line, false},
+        {"check_flags/simple", bench_check_flags, &simple, false},
+        {"check_flags/complex", bench_check_flags, &complex, false},
+        {"execute_command/echo", bench_execute_command, &echo, true},
+        {"execute_command/cd", bench_execute_command, &cd, false},
+        {"builtin_find/builtin", bench_builtin_find, "status_monitor", false},
+        {"builtin_find/external", bench_builtin_find, "grep", false},
+        {"filtrar_metricas", bench_filtrar_metricas, &metrics, false},
+        {"imprimir_metricas", bench_imprimir_metricas, &metrics, true},
+        {"cJSON_Parse/sample", bench_cjson_parse, &metrics, false},
+        {"cJSON_PrintUnformatted/sample", bench_cjson_print_unformatted, &metrics, false},
+        {"cJSON_WriterPrint/sample", bench_cjson_writer_print, &metrics, false},
+        {"launch/fork_exec", bench_fork_exec, true_argv, false},
+        {"launch/posix_spawn", bench_posix_spawn, true_argv, false},
+    };
+
+    cJSON* report = cJSON_CreateObject();
+    cJSON* results = cJSON_AddArrayToObject(report, "benchmarks");
+    cJSON_AddNumberToObject(report, "min_time_ns", (double)MIN_TIME_NS);
+
+    for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++)
+    {
+        if (!filter || strstr(benchmarks[i].name, filter))
+            run_benchmark(&benchmarks[i], results);
+    }
+
+    char* text = cJSON_Print(report);
+    printf("%s\n", text);
+
+    free(text);
+    cJSON_Delete(report);
+    cJSON_Delete(metrics.sample);
+    cJSON_Delete(metrics.settings);
+    cJSON_Delete(metrics.filtered);
+    cJSON_DeleteWriter(metrics.writer);
+    free(metrics.text);
+    return EXIT_SUCCESS;
+}
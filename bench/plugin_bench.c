@@ -0,0 +1,216 @@
+/**
+ * @file plugin_bench.c
+ * @brief Benchmark of a command loaded from a plugin against the same command as an external program.
+ * @details shellter runs in batch mode three scripts: one that only loads the sample plugin, one that loads it and
+ * calls its basename N times, and one that calls the basename program N times. The script that only loads the plugin
+ * is the baseline: subtracting it leaves the cost of the calls, start of the shell and dlopen() excluded, so the time
+ * of one invocation is (script - baseline) / N. Every script runs several times and the median is kept.
+ *
+ * Usage: bench_plugin [-n calls] [-r runs] shellter-path plugin-path [program]
+ * The program defaults to basename, found in PATH. The result is a tab separated table on stdout.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief Maximum number of runs of each script.
+ */
+#define MAX_RUNS 15
+
+/**
+ * @brief Returns a monotonic timestamp in nanoseconds.
+ * @return The timestamp.
+ */
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Compares two doubles for qsort.
+ */
+static int compare_doubles(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Writes a script: an optional first line and the same line repeated.
+ * @param path The path of the script.
+ * @param header The first line, NULL for none.
+ * @param count The number of repeated lines.
+ * @param line The repeated line.
+ * @return 0 on success, -1 on error.
+ */
+static int write_script(const char* path, const char* header, long count, const char* line)
+{
+    FILE* file = fopen(path, "w");
+    if (!file)
+        return -1;
+    if (header)
+        fprintf(file, "%s\n", header);
+    for (long i = 0; i < count; i++)
+        fprintf(file, "%s\n", line);
+    return fclose(file);
+}
+
+/**
+ * @brief Runs a script with shellter, stdout sent to /dev/null.
+ * @param shell The shell.
+ * @param script The script.
+ * @return The wall time in seconds, a negative number if the shell failed.
+ */
+static double run_script(const char* shell, const char* script)
+{
+    uint64_t start = now_ns();
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        int null = open("/dev/null", O_RDWR);
+        if (null < 0)
+            _exit(127);
+        dup2(null, STDIN_FILENO);
+        dup2(null, STDOUT_FILENO);
+        close(null);
+        execl(shell, shell, script, (char*)NULL);
+        _exit(127);
+    }
+    if (pid < 0)
+        return -1;
+
+    int status;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+        ;
+
+    double seconds = (double)(now_ns() - start) / 1e9;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? seconds : -1;
+}
+
+/**
+ * @brief Runs a script several times.
+ * @param shell The shell.
+ * @param script The script.
+ * @param runs The number of runs.
+ * @return The median wall time in seconds, a negative number if a run failed.
+ */
+static double median_run(const char* shell, const char* script, int runs)
+{
+    double times[MAX_RUNS];
+    for (int r = 0; r < runs; r++)
+    {
+        times[r] = run_script(shell, script);
+        if (times[r] < 0)
+            return -1;
+    }
+    qsort(times, (size_t)runs, sizeof(double), compare_doubles);
+    return times[runs / 2];
+}
+
+/**
+ * @brief Prints the command line help.
+ * @param program The name of the program.
+ */
+static void usage(const char* program)
+{
+    fprintf(stderr, "Uso: %s [-n llamadas] [-r corridas] shellter plugin [programa]\n", program);
+}
+
+/**
+ * @brief Main function.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @return EXIT_SUCCESS if every script ran successfully.
+ */
+int main(int argc, char* argv[])
+{
+    long calls = 2000;
+    int runs = 5;
+    int option;
+
+    while ((option = getopt(argc, argv, "n:r:")) != -1)
+    {
+        switch (option)
+        {
+        case 'n':
+            calls = atol(optarg);
+            break;
+        case 'r':
+            runs = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (argc - optind < 2 || argc - optind > 3 || calls < 1 || runs < 1 || runs > MAX_RUNS)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    const char* shell = argv[optind];
+    const char* plugin = argv[optind + 1];
+    const char* program = argc - optind == 3 ? argv[optind + 2] : "basename";
+
+    char directory[] = "/tmp/shellter-plugin-bench-XXXXXX";
+    if (!mkdtemp(directory))
+    {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+
+    char baseline[600];
+    char loaded[600];
+    char external[600];
+    char enable[1024];
+    char line[1024];
+    snprintf(baseline, sizeof(baseline), "%s/baseline.sh", directory);
+    snprintf(loaded, sizeof(loaded), "%s/plugin.sh", directory);
+    snprintf(external, sizeof(external), "%s/external.sh", directory);
+    snprintf(enable, sizeof(enable), "enable -f %s basename", plugin);
+
+    // El programa por su ruta: la búsqueda en el PATH no es lo que se mide
+    int failed = write_script(baseline, enable, 0, "");
+    failed |= write_script(loaded, enable, calls, "basename /usr/lib/libshellter.so .so");
+    snprintf(line, sizeof(line), "%s /usr/lib/libshellter.so .so", program);
+    failed |= write_script(external, enable, calls, line);
+    if (failed)
+    {
+        perror("Error al escribir los scripts");
+        return EXIT_FAILURE;
+    }
+
+    double base = median_run(shell, baseline, runs);
+    double times[2] = {median_run(shell, loaded, runs), median_run(shell, external, runs)};
+    const char* names[2] = {"plugin", "external"};
+
+    int status = EXIT_SUCCESS;
+    printf("mode\tcalls\tseconds\tus_per_call\n");
+    for (int i = 0; i < 2; i++)
+    {
+        if (base < 0 || times[i] < 0)
+        {
+            fprintf(stderr, "%s: shellter terminó con error\n", names[i]);
+            status = EXIT_FAILURE;
+            continue;
+        }
+        printf("%s\t%ld\t%.4f\t%.2f\n", names[i], calls, times[i], (times[i] - base) * 1e6 / (double)calls);
+    }
+
+    unlink(baseline);
+    unlink(loaded);
+    unlink(external);
+    rmdir(directory);
+    return status;
+}
@@ -0,0 +1,441 @@
+/**
+ * @file shells_bench.c
+ * @brief End-to-end benchmark of shellter against bash and dash.
+ * @details The same workload scripts, written in the syntax the three shells share, are run in batch mode by every
+ * shell: builtin calls, external command launches, a multi-stage pipeline moving a large stream, a redirection
+ * heavy script and a fan-out of background commands. Each run is timed from the outside and reaped with wait4()
+ * for its peak RSS (the largest of the shell and its children). The external launches run this same program with
+ * --stamp, which prints the time it started: the difference between consecutive stamps is the latency of one
+ * launch, from the start of a command to the start of the next one.
+ *
+ * Usage: bench_shells [-n commands] [-m MiB] [-r runs] shellter-path [other shells...]
+ * The result is a tab separated table on stdout, one row per shell and workload.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief Size of the blocks written by --source and read by --sink.
+ */
+#define BLOCK_SIZE (128 * 1024)
+
+/**
+ * @brief Maximum number of runs of each workload.
+ */
+#define MAX_RUNS 15
+
+/**
+ * @brief Result of one workload.
+ */
+typedef struct
+{
+    double seconds;      /**< Wall time of the run. */
+    long peak_rss_kb;    /**< Peak RSS of the shell and its children. */
+    double launch_p50;   /**< Median launch latency in microseconds, 0 if not measured. */
+    double launch_p99;   /**< 99th percentile of the launch latency in microseconds, 0 if not measured. */
+    int status;          /**< Exit status of the shell. */
+} run_result;
+
+/**
+ * @brief Returns a monotonic timestamp in nanoseconds.
+ * @return The timestamp.
+ */
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief --stamp: prints the time the process started, in nanoseconds.
+ * @return EXIT_SUCCESS.
+ */
+static int stamp(void)
+{
+    char line[32];
+    int length = snprintf(line, sizeof(line), "%llu\n", (unsigned long long)now_ns());
+    ssize_t written = write(STDOUT_FILENO, line, (size_t)length);
+    return written == length ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief --source: writes a number of MiB to stdout.
+ * @param mib The number of MiB.
+ * @return EXIT_SUCCESS if everything was written.
+ */
+static int source(long mib)
+{
+    static char block[BLOCK_SIZE];
+    memset(block, 'x', sizeof(block));
+
+    long long left = (long long)mib * 1024 * 1024;
+    while (left > 0)
+    {
+        size_t size = left < BLOCK_SIZE ? (size_t)left : BLOCK_SIZE;
+        ssize_t written = write(STDOUT_FILENO, block, size);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return EXIT_FAILURE;
+        left -= written;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief --sink: reads stdin until the end and checks the number of MiB.
+ * @param mib The number of MiB expected.
+ * @return EXIT_SUCCESS if the stream had the expected size.
+ */
+static int sink(long mib)
+{
+    static char block[BLOCK_SIZE];
+    long long total = 0;
+    ssize_t bytes;
+
+    while ((bytes = read(STDIN_FILENO, block, sizeof(block))) != 0)
+    {
+        if (bytes < 0 && errno == EINTR)
+            continue;
+        if (bytes < 0)
+            return EXIT_FAILURE;
+        total += bytes;
+    }
+    return total == (long long)mib * 1024 * 1024 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Compares two doubles for qsort.
+ */
+static int compare_doubles(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Reads the stamps written by a run and computes the launch latency percentiles.
+ * @param path The file with the stamps.
+ * @param result Output: launch_p50 and launch_p99.
+ */
+static void launch_latency(const char* path, run_result* result)
+{
+    FILE* file = fopen(path, "r");
+    if (!file)
+        return;
+
+    size_t capacity = 1024;
+    size_t count = 0;
+    double* deltas = malloc(capacity * sizeof(double));
+    unsigned long long previous = 0;
+    unsigned long long stamp_ns;
+
+    while (deltas && fscanf(file, "%llu", &stamp_ns) == 1)
+    {
+        if (previous != 0)
+        {
+            if (count == capacity)
+            {
+                capacity *= 2;
+                double* grown = realloc(deltas, capacity * sizeof(double));
+                if (!grown)
+                    break;
+                deltas = grown;
+            }
+            deltas[count++] = (double)(stamp_ns - previous) / 1000.0;
+        }
+        previous = stamp_ns;
+    }
+    fclose(file);
+
+    if (count > 0)
+    {
+        qsort(deltas, count, sizeof(double), compare_doubles);
+        result->launch_p50 = deltas[count / 2];
+        size_t rank = (size_t)((double)count * 0.99);
+        result->launch_p99 = deltas[rank < count ? rank : count - 1];
+    }
+    free(deltas);
+}
+
+/**
+ * @brief Runs a script with a shell, stdout sent to a file.
+ * @param shell The shell.
+ * @param script The script.
+ * @param output The file for stdout.
+ * @return The result of the run.
+ */
+static run_result run_script(const char* shell, const char* script, const char* output)
+{
+    run_result result = {0};
+    uint64_t start = now_ns();
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        int fd = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        int null = open("/dev/null", O_RDONLY);
+        if (fd < 0 || null < 0)
+            _exit(127);
+        dup2(fd, STDOUT_FILENO);
+        dup2(null, STDIN_FILENO);
+        close(fd);
+        close(null);
+        execlp(shell, shell, script, (char*)NULL);
+        _exit(127);
+    }
+    if (pid < 0)
+    {
+        result.status = -1;
+        return result;
+    }
+
+    int status;
+    struct rusage usage;
+    while (wait4(pid, &status, 0, &usage) < 0 && errno == EINTR)
+        ;
+
+    result.seconds = (double)(now_ns() - start) / 1e9;
+    result.peak_rss_kb = usage.ru_maxrss;
+    result.status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    return result;
+}
+
+/**
+ * @brief Compares two runs by wall time for qsort.
+ */
+static int compare_runs(const void* a, const void* b)
+{
+    return compare_doubles(&((const run_result*)a)->seconds, &((const run_result*)b)->seconds);
+}
+
+/**
+ * @brief A workload: a script and how to read its result.
+ */
+typedef struct
+{
+    const char* name;   /**< Name in the table. */
+    char path[512];     /**< Path of the script. */
+    long commands;      /**< Number of commands of the script. */
+    long mib;           /**< MiB moved through the pipeline, 0 if not a pipeline. */
+    bool stamps;        /**< The output holds the stamps of the launches. */
+} workload;
+
+/**
+ * @brief Writes a script: the same line repeated.
+ * @param path The path of the script.
+ * @param count The number of lines.
+ * @param first The line, or the even lines if second is not NULL.
+ * @param second The odd lines, NULL to repeat first.
+ * @return 0 on success, -1 on error.
+ */
+static int write_script(const char* path, long count, const char* first, const char* second)
+{
+    FILE* file = fopen(path, "w");
+    if (!file)
+        return -1;
+    for (long i = 0; i < count; i++)
+        fprintf(file, "%s\n", second && i % 2 ? second : first);
+    return fclose(file);
+}
+
+/**
+ * @brief Tells whether a shell can be run: a path to an executable or a name found in PATH.
+ * @param shell The shell.
+ * @return true if it can be run.
+ */
+static bool shell_exists(const char* shell)
+{
+    if (strchr(shell, '/'))
+        return access(shell, X_OK) == 0;
+
+    const char* path = getenv("PATH");
+    char candidate[1024];
+    while (path && *path)
+    {
+        size_t length = strcspn(path, ":");
+        snprintf(candidate, sizeof(candidate), "%.*s/%s", (int)length, path, shell);
+        if (access(candidate, X_OK) == 0)
+            return true;
+        path += length + (path[length] == ':');
+    }
+    return false;
+}
+
+/**
+ * @brief Prints the command line help.
+ * @param program The name of the program.
+ */
+static void usage(const char* program)
+{
+    fprintf(stderr, "Uso: %s [-n comandos] [-m MiB] [-r corridas] shellter [otras shells...]\n", program);
+}
+
+/**
+ * @brief Main function.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @return EXIT_SUCCESS if every shell ran every workload successfully.
+ */
+int main(int argc, char* argv[])
+{
+    if (argc == 2 && strcmp(argv[1], "--stamp") == 0)
+        return stamp();
+    if (argc == 3 && strcmp(argv[1], "--source") == 0)
+        return source(atol(argv[2]));
+    if (argc == 3 && strcmp(argv[1], "--sink") == 0)
+        return sink(atol(argv[2]));
+
+    long commands = 2000;
+    long mib = 1024;
+    int runs = 3;
+    int option;
+
+    while ((option = getopt(argc, argv, "n:m:r:")) != -1)
+    {
+        switch (option)
+        {
+        case 'n':
+            commands = atol(optarg);
+            break;
+        case 'm':
+            mib = atol(optarg);
+            break;
+        case 'r':
+            runs = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (optind >= argc || commands < 2 || mib < 1 || runs < 1 || runs > MAX_RUNS)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Los scripts llaman a este mismo programa por su ruta absoluta
+    char self[512];
+    ssize_t length = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (length <= 0)
+    {
+        perror("readlink");
+        return EXIT_FAILURE;
+    }
+    self[length] = '\0';
+
+    char directory[] = "/tmp/shellter-bench-XXXXXX";
+    if (!mkdtemp(directory))
+    {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+
+    char line[1536];
+    char second[1536];
+    char output[600];
+    snprintf(output, sizeof(output), "%s/output.txt", directory);
+
+    workload workloads[] = {
+        {"builtins", "", commands, 0, false},
+        {"launches", "", commands, 0, true},
+        {"pipeline", "", 4, mib, false},
+        {"redirections", "", commands, 0, false},
+        {"fan_out", "", commands, 0, false},
+    };
+    size_t workload_count = sizeof(workloads) / sizeof(workloads[0]);
+
+    // Solo la sintaxis que las tres shells comparten: palabras separadas por un espacio, |, <, > y &
+    int failed = 0;
+    for (size_t i = 0; i < workload_count; i++)
+        snprintf(workloads[i].path, sizeof(workloads[i].path), "%s/%s.sh", directory, workloads[i].name);
+
+    failed |= write_script(workloads[0].path, commands, "echo hola mundo", "cd .");
+    snprintf(line, sizeof(line), "%s --stamp", self);
+    failed |= write_script(workloads[1].path, commands, line, NULL);
+    snprintf(line, sizeof(line), "%s --source %ld | cat | cat | %s --sink %ld", self, mib, self, mib);
+    failed |= write_script(workloads[2].path, 1, line, NULL);
+    snprintf(line, sizeof(line), "/bin/echo linea > %s/redirect.txt", directory);
+    snprintf(second, sizeof(second), "/bin/cat < %s/redirect.txt > %s/copy.txt", directory, directory);
+    failed |= write_script(workloads[3].path, commands, line, second);
+    failed |= write_script(workloads[4].path, commands, "/bin/true &", NULL);
+    if (failed)
+    {
+        perror("Error al escribir los scripts");
+        return EXIT_FAILURE;
+    }
+
+    printf("shell\tworkload\tcommands\tseconds\tcommands_per_s\tmib_per_s\tlaunch_p50_us\tlaunch_p99_us\t"
+           "peak_rss_kb\n");
+
+    int status = EXIT_SUCCESS;
+    for (int s = optind; s < argc; s++)
+    {
+        const char* shell = argv[s];
+        const char* name = strrchr(shell, '/') ? strrchr(shell, '/') + 1 : shell;
+        if (!shell_exists(shell))
+        {
+            fprintf(stderr, "%s: no está instalada, se omite\n", shell);
+            continue;
+        }
+
+        for (size_t w = 0; w < workload_count; w++)
+        {
+            run_result results[MAX_RUNS];
+            bool ok = true;
+
+            for (int r = 0; r < runs; r++)
+            {
+                results[r] = run_script(shell, workloads[w].path, output);
+                if (workloads[w].stamps)
+                    launch_latency(output, &results[r]);
+                ok = ok && results[r].status == 0;
+            }
+
+            // La corrida mediana por tiempo
+            qsort(results, (size_t)runs, sizeof(run_result), compare_runs);
+            run_result* median = &results[runs / 2];
+
+            if (!ok)
+            {
+                fprintf(stderr, "%s: %s terminó con error (%d)\n", name, workloads[w].name, median->status);
+                status = EXIT_FAILURE;
+            }
+
+            printf("%s\t%s\t%ld\t%.4f\t", name, workloads[w].name, workloads[w].commands, median->seconds);
+            if (workloads[w].mib > 0)
+                printf("-\t%.1f\t", (double)workloads[w].mib / median->seconds);
+            else
+                printf("%.0f\t-\t", (double)workloads[w].commands / median->seconds);
+            if (workloads[w].stamps)
+                printf("%.1f\t%.1f\t", median->launch_p50, median->launch_p99);
+            else
+                printf("-\t-\t");
+            printf("%ld\n", median->peak_rss_kb);
+            fflush(stdout);
+        }
+    }
+
+    for (size_t i = 0; i < workload_count; i++)
+        unlink(workloads[i].path);
+    snprintf(line, sizeof(line), "%s/redirect.txt", directory);
+    unlink(line);
+    snprintf(line, sizeof(line), "%s/copy.txt", directory);
+    unlink(line);
+    unlink(output);
+    rmdir(directory);
+
+    return status;
+}
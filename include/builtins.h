@@ -0,0 +1,96 @@
+/**
+ * @file builtins.h
+ * @brief This file contains the declaration of the registry of the internal commands.
+ * @details Every subsystem registers its own commands (the core ones in commands.c, jobs, monitor, config index,
+ * stats) with a name, a handler and flags. The names are found with a perfect hash built from the registered set: a
+ * first hash picks a bucket, the displacement of the bucket gives a slot that holds only that name, so a lookup is one
+ * pass over the name and one strcmp(), for a builtin and for an external command alike. The table is rebuilt on the
+ * first lookup after a registration.
+ */
+#ifndef BUILTINS_H
+#define BUILTINS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Flags of an internal command.
+ */
+typedef enum
+{
+    BUILTIN_PARENT = 1 << 0,   /**< Changes the shell itself (cd, quit, fg): in a child it would have no effect. */
+    BUILTIN_PIPELINE = 1 << 1, /**< Safe in a pipeline: it can run on a thread of the shell with run_fd(). */
+    BUILTIN_INPUT = 1 << 2     /**< Reads its input: as a first stage it keeps its process, for the terminal. */
+} builtin_flag;
+
+struct builtin_command;
+
+/**
+ * @brief Handler of a command on a pipeline thread: its entry of the registry, its arguments and its descriptors.
+ */
+typedef int (*builtin_fd_handler)(const struct builtin_command* self, int argc, char* args[], int input, int output);
+
+/**
+ * @brief An internal command.
+ * @note pipeline_safe and data can be NULL: any arguments are safe in a pipeline, the handler has no data.
+ */
+typedef struct builtin_command
+{
+    const char* name;                              /**< Name of the command. */
+    const char* usage;                             /**< Arguments, for help, "" for none. */
+    const char* summary;                           /**< One line description, for help. */
+    unsigned flags;                                /**< builtin_flag values. */
+    int (*run)(int argc, char* args[]);            /**< Runs the command, returns its exit status. */
+    builtin_fd_handler run_fd;                     /**< With BUILTIN_PIPELINE, runs it on a thread. */
+    bool (*pipeline_safe)(int argc, char* args[]); /**< With BUILTIN_PIPELINE, checks the arguments. */
+    const void* data;                              /**< Data of the handler (a plugin command). */
+} builtin_command;
+
+/**
+ * @brief This function registers internal commands.
+ * @param commands The commands, they must live for the whole run.
+ * @param count The number of commands.
+ * @return 0 on success, -1 if a name is already registered or memory runs out (already reported, the commands before
+ * it stay registered).
+ */
+int builtin_register(const builtin_command* commands, size_t count);
+
+/**
+ * @brief This function removes internal commands registered with builtin_register().
+ * @param commands The commands.
+ * @param count The number of commands.
+ * @note The commands must still live: a thread of a stopped pipeline may be running one.
+ */
+void builtin_unregister(const builtin_command* commands, size_t count);
+
+/**
+ * @brief This function finds an internal command.
+ * @param name The name of the command.
+ * @return The command, NULL if it is not an internal one.
+ */
+const builtin_command* builtin_find(const char* name);
+
+/**
+ * @brief This function returns every internal command, sorted by name.
+ * @param count Where to store the number of commands.
+ * @return The commands, valid until the next registration or removal.
+ */
+const builtin_command* const* builtin_all(size_t* count);
+
+/**
+ * @brief This function implements the type command: it tells what every name runs.
+ * @param argc The number of arguments.
+ * @param args The arguments: the names.
+ * @return 0 if every name was found, 1 otherwise.
+ */
+int builtin_type(int argc, char* args[]);
+
+/**
+ * @brief This function implements the help command: it lists the internal commands or shows the usage of some.
+ * @param argc The number of arguments.
+ * @param args The arguments: the commands, none for the list.
+ * @return 0 if every command exists, 1 otherwise.
+ */
+int builtin_help(int argc, char* args[]);
+
+#endif
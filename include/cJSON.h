@@ -157,6 +157,11 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithLength(const char *value, size_t buffer_len
 /* If you supply a ptr in return_parse_end and parsing fails, then return_parse_end will contain a pointer to the error so will match cJSON_GetErrorPtr(). */
 CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated);
 CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated);
+/* In-situ parsing: strings and object keys are decoded in place inside the caller's mutable buffer instead of being allocated.
+ * String values are flagged cJSON_IsReference and keys cJSON_StringIsConst, so cJSON_Delete doesn't free them.
+ * The buffer is modified and must outlive the returned tree (and any duplicate made from it). */
+CJSON_PUBLIC(cJSON *) cJSON_ParseInSitu(char *value, size_t buffer_length);
+CJSON_PUBLIC(cJSON *) cJSON_ParseInSituWithOpts(char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated);
 
 /* Render a cJSON entity to text for transfer/storage. */
 CJSON_PUBLIC(char *) cJSON_Print(const cJSON *item);
@@ -167,6 +172,24 @@ CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON
 /* Render a cJSON entity to text using a buffer already allocated in memory with given length. Returns 1 on success and 0 on failure. */
 /* NOTE: cJSON is not always 100% accurate in estimating how much memory it will use, so to be safe allocate 5 bytes more than you actually need */
 CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buffer, const int length, const cJSON_bool format);
+
+/* Reusable output buffer for repeated serialization. The writer keeps its buffer between calls and only grows it
+ * (geometrically) when a document doesn't fit, so printing many documents doesn't allocate once the buffer is warm. */
+typedef struct cJSON_Writer cJSON_Writer;
+/* Create a writer with an initial capacity guess (0 picks a default). Free it with cJSON_DeleteWriter. */
+CJSON_PUBLIC(cJSON_Writer *) cJSON_CreateWriter(size_t initial_size);
+CJSON_PUBLIC(void) cJSON_DeleteWriter(cJSON_Writer *writer);
+/* Replace the contents of the writer with the rendered item. The returned string belongs to the writer and is valid until the next call. */
+CJSON_PUBLIC(const char *) cJSON_WriterPrint(cJSON_Writer *writer, const cJSON *item, cJSON_bool format);
+/* Append the rendered item followed by a newline (one NDJSON record). Returns the whole buffer or NULL on failure. */
+CJSON_PUBLIC(const char *) cJSON_WriterAppend(cJSON_Writer *writer, const cJSON *item, cJSON_bool format);
+/* Access the current contents of the writer. */
+CJSON_PUBLIC(const char *) cJSON_WriterGetBuffer(const cJSON_Writer *writer);
+CJSON_PUBLIC(size_t) cJSON_WriterGetLength(const cJSON_Writer *writer);
+/* Empty the writer but keep its buffer. */
+CJSON_PUBLIC(void) cJSON_WriterReset(cJSON_Writer *writer);
+/* Write the contents of the writer to a file descriptor and empty it. Returns 1 on success and 0 on failure. */
+CJSON_PUBLIC(cJSON_bool) cJSON_WriterFlush(cJSON_Writer *writer, int fd);
 /* Delete a cJSON entity and all subentities. */
 CJSON_PUBLIC(void) cJSON_Delete(cJSON *item);
 
@@ -0,0 +1,61 @@
+/**
+ * @file cbor.h
+ * @brief This file contains the declaration of the CBOR (RFC 8949) codec for cJSON trees.
+ * @details Metric frames can be sent either as JSON text or as CBOR. CBOR frames are smaller and avoid number
+ * parsing and string allocation; cbor_decode_record() reads the numeric fields of a frame without building a tree.
+ */
+#ifndef CBOR_H
+#define CBOR_H
+
+#include <cJSON.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief A numeric field extracted by cbor_decode_record().
+ */
+typedef struct
+{
+    const char* name; /**< Key of the field in the top-level map. */
+    double value;     /**< Value of the field, valid if present (0 or 1 for a boolean). */
+    bool boolean;     /**< Whether the value is a boolean, so it can be rebuilt as true or false. */
+    bool present;     /**< Whether the field was found in the frame. */
+} cbor_field;
+
+/**
+ * @brief This function encodes a cJSON tree as CBOR.
+ * @param item The tree to encode.
+ * @param length Output, the length of the encoded data.
+ * @return The encoded data (free it with free()), NULL on error.
+ * @note Integral numbers use the shortest integer encoding, other numbers a float or a double if no precision is lost.
+ */
+unsigned char* cbor_encode(const cJSON* item, size_t* length);
+
+/**
+ * @brief This function decodes a CBOR data item into a cJSON tree.
+ * @param data The encoded data.
+ * @param length The length of the data.
+ * @param consumed Output, the number of bytes used by the item (can be NULL).
+ * @return The decoded tree (free it with cJSON_Delete()), NULL if the data is invalid or can't be represented.
+ */
+cJSON* cbor_decode(const unsigned char* data, size_t length, size_t* consumed);
+
+/**
+ * @brief This function reads numeric fields from a CBOR map without building a tree.
+ * @param data The encoded data.
+ * @param length The length of the data.
+ * @param fields The fields to extract, present is updated for all of them.
+ * @param count The number of fields.
+ * @return true on success, false if the data isn't a map or a requested field isn't a number or boolean.
+ */
+bool cbor_decode_record(const unsigned char* data, size_t length, cbor_field* fields, size_t count);
+
+/**
+ * @brief This function tells whether a frame is CBOR (a map, optionally tagged as self-described CBOR).
+ * @param data The frame.
+ * @param length The length of the frame.
+ * @return true if the frame is CBOR, false if it should be parsed as JSON text.
+ */
+bool cbor_is_frame(const unsigned char* data, size_t length);
+
+#endif
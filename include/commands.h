@@ -2,9 +2,25 @@
  * @file commands.h
  * @brief This file contains the declarations of the functions that handle the commands.
  */
+#include "builtins.h"
+#include "config_index.h"
+#include "filters.h"
+#include "jobs.h"
 #include "monitor.h"
+#include "plugins.h"
+#include "prompt.h"
+#include "reader.h"
+#include "search.h"
+#include "stats.h"
+#include "trace.h"
 #include <dirent.h>
 
+/**
+ * @brief This function registers the internal commands: the ones of the shell and the ones of every subsystem.
+ * @note Must be called once, before the first command.
+ */
+void commands_init(void);
+
 /**
  * @brief This function executes the internal commands.
  * @param argc The number of arguments.
@@ -13,6 +29,36 @@
  */
 void internal_commands(int argc, char* args[], bool background);
 
+/**
+ * @brief This function tells whether a command is an internal one.
+ * @param name The name of the command.
+ * @return true if internal_commands() runs it without starting a program.
+ */
+bool is_builtin(const char* name);
+
+/**
+ * @brief This function tells whether an internal command can run on a thread of the shell.
+ * @param argc The number of arguments.
+ * @param args The arguments of the command.
+ * @param shell_input true if the stage would read the standard input of the shell.
+ * @return The command, for stage_start(), if it is registered with BUILTIN_PIPELINE and its arguments are safe there
+ * (echo, read_file without --follow and --json, the filters); NULL otherwise, and for a command that reads its input
+ * when that input is the shell's.
+ */
+const builtin_command* builtin_threadable(int argc, char* args[], bool shell_input);
+
+/**
+ * @brief This function returns the exit status of the last command.
+ * @return The exit status of the last external command, 0 after an internal one.
+ */
+int last_command_status(void);
+
+/**
+ * @brief This function sets the exit status of the last command.
+ * @param status The exit status, 128 + signal if the command was killed or stopped.
+ */
+void set_command_status(int status);
+
 /**
  * @brief This function changes the directory.
  * @param path The path to change to.
@@ -44,12 +90,14 @@ void list_configuration_files(char* directory);
 
 /**
  * @brief This function searches recursively for the configuration files in the directory.
- * @param directory The directory to search the configuration files.
+ * @param argc The number of arguments.
+ * @param args The arguments of the command: options and the directory to search the configuration files.
  */
-void search_config_files_recursively(char* directory);
+void search_config_files_recursively(int argc, char* args[]);
 
 /**
  * @brief This function reads the content of the file.
- * @param filepath The path to the file.
+ * @param argc The number of arguments.
+ * @param args The arguments of the command: options and the path to the file.
  */
-void read_file_content(char* filepath);
+void read_file_content(int argc, char* args[]);
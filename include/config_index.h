@@ -0,0 +1,41 @@
+/**
+ * @file config_index.h
+ * @brief This file contains the declaration of the persistent index of configuration files.
+ * @details The index lists every ".config" and ".json" file under a directory (path, size, mtime, inode) in a
+ * compact file that is mapped with mmap(). A refresh only reads the directories whose mtime changed since the
+ * index was written; the other directories are just stat'ed. An optional inotify watcher keeps the index up to date
+ * in the background, so a search is a read of the mapped index.
+ */
+#ifndef CONFIG_INDEX_H
+#define CONFIG_INDEX_H
+
+#include <stdbool.h>
+
+/**
+ * @brief This function refreshes the index of a directory and prints the configuration files it contains.
+ * @param directory The directory.
+ * @param recursive true to print the whole tree (search_config), false for the directory itself (list_config).
+ * @return The number of files printed, -1 on error.
+ * @note The index is kept in $XDG_CACHE_HOME/shellter (or ~/.cache/shellter).
+ */
+long config_index_search(const char* directory, bool recursive);
+
+/**
+ * @brief This function starts a background watcher that keeps the index of a directory up to date.
+ * @param directory The directory.
+ * @return 0 on success, -1 on error.
+ * @note Only one directory is watched at a time, watching another one stops the previous watcher.
+ */
+int config_index_watch(const char* directory);
+
+/**
+ * @brief This function stops the background watcher, if any.
+ */
+void config_index_unwatch(void);
+
+/**
+ * @brief This function registers the watch_config command.
+ */
+void config_index_register_builtins(void);
+
+#endif
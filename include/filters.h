@@ -0,0 +1,40 @@
+/**
+ * @file filters.h
+ * @brief This file contains the declaration of the text filters of the shell: grep, wc, head and tail.
+ * @details With the builtin-filters option ("set -o builtin-filters") the four names are internal commands instead of
+ * programs. The input is read in large blocks and is not cut into lines: grep looks for the pattern in the whole block
+ * with memmem(), and a regular expression only runs regexec() on the lines that contain its longest required text, so
+ * only the limits of the lines that match are found; wc -l counts the newlines of the block eight bytes at a time in a
+ * 64-bit word, head stops reading as soon as it has its lines and tail reads a regular file from the end. Consecutive
+ * filters of a pipeline ("grep x | wc -l") are joined into one stage that passes the lines from one filter to the next
+ * in memory, without pipes, and runs on a thread of the shell when its output goes to another stage.
+ */
+#ifndef FILTERS_H
+#define FILTERS_H
+
+#include <stdbool.h>
+
+/**
+ * @brief This function tells whether the filters replace the programs.
+ * @return true if grep, wc, head and tail are internal commands.
+ */
+bool filters_enabled(void);
+
+/**
+ * @brief This function turns the builtin-filters option on or off.
+ * @param enable true to register grep, wc, head and tail as internal commands, false to run the programs again.
+ * @return 0 on success, -1 if a name is already taken by another internal command (already reported).
+ */
+int filters_enable(bool enable);
+
+/**
+ * @brief This function tells whether a stage of a pipeline is a filter that can be joined to the previous one.
+ * @param argc The number of arguments.
+ * @param args The arguments of the stage.
+ * @param first true for the first filter of the group: it may read files, the next ones only read the lines of the
+ * previous filter.
+ * @return true if the option is on, the command is a filter and its arguments are valid.
+ */
+bool filters_joinable(int argc, char* args[], bool first);
+
+#endif
@@ -0,0 +1,118 @@
+/**
+ * @file jobs.h
+ * @brief This file contains the declaration of the job control.
+ * @details On a terminal the shell runs in its own process group and every job (a command or a whole pipeline) gets
+ * a new one. The foreground job owns the terminal (tcsetpgrp()) while it runs, so the terminal sends Ctrl+C, Ctrl+Z
+ * and Ctrl+\ to every process of the job and never to the shell. Without a terminal (batch files) there is no job
+ * control: the children stay in the group of the shell and are just waited for.
+ */
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <time.h>
+
+/**
+ * @brief Resource usage of a process of a foreground job, reported by wait4() when it ends.
+ */
+typedef struct
+{
+    size_t stage;         /**< Position of the process in the job (stage of the pipeline). */
+    int status;           /**< Exit status, 128 + signal if it was killed. */
+    struct timespec end;  /**< When it was collected (CLOCK_MONOTONIC). */
+    struct rusage usage;  /**< Usage of the process and of the children it waited for. */
+} job_usage;
+
+/**
+ * @brief This function takes the terminal for the shell, if stdin is one.
+ * @note Must be called once, before the first job is started.
+ */
+void jobs_init(void);
+
+/**
+ * @brief This function tells whether the shell does job control.
+ * @return true on an interactive terminal, false in batch mode and in the children of the shell.
+ */
+bool jobs_interactive(void);
+
+/**
+ * @brief This function prepares a child of the shell, right after fork().
+ * @param pgid Process group to join, 0 to start a new one.
+ * @param foreground true to give the terminal to the group.
+ * @note It restores the signals the shell ignores or blocks, so the program run by the child gets the defaults.
+ */
+void job_child_setup(pid_t pgid, bool foreground);
+
+/**
+ * @brief This function moves a new child to its process group from the shell, right after fork().
+ * @param pid The child.
+ * @param pgid Process group to join, 0 to start a new one.
+ * @note The child does the same: whichever runs first, the group exists before the terminal is handed over.
+ */
+void job_parent_setup(pid_t pid, pid_t pgid);
+
+/**
+ * @brief This function registers a job.
+ * @param pgid Process group of the job (the first process).
+ * @param pids Processes of the job.
+ * @param count Number of processes.
+ * @param words Words of the command line, NULL terminated, for the job list.
+ * @param separator Separator of the words (" " for the arguments, " | " for the stages of a pipeline).
+ * @return The job number, -1 if there is no memory (the processes are killed and waited for).
+ */
+int jobs_add(pid_t pgid, const pid_t* pids, size_t count, char* const words[], const char* separator);
+
+/**
+ * @brief This function runs a job in the foreground until it finishes or is stopped.
+ * @param job The job number.
+ * @param resume true to send SIGCONT first (fg).
+ * @return The exit status of the last process, 128 + signal if it was killed or stopped.
+ */
+int jobs_foreground(int job, bool resume);
+
+/**
+ * @brief This function tells whether a job is still in the table.
+ * @param job The job number.
+ * @return true if it runs in the background or was stopped, false once it finished.
+ */
+bool jobs_exists(int job);
+
+/**
+ * @brief This function asks jobs_foreground() to record the usage of the processes that end while it waits.
+ * @param usages Where to store them, NULL to stop recording.
+ * @param capacity Number of entries of usages.
+ * @param count Number of entries stored, it must be 0 at the start.
+ * @note The processes that end past the capacity are not recorded.
+ */
+void jobs_record_usage(job_usage* usages, size_t capacity, size_t* count);
+
+/**
+ * @brief This function lets a job run in the background.
+ * @param job The job number.
+ * @param resume true to send SIGCONT first (bg).
+ */
+void jobs_background(int job, bool resume);
+
+/**
+ * @brief This function collects the background jobs that finished or stopped, without blocking, and reports them.
+ * @param at_prompt true if the prompt is on screen: a newline is written before the first report.
+ * @return The number of jobs reported.
+ */
+int jobs_reap(bool at_prompt);
+
+/**
+ * @brief This function handles the jobs, fg and bg commands.
+ * @param args The arguments of the command, args[0] is the command.
+ * @return The exit status of the command.
+ */
+int jobs_command(char* args[]);
+
+/**
+ * @brief This function registers the jobs, fg and bg commands.
+ */
+void jobs_register_builtins(void);
+
+#endif
@@ -0,0 +1,49 @@
+/**
+ * @file json_query.h
+ * @brief This file contains the declaration of the compiled JSON path queries.
+ * @details A query is compiled once from one or more paths and can then be evaluated against many documents.
+ * All the paths of a query are resolved in a single traversal of the tree.
+ */
+#ifndef JSON_QUERY_H
+#define JSON_QUERY_H
+
+#include <cJSON.h>
+#include <stddef.h>
+
+/**
+ * @brief A compiled set of paths.
+ */
+typedef struct json_query json_query;
+
+/**
+ * @brief This function compiles a set of paths into a query.
+ * @param paths The paths, either JSON Pointers ("/disk/reads", "/list/0") or dotted paths ("disk.reads", "list[0]").
+ * @param count The number of paths.
+ * @return The compiled query, NULL if a path is invalid or memory runs out.
+ * @note Keys are compared case-sensitively, like JSON Pointer.
+ */
+json_query* json_query_compile(const char* const paths[], size_t count);
+
+/**
+ * @brief This function evaluates a query against a document.
+ * @param query The compiled query.
+ * @param root The document.
+ * @param results Array of as many items as paths, results[i] is set to the item of paths[i] or NULL if missing.
+ * @return The number of paths found.
+ */
+size_t json_query_eval(const json_query* query, const cJSON* root, cJSON* results[]);
+
+/**
+ * @brief This function returns the number of paths in a query.
+ * @param query The compiled query.
+ * @return The number of paths.
+ */
+size_t json_query_count(const json_query* query);
+
+/**
+ * @brief This function frees a compiled query.
+ * @param query The compiled query.
+ */
+void json_query_free(json_query* query);
+
+#endif
@@ -5,6 +5,10 @@
 #include "commands.h"
 #include "monitor.h"
 #include "prompt.h"
+#include "reactor.h"
+#include "redirect.h"
+#include "signals.h"
+#include "stage.h"
 #include <fcntl.h>
 
 /**
@@ -17,12 +21,34 @@
  */
 void get_command(void);
 
+/**
+ * @brief This function reads the command from the terminal, called from the event loop when stdin is readable.
+ * @param fd The file descriptor of the terminal.
+ * @param events The epoll events.
+ * @param data Unused.
+ */
+void input_ready(int fd, uint32_t events, void* data);
+
+/**
+ * @brief This function runs a command entered by the user and records its status for the prompt.
+ * @param command the command to be executed.
+ */
+void process_command(char* command);
+
 /**
  * @brief This function executes the command.
  * @param command the command to be executed.
  */
 void execute_command(char* command);
 
+/**
+ * @brief This function runs a command and reports the time and resources it used, on stderr.
+ * @param command the command to be measured, without the "time" prefix.
+ * @note A pipeline gets one line per stage and a total: wall, user and system time, maximum RSS, context switches
+ * and page faults, from the wait4() of every process.
+ */
+void time_command(char* command);
+
 /**
  * @brief This function tokenizes the command.
  * @param command the command to be tokenized.
@@ -45,14 +71,16 @@ void check_flags(char* command, bool* background, bool* pipes, bool* input, bool
  * @brief This function handles the pipes.
  * @param command the command to be executed.
  * @param args the array of arguments.
+ * @param background true to run the pipeline in the background.
+ * @note Every stage is started before waiting, all of them in the process group of the first one. In the foreground
+ * the internal commands that write to a pipe (echo, read_file) run on threads of the shell instead of forking.
  */
-void run_pipelines(char* command, char* args[]);
+void run_pipelines(char* command, char* args[], bool background);
 
 /**
  * @brief This function handles the I/O redirection.
  * @param command the command to be executed.
  * @param args the array of arguments.
- * @param input pointer to boolean for input redirection.
- * @param output pointer to boolean for output redirection.
+ * @note The internal commands are redirected in the shell itself, the external ones in their child.
  */
-void io_redirection(char* command, char* args[], bool* input, bool* output);
+void io_redirection(char* command, char* args[]);
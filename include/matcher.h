@@ -0,0 +1,79 @@
+/**
+ * @file matcher.h
+ * @brief This file contains the declaration of the name and content matchers of search_config.
+ * @details Several glob patterns are compiled into one bit-parallel automaton, so a file name is matched against all
+ * of them in a single pass. Content is searched with memchr() on the rarest byte of the pattern and verified with
+ * memcmp(), which lets the vectorized memchr of the C library skip most of the text.
+ */
+#ifndef MATCHER_H
+#define MATCHER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief A compiled set of glob patterns.
+ */
+typedef struct glob_set glob_set;
+
+/**
+ * @brief A compiled substring pattern.
+ */
+typedef struct text_finder text_finder;
+
+/**
+ * @brief This function compiles a set of glob patterns.
+ * @param patterns The patterns: "*" matches any sequence, "?" any character, "[a-z]" and "[!a-z]" a class and "\\"
+ * escapes the next character.
+ * @param count The number of patterns.
+ * @return The compiled set, NULL if memory runs out.
+ */
+glob_set* glob_set_compile(const char* const patterns[], size_t count);
+
+/**
+ * @brief This function checks whether a name matches any pattern of a set.
+ * @param set The compiled set.
+ * @param name The name.
+ * @return true if at least one pattern matches the whole name.
+ */
+bool glob_set_match(const glob_set* set, const char* name);
+
+/**
+ * @brief This function frees a compiled set.
+ * @param set The compiled set.
+ */
+void glob_set_free(glob_set* set);
+
+/**
+ * @brief This function compiles a substring pattern.
+ * @param pattern The bytes to search.
+ * @param length The number of bytes.
+ * @return The compiled pattern, NULL if memory runs out.
+ */
+text_finder* text_finder_compile(const char* pattern, size_t length);
+
+/**
+ * @brief This function finds the first occurrence of a pattern in a buffer.
+ * @param finder The compiled pattern.
+ * @param data The buffer.
+ * @param length The size of the buffer.
+ * @return The first occurrence, NULL if there is none.
+ */
+const char* text_finder_find(const text_finder* finder, const char* data, size_t length);
+
+/**
+ * @brief This function checks whether the content of a file contains a pattern.
+ * @param finder The compiled pattern.
+ * @param fd Descriptor of the file, open for reading.
+ * @return true if the pattern occurs in the file.
+ * @note Big files are mapped with mmap(), small ones are read into a buffer.
+ */
+bool text_finder_file(const text_finder* finder, int fd);
+
+/**
+ * @brief This function frees a compiled pattern.
+ * @param finder The compiled pattern.
+ */
+void text_finder_free(text_finder* finder);
+
+#endif
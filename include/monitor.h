@@ -2,6 +2,12 @@
  * @file monitor.h
  * @brief This file contains the declaration of the functions that handle the Prometheus monitor.
  */
+#include "cbor.h"
+#include "jobs.h"
+#include "prompt.h"
+#include "reactor.h"
+#include "stats.h"
+#include "json_query.h"
 #include <cJSON.h>
 #include <fcntl.h>
 #include <signal.h>
@@ -18,6 +24,16 @@
  */
 #define BUFFER_SIZE 4096
 
+/**
+ * @brief The FIFO where the monitor writes its samples.
+ */
+#define MONITOR_FIFO "/tmp/monitor_pipe"
+
+/**
+ * @brief Milliseconds without samples after which the live view warns that the monitor is silent.
+ */
+#define MONITOR_LIVE_TIMEOUT_MS 5000
+
 /**
  * @brief Color codes for the terminal.
  * @details These color codes are used to print the metrics in a pretty way.
@@ -52,10 +68,23 @@ void start_monitor(void);
  */
 void stop_monitor(void);
 
+/**
+ * @brief This function checks whether the monitor is running.
+ * @return true if the monitor was started and not stopped.
+ */
+bool monitor_is_running(void);
+
 /**
  * @brief This function shows the status of the monitor.
+ * @param option NULL to read the FIFO until the monitor closes it, "-live" to print every sample at the prompt as it
+ * arrives (from the event loop) and "-stop" to end the live view.
+ */
+void status_monitor(const char* option);
+
+/**
+ * @brief This function registers the start_monitor, stop_monitor and status_monitor commands.
  */
-void status_monitor(void);
+void monitor_register_builtins(void);
 
 /**
  * @brief This function loads the settings from a JSON file.
@@ -72,6 +101,15 @@ cJSON* cargar_settings(const char* settings_path);
  */
 cJSON* filtrar_metricas(cJSON* metricas, cJSON* settings);
 
+/**
+ * @brief This function filters the metrics of a CBOR encoded frame according to the settings.
+ * @param frame The CBOR frame.
+ * @param length The length of the frame.
+ * @param settings The settings to filter the metrics.
+ * @return The filtered metrics, NULL if the frame is invalid.
+ */
+cJSON* filtrar_metricas_cbor(const unsigned char* frame, size_t length, cJSON* settings);
+
 /**
  * @brief This function processes the FIFO and prints the metrics.
  * @param fifo_path The path to the FIFO.
@@ -79,6 +117,14 @@ cJSON* filtrar_metricas(cJSON* metricas, cJSON* settings);
  */
 void procesar_fifo(const char* fifo_path, cJSON* settings);
 
+/**
+ * @brief This function filters and prints one sample of the monitor.
+ * @param buffer The sample, JSON or CBOR, followed by a '\0'. JSON strings are decoded inside the buffer.
+ * @param length The length of the sample.
+ * @param settings The settings to filter the metrics.
+ */
+void procesar_muestra(char* buffer, size_t length, cJSON* settings);
+
 /**
  * @brief This function prints the metrics in a pretty way.
  * @param filtrado The filtered metrics to print.
@@ -0,0 +1,18 @@
+/**
+ * @file plugins.h
+ * @brief This file contains the declaration of the loader of plugins, the enable command.
+ * @details "enable -f lib.so name..." opens a shared object that follows shellter_plugin.h and registers the named
+ * commands of its shellter_builtin_v1 array as internal commands. They run in the shell on its descriptors (or, if
+ * they are thread safe, on a pipeline thread with the pipes), so a helper called thousands of times by a script
+ * does not pay a fork(), an exec() and the dynamic linking of a program every time. A plugin stays loaded until the
+ * shell exits.
+ */
+#ifndef PLUGINS_H
+#define PLUGINS_H
+
+/**
+ * @brief This function registers the enable command.
+ */
+void plugins_register_builtins(void);
+
+#endif
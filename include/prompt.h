@@ -18,6 +18,18 @@
  */
 #define ANSI_GREEN "\x1b[32m"
 
+/**
+ * @brief These are the ANSI escape codes for colors.
+ * This code is used to color the exit status of the last command.
+ */
+#define ANSI_RED "\x1b[31m"
+
+/**
+ * @brief These are the ANSI escape codes for colors.
+ * This code is used to color the duration of the last command.
+ */
+#define ANSI_YELLOW "\x1b[33m"
+
 /**
  * @brief These are the ANSI escape codes for colors.
  * This code is used to reset the color.
@@ -30,11 +42,41 @@
 #define HOSTNAME_MAX 100
 
 /**
- * @brief This is the maximum length of the directory.
+ * @brief Commands that take at least this long show their duration in the prompt.
+ */
+#define PROMPT_DURATION_MIN_MS 100
+
+/**
+ * @brief Minimum free columns left of the segments drawn on the right side of the prompt.
  */
-#define DIRECTORY_MAX 100
+#define PROMPT_RIGHT_MARGIN 40
 
 /**
  * @brief This function shows the prompt.
+ * @note The prompt is cached: user and hostname are read once and the directory only after prompt_update_cwd().
  */
 void show_prompt(void);
+
+/**
+ * @brief This function shows the prompt on a new line.
+ * @note It is async-signal-safe: a single write(2) of the prompt already rendered.
+ */
+void show_prompt_signal_safe(void);
+
+/**
+ * @brief This function updates the directory shown in the prompt.
+ * @note It must be called after every change of the current directory.
+ */
+void prompt_update_cwd(void);
+
+/**
+ * @brief This function stops the repaints of the asynchronous segments once the user entered a command.
+ */
+void prompt_input_received(void);
+
+/**
+ * @brief This function records the status and duration of the last command for the next prompt.
+ * @param status The exit status.
+ * @param duration_ms The duration in milliseconds.
+ */
+void prompt_set_status(int status, long duration_ms);
@@ -0,0 +1,70 @@
+/**
+ * @file reactor.h
+ * @brief This file contains the declaration of the event loop of the shell.
+ * @details A single epoll instance waits for every source of events of the interactive shell: the terminal, the
+ * signalfd, the pidfds of the background jobs, the stream of the monitor and the timers. Each file descriptor has a
+ * callback, run from reactor_dispatch() on the main thread, so nothing is polled and the prompt never blocks them.
+ */
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <stdint.h>
+#include <sys/epoll.h>
+
+/**
+ * @brief Callback of a file descriptor.
+ * @param fd The file descriptor.
+ * @param events The epoll events (EPOLLIN, EPOLLHUP, ...).
+ * @param data The pointer given when it was registered.
+ */
+typedef void (*reactor_callback)(int fd, uint32_t events, void* data);
+
+/**
+ * @brief This function registers a file descriptor, level triggered.
+ * @param fd The file descriptor.
+ * @param events The epoll events to wait for.
+ * @param callback Function called when the events happen.
+ * @param data Pointer passed to the callback.
+ * @return 0 on success, -1 on error. The epoll instance is created by the first call.
+ */
+int reactor_add(int fd, uint32_t events, reactor_callback callback, void* data);
+
+/**
+ * @brief This function unregisters a file descriptor, it must be called before closing it.
+ * @param fd The file descriptor.
+ * @note It can be called from a callback: the pending events of the descriptor are dropped.
+ */
+void reactor_remove(int fd);
+
+/**
+ * @brief This function creates a timer (a timerfd) and registers it.
+ * @param delay_ms Milliseconds until the first expiration.
+ * @param interval_ms Milliseconds between expirations, 0 for a one-shot timer.
+ * @param callback Function called on every expiration.
+ * @param data Pointer passed to the callback.
+ * @return The file descriptor of the timer, -1 on error.
+ */
+int reactor_timer(long delay_ms, long interval_ms, reactor_callback callback, void* data);
+
+/**
+ * @brief This function arms a timer again.
+ * @param fd The timer.
+ * @param delay_ms Milliseconds until the next expiration, 0 to disarm it.
+ * @param interval_ms Milliseconds between expirations, 0 for a one-shot timer.
+ */
+void reactor_timer_set(int fd, long delay_ms, long interval_ms);
+
+/**
+ * @brief This function unregisters and closes a timer.
+ * @param fd The timer.
+ */
+void reactor_timer_remove(int fd);
+
+/**
+ * @brief This function waits for events and runs their callbacks.
+ * @param timeout_ms Maximum wait in milliseconds, -1 to wait without limit.
+ * @return The number of callbacks run, -1 on error.
+ */
+int reactor_dispatch(int timeout_ms);
+
+#endif
@@ -0,0 +1,39 @@
+/**
+ * @file reader.h
+ * @brief This file contains the declaration of the read_file command.
+ * @details Files are copied to stdout with sendfile() (or splice() into a pipe) without going through user space.
+ * Line ranges are found by reading the file with pread() and scanning it with memchr()/memrchr(), never through a
+ * mapping, so a file truncated meanwhile can't kill the shell with SIGBUS. When the shell is interactive and both stdin
+ * and stdout are a terminal the content is shown in a pager that indexes the lines on demand. In JSON mode the parsed
+ * tree is cached by (inode, mtime), so repeated queries on the same file don't parse it again.
+ */
+#ifndef READER_H
+#define READER_H
+
+#include <stdbool.h>
+
+/**
+ * @brief Options of read_file.
+ */
+typedef struct
+{
+    long first_line; /**< First line to print (1-based), 0 from the beginning. */
+    long last_line;  /**< Last line to print (inclusive), 0 to the end. */
+    long head;       /**< Print only the first lines, -1 to disable. */
+    long tail;       /**< Print only the last lines, -1 to disable. */
+    bool follow;     /**< Keep printing what is appended to the file until interrupted. */
+    bool json;       /**< Parse the file as JSON and pretty-print it. */
+    const char* key; /**< In JSON mode, path of the value to print ("server.port"), NULL for the whole document. */
+    int output;      /**< Descriptor the content is written to, STDOUT_FILENO but in a pipeline thread (not JSON). */
+} read_options;
+
+/**
+ * @brief This function prints the content of a file.
+ * @param path The path to the file.
+ * @param options The options.
+ * @return 0 on success, -1 if the file can't be read.
+ * @note Without --follow and --json it does not use stdio nor shared state, so it can run on a thread of the shell.
+ */
+int read_file(const char* path, const read_options* options);
+
+#endif
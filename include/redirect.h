@@ -0,0 +1,117 @@
+/**
+ * @file redirect.h
+ * @brief This file contains the declaration of the redirections of a command.
+ * @details The operators are recognized with or without spaces around them: "<", ">", ">>", "N>", "N>>", "N<",
+ * "N>&M", "N<&M", "&>", "&>>", "<<DELIMITER" (here-document) and "<<< word" (here-string). The bodies of the
+ * here-documents and here-strings are read while parsing and kept in memory: in a pipe when they fit in PIPE_BUF
+ * bytes, in a memfd_create() file otherwise, so they never touch the disk.
+ */
+#ifndef REDIRECT_H
+#define REDIRECT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @brief Maximum number of redirections of a command.
+ */
+#define REDIRECT_MAX 16
+
+/**
+ * @brief Size of the copy of the words of a command.
+ */
+#define REDIRECT_WORDS 2048
+
+/**
+ * @brief Kinds of redirection.
+ */
+typedef enum
+{
+    REDIRECT_OPEN,   /**< The descriptor is a file opened with flags. */
+    REDIRECT_DUP,    /**< The descriptor is a copy of another one (2>&1). */
+    REDIRECT_MEMORY  /**< The descriptor reads a here-document or a here-string. */
+} redirect_kind;
+
+/**
+ * @brief A redirection.
+ */
+typedef struct
+{
+    redirect_kind kind; /**< Kind of redirection. */
+    int target;         /**< Descriptor that is redirected. */
+    int flags;          /**< Flags of open(), for REDIRECT_OPEN. */
+    const char* path;   /**< File, for REDIRECT_OPEN. */
+    int source;         /**< Descriptor copied (REDIRECT_DUP), holding the text (REDIRECT_MEMORY, owned) or opened by
+                             redirect_open() (REDIRECT_OPEN, owned, -1 until then). */
+    uint64_t size;      /**< Bytes of the text (REDIRECT_MEMORY), size of the file when redirect_open() opened it for
+                             writing (REDIRECT_OPEN). */
+    int saved;          /**< Copy of the previous descriptor while applied in the shell, -1 if none. */
+    bool applied;       /**< The redirection is in place and redirect_restore() must undo it. */
+} redirection;
+
+/**
+ * @brief The redirections of a command.
+ */
+typedef struct
+{
+    redirection items[REDIRECT_MAX]; /**< Redirections, in the order of the command line. */
+    size_t count;                    /**< Number of redirections. */
+    char words[REDIRECT_WORDS];      /**< Copy of the words of the command, the arguments and paths point into it. */
+} redirect_list;
+
+/**
+ * @brief This function sets where the bodies of the here-documents are read from.
+ * @param source The batch file, NULL for stdin (with a "> " prompt on a terminal).
+ */
+void redirect_input(FILE* source);
+
+/**
+ * @brief This function separates the arguments and the redirections of a command.
+ * @param command The command, it is not modified.
+ * @param args Where to store the arguments, NULL terminated.
+ * @param max_args Number of entries of args.
+ * @param list Where to store the redirections.
+ * @return The number of arguments, -1 on a syntax error (already reported, nothing to close).
+ * @note The here-documents are read here: the caller must call redirect_close() when the command is started.
+ */
+int redirect_parse(const char* command, char* args[], int max_args, redirect_list* list);
+
+/**
+ * @brief This function opens the files of the redirections in the shell, before the command starts.
+ * @param list The redirections.
+ * @return 0 on success, -1 on error (already reported, redirect_close() closes the ones opened).
+ * @note The command shares the open files with the shell, so redirect_bytes() sees how far it read or wrote. Without
+ * this call redirect_apply() opens them itself.
+ */
+int redirect_open(redirect_list* list);
+
+/**
+ * @brief This function applies the redirections, in the order of the command line.
+ * @param list The redirections.
+ * @param save true to keep copies of the previous descriptors for redirect_restore() (commands run by the shell
+ * itself), false in a child.
+ * @return 0 on success, -1 on error (already reported; with save the applied ones must still be restored).
+ */
+int redirect_apply(redirect_list* list, bool save);
+
+/**
+ * @brief This function gives the shell its descriptors back, in reverse order.
+ * @param list The redirections applied with save.
+ */
+void redirect_restore(redirect_list* list);
+
+/**
+ * @brief This function closes the here-documents and the files opened by redirect_open().
+ * @param list The redirections.
+ */
+void redirect_close(redirect_list* list);
+
+/**
+ * @brief This function returns the bytes that went through the redirected files and here-documents.
+ * @param list The redirections of a command that finished, opened with redirect_open().
+ * @return The bytes read from or added to the regular files, plus the size of the here-documents.
+ */
+uint64_t redirect_bytes(const redirect_list* list);
+
+#endif
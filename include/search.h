@@ -0,0 +1,40 @@
+/**
+ * @file search.h
+ * @brief This file contains the declaration of the parallel configuration file search.
+ * @details Directories are walked by a pool of threads with work-stealing queues. Each directory is opened with
+ * openat() relative to its parent and read with getdents64(), so full paths are only built to print a match.
+ */
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include "matcher.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Maximum number of walker threads.
+ */
+#define SEARCH_MAX_THREADS 64
+
+/**
+ * @brief Options of a configuration file search.
+ */
+typedef struct
+{
+    size_t threads;              /**< Number of walker threads, 0 uses one per online CPU. */
+    bool sorted;                 /**< Collect the matches and print them sorted, memory grows with the matches. */
+    const glob_set* names;       /**< File name patterns, NULL for the ".config" and ".json" extensions. */
+    const text_finder* contains; /**< Text the files must contain, NULL to skip reading them. */
+    int max_depth;               /**< Maximum depth of the files (1 for the directory itself), -1 for no limit. */
+} search_options;
+
+/**
+ * @brief This function searches recursively for the configuration files in a directory.
+ * @param directory The directory to search.
+ * @param options The search options.
+ * @return The number of files found, -1 if the directory can't be opened.
+ * @note By default matches are streamed through fixed size per-thread buffers, so memory stays bounded.
+ */
+long search_config_files(const char* directory, const search_options* options);
+
+#endif
@@ -0,0 +1,39 @@
+/**
+ * @file segments.h
+ * @brief This file contains the declaration of the asynchronous prompt segments.
+ * @details Slow segments (git branch and state, CPU and memory of the monitor) are computed on a worker thread and
+ * cached per directory with a time to live. The prompt is drawn at once with the cached (maybe stale) values or a
+ * placeholder, and the worker asks the prompt to repaint them when fresh data arrives.
+ */
+#ifndef SEGMENTS_H
+#define SEGMENTS_H
+
+#include <stddef.h>
+
+/**
+ * @brief Maximum size of the rendered segments, escape codes included.
+ */
+#define SEGMENTS_MAX 256
+
+/**
+ * @brief This function starts the worker thread of the segments.
+ * @param repaint Function called from the worker when the rendered segments change.
+ * @return 0 on success, -1 on error.
+ */
+int segments_start(void (*repaint)(void));
+
+/**
+ * @brief This function asks the worker to refresh the stale segments of a directory.
+ * @param cwd The current directory.
+ */
+void segments_request(const char* cwd);
+
+/**
+ * @brief This function renders the segments with the values available right now.
+ * @param buffer Output buffer of SEGMENTS_MAX bytes.
+ * @param width Output: number of columns of the rendered text.
+ * @return The length of the rendered text.
+ */
+size_t segments_render(char* buffer, size_t* width);
+
+#endif
@@ -0,0 +1,54 @@
+/**
+ * @file shellter_plugin.h
+ * @brief This file contains the ABI of the plugins of shellter, the only header a plugin needs.
+ * @details A plugin is a shared object that exports an array named shellter_builtin_v1, ended by an entry with a NULL
+ * name. "enable -f lib.so name..." loads it into the shell with dlopen() and registers the named entries as internal
+ * commands, so running one costs a function call instead of fork(), exec() and the dynamic linking of a program. A
+ * command gets its arguments and the descriptors it must use: it must not write to stdout with stdio (the shell
+ * buffers its own), must not exit() and must free what it allocates, since it runs inside the shell. With
+ * SHELLTER_PLUGIN_THREAD_SAFE it may also run on a thread of the shell as a stage of a pipeline.
+ *
+ * A plugin is built with: cc -shared -fPIC -I<shellter>/include plugin.c -o plugin.so
+ */
+#ifndef SHELLTER_PLUGIN_H
+#define SHELLTER_PLUGIN_H
+
+/**
+ * @brief Version of the ABI, the shell rejects an entry with another one.
+ */
+#define SHELLTER_PLUGIN_ABI 1
+
+/**
+ * @brief Name of the array every plugin exports.
+ */
+#define SHELLTER_PLUGIN_SYMBOL "shellter_builtin_v1"
+
+/**
+ * @brief The command only uses its arguments, its descriptors and its own memory: it can run on a pipeline thread.
+ */
+#define SHELLTER_PLUGIN_THREAD_SAFE 0x1u
+
+/**
+ * @brief The descriptors of a run of a command.
+ */
+struct shellter_io_v1
+{
+    int input;  /**< Standard input: the terminal, a redirected file or a pipe. */
+    int output; /**< Standard output. */
+    int error;  /**< Standard error. */
+};
+
+/**
+ * @brief A command of a plugin.
+ */
+struct shellter_builtin_v1
+{
+    unsigned abi;        /**< SHELLTER_PLUGIN_ABI. */
+    const char* name;    /**< Name of the command, NULL ends the array. */
+    const char* usage;   /**< Arguments, for help, "" for none. */
+    const char* summary; /**< One line description, for help. */
+    unsigned flags;      /**< SHELLTER_PLUGIN_* flags. */
+    int (*run)(int argc, char* argv[], const struct shellter_io_v1* io); /**< Runs the command, returns its status. */
+};
+
+#endif
@@ -2,15 +2,35 @@
  * @file signals.h
  * @brief This file contains the declaration of the functions that handle the signals.
  */
+#include "jobs.h"
 #include "prompt.h"
 #include <signal.h>
 #include <stdio.h>
 
 /**
  * @brief This function manages the signals.
+ * @note It is called once, when the shell starts. It also starts the job control (see jobs.h).
  */
 void manage_signals(void);
 
+/**
+ * @brief This function tells whether the signals are read from the event loop.
+ * @return true on a terminal, where the shell runs the event loop (see reactor.h).
+ */
+bool signals_in_reactor(void);
+
+/**
+ * @brief This function lets SIGINT and SIGQUIT interrupt the command that the shell is about to run itself.
+ * @note Only on a terminal, where they are blocked for the signalfd. The threads created until
+ * signals_command_end() must block every signal, as stage_start() does.
+ */
+void signals_command_begin(void);
+
+/**
+ * @brief This function blocks SIGINT and SIGQUIT again after a command and drops the Ctrl+Z typed while it ran.
+ */
+void signals_command_end(void);
+
 /**
  * @brief This function handles the signals.
  * @param signum1 the signal number.
@@ -0,0 +1,35 @@
+/**
+ * @file stage.h
+ * @brief This file contains the declaration of the internal commands of a pipeline that run on threads of the shell.
+ * @details In "read_file big.json | grep x" the first stage does not need a process of its own: a thread of the shell
+ * runs it with the write end of the pipe as its output, so only grep forks. read_file moves the file into the pipe with
+ * sendfile()/splice(), without copying it through user space, and echo gives its words to one writev(). The threads
+ * block every signal (Ctrl+C and Ctrl+Z go to the processes of the job, and a reader that left gives EPIPE instead of
+ * a SIGPIPE that would kill the shell) and close their descriptors when they end.
+ */
+#ifndef STAGE_H
+#define STAGE_H
+
+#include "builtins.h"
+#include <pthread.h>
+
+/**
+ * @brief This function starts a thread that runs an internal command accepted by builtin_threadable().
+ * @param command The command, found by the shell: the thread does not touch the registry.
+ * @param argc The number of arguments.
+ * @param args The arguments of the command, they are copied.
+ * @param input The read end of the previous pipe or STDIN_FILENO, the thread closes it when it ends.
+ * @param output The write end of the next pipe, the thread closes it when it ends.
+ * @param thread Where to store the thread, for stage_wait() or pthread_detach().
+ * @return 0 on success, -1 on error (already reported, the descriptors are still the caller's).
+ */
+int stage_start(const builtin_command* command, int argc, char* args[], int input, int output, pthread_t* thread);
+
+/**
+ * @brief This function waits for a thread started with stage_start().
+ * @param thread The thread.
+ * @return The exit status of the command.
+ */
+int stage_wait(pthread_t thread);
+
+#endif
@@ -0,0 +1,112 @@
+/**
+ * @file stats.h
+ * @brief This file contains the declaration of the latency histograms and counters of the shell.
+ * @details Every histogram is log-linear, like an HDR histogram: 16 buckets per power of two, so any value is kept
+ * with a relative error under 6.25% in a fixed table and recording is a couple of shifts and an increment. Building
+ * without SHELLTER_STATS (cmake -DSHELLTER_STATS=OFF) turns the STATS_* macros into nothing.
+ */
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+
+/**
+ * @brief Latencies measured by the shell.
+ */
+typedef enum
+{
+    STATS_PARSE,          /**< Parsing of a command line (check_flags() and tokenizer()). */
+    STATS_FORK,           /**< fork() of a child, seen by the parent. */
+    STATS_PIPELINE_SETUP, /**< Pipes and forks of every stage of a pipeline. */
+    STATS_MONITOR_SAMPLE, /**< Processing of a sample of the monitor. */
+    STATS_HISTOGRAMS      /**< Number of histograms. */
+} stats_histogram;
+
+/**
+ * @brief Events counted by the shell.
+ */
+typedef enum
+{
+    STATS_COMMANDS,         /**< Command lines run. */
+    STATS_FORKS,            /**< Children started. */
+    STATS_FAILURES,         /**< Command lines that ended with a status other than 0. */
+    STATS_REDIRECTED_BYTES, /**< Bytes read from or written to redirected files. */
+    STATS_COUNTERS          /**< Number of counters. */
+} stats_counter;
+
+/**
+ * @brief Maximum length of the name of a command, longer names are cut.
+ */
+#define STATS_NAME_LENGTH 32
+
+#ifdef SHELLTER_STATS
+
+/**
+ * @brief Declares a variable with the current time, the start of a measure.
+ */
+#define STATS_TIMER(name) uint64_t name = stats_now()
+
+/**
+ * @brief Records the time elapsed since a STATS_TIMER in a histogram.
+ */
+#define STATS_RECORD(histogram, start) stats_record(histogram, stats_now() - (start))
+
+/**
+ * @brief Records the time elapsed since a STATS_TIMER for a command.
+ */
+#define STATS_RECORD_COMMAND(name, start) stats_record_command(name, stats_now() - (start))
+
+/**
+ * @brief Adds to a counter.
+ */
+#define STATS_COUNT(counter, amount) stats_count(counter, amount)
+
+#else
+
+#define STATS_TIMER(name) ((void)0)
+#define STATS_RECORD(histogram, start) ((void)0)
+#define STATS_RECORD_COMMAND(name, start) ((void)0)
+#define STATS_COUNT(counter, amount) ((void)0)
+
+#endif
+
+/**
+ * @brief This function returns the monotonic clock in nanoseconds.
+ */
+uint64_t stats_now(void);
+
+/**
+ * @brief This function records a latency.
+ * @param histogram The histogram.
+ * @param nanoseconds The latency.
+ */
+void stats_record(stats_histogram histogram, uint64_t nanoseconds);
+
+/**
+ * @brief This function records the time from the start to the end of a command.
+ * @param name The name of the command (args[0]), the commands past the first 32 names share a histogram.
+ * @param nanoseconds The time.
+ */
+void stats_record_command(const char* name, uint64_t nanoseconds);
+
+/**
+ * @brief This function adds to a counter.
+ * @param counter The counter.
+ * @param amount The amount.
+ */
+void stats_count(stats_counter counter, uint64_t amount);
+
+/**
+ * @brief This function handles the stats command: "stats" prints a table, "stats -json" the same as JSON and
+ * "stats -reset" clears everything.
+ * @param args The arguments of the command, args[0] is the command.
+ * @return The exit status of the command.
+ */
+int stats_command(char* args[]);
+
+/**
+ * @brief This function registers the stats command.
+ */
+void stats_register_builtins(void);
+
+#endif
@@ -0,0 +1,61 @@
+/**
+ * @file trace.h
+ * @brief This file contains the declaration of the trace of the shell, in the Chrome trace event format.
+ * @details With SHELLTER_TRACE=file.json in the environment the shell records spans (parse, fork, exec, wait,
+ * redirection and builtin) with their pids and job numbers. Each thread fills its own buffer without locks and writes
+ * it to the file when it is full, so the children of the shell add their own spans (the setup before exec(), the
+ * redirections, the builtins of a pipeline) to the same file. The file can be opened in chrome://tracing or in
+ * Perfetto. Without the variable every function returns at once.
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/**
+ * @brief Name of the environment variable with the path of the trace.
+ */
+#define TRACE_VARIABLE "SHELLTER_TRACE"
+
+/**
+ * @brief This function opens the trace if SHELLTER_TRACE is set, it must be called once at the start.
+ * @note The trace is closed at exit().
+ */
+void trace_init(void);
+
+/**
+ * @brief This function tells whether the shell is tracing.
+ */
+bool trace_enabled(void);
+
+/**
+ * @brief This function returns the start of a span.
+ * @return The monotonic clock in nanoseconds, 0 if the shell is not tracing.
+ */
+uint64_t trace_begin(void);
+
+/**
+ * @brief This function records a span that started at trace_begin() and ends now.
+ * @param name Name of the span, a string that lives for the whole run.
+ * @param start The value returned by trace_begin(), nothing is recorded if it is 0.
+ * @param child Process the span is about (the child of a fork, the group of a job), 0 for none.
+ * @param job Job number, 0 for none.
+ * @param detail The command, NULL for none. It is copied.
+ */
+void trace_end(const char* name, uint64_t start, pid_t child, int job, const char* detail);
+
+/**
+ * @brief This function writes the spans of the calling thread to the file.
+ * @note The children of the shell must call it before exec() and _exit(), their spans would be lost otherwise.
+ */
+void trace_flush(void);
+
+/**
+ * @brief This function writes the spans of the calling thread and gives its buffer to the next thread.
+ * @note Threads that end before the shell must call it last, their buffer would be kept for nothing otherwise.
+ */
+void trace_thread_end(void);
+
+#endif
@@ -0,0 +1,135 @@
+/**
+ * @file sample_plugin.c
+ * @brief Sample plugin of shellter: basename, dirname and upper as internal commands.
+ * @details basename and dirname are the kind of helper a script runs thousands of times, where starting the program
+ * costs far more than its work. upper copies its input to its output in upper case: it is thread safe, so in a
+ * pipeline like "read_file log | upper | grep ERROR" it runs on a thread of the shell, reading and writing the pipes.
+ *
+ * Usage: enable -f ./libshellter_sample.so basename dirname upper
+ */
+#include "shellter_plugin.h"
+#include <ctype.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/**
+ * @brief Size of the buffer of upper.
+ */
+#define UPPER_BUFFER_SIZE (64 * 1024)
+
+/**
+ * @brief This function writes a piece of a path and a newline.
+ * @return 0 on success, 1 on error.
+ */
+static int write_line(int fd, const char* text, size_t length)
+{
+    struct iovec pieces[2] = {{.iov_base = (void*)(size_t)text, .iov_len = length},
+                              {.iov_base = (void*)"\n", .iov_len = 1}};
+    return writev(fd, pieces, 2) == (ssize_t)length + 1 ? 0 : 1;
+}
+
+/**
+ * @brief This function reports a wrong use of a command.
+ * @return 1, the status of the command.
+ */
+static int usage_error(const struct shellter_io_v1* io, const char* usage)
+{
+    ssize_t written = write(io->error, usage, strlen(usage));
+    (void)written;
+    return 1;
+}
+
+/**
+ * @brief basename NAME [SUFFIX]: the last component of a path, without the suffix.
+ */
+static int basename_run(int argc, char* argv[], const struct shellter_io_v1* io)
+{
+    if (argc < 2 || argc > 3)
+        return usage_error(io, "Uso: basename NOMBRE [SUFIJO]\n");
+
+    const char* path = argv[1];
+    size_t end = strlen(path);
+    while (end > 1 && path[end - 1] == '/')
+        end--;
+    size_t start = end;
+    while (start > 0 && path[start - 1] != '/')
+        start--;
+
+    // "/" queda como "/"; el sufijo no se quita si es todo el nombre
+    if (end == 1 && path[0] == '/')
+        start = 0;
+    if (argc == 3)
+    {
+        size_t suffix = strlen(argv[2]);
+        if (suffix < end - start && memcmp(path + end - suffix, argv[2], suffix) == 0)
+            end -= suffix;
+    }
+    return write_line(io->output, path + start, end - start);
+}
+
+/**
+ * @brief dirname NAME: the path without its last component.
+ */
+static int dirname_run(int argc, char* argv[], const struct shellter_io_v1* io)
+{
+    if (argc != 2)
+        return usage_error(io, "Uso: dirname NOMBRE\n");
+
+    const char* path = argv[1];
+    size_t end = strlen(path);
+    while (end > 1 && path[end - 1] == '/')
+        end--;
+    while (end > 0 && path[end - 1] != '/')
+        end--;
+    if (end == 0)
+        return write_line(io->output, ".", 1);
+    while (end > 1 && path[end - 1] == '/')
+        end--;
+    return write_line(io->output, path, end);
+}
+
+/**
+ * @brief upper: copies the input to the output in upper case.
+ */
+static int upper_run(int argc, char* argv[], const struct shellter_io_v1* io)
+{
+    (void)argv;
+    if (argc != 1)
+        return usage_error(io, "Uso: upper\n");
+
+    // En la pila y no estático: el comando puede correr en varios threads a la vez
+    char buffer[UPPER_BUFFER_SIZE];
+    while (1)
+    {
+        ssize_t length = read(io->input, buffer, sizeof(buffer));
+        if (length < 0 && errno == EINTR)
+            continue;
+        if (length <= 0)
+            return length < 0 ? 1 : 0;
+
+        for (ssize_t i = 0; i < length; i++)
+            buffer[i] = (char)toupper((unsigned char)buffer[i]);
+        for (ssize_t written = 0; written < length;)
+        {
+            ssize_t result = write(io->output, buffer + written, (size_t)(length - written));
+            if (result < 0 && errno == EINTR)
+                continue;
+            if (result < 0)
+                return 1;
+            written += result;
+        }
+    }
+}
+
+/**
+ * @brief The commands of the plugin, the symbol the shell looks for.
+ */
+const struct shellter_builtin_v1 shellter_builtin_v1[] = {
+    {SHELLTER_PLUGIN_ABI, "basename", "NOMBRE [SUFIJO]", "Muestra el último componente de una ruta", 0, basename_run},
+    {SHELLTER_PLUGIN_ABI, "dirname", "NOMBRE", "Muestra una ruta sin su último componente", 0, dirname_run},
+    {SHELLTER_PLUGIN_ABI, "upper", "", "Copia la entrada a la salida en mayúsculas", SHELLTER_PLUGIN_THREAD_SAFE,
+     upper_run},
+    {SHELLTER_PLUGIN_ABI, NULL, NULL, NULL, 0, NULL},
+};
@@ -0,0 +1,366 @@
+/**
+ * @file builtins.c
+ * @brief This file contains the implementation of the registry of the internal commands.
+ * @details The perfect hash is a "hash and displace" table: an FNV-1a hash of the name picks one of slots / 4 buckets
+ * with its high bits, and every bucket has a displacement that mixes the hash into a slot of a table of twice as many
+ * slots as commands. The buckets are placed from the largest to the smallest, trying displacements until all the names
+ * of the bucket land on free slots, which takes a few tries with half of the table empty.
+ */
+#include "builtins.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Displacements tried for a bucket before giving up on the perfect hash.
+ */
+#define BUILTIN_MAX_SEED (1u << 20)
+
+/**
+ * @brief Maximum length of a path searched by type.
+ */
+#define BUILTIN_PATH_LENGTH 4096
+
+/**
+ * @brief The registered commands and their perfect hash.
+ */
+typedef struct
+{
+    const builtin_command** commands; /**< Registered commands, sorted by name after a rebuild. */
+    size_t count;                     /**< Number of commands. */
+    size_t capacity;                  /**< Capacity of commands. */
+    const builtin_command** slots;    /**< Table of the perfect hash, NULL for an empty slot. */
+    size_t slot_mask;                 /**< Number of slots - 1, a power of two - 1. */
+    uint32_t* seeds;                  /**< Displacement of every bucket. */
+    size_t bucket_mask;               /**< Number of buckets - 1, a power of two - 1. */
+    bool dirty;                       /**< A command was registered after the last rebuild. */
+} builtin_registry;
+
+/**
+ * @brief The registry.
+ */
+static builtin_registry registry = {NULL, 0, 0, NULL, 0, NULL, 0, false};
+
+/**
+ * @brief This function returns the FNV-1a hash of a name.
+ */
+static uint64_t name_hash(const char* name)
+{
+    uint64_t hash = 0xcbf29ce484222325u;
+    for (const unsigned char* p = (const unsigned char*)name; *p; p++)
+        hash = (hash ^ *p) * 0x100000001b3u;
+    return hash;
+}
+
+/**
+ * @brief This function returns the bucket of a hash, from its high bits.
+ */
+static size_t bucket_of(uint64_t hash)
+{
+    return (size_t)(hash >> 32) & registry.bucket_mask;
+}
+
+/**
+ * @brief This function returns the slot of a hash with the displacement of its bucket.
+ * @note splitmix64: every displacement spreads the names of the bucket in a different way.
+ */
+static size_t slot_of(uint64_t hash, uint32_t seed)
+{
+    uint64_t x = hash + (uint64_t)seed * 0x9e3779b97f4a7c15u;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9u;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebu;
+    return (size_t)(x ^ (x >> 31)) & registry.slot_mask;
+}
+
+/**
+ * @brief qsort() comparator of the commands by name.
+ */
+static int compare_commands(const void* a, const void* b)
+{
+    return strcmp((*(const builtin_command* const*)a)->name, (*(const builtin_command* const*)b)->name);
+}
+
+/**
+ * @brief This function places the names of a bucket on free slots.
+ * @param members Indexes of the commands of the bucket.
+ * @param size Number of members.
+ * @param hashes Hash of every command.
+ * @param taken Slots of the members, scratch space of size entries.
+ * @return The displacement, BUILTIN_MAX_SEED if none was found.
+ */
+static uint32_t place_bucket(const size_t* members, size_t size, const uint64_t* hashes, size_t* taken)
+{
+    for (uint32_t seed = 0; seed < BUILTIN_MAX_SEED; seed++)
+    {
+        size_t placed = 0;
+        while (placed < size)
+        {
+            size_t slot = slot_of(hashes[members[placed]], seed);
+            bool free_slot = registry.slots[slot] == NULL;
+            for (size_t i = 0; free_slot && i < placed; i++)
+                free_slot = taken[i] != slot;
+            if (!free_slot)
+                break;
+            taken[placed++] = slot;
+        }
+
+        if (placed == size)
+        {
+            for (size_t i = 0; i < size; i++)
+                registry.slots[taken[i]] = registry.commands[members[i]];
+            return seed;
+        }
+    }
+    return BUILTIN_MAX_SEED;
+}
+
+/**
+ * @brief This function builds the perfect hash of the registered commands.
+ * @return 0 on success, -1 if it could not be built (builtin_find() then searches the list).
+ */
+static int rebuild(void)
+{
+    registry.dirty = false;
+    free(registry.slots);
+    free(registry.seeds);
+    registry.slots = NULL;
+    registry.seeds = NULL;
+
+    size_t count = registry.count;
+    qsort(registry.commands, count, sizeof(registry.commands[0]), compare_commands);
+
+    size_t slot_count = 8;
+    while (slot_count < 2 * count)
+        slot_count *= 2;
+    registry.slot_mask = slot_count - 1;
+    registry.bucket_mask = slot_count / 4 - 1;
+
+    registry.slots = calloc(slot_count, sizeof(registry.slots[0]));
+    registry.seeds = calloc(slot_count / 4, sizeof(registry.seeds[0]));
+    uint64_t* hashes = malloc(sizeof(uint64_t) * (count + 1));
+    size_t* sizes = calloc(slot_count / 4, sizeof(size_t));
+    size_t* members = malloc(sizeof(size_t) * (count + 1));
+    size_t* taken = malloc(sizeof(size_t) * (count + 1));
+    bool built = registry.slots && registry.seeds && hashes && sizes && members && taken;
+
+    for (size_t i = 0; built && i < count; i++)
+    {
+        hashes[i] = name_hash(registry.commands[i]->name);
+        sizes[bucket_of(hashes[i])]++;
+    }
+
+    // Los baldes grandes primero, cuando la tabla todavía está vacía
+    size_t largest = 0;
+    for (size_t b = 0; built && b <= registry.bucket_mask; b++)
+        largest = sizes[b] > largest ? sizes[b] : largest;
+
+    for (size_t size = largest; built && size > 0; size--)
+    {
+        for (size_t b = 0; built && b <= registry.bucket_mask; b++)
+        {
+            if (sizes[b] != size)
+                continue;
+
+            size_t found = 0;
+            for (size_t i = 0; i < count; i++)
+            {
+                if (bucket_of(hashes[i]) == b)
+                    members[found++] = i;
+            }
+
+            uint32_t seed = place_bucket(members, found, hashes, taken);
+            built = seed < BUILTIN_MAX_SEED;
+            registry.seeds[b] = seed;
+        }
+    }
+
+    free(hashes);
+    free(sizes);
+    free(members);
+    free(taken);
+
+    if (!built)
+    {
+        free(registry.slots);
+        free(registry.seeds);
+        registry.slots = NULL;
+        registry.seeds = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int builtin_register(const builtin_command* commands, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        for (size_t j = 0; j < registry.count; j++)
+        {
+            if (strcmp(registry.commands[j]->name, commands[i].name) == 0)
+            {
+                fprintf(stderr, "Error: El comando interno %s ya existe\n", commands[i].name);
+                return -1;
+            }
+        }
+
+        if (registry.count == registry.capacity)
+        {
+            size_t capacity = registry.capacity ? registry.capacity * 2 : 32;
+            const builtin_command** larger = realloc(registry.commands, sizeof(registry.commands[0]) * capacity);
+            if (!larger)
+            {
+                perror("Error: No hay memoria para los comandos internos");
+                return -1;
+            }
+            registry.commands = larger;
+            registry.capacity = capacity;
+        }
+
+        registry.commands[registry.count++] = &commands[i];
+        registry.dirty = true;
+    }
+    return 0;
+}
+
+void builtin_unregister(const builtin_command* commands, size_t count)
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < registry.count; i++)
+    {
+        const builtin_command* command = registry.commands[i];
+        if (command >= commands && command < commands + count)
+            registry.dirty = true;
+        else
+            registry.commands[kept++] = command;
+    }
+    registry.count = kept;
+}
+
+const builtin_command* builtin_find(const char* name)
+{
+    if (registry.dirty)
+        rebuild();
+
+    if (registry.slots)
+    {
+        uint64_t hash = name_hash(name);
+        const builtin_command* command = registry.slots[slot_of(hash, registry.seeds[bucket_of(hash)])];
+        return command && strcmp(command->name, name) == 0 ? command : NULL;
+    }
+
+    // Sin tabla (no hubo memoria): la lista ordenada
+    for (size_t i = 0; i < registry.count; i++)
+    {
+        if (strcmp(registry.commands[i]->name, name) == 0)
+            return registry.commands[i];
+    }
+    return NULL;
+}
+
+const builtin_command* const* builtin_all(size_t* count)
+{
+    if (registry.dirty)
+        rebuild();
+    *count = registry.count;
+    return registry.commands;
+}
+
+/**
+ * @brief This function finds a program like execvp() does: in the PATH, or the name itself if it has a "/".
+ * @param name The name of the program.
+ * @param path Where to store the path, BUILTIN_PATH_LENGTH bytes.
+ * @return true if it was found.
+ */
+static bool find_program(const char* name, char* path)
+{
+    struct stat file;
+    if (strchr(name, '/'))
+    {
+        snprintf(path, BUILTIN_PATH_LENGTH, "%s", name);
+        return stat(path, &file) == 0 && S_ISREG(file.st_mode) && access(path, X_OK) == 0;
+    }
+
+    const char* directories = getenv("PATH");
+    if (!directories)
+        directories = "/usr/local/bin:/usr/bin:/bin";
+
+    while (1)
+    {
+        // Un directorio vacío es el actual
+        size_t length = strcspn(directories, ":");
+        int written = snprintf(path, BUILTIN_PATH_LENGTH, "%.*s%s%s", (int)length, directories, length ? "/" : "",
+                               name);
+        if (written > 0 && written < BUILTIN_PATH_LENGTH && stat(path, &file) == 0 && S_ISREG(file.st_mode) &&
+            access(path, X_OK) == 0)
+            return true;
+
+        if (directories[length] == '\0')
+            return false;
+        directories += length + 1;
+    }
+}
+
+int builtin_type(int argc, char* args[])
+{
+    if (argc < 2)
+    {
+        printf("Uso: type <nombre>...\n");
+        return 1;
+    }
+
+    int status = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        char path[BUILTIN_PATH_LENGTH];
+        if (builtin_find(args[i]))
+        {
+            printf("%s es un comando interno de la shell\n", args[i]);
+        }
+        else if (find_program(args[i], path))
+        {
+            printf("%s es %s\n", args[i], path);
+        }
+        else
+        {
+            printf("%s: no encontrado\n", args[i]);
+            status = 1;
+        }
+    }
+    return status;
+}
+
+int builtin_help(int argc, char* args[])
+{
+    if (argc < 2)
+    {
+        size_t count;
+        const builtin_command* const* commands = builtin_all(&count);
+        printf("Comandos internos (help <comando> muestra su uso):\n");
+        for (size_t i = 0; i < count; i++)
+            printf("  %-16s %s\n", commands[i]->name, commands[i]->summary);
+        return 0;
+    }
+
+    int status = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        const builtin_command* command = builtin_find(args[i]);
+        if (!command)
+        {
+            printf("help: %s no es un comando interno\n", args[i]);
+            status = 1;
+            continue;
+        }
+
+        printf("Uso: %s%s%s\n    %s\n", command->name, command->usage[0] ? " " : "", command->usage,
+               command->summary);
+        if (command->flags & BUILTIN_PARENT)
+            printf("    Cambia la shell: en segundo plano no tiene efecto.\n");
+        if (command->flags & BUILTIN_PIPELINE)
+            printf("    En un pipeline corre en un thread de la shell, sin fork.\n");
+    }
+    return status;
+}
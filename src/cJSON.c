@@ -44,6 +44,13 @@
 #include <limits.h>
 #include <ctype.h>
 #include <float.h>
+#include <stdint.h>
+#include <errno.h>
+#ifdef __WINDOWS__
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 #ifdef ENABLE_LOCALES
 #include <locale.h>
@@ -293,6 +300,7 @@ typedef struct
     size_t offset;
     size_t depth; /* How deeply nested (in arrays/objects) is the input at the current offset. */
     internal_hooks hooks;
+    cJSON_bool in_situ; /* decode strings in place, content is writable memory owned by the caller */
 } parse_buffer;
 
 /* check if the given size is left to read in a given parse buffer (starting with 1) */
@@ -303,13 +311,315 @@ typedef struct
 /* get a pointer to the buffer at the position */
 #define buffer_at_offset(buffer) ((buffer)->content + (buffer)->offset)
 
+/* fast number parsing:
+ * 1. integers with up to 19 significant digits are converted exactly
+ * 2. small mantissas with small decimal exponents use Clinger's fast path (one exact multiplication or division)
+ * 3. everything else with up to 19 significant digits uses the Eisel-Lemire algorithm
+ * 4. only the remaining (rare) inputs fall back to strtod */
+#define CJSON_POW10_MIN (-64)
+#define CJSON_POW10_MAX 64
+#define CJSON_MAX_MANTISSA_DIGITS 19
+#define CJSON_MAX_EXACT_MANTISSA ((uint64_t)1 << 53)
+
+/* Clinger's fast path relies on double arithmetic not using extended precision (e.g. x87) */
+#if !defined(FLT_EVAL_METHOD) || (FLT_EVAL_METHOD == 0)
+#define CJSON_CLINGER_FAST_PATH 1
+#else
+#define CJSON_CLINGER_FAST_PATH 0
+#endif
+
+/* exactly representable powers of ten for the Clinger fast path */
+static const double exact_powers_of_ten[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* 128 bit approximations (rounded down) of the powers of ten in [CJSON_POW10_MIN, CJSON_POW10_MAX],
+ * normalized so that the most significant bit is set. {low 64 bits, high 64 bits} */
+static const uint64_t detailed_powers_of_ten[CJSON_POW10_MAX - CJSON_POW10_MIN + 1][2] = {
+    {0x3F2398D747B36224ULL, 0xA87FEA27A539E9A5ULL}, /* 1e-64 */
+    {0x8EEC7F0D19A03AADULL, 0xD29FE4B18E88640EULL}, /* 1e-63 */
+    {0x1953CF68300424ACULL, 0x83A3EEEEF9153E89ULL}, /* 1e-62 */
+    {0x5FA8C3423C052DD7ULL, 0xA48CEAAAB75A8E2BULL}, /* 1e-61 */
+    {0x3792F412CB06794DULL, 0xCDB02555653131B6ULL}, /* 1e-60 */
+    {0xE2BBD88BBEE40BD0ULL, 0x808E17555F3EBF11ULL}, /* 1e-59 */
+    {0x5B6ACEAEAE9D0EC4ULL, 0xA0B19D2AB70E6ED6ULL}, /* 1e-58 */
+    {0xF245825A5A445275ULL, 0xC8DE047564D20A8BULL}, /* 1e-57 */
+    {0xEED6E2F0F0D56712ULL, 0xFB158592BE068D2EULL}, /* 1e-56 */
+    {0x55464DD69685606BULL, 0x9CED737BB6C4183DULL}, /* 1e-55 */
+    {0xAA97E14C3C26B886ULL, 0xC428D05AA4751E4CULL}, /* 1e-54 */
+    {0xD53DD99F4B3066A8ULL, 0xF53304714D9265DFULL}, /* 1e-53 */
+    {0xE546A8038EFE4029ULL, 0x993FE2C6D07B7FABULL}, /* 1e-52 */
+    {0xDE98520472BDD033ULL, 0xBF8FDB78849A5F96ULL}, /* 1e-51 */
+    {0x963E66858F6D4440ULL, 0xEF73D256A5C0F77CULL}, /* 1e-50 */
+    {0xDDE7001379A44AA8ULL, 0x95A8637627989AADULL}, /* 1e-49 */
+    {0x5560C018580D5D52ULL, 0xBB127C53B17EC159ULL}, /* 1e-48 */
+    {0xAAB8F01E6E10B4A6ULL, 0xE9D71B689DDE71AFULL}, /* 1e-47 */
+    {0xCAB3961304CA70E8ULL, 0x9226712162AB070DULL}, /* 1e-46 */
+    {0x3D607B97C5FD0D22ULL, 0xB6B00D69BB55C8D1ULL}, /* 1e-45 */
+    {0x8CB89A7DB77C506AULL, 0xE45C10C42A2B3B05ULL}, /* 1e-44 */
+    {0x77F3608E92ADB242ULL, 0x8EB98A7A9A5B04E3ULL}, /* 1e-43 */
+    {0x55F038B237591ED3ULL, 0xB267ED1940F1C61CULL}, /* 1e-42 */
+    {0x6B6C46DEC52F6688ULL, 0xDF01E85F912E37A3ULL}, /* 1e-41 */
+    {0x2323AC4B3B3DA015ULL, 0x8B61313BBABCE2C6ULL}, /* 1e-40 */
+    {0xABEC975E0A0D081AULL, 0xAE397D8AA96C1B77ULL}, /* 1e-39 */
+    {0x96E7BD358C904A21ULL, 0xD9C7DCED53C72255ULL}, /* 1e-38 */
+    {0x7E50D64177DA2E54ULL, 0x881CEA14545C7575ULL}, /* 1e-37 */
+    {0xDDE50BD1D5D0B9E9ULL, 0xAA242499697392D2ULL}, /* 1e-36 */
+    {0x955E4EC64B44E864ULL, 0xD4AD2DBFC3D07787ULL}, /* 1e-35 */
+    {0xBD5AF13BEF0B113EULL, 0x84EC3C97DA624AB4ULL}, /* 1e-34 */
+    {0xECB1AD8AEACDD58EULL, 0xA6274BBDD0FADD61ULL}, /* 1e-33 */
+    {0x67DE18EDA5814AF2ULL, 0xCFB11EAD453994BAULL}, /* 1e-32 */
+    {0x80EACF948770CED7ULL, 0x81CEB32C4B43FCF4ULL}, /* 1e-31 */
+    {0xA1258379A94D028DULL, 0xA2425FF75E14FC31ULL}, /* 1e-30 */
+    {0x096EE45813A04330ULL, 0xCAD2F7F5359A3B3EULL}, /* 1e-29 */
+    {0x8BCA9D6E188853FCULL, 0xFD87B5F28300CA0DULL}, /* 1e-28 */
+    {0x775EA264CF55347DULL, 0x9E74D1B791E07E48ULL}, /* 1e-27 */
+    {0x95364AFE032A819DULL, 0xC612062576589DDAULL}, /* 1e-26 */
+    {0x3A83DDBD83F52204ULL, 0xF79687AED3EEC551ULL}, /* 1e-25 */
+    {0xC4926A9672793542ULL, 0x9ABE14CD44753B52ULL}, /* 1e-24 */
+    {0x75B7053C0F178293ULL, 0xC16D9A0095928A27ULL}, /* 1e-23 */
+    {0x5324C68B12DD6338ULL, 0xF1C90080BAF72CB1ULL}, /* 1e-22 */
+    {0xD3F6FC16EBCA5E03ULL, 0x971DA05074DA7BEEULL}, /* 1e-21 */
+    {0x88F4BB1CA6BCF584ULL, 0xBCE5086492111AEAULL}, /* 1e-20 */
+    {0x2B31E9E3D06C32E5ULL, 0xEC1E4A7DB69561A5ULL}, /* 1e-19 */
+    {0x3AFF322E62439FCFULL, 0x9392EE8E921D5D07ULL}, /* 1e-18 */
+    {0x09BEFEB9FAD487C2ULL, 0xB877AA3236A4B449ULL}, /* 1e-17 */
+    {0x4C2EBE687989A9B3ULL, 0xE69594BEC44DE15BULL}, /* 1e-16 */
+    {0x0F9D37014BF60A10ULL, 0x901D7CF73AB0ACD9ULL}, /* 1e-15 */
+    {0x538484C19EF38C94ULL, 0xB424DC35095CD80FULL}, /* 1e-14 */
+    {0x2865A5F206B06FB9ULL, 0xE12E13424BB40E13ULL}, /* 1e-13 */
+    {0xF93F87B7442E45D3ULL, 0x8CBCCC096F5088CBULL}, /* 1e-12 */
+    {0xF78F69A51539D748ULL, 0xAFEBFF0BCB24AAFEULL}, /* 1e-11 */
+    {0xB573440E5A884D1BULL, 0xDBE6FECEBDEDD5BEULL}, /* 1e-10 */
+    {0x31680A88F8953030ULL, 0x89705F4136B4A597ULL}, /* 1e-9 */
+    {0xFDC20D2B36BA7C3DULL, 0xABCC77118461CEFCULL}, /* 1e-8 */
+    {0x3D32907604691B4CULL, 0xD6BF94D5E57A42BCULL}, /* 1e-7 */
+    {0xA63F9A49C2C1B10FULL, 0x8637BD05AF6C69B5ULL}, /* 1e-6 */
+    {0x0FCF80DC33721D53ULL, 0xA7C5AC471B478423ULL}, /* 1e-5 */
+    {0xD3C36113404EA4A8ULL, 0xD1B71758E219652BULL}, /* 1e-4 */
+    {0x645A1CAC083126E9ULL, 0x83126E978D4FDF3BULL}, /* 1e-3 */
+    {0x3D70A3D70A3D70A3ULL, 0xA3D70A3D70A3D70AULL}, /* 1e-2 */
+    {0xCCCCCCCCCCCCCCCCULL, 0xCCCCCCCCCCCCCCCCULL}, /* 1e-1 */
+    {0x0000000000000000ULL, 0x8000000000000000ULL}, /* 1e0 */
+    {0x0000000000000000ULL, 0xA000000000000000ULL}, /* 1e1 */
+    {0x0000000000000000ULL, 0xC800000000000000ULL}, /* 1e2 */
+    {0x0000000000000000ULL, 0xFA00000000000000ULL}, /* 1e3 */
+    {0x0000000000000000ULL, 0x9C40000000000000ULL}, /* 1e4 */
+    {0x0000000000000000ULL, 0xC350000000000000ULL}, /* 1e5 */
+    {0x0000000000000000ULL, 0xF424000000000000ULL}, /* 1e6 */
+    {0x0000000000000000ULL, 0x9896800000000000ULL}, /* 1e7 */
+    {0x0000000000000000ULL, 0xBEBC200000000000ULL}, /* 1e8 */
+    {0x0000000000000000ULL, 0xEE6B280000000000ULL}, /* 1e9 */
+    {0x0000000000000000ULL, 0x9502F90000000000ULL}, /* 1e10 */
+    {0x0000000000000000ULL, 0xBA43B74000000000ULL}, /* 1e11 */
+    {0x0000000000000000ULL, 0xE8D4A51000000000ULL}, /* 1e12 */
+    {0x0000000000000000ULL, 0x9184E72A00000000ULL}, /* 1e13 */
+    {0x0000000000000000ULL, 0xB5E620F480000000ULL}, /* 1e14 */
+    {0x0000000000000000ULL, 0xE35FA931A0000000ULL}, /* 1e15 */
+    {0x0000000000000000ULL, 0x8E1BC9BF04000000ULL}, /* 1e16 */
+    {0x0000000000000000ULL, 0xB1A2BC2EC5000000ULL}, /* 1e17 */
+    {0x0000000000000000ULL, 0xDE0B6B3A76400000ULL}, /* 1e18 */
+    {0x0000000000000000ULL, 0x8AC7230489E80000ULL}, /* 1e19 */
+    {0x0000000000000000ULL, 0xAD78EBC5AC620000ULL}, /* 1e20 */
+    {0x0000000000000000ULL, 0xD8D726B7177A8000ULL}, /* 1e21 */
+    {0x0000000000000000ULL, 0x878678326EAC9000ULL}, /* 1e22 */
+    {0x0000000000000000ULL, 0xA968163F0A57B400ULL}, /* 1e23 */
+    {0x0000000000000000ULL, 0xD3C21BCECCEDA100ULL}, /* 1e24 */
+    {0x0000000000000000ULL, 0x84595161401484A0ULL}, /* 1e25 */
+    {0x0000000000000000ULL, 0xA56FA5B99019A5C8ULL}, /* 1e26 */
+    {0x0000000000000000ULL, 0xCECB8F27F4200F3AULL}, /* 1e27 */
+    {0x4000000000000000ULL, 0x813F3978F8940984ULL}, /* 1e28 */
+    {0x5000000000000000ULL, 0xA18F07D736B90BE5ULL}, /* 1e29 */
+    {0xA400000000000000ULL, 0xC9F2C9CD04674EDEULL}, /* 1e30 */
+    {0x4D00000000000000ULL, 0xFC6F7C4045812296ULL}, /* 1e31 */
+    {0xF020000000000000ULL, 0x9DC5ADA82B70B59DULL}, /* 1e32 */
+    {0x6C28000000000000ULL, 0xC5371912364CE305ULL}, /* 1e33 */
+    {0xC732000000000000ULL, 0xF684DF56C3E01BC6ULL}, /* 1e34 */
+    {0x3C7F400000000000ULL, 0x9A130B963A6C115CULL}, /* 1e35 */
+    {0x4B9F100000000000ULL, 0xC097CE7BC90715B3ULL}, /* 1e36 */
+    {0x1E86D40000000000ULL, 0xF0BDC21ABB48DB20ULL}, /* 1e37 */
+    {0x1314448000000000ULL, 0x96769950B50D88F4ULL}, /* 1e38 */
+    {0x17D955A000000000ULL, 0xBC143FA4E250EB31ULL}, /* 1e39 */
+    {0x5DCFAB0800000000ULL, 0xEB194F8E1AE525FDULL}, /* 1e40 */
+    {0x5AA1CAE500000000ULL, 0x92EFD1B8D0CF37BEULL}, /* 1e41 */
+    {0xF14A3D9E40000000ULL, 0xB7ABC627050305ADULL}, /* 1e42 */
+    {0x6D9CCD05D0000000ULL, 0xE596B7B0C643C719ULL}, /* 1e43 */
+    {0xE4820023A2000000ULL, 0x8F7E32CE7BEA5C6FULL}, /* 1e44 */
+    {0xDDA2802C8A800000ULL, 0xB35DBF821AE4F38BULL}, /* 1e45 */
+    {0xD50B2037AD200000ULL, 0xE0352F62A19E306EULL}, /* 1e46 */
+    {0x4526F422CC340000ULL, 0x8C213D9DA502DE45ULL}, /* 1e47 */
+    {0x9670B12B7F410000ULL, 0xAF298D050E4395D6ULL}, /* 1e48 */
+    {0x3C0CDD765F114000ULL, 0xDAF3F04651D47B4CULL}, /* 1e49 */
+    {0xA5880A69FB6AC800ULL, 0x88D8762BF324CD0FULL}, /* 1e50 */
+    {0x8EEA0D047A457A00ULL, 0xAB0E93B6EFEE0053ULL}, /* 1e51 */
+    {0x72A4904598D6D880ULL, 0xD5D238A4ABE98068ULL}, /* 1e52 */
+    {0x47A6DA2B7F864750ULL, 0x85A36366EB71F041ULL}, /* 1e53 */
+    {0x999090B65F67D924ULL, 0xA70C3C40A64E6C51ULL}, /* 1e54 */
+    {0xFFF4B4E3F741CF6DULL, 0xD0CF4B50CFE20765ULL}, /* 1e55 */
+    {0xBFF8F10E7A8921A4ULL, 0x82818F1281ED449FULL}, /* 1e56 */
+    {0xAFF72D52192B6A0DULL, 0xA321F2D7226895C7ULL}, /* 1e57 */
+    {0x9BF4F8A69F764490ULL, 0xCBEA6F8CEB02BB39ULL}, /* 1e58 */
+    {0x02F236D04753D5B4ULL, 0xFEE50B7025C36A08ULL}, /* 1e59 */
+    {0x01D762422C946590ULL, 0x9F4F2726179A2245ULL}, /* 1e60 */
+    {0x424D3AD2B7B97EF5ULL, 0xC722F0EF9D80AAD6ULL}, /* 1e61 */
+    {0xD2E0898765A7DEB2ULL, 0xF8EBAD2B84E0D58BULL}, /* 1e62 */
+    {0x63CC55F49F88EB2FULL, 0x9B934C3B330C8577ULL}, /* 1e63 */
+    {0x3CBF6B71C76B25FBULL, 0xC2781F49FFCFA6D5ULL}, /* 1e64 */
+};
+
+/* 64x64 -> 128 bit multiplication, returns the high half */
+static uint64_t multiply_64(const uint64_t a, const uint64_t b, uint64_t * const low)
+{
+#if defined(__GNUC__) && defined(__SIZEOF_INT128__)
+    __extension__ typedef unsigned __int128 uint128;
+    uint128 product = (uint128)a * b;
+    *low = (uint64_t)product;
+    return (uint64_t)(product >> 64);
+#else
+    uint64_t a_low = a & 0xFFFFFFFF;
+    uint64_t a_high = a >> 32;
+    uint64_t b_low = b & 0xFFFFFFFF;
+    uint64_t b_high = b >> 32;
+    uint64_t low_low = a_low * b_low;
+    uint64_t high_low = a_high * b_low;
+    uint64_t low_high = a_low * b_high;
+    uint64_t middle = high_low + (low_low >> 32) + (low_high & 0xFFFFFFFF);
+
+    *low = (middle << 32) | (low_low & 0xFFFFFFFF);
+    return (a_high * b_high) + (middle >> 32) + (low_high >> 32);
+#endif
+}
+
+static int count_leading_zeros_64(uint64_t value)
+{
+#if defined(__GNUC__)
+    return __builtin_clzll(value);
+#else
+    int count = 0;
+    while ((value & ((uint64_t)1 << 63)) == 0)
+    {
+        value <<= 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+/* Eisel-Lemire: compute mantissa * 10^exponent correctly rounded, or return false if it can't decide */
+static cJSON_bool eisel_lemire(uint64_t mantissa, const int exponent, const cJSON_bool negative, double * const result)
+{
+    const uint64_t *power = NULL;
+    uint64_t high = 0;
+    uint64_t low = 0;
+    uint64_t binary_exponent = 0;
+    uint64_t upper_bit = 0;
+    uint64_t bits = 0;
+    int leading_zeros = 0;
+
+    if ((exponent < CJSON_POW10_MIN) || (exponent > CJSON_POW10_MAX) || (mantissa == 0))
+    {
+        return false;
+    }
+    power = detailed_powers_of_ten[exponent - CJSON_POW10_MIN];
+
+    /* normalize */
+    leading_zeros = count_leading_zeros_64(mantissa);
+    mantissa <<= leading_zeros;
+    /* floor(log2(10) * exponent) + 64 + bias - leading zeros */
+    binary_exponent = (uint64_t)(((217706 * exponent) >> 16) + 64 + 1023 - leading_zeros);
+
+    high = multiply_64(mantissa, power[1], &low);
+
+    /* the truncated product may be too imprecise, take the lower 64 bits of the power into account */
+    if (((high & 0x1FF) == 0x1FF) && ((low + mantissa) < mantissa))
+    {
+        uint64_t second_low = 0;
+        uint64_t second_high = multiply_64(mantissa, power[0], &second_low);
+        uint64_t merged_high = high;
+        uint64_t merged_low = low + second_high;
+        if (merged_low < low)
+        {
+            merged_high++;
+        }
+        if (((merged_high & 0x1FF) == 0x1FF) && ((merged_low + 1) == 0) && ((second_low + mantissa) < mantissa))
+        {
+            return false;
+        }
+        high = merged_high;
+        low = merged_low;
+    }
+
+    /* shift down to 54 bits */
+    upper_bit = high >> 63;
+    bits = high >> (upper_bit + 9);
+    binary_exponent -= 1 ^ upper_bit;
+
+    /* exactly halfway between two doubles, let strtod decide */
+    if ((low == 0) && ((high & 0x1FF) == 0) && ((bits & 3) == 1))
+    {
+        return false;
+    }
+
+    /* round to 53 bits */
+    bits += bits & 1;
+    bits >>= 1;
+    if ((bits >> 53) > 0)
+    {
+        bits >>= 1;
+        binary_exponent++;
+    }
+
+    /* subnormal, infinity or NaN */
+    if ((binary_exponent - 1) >= (0x7FF - 1))
+    {
+        return false;
+    }
+
+    bits = (binary_exponent << 52) | (bits & (((uint64_t)1 << 52) - 1));
+    if (negative)
+    {
+        bits |= (uint64_t)1 << 63;
+    }
+    memcpy(result, &bits, sizeof(*result));
+
+    return true;
+}
+
+/* slow path: let strtod convert the number, replacing '.' with the decimal point of the current locale.
+ * Returns the number of characters consumed or 0 on error. */
+static size_t strtod_number(const unsigned char * const number, const size_t length, double * const result)
+{
+    unsigned char number_c_string[64];
+    unsigned char *after_end = NULL;
+    unsigned char decimal_point = get_decimal_point();
+    size_t i = 0;
+
+    for (i = 0; (i < length) && (i < (sizeof(number_c_string) - 1)); i++)
+    {
+        number_c_string[i] = (number[i] == '.') ? decimal_point : number[i];
+    }
+    number_c_string[i] = '\0';
+
+    *result = strtod((const char*)number_c_string, (char**)&after_end);
+
+    return (size_t)(after_end - number_c_string);
+}
+
 /* Parse the input text to generate a number, and populate the result into item. */
 static cJSON_bool parse_number(cJSON * const item, parse_buffer * const input_buffer)
 {
+    const unsigned char *number_string = NULL;
     double number = 0;
-    unsigned char *after_end = NULL;
-    unsigned char number_c_string[64];
-    unsigned char decimal_point = get_decimal_point();
+    uint64_t mantissa = 0;
+    int significant_digits = 0;
+    int digits = 0;
+    int exponent = 0;
+    int explicit_exponent = 0;
+    cJSON_bool negative = false;
+    cJSON_bool truncated = false;
+    cJSON_bool is_integer = true;
+    size_t length = 0;
     size_t i = 0;
 
     if ((input_buffer == NULL) || (input_buffer->content == NULL))
@@ -317,43 +627,117 @@ static cJSON_bool parse_number(cJSON * const item, parse_buffer * const input_bu
         return false;
     }
 
-    /* copy the number into a temporary buffer and replace '.' with the decimal point
-     * of the current locale (for strtod)
-     * This also takes care of '\0' not necessarily being available for marking the end of the input */
-    for (i = 0; (i < (sizeof(number_c_string) - 1)) && can_access_at_index(input_buffer, i); i++)
-    {
-        switch (buffer_at_offset(input_buffer)[i])
-        {
-            case '0':
-            case '1':
-            case '2':
-            case '3':
-            case '4':
-            case '5':
-            case '6':
-            case '7':
-            case '8':
-            case '9':
-            case '+':
-            case '-':
-            case 'e':
-            case 'E':
-                number_c_string[i] = buffer_at_offset(input_buffer)[i];
-                break;
+    /* the length check also takes care of '\0' not necessarily being available for marking the end of the input */
+    number_string = buffer_at_offset(input_buffer);
+    length = input_buffer->length - input_buffer->offset;
 
-            case '.':
-                number_c_string[i] = decimal_point;
-                break;
+    if ((i < length) && (number_string[i] == '-'))
+    {
+        negative = true;
+        i++;
+    }
 
-            default:
-                goto loop_end;
+    /* integer part, leading zeros are not significant */
+    for (; (i < length) && (number_string[i] >= '0') && (number_string[i] <= '9'); i++, digits++)
+    {
+        if ((mantissa == 0) && (number_string[i] == '0'))
+        {
+            continue;
+        }
+        if (significant_digits < CJSON_MAX_MANTISSA_DIGITS)
+        {
+            mantissa = (mantissa * 10) + (uint64_t)(number_string[i] - '0');
+            significant_digits++;
+        }
+        else
+        {
+            truncated = true;
         }
     }
-loop_end:
-    number_c_string[i] = '\0';
 
-    number = strtod((const char*)number_c_string, (char**)&after_end);
-    if (number_c_string == after_end)
+    /* fractional part */
+    if ((i < length) && (number_string[i] == '.'))
+    {
+        is_integer = false;
+        for (i++; (i < length) && (number_string[i] >= '0') && (number_string[i] <= '9'); i++, digits++)
+        {
+            if ((mantissa == 0) && (number_string[i] == '0'))
+            {
+                exponent--;
+                continue;
+            }
+            if (significant_digits < CJSON_MAX_MANTISSA_DIGITS)
+            {
+                mantissa = (mantissa * 10) + (uint64_t)(number_string[i] - '0');
+                significant_digits++;
+                exponent--;
+            }
+            else
+            {
+                truncated = true;
+            }
+        }
+    }
+
+    if (digits == 0)
+    {
+        return false; /* parse_error */
+    }
+
+    /* exponent, only consumed if at least one digit follows (like strtod) */
+    if ((i < length) && ((number_string[i] == 'e') || (number_string[i] == 'E')))
+    {
+        size_t exponent_start = i + 1;
+        cJSON_bool negative_exponent = false;
+
+        if ((exponent_start < length) && ((number_string[exponent_start] == '-') || (number_string[exponent_start] == '+')))
+        {
+            negative_exponent = number_string[exponent_start] == '-';
+            exponent_start++;
+        }
+        if ((exponent_start < length) && (number_string[exponent_start] >= '0') && (number_string[exponent_start] <= '9'))
+        {
+            is_integer = false;
+            for (i = exponent_start; (i < length) && (number_string[i] >= '0') && (number_string[i] <= '9'); i++)
+            {
+                /* saturate, exponents this large are left to strtod */
+                if (explicit_exponent < 100000)
+                {
+                    explicit_exponent = (explicit_exponent * 10) + (number_string[i] - '0');
+                }
+            }
+            exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+        }
+    }
+
+    if (truncated)
+    {
+        i = strtod_number(number_string, i, &number);
+    }
+    else if (mantissa == 0)
+    {
+        number = negative ? -0.0 : 0.0;
+    }
+    else if (is_integer)
+    {
+        /* exact up to 2^53, correctly rounded beyond that */
+        number = (double)mantissa;
+        number = negative ? -number : number;
+    }
+#if CJSON_CLINGER_FAST_PATH
+    else if ((mantissa <= CJSON_MAX_EXACT_MANTISSA) && (exponent >= -22) && (exponent <= 22))
+    {
+        number = (double)mantissa;
+        number = (exponent < 0) ? (number / exact_powers_of_ten[-exponent]) : (number * exact_powers_of_ten[exponent]);
+        number = negative ? -number : number;
+    }
+#endif
+    else if (!eisel_lemire(mantissa, exponent, negative, &number))
+    {
+        i = strtod_number(number_string, i, &number);
+    }
+
+    if (i == 0)
     {
         return false; /* parse_error */
     }
@@ -376,7 +760,7 @@ loop_end:
 
     item->type = cJSON_Number;
 
-    input_buffer->offset += (size_t)(after_end - number_c_string);
+    input_buffer->offset += i;
     return true;
 }
 
@@ -788,6 +1172,8 @@ fail:
     return 0;
 }
 
+static void* cast_away_const(const void* string);
+
 /* Parse the input text into an unescaped cinput, and populate item. */
 static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_buffer)
 {
@@ -826,12 +1212,20 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
             goto fail; /* string ended unexpectedly */
         }
 
-        /* This is at most how much we need for the output */
-        allocation_length = (size_t) (input_end - buffer_at_offset(input_buffer)) - skipped_bytes;
-        output = (unsigned char*)input_buffer->hooks.allocate(allocation_length + sizeof(""));
-        if (output == NULL)
+        if (input_buffer->in_situ)
         {
-            goto fail; /* allocation failure */
+            /* escape sequences only ever shrink, so the decoded string fits where the literal was */
+            output = (unsigned char*)cast_away_const(input_pointer);
+        }
+        else
+        {
+            /* This is at most how much we need for the output */
+            allocation_length = (size_t) (input_end - buffer_at_offset(input_buffer)) - skipped_bytes;
+            output = (unsigned char*)input_buffer->hooks.allocate(allocation_length + sizeof(""));
+            if (output == NULL)
+            {
+                goto fail; /* allocation failure */
+            }
         }
     }
 
@@ -897,6 +1291,11 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
 
     item->type = cJSON_String;
     item->valuestring = (char*)output;
+    if (input_buffer->in_situ)
+    {
+        /* the string isn't owned by the item, like with cJSON_CreateStringReference */
+        item->type |= cJSON_IsReference;
+    }
 
     input_buffer->offset = (size_t) (input_end - input_buffer->content);
     input_buffer->offset++;
@@ -904,7 +1303,7 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
     return true;
 
 fail:
-    if (output != NULL)
+    if ((output != NULL) && !input_buffer->in_situ)
     {
         input_buffer->hooks.deallocate(output);
         output = NULL;
@@ -1112,9 +1511,9 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return
 }
 
 /* Parse an object - create a new root, and populate. */
-CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated)
+static cJSON *parse_with_length_opts(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated, cJSON_bool in_situ)
 {
-    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 } };
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 }, 0 };
     cJSON *item = NULL;
 
     /* reset error position */
@@ -1130,6 +1529,7 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer
     buffer.length = buffer_length;
     buffer.offset = 0;
     buffer.hooks = global_hooks;
+    buffer.in_situ = in_situ;
 
     item = cJSON_New_Item(&global_hooks);
     if (item == NULL) /* memory fail */
@@ -1191,6 +1591,22 @@ fail:
     return NULL;
 }
 
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated)
+{
+    return parse_with_length_opts(value, buffer_length, return_parse_end, require_null_terminated, false);
+}
+
+/* In-situ parsing: strings are decoded inside value, which must stay alive (and unmodified) as long as the tree. */
+CJSON_PUBLIC(cJSON *) cJSON_ParseInSitu(char *value, size_t buffer_length)
+{
+    return parse_with_length_opts(value, buffer_length, NULL, false, true);
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseInSituWithOpts(char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated)
+{
+    return parse_with_length_opts(value, buffer_length, return_parse_end, require_null_terminated, true);
+}
+
 /* Default options for cJSON_Parse */
 CJSON_PUBLIC(cJSON *) cJSON_Parse(const char *value)
 {
@@ -1313,6 +1729,204 @@ CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON
     return (char*)p.buffer;
 }
 
+struct cJSON_Writer
+{
+    unsigned char *buffer;
+    size_t size; /* allocated size */
+    size_t length; /* used size, without the terminating '\0' */
+    internal_hooks hooks;
+};
+
+CJSON_PUBLIC(cJSON_Writer *) cJSON_CreateWriter(size_t initial_size)
+{
+    static const size_t default_buffer_size = 256;
+    cJSON_Writer *writer = (cJSON_Writer*)global_hooks.allocate(sizeof(cJSON_Writer));
+    if (writer == NULL)
+    {
+        return NULL;
+    }
+
+    writer->hooks = global_hooks;
+    writer->size = (initial_size > 0) ? initial_size : default_buffer_size;
+    writer->length = 0;
+    writer->buffer = (unsigned char*)writer->hooks.allocate(writer->size);
+    if (writer->buffer == NULL)
+    {
+        writer->hooks.deallocate(writer);
+        return NULL;
+    }
+    writer->buffer[0] = '\0';
+
+    return writer;
+}
+
+CJSON_PUBLIC(void) cJSON_DeleteWriter(cJSON_Writer *writer)
+{
+    if (writer == NULL)
+    {
+        return;
+    }
+
+    if (writer->buffer != NULL)
+    {
+        writer->hooks.deallocate(writer->buffer);
+    }
+    writer->hooks.deallocate(writer);
+}
+
+/* render item at the end of the writer's buffer, growing it through ensure() if needed */
+static cJSON_bool writer_print(cJSON_Writer * const writer, const cJSON * const item, const cJSON_bool format, const cJSON_bool newline)
+{
+    printbuffer buffer[1];
+    unsigned char *output_pointer = NULL;
+    cJSON_bool success = false;
+
+    if ((writer == NULL) || (item == NULL))
+    {
+        return false;
+    }
+
+    /* the buffer is gone after a failed reallocation, start over */
+    if (writer->buffer == NULL)
+    {
+        writer->buffer = (unsigned char*)writer->hooks.allocate(writer->size);
+        writer->length = 0;
+        if (writer->buffer == NULL)
+        {
+            return false;
+        }
+    }
+
+    memset(buffer, 0, sizeof(buffer));
+    buffer->buffer = writer->buffer;
+    buffer->length = writer->size;
+    buffer->offset = writer->length;
+    buffer->format = format;
+    buffer->hooks = writer->hooks;
+
+    success = print_value(item, buffer);
+    if (success)
+    {
+        update_offset(buffer);
+        if (newline)
+        {
+            output_pointer = ensure(buffer, 1);
+            success = output_pointer != NULL;
+            if (success)
+            {
+                *output_pointer++ = '\n';
+                *output_pointer = '\0';
+                buffer->offset++;
+            }
+        }
+    }
+
+    /* ensure() may have moved or (on failure) freed the buffer */
+    writer->buffer = buffer->buffer;
+    writer->size = (buffer->buffer != NULL) ? buffer->length : writer->size;
+    if (writer->buffer == NULL)
+    {
+        writer->length = 0;
+        return false;
+    }
+
+    if (success)
+    {
+        writer->length = buffer->offset;
+    }
+    /* drop a partially printed item */
+    writer->buffer[writer->length] = '\0';
+
+    return success;
+}
+
+CJSON_PUBLIC(const char *) cJSON_WriterPrint(cJSON_Writer *writer, const cJSON *item, cJSON_bool format)
+{
+    cJSON_WriterReset(writer);
+    if (!writer_print(writer, item, format, false))
+    {
+        return NULL;
+    }
+
+    return (const char*)writer->buffer;
+}
+
+CJSON_PUBLIC(const char *) cJSON_WriterAppend(cJSON_Writer *writer, const cJSON *item, cJSON_bool format)
+{
+    if (!writer_print(writer, item, format, true))
+    {
+        return NULL;
+    }
+
+    return (const char*)writer->buffer;
+}
+
+CJSON_PUBLIC(const char *) cJSON_WriterGetBuffer(const cJSON_Writer *writer)
+{
+    if ((writer == NULL) || (writer->buffer == NULL))
+    {
+        return NULL;
+    }
+
+    return (const char*)writer->buffer;
+}
+
+CJSON_PUBLIC(size_t) cJSON_WriterGetLength(const cJSON_Writer *writer)
+{
+    if (writer == NULL)
+    {
+        return 0;
+    }
+
+    return writer->length;
+}
+
+CJSON_PUBLIC(void) cJSON_WriterReset(cJSON_Writer *writer)
+{
+    if (writer == NULL)
+    {
+        return;
+    }
+
+    writer->length = 0;
+    if (writer->buffer != NULL)
+    {
+        writer->buffer[0] = '\0';
+    }
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_WriterFlush(cJSON_Writer *writer, int fd)
+{
+    size_t written = 0;
+
+    if ((writer == NULL) || (fd < 0))
+    {
+        return false;
+    }
+
+    while (written < writer->length)
+    {
+#ifdef __WINDOWS__
+        int result = _write(fd, writer->buffer + written, (unsigned int)cjson_min(writer->length - written, INT_MAX));
+#else
+        ssize_t result = write(fd, writer->buffer + written, writer->length - written);
+#endif
+        if (result < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        written += (size_t)result;
+    }
+
+    cJSON_WriterReset(writer);
+
+    return true;
+}
+
 CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buffer, const int length, const cJSON_bool format)
 {
     printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 } };
@@ -1626,6 +2240,7 @@ static cJSON_bool parse_object(cJSON * const item, parse_buffer * const input_bu
 {
     cJSON *head = NULL; /* linked list head */
     cJSON *current_item = NULL;
+    cJSON_bool parsed = false;
 
     if (input_buffer->depth >= CJSON_NESTING_LIMIT)
     {
@@ -1695,6 +2310,11 @@ static cJSON_bool parse_object(cJSON * const item, parse_buffer * const input_bu
         /* swap valuestring and string, because we parsed the name */
         current_item->string = current_item->valuestring;
         current_item->valuestring = NULL;
+        if (input_buffer->in_situ)
+        {
+            /* the name points into the input buffer */
+            current_item->type |= cJSON_StringIsConst;
+        }
 
         if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != ':'))
         {
@@ -1704,7 +2324,13 @@ static cJSON_bool parse_object(cJSON * const item, parse_buffer * const input_bu
         /* parse the value */
         input_buffer->offset++;
         buffer_skip_whitespace(input_buffer);
-        if (!parse_value(current_item, input_buffer))
+        parsed = parse_value(current_item, input_buffer);
+        if (input_buffer->in_situ)
+        {
+            /* parse_value overwrites the type, keep the name from being freed */
+            current_item->type |= cJSON_StringIsConst;
+        }
+        if (!parsed)
         {
             goto fail; /* failed to parse value */
         }
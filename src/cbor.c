@@ -0,0 +1,750 @@
+/**
+ * @file cbor.c
+ * @brief This file contains the implementation of the CBOR codec for cJSON trees.
+ */
+#include "cbor.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief CBOR major types.
+ */
+enum cbor_major
+{
+    CBOR_UNSIGNED = 0,
+    CBOR_NEGATIVE = 1,
+    CBOR_BYTES = 2,
+    CBOR_TEXT = 3,
+    CBOR_ARRAY = 4,
+    CBOR_MAP = 5,
+    CBOR_TAG = 6,
+    CBOR_SIMPLE = 7
+};
+
+/**
+ * @brief Additional information value for indefinite lengths.
+ */
+#define CBOR_INDEFINITE 31
+
+/**
+ * @brief The "break" stop code of indefinite length items.
+ */
+#define CBOR_BREAK 0xFF
+
+/**
+ * @brief Tag that marks self-described CBOR (0xD9 0xD9 0xF7).
+ */
+#define CBOR_SELF_DESCRIBED 55799
+
+/**
+ * @brief Growable output buffer of the encoder.
+ */
+typedef struct
+{
+    unsigned char* data; /**< Encoded bytes. */
+    size_t length;       /**< Used bytes. */
+    size_t capacity;     /**< Allocated bytes. */
+} cbor_writer;
+
+/**
+ * @brief Input cursor of the decoder.
+ */
+typedef struct
+{
+    const unsigned char* data; /**< Encoded bytes. */
+    size_t length;             /**< Number of bytes. */
+    size_t offset;             /**< Current position. */
+    size_t depth;              /**< Current nesting depth. */
+} cbor_reader;
+
+/**
+ * @brief Header of a data item: major type and argument.
+ */
+typedef struct
+{
+    int major;         /**< Major type. */
+    int info;          /**< Additional information (low 5 bits of the first byte). */
+    uint64_t argument; /**< Length, value or simple value. */
+} cbor_header;
+
+/**
+ * @brief Reserves space at the end of the output.
+ * @param writer The writer.
+ * @param needed The number of bytes needed.
+ * @return Pointer to the reserved space, NULL if memory runs out.
+ */
+static unsigned char* reserve(cbor_writer* writer, size_t needed)
+{
+    if (writer->length + needed > writer->capacity)
+    {
+        size_t capacity = writer->capacity ? writer->capacity : 256;
+        while (capacity < writer->length + needed)
+        {
+            capacity *= 2;
+        }
+
+        unsigned char* data = realloc(writer->data, capacity);
+        if (!data)
+        {
+            return NULL;
+        }
+        writer->data = data;
+        writer->capacity = capacity;
+    }
+
+    unsigned char* position = writer->data + writer->length;
+    writer->length += needed;
+
+    return position;
+}
+
+/**
+ * @brief Writes a header with the shortest encoding of its argument.
+ * @param writer The writer.
+ * @param major The major type.
+ * @param argument The argument.
+ * @return true on success.
+ */
+static bool write_header(cbor_writer* writer, int major, uint64_t argument)
+{
+    unsigned char first = (unsigned char)(major << 5);
+    size_t size = 0;
+
+    if (argument < 24)
+    {
+        unsigned char* out = reserve(writer, 1);
+        if (!out)
+        {
+            return false;
+        }
+        out[0] = (unsigned char)(first | argument);
+        return true;
+    }
+
+    if (argument <= UINT8_MAX)
+    {
+        first |= 24;
+        size = 1;
+    }
+    else if (argument <= UINT16_MAX)
+    {
+        first |= 25;
+        size = 2;
+    }
+    else if (argument <= UINT32_MAX)
+    {
+        first |= 26;
+        size = 4;
+    }
+    else
+    {
+        first |= 27;
+        size = 8;
+    }
+
+    unsigned char* out = reserve(writer, size + 1);
+    if (!out)
+    {
+        return false;
+    }
+    out[0] = first;
+    for (size_t i = 0; i < size; i++)
+    {
+        out[size - i] = (unsigned char)(argument >> (8 * i));
+    }
+
+    return true;
+}
+
+/**
+ * @brief Writes a number, as an integer when it is integral and as a float or a double otherwise.
+ * @param writer The writer.
+ * @param number The number.
+ * @return true on success.
+ */
+static bool write_number(cbor_writer* writer, double number)
+{
+    if (number == floor(number) && number >= -9223372036854775808.0 && number < 9223372036854775808.0 &&
+        !(number == 0 && signbit(number)))
+    {
+        int64_t integer = (int64_t)number;
+        return integer >= 0 ? write_header(writer, CBOR_UNSIGNED, (uint64_t)integer)
+                            : write_header(writer, CBOR_NEGATIVE, (uint64_t)(-(integer + 1)));
+    }
+
+    float single = (float)number;
+    if ((double)single == number || isnan(number))
+    {
+        uint32_t bits;
+        memcpy(&bits, &single, sizeof(bits));
+        unsigned char* out = reserve(writer, 5);
+        if (!out)
+        {
+            return false;
+        }
+        out[0] = (CBOR_SIMPLE << 5) | 26;
+        for (size_t i = 0; i < 4; i++)
+        {
+            out[4 - i] = (unsigned char)(bits >> (8 * i));
+        }
+        return true;
+    }
+
+    uint64_t bits;
+    memcpy(&bits, &number, sizeof(bits));
+    unsigned char* out = reserve(writer, 9);
+    if (!out)
+    {
+        return false;
+    }
+    out[0] = (CBOR_SIMPLE << 5) | 27;
+    for (size_t i = 0; i < 8; i++)
+    {
+        out[8 - i] = (unsigned char)(bits >> (8 * i));
+    }
+
+    return true;
+}
+
+/**
+ * @brief Writes a text string.
+ * @param writer The writer.
+ * @param text The text.
+ * @return true on success.
+ */
+static bool write_text(cbor_writer* writer, const char* text)
+{
+    size_t length = strlen(text);
+
+    if (!write_header(writer, CBOR_TEXT, length))
+    {
+        return false;
+    }
+
+    unsigned char* out = reserve(writer, length);
+    if (!out)
+    {
+        return false;
+    }
+    memcpy(out, text, length);
+
+    return true;
+}
+
+/**
+ * @brief Encodes a cJSON item and its children.
+ * @param writer The writer.
+ * @param item The item.
+ * @param depth The nesting depth.
+ * @return true on success.
+ */
+static bool encode_item(cbor_writer* writer, const cJSON* item, size_t depth)
+{
+    const cJSON* child = NULL;
+    uint64_t count = 0;
+
+    if (depth > CJSON_NESTING_LIMIT)
+    {
+        return false;
+    }
+
+    switch (item->type & 0xFF)
+    {
+    case cJSON_False:
+        return write_header(writer, CBOR_SIMPLE, 20);
+    case cJSON_True:
+        return write_header(writer, CBOR_SIMPLE, 21);
+    case cJSON_NULL:
+        return write_header(writer, CBOR_SIMPLE, 22);
+    case cJSON_Number:
+        return write_number(writer, item->valuedouble);
+    case cJSON_String:
+    case cJSON_Raw:
+        return item->valuestring && write_text(writer, item->valuestring);
+    case cJSON_Array:
+    case cJSON_Object:
+        cJSON_ArrayForEach(child, item)
+        {
+            count++;
+        }
+        if (!write_header(writer, cJSON_IsArray(item) ? CBOR_ARRAY : CBOR_MAP, count))
+        {
+            return false;
+        }
+        cJSON_ArrayForEach(child, item)
+        {
+            if (cJSON_IsObject(item) && (!child->string || !write_text(writer, child->string)))
+            {
+                return false;
+            }
+            if (!encode_item(writer, child, depth + 1))
+            {
+                return false;
+            }
+        }
+        return true;
+    default:
+        return false;
+    }
+}
+
+unsigned char* cbor_encode(const cJSON* item, size_t* length)
+{
+    cbor_writer writer = {NULL, 0, 0};
+
+    if (!item || !length || !encode_item(&writer, item, 0))
+    {
+        free(writer.data);
+        return NULL;
+    }
+
+    *length = writer.length;
+
+    return writer.data;
+}
+
+/**
+ * @brief Reads the header of the next data item.
+ * @param reader The reader.
+ * @param header Output, the header.
+ * @return true on success.
+ */
+static bool read_header(cbor_reader* reader, cbor_header* header)
+{
+    if (reader->offset >= reader->length)
+    {
+        return false;
+    }
+
+    unsigned char first = reader->data[reader->offset++];
+    header->major = first >> 5;
+    header->info = first & 0x1F;
+    header->argument = (uint64_t)header->info;
+
+    if (header->info < 24 || header->info == CBOR_INDEFINITE)
+    {
+        return true;
+    }
+    if (header->info > 27)
+    {
+        return false; // Reservado
+    }
+
+    size_t size = (size_t)1 << (header->info - 24);
+    if (reader->length - reader->offset < size)
+    {
+        return false;
+    }
+
+    header->argument = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        header->argument = (header->argument << 8) | reader->data[reader->offset++];
+    }
+
+    return true;
+}
+
+/**
+ * @brief Converts an IEEE 754 half precision float to a double.
+ * @param half The half float bits.
+ * @return The value.
+ */
+static double decode_half(uint16_t half)
+{
+    int exponent = (half >> 10) & 0x1F;
+    double mantissa = half & 0x3FF;
+    double value;
+
+    if (exponent == 0)
+    {
+        value = ldexp(mantissa, -24);
+    }
+    else if (exponent != 31)
+    {
+        value = ldexp(mantissa + 1024, exponent - 25);
+    }
+    else
+    {
+        value = mantissa == 0 ? INFINITY : NAN;
+    }
+
+    return (half & 0x8000) ? -value : value;
+}
+
+/**
+ * @brief Reads the value of a numeric or boolean scalar, after its header.
+ * @param header The header of the item.
+ * @param value Output, the value.
+ * @param boolean Output, whether the item is a boolean.
+ * @return true if the item is a number or a boolean.
+ */
+static bool scalar_value(const cbor_header* header, double* value, bool* boolean)
+{
+    *boolean = header->major == CBOR_SIMPLE && (header->info == 20 || header->info == 21);
+    switch (header->major)
+    {
+    case CBOR_UNSIGNED:
+        *value = (double)header->argument;
+        return header->info != CBOR_INDEFINITE;
+    case CBOR_NEGATIVE:
+        *value = -1.0 - (double)header->argument;
+        return header->info != CBOR_INDEFINITE;
+    case CBOR_SIMPLE:
+        switch (header->info)
+        {
+        case 20:
+        case 21:
+            *value = header->info == 21;
+            return true;
+        case 25:
+            *value = decode_half((uint16_t)header->argument);
+            return true;
+        case 26: {
+            uint32_t bits = (uint32_t)header->argument;
+            float single;
+            memcpy(&single, &bits, sizeof(single));
+            *value = single;
+            return true;
+        }
+        case 27:
+            memcpy(value, &header->argument, sizeof(*value));
+            return true;
+        default:
+            return false;
+        }
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Reads a definite length text string.
+ * @param reader The reader.
+ * @param header The header of the string.
+ * @param text Output, pointer to the bytes of the string inside the data.
+ * @param length Output, the length of the string.
+ * @return true on success.
+ */
+static bool read_text(cbor_reader* reader, const cbor_header* header, const char** text, size_t* length)
+{
+    if (header->major != CBOR_TEXT || header->info == CBOR_INDEFINITE ||
+        header->argument > reader->length - reader->offset)
+    {
+        return false;
+    }
+
+    *text = (const char*)reader->data + reader->offset;
+    *length = (size_t)header->argument;
+    reader->offset += *length;
+
+    return true;
+}
+
+/**
+ * @brief Checks for the break code of an indefinite length item, consuming it.
+ * @param reader The reader.
+ * @return true if the next byte is a break.
+ */
+static bool at_break(cbor_reader* reader)
+{
+    if (reader->offset < reader->length && reader->data[reader->offset] == CBOR_BREAK)
+    {
+        reader->offset++;
+        return true;
+    }
+
+    return false;
+}
+
+static bool skip_item(cbor_reader* reader);
+
+/**
+ * @brief Skips the contents of an item whose header was already read.
+ * @param reader The reader.
+ * @param header The header of the item.
+ * @return true on success.
+ */
+static bool skip_contents(cbor_reader* reader, const cbor_header* header)
+{
+    bool indefinite = header->info == CBOR_INDEFINITE;
+    uint64_t items = header->argument;
+    bool result = true;
+
+    switch (header->major)
+    {
+    case CBOR_UNSIGNED:
+    case CBOR_NEGATIVE:
+        return !indefinite;
+    case CBOR_BYTES:
+    case CBOR_TEXT:
+        if (indefinite)
+        {
+            while (!at_break(reader))
+            {
+                cbor_header chunk;
+                if (!read_header(reader, &chunk) || chunk.major != header->major || !skip_contents(reader, &chunk))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+        if (header->argument > reader->length - reader->offset)
+        {
+            return false;
+        }
+        reader->offset += (size_t)header->argument;
+        return true;
+    case CBOR_ARRAY:
+    case CBOR_MAP:
+        if (++reader->depth > CJSON_NESTING_LIMIT)
+        {
+            return false;
+        }
+        for (uint64_t i = 0; result && (indefinite ? !at_break(reader) : i < items); i++)
+        {
+            result = skip_item(reader) && (header->major == CBOR_ARRAY || skip_item(reader));
+        }
+        reader->depth--;
+        return result;
+    case CBOR_TAG:
+        return !indefinite && skip_item(reader);
+    default:
+        return header->info != CBOR_INDEFINITE;
+    }
+}
+
+/**
+ * @brief Skips a complete data item.
+ * @param reader The reader.
+ * @return true on success.
+ */
+static bool skip_item(cbor_reader* reader)
+{
+    cbor_header header;
+
+    return read_header(reader, &header) && skip_contents(reader, &header);
+}
+
+/**
+ * @brief Decodes a complete data item into a cJSON item.
+ * @param reader The reader.
+ * @return The item, NULL on error.
+ */
+static cJSON* decode_item(cbor_reader* reader)
+{
+    cbor_header header;
+    double number = 0;
+    bool boolean = false;
+
+    if (!read_header(reader, &header))
+    {
+        return NULL;
+    }
+
+    // Los tags (por ejemplo el de CBOR autodescripto) no tienen equivalente en JSON
+    while (header.major == CBOR_TAG)
+    {
+        if (header.info == CBOR_INDEFINITE || !read_header(reader, &header))
+        {
+            return NULL;
+        }
+    }
+
+    if (header.major == CBOR_SIMPLE)
+    {
+        switch (header.info)
+        {
+        case 20:
+            return cJSON_CreateFalse();
+        case 21:
+            return cJSON_CreateTrue();
+        case 22:
+        case 23:
+            return cJSON_CreateNull();
+        default:
+            return scalar_value(&header, &number, &boolean) ? cJSON_CreateNumber(number) : NULL;
+        }
+    }
+
+    if (header.major == CBOR_UNSIGNED || header.major == CBOR_NEGATIVE)
+    {
+        return scalar_value(&header, &number, &boolean) ? cJSON_CreateNumber(number) : NULL;
+    }
+
+    if (header.major == CBOR_TEXT)
+    {
+        const char* text = NULL;
+        size_t length = 0;
+        if (!read_text(reader, &header, &text, &length) || memchr(text, '\0', length))
+        {
+            return NULL;
+        }
+
+        char* copy = strndup(text, length);
+        cJSON* item = copy ? cJSON_CreateString(copy) : NULL;
+        free(copy);
+        return item;
+    }
+
+    if (header.major != CBOR_ARRAY && header.major != CBOR_MAP)
+    {
+        return NULL; // Byte strings no se pueden representar en JSON
+    }
+
+    if (++reader->depth > CJSON_NESTING_LIMIT)
+    {
+        return NULL;
+    }
+
+    bool indefinite = header.info == CBOR_INDEFINITE;
+    cJSON* container = header.major == CBOR_ARRAY ? cJSON_CreateArray() : cJSON_CreateObject();
+    cJSON* last = NULL;
+
+    for (uint64_t i = 0; container && (indefinite ? !at_break(reader) : i < header.argument); i++)
+    {
+        char* key = NULL;
+
+        if (header.major == CBOR_MAP)
+        {
+            cbor_header key_header;
+            const char* text = NULL;
+            size_t length = 0;
+            if (!read_header(reader, &key_header) || !read_text(reader, &key_header, &text, &length) ||
+                !(key = strndup(text, length)))
+            {
+                cJSON_Delete(container);
+                return NULL;
+            }
+        }
+
+        cJSON* child = decode_item(reader);
+        if (!child)
+        {
+            free(key);
+            cJSON_Delete(container);
+            return NULL;
+        }
+
+        // Enlace directo para no recorrer la lista en cada inserción
+        child->string = key;
+        if (last)
+        {
+            last->next = child;
+            child->prev = last;
+        }
+        else
+        {
+            container->child = child;
+        }
+        container->child->prev = child;
+        last = child;
+    }
+
+    reader->depth--;
+
+    return container;
+}
+
+cJSON* cbor_decode(const unsigned char* data, size_t length, size_t* consumed)
+{
+    cbor_reader reader = {data, length, 0, 0};
+
+    if (!data)
+    {
+        return NULL;
+    }
+
+    cJSON* item = decode_item(&reader);
+    if (item && consumed)
+    {
+        *consumed = reader.offset;
+    }
+
+    return item;
+}
+
+bool cbor_decode_record(const unsigned char* data, size_t length, cbor_field* fields, size_t count)
+{
+    cbor_reader reader = {data, length, 0, 0};
+    cbor_header header;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        fields[i].present = false;
+    }
+
+    if (!data || !read_header(&reader, &header))
+    {
+        return false;
+    }
+    if (header.major == CBOR_TAG && header.argument == CBOR_SELF_DESCRIBED && !read_header(&reader, &header))
+    {
+        return false;
+    }
+    if (header.major != CBOR_MAP)
+    {
+        return false;
+    }
+
+    bool indefinite = header.info == CBOR_INDEFINITE;
+    for (uint64_t i = 0; indefinite ? !at_break(&reader) : i < header.argument; i++)
+    {
+        cbor_header key_header;
+        const char* key = NULL;
+        size_t key_length = 0;
+        cbor_field* field = NULL;
+
+        if (!read_header(&reader, &key_header) || !read_text(&reader, &key_header, &key, &key_length))
+        {
+            return false;
+        }
+
+        for (size_t f = 0; f < count && !field; f++)
+        {
+            // La clave viene de la FIFO: puede tener un '\0' adentro y ser más larga que el nombre
+            if (strlen(fields[f].name) == key_length && memcmp(fields[f].name, key, key_length) == 0)
+            {
+                field = &fields[f];
+            }
+        }
+
+        if (!field)
+        {
+            if (!skip_item(&reader))
+            {
+                return false;
+            }
+            continue;
+        }
+
+        cbor_header value_header;
+        if (!read_header(&reader, &value_header) || !scalar_value(&value_header, &field->value, &field->boolean))
+        {
+            return false;
+        }
+        field->present = true;
+    }
+
+    return true;
+}
+
+bool cbor_is_frame(const unsigned char* data, size_t length)
+{
+    if (!data || length == 0)
+    {
+        return false;
+    }
+
+    // Tag 55799: 0xD9 0xD9 0xF7
+    if (length >= 3 && data[0] == 0xD9 && data[1] == 0xD9 && data[2] == 0xF7)
+    {
+        return true;
+    }
+
+    // Un mapa CBOR empieza con 0xA0-0xBF, que nunca es el comienzo de un texto JSON
+    return (data[0] >> 5) == CBOR_MAP;
+}
@@ -3,6 +3,42 @@
  * @brief This file contains the implementation of the functions that handle the commands.
  */
 #include "commands.h"
+#include <errno.h>
+#include <sys/uio.h>
+
+/**
+ * @brief Number of pieces echo gives to one writev().
+ */
+#define ECHO_PIECES 64
+
+/**
+ * @brief Exit status of the last command, 0 for the internal ones.
+ */
+static int command_status = 0;
+
+/**
+ * @brief This function tells whether a command is an internal one.
+ */
+bool is_builtin(const char* name)
+{
+    return builtin_find(name) != NULL;
+}
+
+/**
+ * @brief This function returns the exit status of the last command.
+ */
+int last_command_status(void)
+{
+    return command_status;
+}
+
+/**
+ * @brief This function sets the exit status of the last command.
+ */
+void set_command_status(int status)
+{
+    command_status = status;
+}
 
 /**
  * @brief This function executes the internal commands.
@@ -10,56 +46,28 @@
  */
 void internal_commands(int argc, char* args[], bool background)
 {
-    if (argc > 0)
+    command_status = 0;
+    if (argc == 0)
+        return;
+
+    const builtin_command* command = builtin_find(args[0]);
+    if (!command)
     {
-        if (strcmp(args[0], "cd") == 0)
-        {
-            change_directory(args[1]);
-        }
-        else if (strcmp(args[0], "quit") == 0)
-        {
-            if (!background)
-                exit(EXIT_SUCCESS);
-            else
-                perror("No se puede salir en segundo plano");
-        }
-        else if (strcmp(args[0], "clr") == 0)
-        {
-            clear_screen();
-        }
-        else if (strcmp(args[0], "echo") == 0)
-        {
-            echo(args);
-        }
-        else if (strcmp(args[0], "start_monitor") == 0)
-        {
-            start_monitor();
-        }
-        else if (strcmp(args[0], "stop_monitor") == 0)
-        {
-            stop_monitor();
-        }
-        else if (strcmp(args[0], "status_monitor") == 0)
-        {
-            status_monitor();
-        }
-        else if (strcmp(args[0], "list_config") == 0)
-        {
-            list_configuration_files(args[1]);
-        }
-        else if (strcmp(args[0], "search_config") == 0)
-        {
-            search_config_files_recursively(args[1]);
-        }
-        else if (strcmp(args[0], "read_file") == 0)
-        {
-            read_file_content(args[1]);
-        }
-        else
-        {
-            external_command(args);
-        }
+        external_command(args);
+        return;
     }
+
+    uint64_t trace_start = trace_begin();
+    if (background && (command->flags & BUILTIN_PARENT))
+    {
+        printf("%s: No tiene efecto en segundo plano\n", args[0]);
+        command_status = 1;
+    }
+    else
+    {
+        command_status = command->run(argc, args);
+    }
+    trace_end("builtin", trace_start, 0, 0, args[0]);
 }
 
 /**
@@ -67,13 +75,10 @@ void internal_commands(int argc, char* args[], bool background)
  */
 void external_command(char* args[])
 {
-    // El comando exit genera error en execvp
-    if (strcmp(args[0], "exit") == 0)
-    {
-        printf("¿Quisiste decir \"quit\"?\n");
-        return;
-    }
-
+    // Vaciar stdio antes: el hijo heredaría y repetiría lo pendiente
+    fflush(stdout);
+    STATS_TIMER(fork_start);
+    uint64_t fork_trace = trace_begin();
     pid_t pid = fork();
 
     if (pid < 0)
@@ -83,18 +88,25 @@ void external_command(char* args[])
     }
     else if (pid == 0)
     {
-        // Proceso hijo: ejecutar el comando
+        // Proceso hijo: ejecutar el comando en su propio grupo, dueño de la terminal
+        uint64_t exec_trace = trace_begin();
+        job_child_setup(0, true);
+        trace_end("exec", exec_trace, 0, 0, args[0]);
+        trace_flush();
         execvp(args[0], args);
 
         // Si execvp falla, mostrar el error y terminar el proceso hijo
         perror("execvp error");
-        exit(EXIT_FAILURE);
+        _exit(EXIT_FAILURE);
     }
     else
     {
-        // Proceso padre: esperar a que termine el hijo
-        int status;
-        waitpid(pid, &status, 0);
+        // Proceso padre: esperar a que termine (o se detenga) el hijo
+        STATS_RECORD(STATS_FORK, fork_start);
+        STATS_COUNT(STATS_FORKS, 1);
+        trace_end("fork", fork_trace, pid, 0, args[0]);
+        job_parent_setup(pid, 0);
+        command_status = jobs_foreground(jobs_add(pid, &pid, 1, args, " "), false);
         return;
     }
 }
@@ -107,7 +119,7 @@ void external_command(char* args[])
 void change_directory(char* path)
 {
     char* old_pwd = getenv("PWD");
-    char* new_pwd;
+    char* new_pwd = NULL;
 
     if (path == NULL)
     {
@@ -121,6 +133,7 @@ void change_directory(char* path)
         {
             perror("cd: cwd");
         }
+        return;
     }
     else if (strcmp(path, "-") == 0)
     {
@@ -138,6 +151,7 @@ void change_directory(char* path)
         // Actualizamos las variables de entorno
         setenv("OLDPWD", old_pwd, 1);
         setenv("PWD", new_pwd, 1);
+        prompt_update_cwd();
     }
     else
     {
@@ -153,34 +167,84 @@ void clear_screen(void)
     printf("\033[H\033[J");
 }
 
+/**
+ * @brief This function returns what echo prints for a word: the value of its variable or the word itself.
+ */
+static const char* echo_word(const char* word)
+{
+    if (strchr(word, '$') != NULL)
+    {
+        const char* value = getenv(strchr(word, '$') + 1);
+        return value ? value : "Error con la variable de entorno";
+    }
+    return word;
+}
+
 /**
  * @brief This function echoes the message.
  * @note Supports environment variables.
  */
 void echo(char* message[])
 {
-    int i = 1;
-    while (message[i] != NULL)
+    for (int i = 1; message[i] != NULL; i++)
+    {
+        fprintf(stdout, "%s ", echo_word(message[i]));
+    }
+    fprintf(stdout, "\n");
+}
+
+/**
+ * @brief This function writes all the pieces of a writev(), it continues after a short write.
+ * @return 0 on success, -1 on error.
+ */
+static int write_pieces(int fd, struct iovec* pieces, int count)
+{
+    while (count > 0)
     {
-        if (strchr(message[i], '$') != NULL)
+        ssize_t written = writev(fd, pieces, count);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written < 0)
+            return -1;
+
+        while (count > 0 && (size_t)written >= pieces->iov_len)
         {
-            char* var = strchr(message[i], '$') + 1;
-            if (getenv(var) != NULL)
-            {
-                fprintf(stdout, "%s ", getenv(var));
-            }
-            else
-            {
-                fprintf(stdout, "Error con la variable de entorno ");
-            }
+            written -= (ssize_t)pieces->iov_len;
+            pieces++;
+            count--;
         }
-        else
+        if (count > 0)
         {
-            fprintf(stdout, "%s ", message[i]);
+            pieces->iov_base = (char*)pieces->iov_base + written;
+            pieces->iov_len -= (size_t)written;
         }
-        i++;
     }
-    fprintf(stdout, "\n");
+    return 0;
+}
+
+/**
+ * @brief This function echoes the message to a descriptor.
+ * @note The words are handed to writev() where they are, without building the line in a buffer.
+ */
+static int echo_to_descriptor(char* message[], int fd)
+{
+    struct iovec pieces[ECHO_PIECES];
+    int count = 0;
+
+    for (int i = 1; message[i] != NULL; i++)
+    {
+        if (count + 2 > ECHO_PIECES)
+        {
+            if (write_pieces(fd, pieces, count) != 0)
+                return -1;
+            count = 0;
+        }
+        const char* word = echo_word(message[i]);
+        pieces[count++] = (struct iovec){.iov_base = (void*)(uintptr_t)word, .iov_len = strlen(word)};
+        pieces[count++] = (struct iovec){.iov_base = (void*)" ", .iov_len = 1};
+    }
+    pieces[count++] = (struct iovec){.iov_base = (void*)"\n", .iov_len = 1};
+    return write_pieces(fd, pieces, count);
 }
 
 /** --- TP3: Functions Added --- */
@@ -214,56 +278,370 @@ void list_configuration_files(char* directory)
     closedir(dir);
 }
 
-void search_config_files_recursively(char* directory)
+/**
+ * @brief This function searches recursively for the configuration files in the directory.
+ * @note Usage: search_config [-j threads] [-s] [-i] <directory> [-name GLOB...] [-contains TEXT] [-maxdepth N].
+ * @note The tree is walked in parallel, -s sorts the output. -name replaces the ".config"/".json" extensions, all the
+ * patterns are matched in one pass. With -i and no filters the persistent index is refreshed and printed instead.
+ */
+void search_config_files_recursively(int argc, char* args[])
 {
-    struct dirent* entry;
-    DIR* dir = opendir(directory);
+    search_options options = {0, false, NULL, NULL, -1};
+    const char** patterns = malloc(sizeof(char*) * (size_t)argc);
+    size_t pattern_count = 0;
+    text_finder* contains = NULL;
+    bool use_index = false;
+    char* directory = NULL;
 
-    if (!dir)
+    for (int i = 1; i < argc; i++)
     {
-        printf("Error: No se puede abrir el directorio %s\n", directory);
-        return;
+        if (strcmp(args[i], "-j") == 0 && i + 1 < argc)
+        {
+            options.threads = (size_t)strtoul(args[++i], NULL, 10);
+        }
+        else if (strcmp(args[i], "-s") == 0)
+        {
+            options.sorted = true;
+        }
+        else if (strcmp(args[i], "-i") == 0)
+        {
+            use_index = true;
+        }
+        else if (strcmp(args[i], "-name") == 0)
+        {
+            // -name acepta varios patrones hasta la próxima opción
+            while (i + 1 < argc && args[i + 1][0] != '-' && patterns)
+            {
+                patterns[pattern_count++] = args[++i];
+            }
+        }
+        else if (strcmp(args[i], "-contains") == 0 && i + 1 < argc)
+        {
+            text_finder_free(contains);
+            contains = text_finder_compile(args[i + 1], strlen(args[i + 1]));
+            i++;
+        }
+        else if (strcmp(args[i], "-maxdepth") == 0 && i + 1 < argc)
+        {
+            options.max_depth = atoi(args[++i]);
+        }
+        else
+        {
+            directory = args[i];
+        }
     }
 
-    while ((entry = readdir(dir)) != NULL)
+    if (!directory)
+    {
+        printf("Uso: search_config [-j threads] [-s] [-i] <directorio> [-name GLOB...] [-contains TEXTO] "
+               "[-maxdepth N]\n");
+    }
+    else if (use_index && pattern_count == 0 && !contains && options.max_depth < 0)
+    {
+        config_index_search(directory, true);
+    }
+    else
+    {
+        glob_set* names = pattern_count > 0 ? glob_set_compile(patterns, pattern_count) : NULL;
+        options.names = names;
+        options.contains = contains;
+        search_config_files(directory, &options);
+        glob_set_free(names);
+    }
+
+    text_finder_free(contains);
+    free(patterns);
+}
+
+/**
+ * @brief This function parses the arguments of read_file.
+ * @return The path of the file, NULL if the arguments are not valid.
+ */
+static char* parse_read_options(int argc, char* args[], read_options* options)
+{
+    *options = (read_options){0, 0, -1, -1, false, false, NULL, STDOUT_FILENO};
+    char* filepath = NULL;
+
+    for (int i = 1; i < argc; i++)
     {
-        if (entry->d_type == DT_DIR)
+        if (strcmp(args[i], "-n") == 0 && i + 1 < argc)
         {
-            if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0)
-            {
-                char subpath[1024];
-                snprintf(subpath, sizeof(subpath), "%s/%s", directory, entry->d_name);
-                search_config_files_recursively(subpath);
-            }
+            char* range = args[++i];
+            char* separator = strchr(range, ':');
+            options->first_line = atol(range);
+            options->last_line = separator ? atol(separator + 1) : options->first_line;
         }
-        else if (entry->d_type == DT_REG)
+        else if (strcmp(args[i], "--head") == 0 && i + 1 < argc)
         {
-            const char* ext = strrchr(entry->d_name, '.');
-            if (ext && (strcmp(ext, ".config") == 0 || strcmp(ext, ".json") == 0))
-            {
-                printf("Archivo de configuración encontrado: %s/%s\n", directory, entry->d_name);
-            }
+            options->head = atol(args[++i]);
+        }
+        else if (strcmp(args[i], "--tail") == 0 && i + 1 < argc)
+        {
+            options->tail = atol(args[++i]);
+        }
+        else if (strcmp(args[i], "--follow") == 0 || strcmp(args[i], "-f") == 0)
+        {
+            options->follow = true;
+        }
+        else if (strcmp(args[i], "--json") == 0)
+        {
+            options->json = true;
+        }
+        else if (!filepath)
+        {
+            filepath = args[i];
+        }
+        else
+        {
+            options->key = args[i];
         }
     }
 
-    closedir(dir);
+    return !filepath || (options->key && !options->json) ? NULL : filepath;
 }
 
-void read_file_content(char* filepath)
+/**
+ * @brief This function prints the content of a file.
+ * @note Usage: read_file [-n FIRST:LAST] [--head N] [--tail N] [--follow] <file>. "-n 5" prints line 5, "-n 5:" from
+ * line 5 to the end and "-n :5" up to line 5.
+ * @note Usage: read_file --json <file> [path.to.key] pretty-prints a JSON document or one of its values.
+ */
+void read_file_content(int argc, char* args[])
 {
-    FILE* file = fopen(filepath, "r");
-    if (!file)
+    read_options options;
+    char* filepath = parse_read_options(argc, args, &options);
+
+    if (!filepath)
     {
-        printf("Error: No se puede abrir el archivo %s\n", filepath);
+        printf("Uso: read_file [-n INICIO:FIN] [--head N] [--tail N] [--follow] <archivo>\n");
+        printf("     read_file --json <archivo> [ruta.a.la.clave]\n");
         return;
     }
 
-    printf("Contenido de %s:\n", filepath);
-    char line[256];
-    while (fgets(line, sizeof(line), file))
+    read_file(filepath, &options);
+}
+
+/**
+ * @brief cd [directory | -].
+ */
+static int cd_command(int argc, char* args[])
+{
+    (void)argc;
+    change_directory(args[1]);
+    return 0;
+}
+
+/**
+ * @brief quit.
+ */
+static int quit_command(int argc, char* args[])
+{
+    (void)argc;
+    (void)args;
+    exit(EXIT_SUCCESS);
+}
+
+/**
+ * @brief exit: execvp() would fail, the shell suggests quit.
+ */
+static int exit_command(int argc, char* args[])
+{
+    (void)argc;
+    (void)args;
+    printf("¿Quisiste decir \"quit\"?\n");
+    return 0;
+}
+
+/**
+ * @brief clr.
+ */
+static int clr_command(int argc, char* args[])
+{
+    (void)argc;
+    (void)args;
+    clear_screen();
+    return 0;
+}
+
+/**
+ * @brief echo [word | $VARIABLE]...
+ */
+static int echo_command(int argc, char* args[])
+{
+    (void)argc;
+    echo(args);
+    return 0;
+}
+
+/**
+ * @brief echo in a pipeline thread.
+ */
+static int echo_to_pipe(const builtin_command* self, int argc, char* args[], int input, int output)
+{
+    (void)self;
+    (void)argc;
+    (void)input;
+    return echo_to_descriptor(args, output) == 0 ? 0 : 1;
+}
+
+/**
+ * @brief list_config [-i] <directory>.
+ */
+static int list_config_command(int argc, char* args[])
+{
+    (void)argc;
+    if (args[1] && strcmp(args[1], "-i") == 0)
+    {
+        if (args[2])
+        {
+            printf("Explorando el directorio: %s en busca de archivos '.config' o '.json'\n", args[2]);
+            config_index_search(args[2], false);
+        }
+        else
+        {
+            printf("Uso: list_config [-i] <directorio>\n");
+        }
+    }
+    else
     {
-        printf("%s", line);
+        list_configuration_files(args[1]);
     }
-    fclose(file);
-    printf("\n");
+    return 0;
+}
+
+/**
+ * @brief search_config, see search_config_files_recursively().
+ */
+static int search_config_command(int argc, char* args[])
+{
+    search_config_files_recursively(argc, args);
+    return 0;
+}
+
+/**
+ * @brief read_file, see read_file_content().
+ */
+static int read_file_command(int argc, char* args[])
+{
+    read_file_content(argc, args);
+    return 0;
+}
+
+/**
+ * @brief read_file --follow never ends and --json shares its cache, they keep their own process.
+ */
+static bool read_file_pipeline_safe(int argc, char* args[])
+{
+    read_options options;
+    return parse_read_options(argc, args, &options) && !options.follow && !options.json;
+}
+
+/**
+ * @brief read_file in a pipeline thread.
+ * @note As in read_file_command(), the status is 0 even if the file can't be read.
+ */
+static int read_file_to_pipe(const builtin_command* self, int argc, char* args[], int input, int output)
+{
+    (void)self;
+    (void)input;
+    read_options options;
+    char* filepath = parse_read_options(argc, args, &options);
+    options.output = output;
+    read_file(filepath, &options);
+    return 0;
+}
+
+/**
+ * @brief An option of the shell, for set.
+ */
+typedef struct
+{
+    const char* name;           /**< Name of the option. */
+    bool (*enabled)(void);      /**< Tells whether it is on. */
+    int (*enable)(bool enable); /**< Turns it on or off, returns 0 on success. */
+} shell_option;
+
+/**
+ * @brief Options of the shell.
+ */
+static const shell_option shell_options[] = {
+    {"builtin-filters", filters_enabled, filters_enable},
+};
+
+/**
+ * @brief set [-o | +o] [option]: -o turns an option on, +o off, without an option they are listed.
+ */
+static int set_command(int argc, char* args[])
+{
+    size_t count = sizeof(shell_options) / sizeof(shell_options[0]);
+    bool valid = argc <= 3 && (argc == 1 || strcmp(args[1], "-o") == 0 || strcmp(args[1], "+o") == 0);
+    if (!valid)
+    {
+        printf("Uso: set [-o | +o] [opción]\n");
+        return 1;
+    }
+
+    if (argc < 3)
+    {
+        for (size_t i = 0; i < count; i++)
+            printf("%-16s %s\n", shell_options[i].name, shell_options[i].enabled() ? "on" : "off");
+        return 0;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (strcmp(shell_options[i].name, args[2]) == 0)
+            return shell_options[i].enable(args[1][0] == '-') == 0 ? 0 : 1;
+    }
+    printf("set: %s: opción desconocida\n", args[2]);
+    return 1;
+}
+
+/**
+ * @brief Internal commands of the shell itself, the subsystems register theirs.
+ */
+static const builtin_command core_commands[] = {
+    {"cd", "[directorio | -]", "Cambia el directorio de trabajo, sin argumentos muestra el actual", BUILTIN_PARENT,
+     cd_command, NULL, NULL, NULL},
+    {"quit", "", "Sale de la shell", BUILTIN_PARENT, quit_command, NULL, NULL, NULL},
+    {"exit", "", "Recuerda que para salir se usa quit", 0, exit_command, NULL, NULL, NULL},
+    {"clr", "", "Limpia la pantalla", 0, clr_command, NULL, NULL, NULL},
+    {"echo", "[palabra | $VARIABLE]...", "Muestra las palabras y el valor de las variables de entorno",
+     BUILTIN_PIPELINE, echo_command, echo_to_pipe, NULL, NULL},
+    {"read_file", "[-n INICIO:FIN] [--head N] [--tail N] [--follow] [--json] <archivo> [ruta.a.la.clave]",
+     "Muestra el contenido de un archivo", BUILTIN_PIPELINE, read_file_command, read_file_to_pipe,
+     read_file_pipeline_safe, NULL},
+    {"list_config", "[-i] <directorio>", "Lista los archivos .config y .json de un directorio", 0,
+     list_config_command, NULL, NULL, NULL},
+    {"search_config", "[-j threads] [-s] [-i] <directorio> [-name GLOB...] [-contains TEXTO] [-maxdepth N]",
+     "Busca archivos de configuración en un árbol", 0, search_config_command, NULL, NULL, NULL},
+    {"type", "<nombre>...", "Indica si un nombre es un comando interno o un programa", 0, builtin_type, NULL, NULL,
+     NULL},
+    {"help", "[comando]...", "Muestra la ayuda de los comandos internos", 0, builtin_help, NULL, NULL, NULL},
+    {"set", "[-o | +o] [opción]", "Activa (-o) o desactiva (+o) una opción de la shell, sin opción las lista",
+     BUILTIN_PARENT, set_command, NULL, NULL, NULL},
+};
+
+void commands_init(void)
+{
+    builtin_register(core_commands, sizeof(core_commands) / sizeof(core_commands[0]));
+    jobs_register_builtins();
+    monitor_register_builtins();
+    config_index_register_builtins();
+    stats_register_builtins();
+    plugins_register_builtins();
+}
+
+/**
+ * @brief This function tells whether an internal command can run on a thread of the shell.
+ */
+const builtin_command* builtin_threadable(int argc, char* args[], bool shell_input)
+{
+    if (argc == 0)
+        return NULL;
+
+    const builtin_command* command = builtin_find(args[0]);
+    if (!command || !(command->flags & BUILTIN_PIPELINE) || (shell_input && (command->flags & BUILTIN_INPUT)))
+        return NULL;
+    return !command->pipeline_safe || command->pipeline_safe(argc, args) ? command : NULL;
 }
@@ -0,0 +1,1208 @@
+/**
+ * @file config_index.c
+ * @brief This file contains the implementation of the persistent index of configuration files.
+ * @details File layout (native endianness, every section 8-byte aligned):
+ *
+ *     index_header | index_dir[dir_count] | index_file[file_count] | strings[strings_size]
+ *
+ * Directories are stored so that the children of a directory, and its files, are contiguous and sorted by name.
+ * Names are offsets into the string table; full paths are rebuilt from the parent chain when printing.
+ */
+#include "config_index.h"
+#include "builtins.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief Magic number of the index file, the last byte is the format version.
+ */
+#define INDEX_MAGIC "SHIDX\0\0\1"
+
+/**
+ * @brief Index of a missing directory.
+ */
+#define NO_INDEX UINT32_MAX
+
+/**
+ * @brief Time the watcher waits for more events before refreshing the index.
+ */
+#define WATCH_DEBOUNCE_MS 100
+
+/**
+ * @brief Maximum number of directories forced to be read again in one refresh of the watcher.
+ */
+#define WATCH_MAX_FORCED 256
+
+/**
+ * @brief Events that make the watcher refresh a directory.
+ */
+#define WATCH_EVENTS                                                                                                   \
+    (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_ATTRIB | IN_ONLYDIR)
+
+/**
+ * @brief Prefix of every match, the same the shell always printed.
+ */
+#define MATCH_PREFIX "Archivo de configuración encontrado: "
+
+/**
+ * @brief Header of the index file.
+ */
+typedef struct
+{
+    char magic[8];         /**< INDEX_MAGIC. */
+    uint32_t dir_count;    /**< Number of directories. */
+    uint32_t file_count;   /**< Number of files. */
+    uint32_t strings_size; /**< Size of the string table. */
+    uint32_t reserved;     /**< Padding, always 0. */
+} index_header;
+
+/**
+ * @brief A directory of the index.
+ */
+typedef struct
+{
+    uint64_t ino;        /**< Inode number. */
+    int64_t mtime_sec;   /**< Modification time (seconds), 0 to force a read on the next refresh. */
+    int64_t mtime_nsec;  /**< Modification time (nanoseconds). */
+    uint32_t parent;     /**< Parent directory, NO_INDEX for the root. */
+    uint32_t name;       /**< Offset of the name in the string table. */
+    uint32_t first_file; /**< First file of the directory. */
+    uint32_t file_count; /**< Number of files. */
+    uint32_t first_child; /**< First subdirectory. */
+    uint32_t child_count; /**< Number of subdirectories. */
+} index_dir;
+
+/**
+ * @brief A configuration file of the index.
+ */
+typedef struct
+{
+    uint64_t ino;       /**< Inode number. */
+    uint64_t size;      /**< Size in bytes. */
+    int64_t mtime_sec;  /**< Modification time (seconds). */
+    int64_t mtime_nsec; /**< Modification time (nanoseconds). */
+    uint32_t dir;       /**< Directory of the file. */
+    uint32_t name;      /**< Offset of the name in the string table. */
+} index_file;
+
+/**
+ * @brief Read-only view of an index, either mapped from disk or being built.
+ */
+typedef struct
+{
+    const index_dir* dirs;   /**< Directories. */
+    const index_file* files; /**< Files. */
+    const char* strings;     /**< String table. */
+    uint32_t dir_count;      /**< Number of directories. */
+    uint32_t file_count;     /**< Number of files. */
+} index_view;
+
+/**
+ * @brief An index file mapped in memory.
+ */
+typedef struct
+{
+    void* map;       /**< Mapping of the whole file. */
+    size_t size;     /**< Size of the mapping. */
+    index_view view; /**< Sections of the file. */
+} mapped_index;
+
+/**
+ * @brief A directory waiting to be read during a refresh.
+ */
+typedef struct
+{
+    uint32_t current; /**< Index of the directory in the builder. */
+    uint32_t old;     /**< Index of the directory in the previous index, NO_INDEX if it is new. */
+} pending_dir;
+
+/**
+ * @brief An index being built by a refresh.
+ */
+typedef struct
+{
+    index_dir* dirs;             /**< Directories. */
+    bool* new_dirs;              /**< Directories that were not in the previous index. */
+    size_t dir_count;            /**< Number of directories. */
+    size_t dir_capacity;         /**< Capacity of dirs and new_dirs. */
+    index_file* files;           /**< Files. */
+    size_t file_count;           /**< Number of files. */
+    size_t file_capacity;        /**< Capacity of files. */
+    char* strings;               /**< String table. */
+    size_t strings_size;         /**< Bytes used in the string table. */
+    size_t strings_capacity;     /**< Capacity of the string table. */
+    const mapped_index* old;     /**< Previous index, NULL if there is none. */
+    const uint64_t* forced;      /**< Inodes of directories that must be read again. */
+    size_t forced_count;         /**< Number of forced inodes. */
+    bool force_all;              /**< Read every directory again. */
+    struct timespec started;     /**< Start of the refresh, to detect racy mtimes. */
+    pending_dir* pending;        /**< Directories waiting to be read, a stack. */
+    size_t pending_count;        /**< Number of directories waiting. */
+    size_t pending_capacity;     /**< Capacity of pending. */
+    bool failed;                 /**< Out of memory, out of descriptors or a limit was exceeded. */
+} index_builder;
+
+/**
+ * @brief A directory entry read during a refresh.
+ */
+typedef struct
+{
+    char* name;        /**< Name of the entry. */
+    unsigned char type; /**< DT_REG or DT_DIR. */
+} scan_entry;
+
+/**
+ * @brief State of the background watcher.
+ */
+static struct
+{
+    pthread_t thread;     /**< Watcher thread. */
+    bool active;          /**< The thread is running. */
+    int inotify_fd;       /**< inotify instance. */
+    int wake_fd;          /**< eventfd used to stop the thread. */
+    char* root;           /**< Real path of the watched directory. */
+    uint64_t* wd_inodes;  /**< Inode of the directory of each watch descriptor. */
+    size_t wd_capacity;   /**< Size of wd_inodes. */
+    atomic_bool fresh;    /**< The index on disk matches the tree. */
+    atomic_bool degraded; /**< Some directories are not watched, the index is never trusted as fresh. */
+} watcher = {.inotify_fd = -1, .wake_fd = -1};
+
+/**
+ * @brief Serializes the saves of the index: the shell and the watcher write the same temporary file.
+ * @note Only index_save() runs under it, the walk of the tree does not: a fork() or a search never waits for it.
+ */
+static pthread_mutex_t index_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief This function checks whether the name has a configuration file extension.
+ */
+static bool is_config_file(const char* name)
+{
+    const char* ext = strrchr(name, '.');
+    return ext && (strcmp(ext, ".config") == 0 || strcmp(ext, ".json") == 0);
+}
+
+/**
+ * @brief This function builds the path of the index file of a directory.
+ * @param real Real path of the directory.
+ * @param path Output buffer of PATH_MAX bytes.
+ * @return 0 on success, -1 if there is no cache directory.
+ */
+static int index_path(const char* real, char* path)
+{
+    char directory[PATH_MAX];
+    const char* cache = getenv("XDG_CACHE_HOME");
+    const char* home = getenv("HOME");
+
+    if (cache && cache[0] == '/')
+        snprintf(directory, sizeof(directory), "%s/shellter", cache);
+    else if (home)
+        snprintf(directory, sizeof(directory), "%s/.cache/shellter", home);
+    else
+        return -1;
+
+    // Crear el directorio de caché si no existe (mkdir -p)
+    for (char* p = directory + 1; *p; p++)
+    {
+        if (*p == '/')
+        {
+            *p = '\0';
+            mkdir(directory, 0755);
+            *p = '/';
+        }
+    }
+    if (mkdir(directory, 0755) != 0 && errno != EEXIST)
+        return -1;
+
+    // FNV-1a de la ruta real
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const unsigned char* c = (const unsigned char*)real; *c; c++)
+    {
+        hash ^= *c;
+        hash *= 0x100000001b3ULL;
+    }
+
+    int written = snprintf(path, PATH_MAX, "%s/index-%016" PRIx64 ".bin", directory, hash);
+    return (written > 0 && written < PATH_MAX) ? 0 : -1;
+}
+
+/**
+ * @brief This function maps an index file and validates its layout.
+ * @return 0 on success, -1 if the file does not exist or is not a valid index.
+ */
+static int index_load(const char* path, mapped_index* index)
+{
+    memset(index, 0, sizeof(*index));
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(index_header))
+    {
+        close(fd);
+        return -1;
+    }
+
+    size_t size = (size_t)st.st_size;
+    void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return -1;
+
+    const index_header* header = map;
+    size_t expected = sizeof(index_header) + (size_t)header->dir_count * sizeof(index_dir) +
+                      (size_t)header->file_count * sizeof(index_file) + header->strings_size;
+    if (memcmp(header->magic, INDEX_MAGIC, sizeof(header->magic)) != 0 || expected != size ||
+        header->dir_count == 0 || header->strings_size == 0)
+    {
+        munmap(map, size);
+        return -1;
+    }
+
+    const char* base = map;
+    index->map = map;
+    index->size = size;
+    index->view.dir_count = header->dir_count;
+    index->view.file_count = header->file_count;
+    index->view.dirs = (const index_dir*)(const void*)(base + sizeof(index_header));
+    index->view.files = (const index_file*)(const void*)(index->view.dirs + header->dir_count);
+    index->view.strings = (const char*)(index->view.files + header->file_count);
+
+    // Validar los índices para no confiar en un archivo corrupto
+    const index_view* view = &index->view;
+    bool valid = view->strings[header->strings_size - 1] == '\0' && view->dirs[0].parent == NO_INDEX;
+    for (uint32_t i = 0; valid && i < view->dir_count; i++)
+    {
+        const index_dir* dir = &view->dirs[i];
+        valid = dir->name < header->strings_size && dir->first_file <= view->file_count &&
+                dir->file_count <= view->file_count - dir->first_file && dir->first_child <= view->dir_count &&
+                dir->child_count <= view->dir_count - dir->first_child && (i == 0 || dir->parent < i);
+    }
+    for (uint32_t i = 0; valid && i < view->file_count; i++)
+    {
+        valid = view->files[i].name < header->strings_size && view->files[i].dir < view->dir_count;
+    }
+
+    if (!valid)
+    {
+        munmap(map, size);
+        memset(index, 0, sizeof(*index));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief This function unmaps an index file.
+ */
+static void index_unload(mapped_index* index)
+{
+    if (index->map)
+        munmap(index->map, index->size);
+    memset(index, 0, sizeof(*index));
+}
+
+/**
+ * @brief This function grows an array of the builder.
+ * @return false if there is no memory.
+ */
+static bool builder_grow(index_builder* builder, void** items, size_t* capacity, size_t needed, size_t item_size)
+{
+    if (needed <= *capacity)
+        return true;
+    if (needed > UINT32_MAX)
+    {
+        builder->failed = true;
+        return false;
+    }
+
+    size_t new_capacity = *capacity ? *capacity : 64;
+    while (new_capacity < needed)
+        new_capacity *= 2;
+
+    void* grown = realloc(*items, new_capacity * item_size);
+    if (!grown)
+    {
+        builder->failed = true;
+        return false;
+    }
+    *items = grown;
+    *capacity = new_capacity;
+    return true;
+}
+
+/**
+ * @brief This function adds a name to the string table.
+ * @return Offset of the name.
+ */
+static uint32_t builder_string(index_builder* builder, const char* name)
+{
+    size_t length = strlen(name) + 1;
+    if (!builder_grow(builder, (void**)&builder->strings, &builder->strings_capacity, builder->strings_size + length,
+                      1))
+        return 0;
+
+    uint32_t offset = (uint32_t)builder->strings_size;
+    memcpy(builder->strings + offset, name, length);
+    builder->strings_size += length;
+    return offset;
+}
+
+/**
+ * @brief This function adds a contiguous block of directories.
+ * @return Index of the first directory, NO_INDEX if there is no memory.
+ */
+static uint32_t builder_dirs(index_builder* builder, size_t count, uint32_t parent)
+{
+    size_t capacity = builder->dir_capacity;
+    if (!builder_grow(builder, (void**)&builder->dirs, &capacity, builder->dir_count + count, sizeof(index_dir)))
+        return NO_INDEX;
+    capacity = builder->dir_capacity;
+    if (!builder_grow(builder, (void**)&builder->new_dirs, &capacity, builder->dir_count + count, sizeof(bool)))
+        return NO_INDEX;
+    builder->dir_capacity = capacity;
+
+    uint32_t first = (uint32_t)builder->dir_count;
+    memset(builder->dirs + first, 0, count * sizeof(index_dir));
+    for (size_t i = 0; i < count; i++)
+    {
+        builder->dirs[first + i].parent = parent;
+        builder->dirs[first + i].first_file = (uint32_t)builder->file_count;
+        builder->dirs[first + i].first_child = first;
+        builder->new_dirs[first + i] = true;
+    }
+    builder->dir_count += count;
+    return first;
+}
+
+/**
+ * @brief This function adds a file to the directory being refreshed.
+ */
+static void builder_file(index_builder* builder, uint32_t dir, const char* name, const struct stat* st)
+{
+    if (!builder_grow(builder, (void**)&builder->files, &builder->file_capacity, builder->file_count + 1,
+                      sizeof(index_file)))
+        return;
+
+    index_file* file = &builder->files[builder->file_count];
+    file->ino = (uint64_t)st->st_ino;
+    file->size = (uint64_t)st->st_size;
+    file->mtime_sec = (int64_t)st->st_mtim.tv_sec;
+    file->mtime_nsec = (int64_t)st->st_mtim.tv_nsec;
+    file->dir = dir;
+    file->name = builder_string(builder, name);
+    builder->file_count++;
+    builder->dirs[dir].file_count++;
+}
+
+/**
+ * @brief This function looks for a subdirectory by name in the previous index.
+ * @note The children of a directory are sorted by name, so this is a binary search.
+ */
+static uint32_t old_child(const index_view* old, uint32_t parent, const char* name)
+{
+    if (parent == NO_INDEX)
+        return NO_INDEX;
+
+    uint32_t low = old->dirs[parent].first_child;
+    uint32_t high = low + old->dirs[parent].child_count;
+    while (low < high)
+    {
+        uint32_t middle = low + (high - low) / 2;
+        int order = strcmp(old->strings + old->dirs[middle].name, name);
+        if (order == 0)
+            return middle;
+        if (order < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return NO_INDEX;
+}
+
+/**
+ * @brief This function checks whether a directory must be read again.
+ */
+static bool must_scan(const index_builder* builder, uint32_t old, const struct stat* st)
+{
+    if (old == NO_INDEX || builder->force_all)
+        return true;
+
+    const index_dir* dir = &builder->old->view.dirs[old];
+    if (dir->ino != (uint64_t)st->st_ino || dir->mtime_sec != (int64_t)st->st_mtim.tv_sec ||
+        dir->mtime_nsec != (int64_t)st->st_mtim.tv_nsec)
+        return true;
+
+    for (size_t i = 0; i < builder->forced_count; i++)
+    {
+        if (builder->forced[i] == (uint64_t)st->st_ino)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief This function compares two directory entries by name, for qsort.
+ */
+static int compare_entries(const void* a, const void* b)
+{
+    return strcmp(((const scan_entry*)a)->name, ((const scan_entry*)b)->name);
+}
+
+/**
+ * @brief This function reads the configuration files and subdirectories of a directory.
+ * @param dir The open directory (it is closed here).
+ * @param count Output: number of entries.
+ * @return Entries sorted by name, NULL if there are none or there is no memory.
+ */
+static scan_entry* scan_directory(index_builder* builder, DIR* dir, size_t* count)
+{
+    scan_entry* entries = NULL;
+    size_t capacity = 0;
+    struct dirent* entry;
+
+    *count = 0;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        const char* name = entry->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+            continue;
+
+        unsigned char type = entry->d_type;
+        if (type == DT_UNKNOWN)
+        {
+            // Algunos sistemas de archivos no informan el tipo
+            struct stat st;
+            if (fstatat(dirfd(dir), name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+                continue;
+            type = S_ISDIR(st.st_mode) ? DT_DIR : (S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN);
+        }
+        if (type != DT_DIR && !(type == DT_REG && is_config_file(name)))
+            continue;
+
+        if (!builder_grow(builder, (void**)&entries, &capacity, *count + 1, sizeof(scan_entry)))
+            break;
+        entries[*count].name = strdup(name);
+        entries[*count].type = type;
+        if (!entries[*count].name)
+        {
+            builder->failed = true;
+            break;
+        }
+        (*count)++;
+    }
+
+    if (*count > 1)
+        qsort(entries, *count, sizeof(scan_entry), compare_entries);
+    return entries;
+}
+
+/**
+ * @brief This function adds a subdirectory to the directories waiting to be read.
+ */
+static void builder_push(index_builder* builder, uint32_t current, uint32_t old)
+{
+    if (!builder_grow(builder, (void**)&builder->pending, &builder->pending_capacity, builder->pending_count + 1,
+                      sizeof(pending_dir)))
+        return;
+    builder->pending[builder->pending_count].current = current;
+    builder->pending[builder->pending_count].old = old;
+    builder->pending_count++;
+}
+
+/**
+ * @brief This function tells whether a failed open() or opendir() leaves the index incomplete.
+ * @note Without descriptors or memory the subtree would look empty: the refresh fails instead. A directory that
+ * can't be read for other reasons (permissions, removed meanwhile) stays empty and is read again next time.
+ */
+static void builder_open_failed(index_builder* builder)
+{
+    if (errno == EMFILE || errno == ENFILE || errno == ENOMEM)
+        builder->failed = true;
+}
+
+/**
+ * @brief This function refreshes a directory of the index and queues its subdirectories.
+ * @param current Index of the directory in the builder.
+ * @param fd Open descriptor of the directory (it is closed here).
+ * @param old Index of the directory in the previous index, NO_INDEX if it is new.
+ */
+static void refresh_directory(index_builder* builder, uint32_t current, int fd, uint32_t old)
+{
+    struct stat st;
+    if (builder->failed || fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return;
+    }
+
+    builder->dirs[current].ino = (uint64_t)st.st_ino;
+    builder->dirs[current].first_file = (uint32_t)builder->file_count;
+    builder->new_dirs[current] = old == NO_INDEX;
+
+    // Un mtime en el mismo segundo de la actualización puede cambiar sin que se note: se relee la próxima vez
+    if (st.st_mtim.tv_sec < builder->started.tv_sec - 1)
+    {
+        builder->dirs[current].mtime_sec = (int64_t)st.st_mtim.tv_sec;
+        builder->dirs[current].mtime_nsec = (int64_t)st.st_mtim.tv_nsec;
+    }
+
+    if (!must_scan(builder, old, &st))
+    {
+        // El listado no cambió: se copian los nombres y solo se revisan los subdirectorios
+        const index_view* previous = &builder->old->view;
+        const index_dir* dir = &previous->dirs[old];
+
+        // Escribir un archivo no cambia el mtime del directorio: el tamaño y el mtime se vuelven a leer
+        for (uint32_t i = 0; i < dir->file_count && !builder->failed; i++)
+        {
+            const char* name = previous->strings + previous->files[dir->first_file + i].name;
+            struct stat file_st;
+            if (fstatat(fd, name, &file_st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISREG(file_st.st_mode))
+                builder_file(builder, current, name, &file_st);
+        }
+        close(fd);
+
+        uint32_t first = builder_dirs(builder, dir->child_count, current);
+        if (first == NO_INDEX)
+            return;
+        builder->dirs[current].first_child = first;
+        builder->dirs[current].child_count = dir->child_count;
+
+        // Al revés: la pila los devuelve en orden
+        for (uint32_t i = dir->child_count; i > 0 && !builder->failed; i--)
+        {
+            builder->dirs[first + i - 1].name =
+                builder_string(builder, previous->strings + previous->dirs[dir->first_child + i - 1].name);
+            builder_push(builder, first + i - 1, dir->first_child + i - 1);
+        }
+        return;
+    }
+
+    DIR* dir = fdopendir(fd);
+    if (!dir)
+    {
+        builder_open_failed(builder);
+        close(fd);
+        return;
+    }
+
+    size_t count;
+    scan_entry* entries = scan_directory(builder, dir, &count);
+
+    size_t children = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (entries[i].type == DT_REG)
+        {
+            struct stat file_st;
+            if (fstatat(dirfd(dir), entries[i].name, &file_st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISREG(file_st.st_mode))
+                builder_file(builder, current, entries[i].name, &file_st);
+        }
+        else
+        {
+            children++;
+        }
+    }
+    closedir(dir);
+
+    uint32_t first = builder_dirs(builder, children, current);
+    if (first != NO_INDEX)
+    {
+        builder->dirs[current].first_child = first;
+        builder->dirs[current].child_count = (uint32_t)children;
+
+        uint32_t next = first + (uint32_t)children;
+        for (size_t i = count; i > 0 && !builder->failed; i--)
+        {
+            if (entries[i - 1].type != DT_DIR)
+                continue;
+
+            next--;
+            builder->dirs[next].name = builder_string(builder, entries[i - 1].name);
+            uint32_t previous = builder->old ? old_child(&builder->old->view, old, entries[i - 1].name) : NO_INDEX;
+            builder_push(builder, next, previous);
+        }
+    }
+
+    for (size_t i = 0; i < count; i++)
+        free(entries[i].name);
+    free(entries);
+}
+
+/**
+ * @brief This function builds the path of a directory of the builder relative to the root of the refresh.
+ * @param path Buffer, grown as needed.
+ * @return The path, "." for the root, NULL if there is no memory.
+ */
+static const char* builder_path(index_builder* builder, uint32_t current, char** path, size_t* capacity)
+{
+    if (current == 0)
+        return ".";
+
+    size_t length = 0;
+    for (uint32_t d = current; d != 0; d = builder->dirs[d].parent)
+        length += strlen(builder->strings + builder->dirs[d].name) + 1;
+
+    if (!builder_grow(builder, (void**)path, capacity, length, 1))
+        return NULL;
+
+    size_t end = length - 1;
+    (*path)[end] = '\0';
+    for (uint32_t d = current; d != 0; d = builder->dirs[d].parent)
+    {
+        const char* name = builder->strings + builder->dirs[d].name;
+        size_t name_length = strlen(name);
+        end -= name_length;
+        memcpy(*path + end, name, name_length);
+        if (end > 0)
+            (*path)[--end] = '/';
+    }
+    return *path;
+}
+
+/**
+ * @brief This function refreshes every directory of the tree, depth first.
+ * @param root Open descriptor of the root of the tree.
+ * @param old Index of the root in the previous index, NO_INDEX if there is none.
+ * @note The directories wait in an explicit stack and are opened by their path from the root, so a refresh holds
+ * two descriptors at most whatever the depth of the tree.
+ */
+static void refresh_tree(index_builder* builder, int root, uint32_t old)
+{
+    char* path = NULL;
+    size_t capacity = 0;
+
+    builder_push(builder, 0, old);
+    while (builder->pending_count > 0 && !builder->failed)
+    {
+        pending_dir next = builder->pending[--builder->pending_count];
+        const char* relative = builder_path(builder, next.current, &path, &capacity);
+        if (!relative)
+            break;
+
+        int fd = openat(root, relative, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if (fd < 0)
+        {
+            builder_open_failed(builder);
+            continue;
+        }
+        refresh_directory(builder, next.current, fd, next.old);
+    }
+
+    free(path);
+}
+
+/**
+ * @brief This function frees the memory of a builder.
+ */
+static void builder_free(index_builder* builder)
+{
+    free(builder->dirs);
+    free(builder->new_dirs);
+    free(builder->files);
+    free(builder->strings);
+    free(builder->pending);
+    memset(builder, 0, sizeof(*builder));
+}
+
+/**
+ * @brief This function returns the view of a builder.
+ */
+static index_view builder_view(const index_builder* builder)
+{
+    index_view view = {builder->dirs, builder->files, builder->strings, (uint32_t)builder->dir_count,
+                       (uint32_t)builder->file_count};
+    return view;
+}
+
+/**
+ * @brief This function writes all the bytes of a buffer.
+ */
+static int write_all(int fd, const void* data, size_t length)
+{
+    const char* bytes = data;
+    while (length > 0)
+    {
+        ssize_t written = write(fd, bytes, length);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        bytes += written;
+        length -= (size_t)written;
+    }
+    return 0;
+}
+
+/**
+ * @brief This function saves a builder as an index file.
+ * @note The file is written aside and renamed, so readers never see a partial index.
+ */
+static int index_save(const index_builder* builder, const char* path)
+{
+    char temporary[PATH_MAX];
+    int written = snprintf(temporary, sizeof(temporary), "%s.%ld", path, (long)getpid());
+    if (written < 0 || written >= (int)sizeof(temporary))
+        return -1;
+
+    int fd = open(temporary, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return -1;
+
+    // Rellenar la tabla de cadenas hasta múltiplo de 8 para mantener la alineación
+    static const char padding[8] = {0};
+    size_t strings_size = (builder->strings_size + 7) & ~(size_t)7;
+
+    index_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+    header.dir_count = (uint32_t)builder->dir_count;
+    header.file_count = (uint32_t)builder->file_count;
+    header.strings_size = (uint32_t)strings_size;
+
+    int result = write_all(fd, &header, sizeof(header));
+    if (result == 0)
+        result = write_all(fd, builder->dirs, builder->dir_count * sizeof(index_dir));
+    if (result == 0)
+        result = write_all(fd, builder->files, builder->file_count * sizeof(index_file));
+    if (result == 0)
+        result = write_all(fd, builder->strings, builder->strings_size);
+    if (result == 0)
+        result = write_all(fd, padding, strings_size - builder->strings_size);
+    if (close(fd) != 0)
+        result = -1;
+
+    if (result == 0 && rename(temporary, path) != 0)
+        result = -1;
+    if (result != 0)
+        unlink(temporary);
+    return result;
+}
+
+/**
+ * @brief This function refreshes the index of a directory and saves it.
+ * @param real Real path of the directory.
+ * @param builder Output: the new index. It must be freed with builder_free().
+ * @param forced Inodes of directories that must be read again even if their mtime did not change.
+ * @return 0 on success, -1 on error.
+ */
+static int index_refresh(const char* real, index_builder* builder, const uint64_t* forced, size_t forced_count,
+                         bool force_all)
+{
+    char path[PATH_MAX];
+    bool has_path = index_path(real, path) == 0;
+
+    mapped_index old;
+    bool has_old = has_path && index_load(path, &old) == 0;
+
+    memset(builder, 0, sizeof(*builder));
+    builder->old = has_old ? &old : NULL;
+    builder->forced = forced;
+    builder->forced_count = forced_count;
+    builder->force_all = force_all;
+    clock_gettime(CLOCK_REALTIME, &builder->started);
+
+    int result = -1;
+    int fd = open(real, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0 && builder_dirs(builder, 1, NO_INDEX) == 0)
+    {
+        builder->dirs[0].name = builder_string(builder, "");
+        refresh_tree(builder, fd, has_old ? 0 : NO_INDEX);
+        result = builder->failed ? -1 : 0;
+    }
+    if (fd >= 0)
+        close(fd);
+
+    // Si no se puede guardar el índice la búsqueda igual es válida
+    if (result == 0 && has_path)
+    {
+        pthread_mutex_lock(&index_lock);
+        index_save(builder, path);
+        pthread_mutex_unlock(&index_lock);
+    }
+
+    builder->old = NULL;
+    if (has_old)
+        index_unload(&old);
+    return result;
+}
+
+/**
+ * @brief This function prints the configuration files of an index.
+ * @param directory The directory as the user wrote it, prefix of every path.
+ * @param recursive false to print only the files of the root directory.
+ * @return The number of files printed.
+ */
+static long index_print(const index_view* view, const char* directory, bool recursive)
+{
+    char* path = NULL;
+    size_t capacity = 0;
+    long printed = 0;
+    uint32_t dir_count = recursive ? view->dir_count : 1;
+
+    for (uint32_t i = 0; i < dir_count; i++)
+    {
+        const index_dir* dir = &view->dirs[i];
+        if (dir->file_count == 0)
+            continue;
+
+        // Reconstruir la ruta subiendo por los padres
+        size_t length = strlen(directory);
+        for (uint32_t d = i; d != 0; d = view->dirs[d].parent)
+            length += 1 + strlen(view->strings + view->dirs[d].name);
+
+        if (length + 1 > capacity)
+        {
+            char* grown = realloc(path, length + 1);
+            if (!grown)
+                break;
+            path = grown;
+            capacity = length + 1;
+        }
+
+        path[length] = '\0';
+        size_t end = length;
+        for (uint32_t d = i; d != 0; d = view->dirs[d].parent)
+        {
+            const char* name = view->strings + view->dirs[d].name;
+            size_t name_length = strlen(name);
+            end -= name_length;
+            memcpy(path + end, name, name_length);
+            path[--end] = '/';
+        }
+        memcpy(path, directory, end);
+
+        for (uint32_t f = 0; f < dir->file_count; f++)
+        {
+            printf(MATCH_PREFIX "%s/%s\n", path, view->strings + view->files[dir->first_file + f].name);
+            printed++;
+        }
+    }
+
+    free(path);
+    fflush(stdout);
+    return printed;
+}
+
+long config_index_search(const char* directory, bool recursive)
+{
+    char real[PATH_MAX];
+    if (!realpath(directory, real))
+    {
+        printf("Error: No se puede abrir el directorio %s\n", directory);
+        return -1;
+    }
+
+    // Con el watcher al día alcanza con leer el índice mapeado
+    if (watcher.active && !atomic_load(&watcher.degraded) && atomic_load(&watcher.fresh) &&
+        strcmp(watcher.root, real) == 0)
+    {
+        char path[PATH_MAX];
+        mapped_index index;
+        if (index_path(real, path) == 0 && index_load(path, &index) == 0)
+        {
+            long printed = index_print(&index.view, directory, recursive);
+            index_unload(&index);
+            return printed;
+        }
+    }
+
+    index_builder builder;
+    int result = index_refresh(real, &builder, NULL, 0, false);
+
+    long printed = -1;
+    if (result == 0)
+    {
+        index_view view = builder_view(&builder);
+        printed = index_print(&view, directory, recursive);
+    }
+    else
+    {
+        printf("Error: No se puede abrir el directorio %s\n", directory);
+    }
+
+    builder_free(&builder);
+    return printed;
+}
+
+/**
+ * @brief This function watches the directories added by the last refresh.
+ * @param all Watch every directory, for the first refresh of the watcher.
+ * @note Directories that were already indexed keep their watch descriptor.
+ */
+static void watch_new_directories(const index_builder* builder, bool all)
+{
+    char* path = NULL;
+    size_t capacity = 0;
+    size_t root_length = strlen(watcher.root);
+
+    for (size_t i = 0; i < builder->dir_count; i++)
+    {
+        if (!all && !builder->new_dirs[i])
+            continue;
+
+        size_t length = root_length;
+        for (uint32_t d = (uint32_t)i; d != 0; d = builder->dirs[d].parent)
+            length += 1 + strlen(builder->strings + builder->dirs[d].name);
+
+        if (length + 1 > capacity)
+        {
+            char* grown = realloc(path, length + 1);
+            if (!grown)
+                break;
+            path = grown;
+            capacity = length + 1;
+        }
+
+        path[length] = '\0';
+        size_t end = length;
+        for (uint32_t d = (uint32_t)i; d != 0; d = builder->dirs[d].parent)
+        {
+            const char* name = builder->strings + builder->dirs[d].name;
+            size_t name_length = strlen(name);
+            end -= name_length;
+            memcpy(path + end, name, name_length);
+            path[--end] = '/';
+        }
+        memcpy(path, watcher.root, end);
+
+        int wd = inotify_add_watch(watcher.inotify_fd, path, WATCH_EVENTS);
+        if (wd < 0)
+        {
+            if (errno == ENOSPC && !atomic_exchange(&watcher.degraded, true))
+                fprintf(stderr, "Aviso: se alcanzó el límite de inotify, el índice se actualizará en cada búsqueda\n");
+            continue;
+        }
+
+        if ((size_t)wd >= watcher.wd_capacity)
+        {
+            size_t new_capacity = watcher.wd_capacity ? watcher.wd_capacity : 64;
+            while (new_capacity <= (size_t)wd)
+                new_capacity *= 2;
+            uint64_t* grown = realloc(watcher.wd_inodes, new_capacity * sizeof(uint64_t));
+            if (!grown)
+                continue;
+            memset(grown + watcher.wd_capacity, 0, (new_capacity - watcher.wd_capacity) * sizeof(uint64_t));
+            watcher.wd_inodes = grown;
+            watcher.wd_capacity = new_capacity;
+        }
+        watcher.wd_inodes[wd] = builder->dirs[i].ino;
+    }
+
+    free(path);
+}
+
+/**
+ * @brief This function refreshes the index from the watcher thread.
+ */
+static void watch_refresh(const uint64_t* forced, size_t forced_count, bool force_all)
+{
+    index_builder builder;
+
+    if (index_refresh(watcher.root, &builder, forced, forced_count, force_all) == 0)
+    {
+        watch_new_directories(&builder, force_all);
+        atomic_store(&watcher.fresh, true);
+    }
+
+    builder_free(&builder);
+}
+
+/**
+ * @brief Body of the watcher thread: collects inotify events and refreshes the index once they settle.
+ */
+static void* watch_thread(void* arg)
+{
+    (void)arg;
+    _Alignas(struct inotify_event) char events[16 * 1024];
+    uint64_t forced[WATCH_MAX_FORCED];
+    size_t forced_count = 0;
+    bool force_all = false;
+    bool dirty = false;
+
+    watch_refresh(NULL, 0, true);
+
+    for (;;)
+    {
+        struct pollfd fds[2] = {{watcher.inotify_fd, POLLIN, 0}, {watcher.wake_fd, POLLIN, 0}};
+        int ready = poll(fds, 2, dirty ? WATCH_DEBOUNCE_MS : -1);
+
+        if (ready < 0 && errno != EINTR)
+            break;
+        if (ready > 0 && (fds[1].revents & POLLIN))
+            break;
+
+        if (ready == 0 && dirty)
+        {
+            watch_refresh(forced, forced_count, force_all);
+            forced_count = 0;
+            force_all = false;
+            dirty = false;
+            continue;
+        }
+
+        if (ready <= 0 || !(fds[0].revents & POLLIN))
+            continue;
+
+        ssize_t length = read(watcher.inotify_fd, events, sizeof(events));
+        for (ssize_t offset = 0; length > 0 && offset < length;)
+        {
+            const struct inotify_event* event = (const struct inotify_event*)(const void*)(events + offset);
+            offset += (ssize_t)(sizeof(struct inotify_event) + event->len);
+
+            if (event->mask & IN_IGNORED)
+                continue;
+
+            dirty = true;
+            atomic_store(&watcher.fresh, false);
+
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                force_all = true;
+            }
+            else if (event->wd >= 0 && (size_t)event->wd < watcher.wd_capacity)
+            {
+                // Releer el directorio aunque su mtime no cambie (p. ej. se modificó un archivo)
+                uint64_t ino = watcher.wd_inodes[event->wd];
+                bool known = false;
+                for (size_t i = 0; i < forced_count && !known; i++)
+                    known = forced[i] == ino;
+                if (!known && forced_count < WATCH_MAX_FORCED)
+                    forced[forced_count++] = ino;
+                else if (!known)
+                    force_all = true;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+int config_index_watch(const char* directory)
+{
+    char real[PATH_MAX];
+    if (!realpath(directory, real))
+    {
+        printf("Error: No se puede abrir el directorio %s\n", directory);
+        return -1;
+    }
+
+    config_index_unwatch();
+
+    watcher.inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    watcher.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    watcher.root = strdup(real);
+    if (watcher.inotify_fd < 0 || watcher.wake_fd < 0 || !watcher.root)
+    {
+        perror("inotify");
+        config_index_unwatch();
+        return -1;
+    }
+
+    atomic_store(&watcher.fresh, false);
+    atomic_store(&watcher.degraded, false);
+
+    // Las señales tienen que llegar al thread principal, no al watcher
+    sigset_t all;
+    sigset_t saved;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &saved);
+    int created = pthread_create(&watcher.thread, NULL, watch_thread, NULL);
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+    if (created != 0)
+    {
+        perror("pthread_create");
+        config_index_unwatch();
+        return -1;
+    }
+    watcher.active = true;
+    return 0;
+}
+
+void config_index_unwatch(void)
+{
+    if (watcher.active)
+    {
+        uint64_t one = 1;
+        if (write(watcher.wake_fd, &one, sizeof(one)) < 0)
+            perror("eventfd");
+        pthread_join(watcher.thread, NULL);
+        watcher.active = false;
+    }
+
+    if (watcher.inotify_fd >= 0)
+        close(watcher.inotify_fd);
+    if (watcher.wake_fd >= 0)
+        close(watcher.wake_fd);
+    free(watcher.root);
+    free(watcher.wd_inodes);
+
+    watcher.inotify_fd = -1;
+    watcher.wake_fd = -1;
+    watcher.root = NULL;
+    watcher.wd_inodes = NULL;
+    watcher.wd_capacity = 0;
+    atomic_store(&watcher.fresh, false);
+}
+
+/**
+ * @brief watch_config <directory> | watch_config -stop.
+ */
+static int watch_config_command(int argc, char* args[])
+{
+    (void)argc;
+    if (args[1] && strcmp(args[1], "-stop") == 0)
+        config_index_unwatch();
+    else if (args[1])
+        config_index_watch(args[1]);
+    else
+        printf("Uso: watch_config <directorio> | watch_config -stop\n");
+    return 0;
+}
+
+/**
+ * @brief Commands of the index.
+ */
+static const builtin_command index_commands[] = {
+    {"watch_config", "<directorio> | -stop", "Mantiene al día el índice de un directorio en segundo plano",
+     BUILTIN_PARENT, watch_config_command, NULL, NULL, NULL},
+};
+
+/**
+ * @brief fork() handler of the child: the child of a pipeline may save the index while the watcher held the lock.
+ * @note fork() does not take the lock first, so it never waits for a save of the watcher.
+ */
+static void index_fork_child(void)
+{
+    // El watcher no existe en el hijo: ni corre ni va a soltar el lock
+    watcher.active = false;
+    pthread_mutex_init(&index_lock, NULL);
+}
+
+void config_index_register_builtins(void)
+{
+    pthread_atfork(NULL, NULL, index_fork_child);
+    builtin_register(index_commands, sizeof(index_commands) / sizeof(index_commands[0]));
+}
@@ -0,0 +1,1357 @@
+/**
+ * @file filters.c
+ * @brief This file contains the implementation of the text filters of the shell.
+ * @details A run is a chain of filters: the arguments of a joined stage are the ones of every filter separated by "|"
+ * words (the pipeline was already cut at every "|", so no argument can be one). The first filter reads the input or
+ * its files and gives each filter the lines it keeps as whole blocks, the last one writes them through a buffer. Only
+ * whole lines go from one filter to the next, except the last line of an input without a final newline.
+ */
+#define _GNU_SOURCE
+#include "filters.h"
+#include "builtins.h"
+#include "commands.h"
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <regex.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Size of the reads of the input, it grows for longer lines.
+ */
+#define FILTER_BLOCK_SIZE (128 * 1024)
+
+/**
+ * @brief Size of the output buffer of a chain.
+ */
+#define FILTER_OUTPUT_SIZE (64 * 1024)
+
+/**
+ * @brief Maximum number of filters joined in one stage.
+ */
+#define FILTER_MAX 16
+
+/**
+ * @brief Kinds of filter.
+ */
+typedef enum
+{
+    FILTER_GREP, /**< Lines that contain a pattern. */
+    FILTER_WC,   /**< Counts of lines, words and bytes. */
+    FILTER_HEAD, /**< First lines. */
+    FILTER_TAIL  /**< Last lines, or the lines from one on. */
+} filter_kind;
+
+/**
+ * @brief The buffered output of a chain.
+ */
+typedef struct
+{
+    int fd;                          /**< Descriptor written to. */
+    bool broken;                     /**< A write failed (the reader left): the chain stops. */
+    size_t used;                     /**< Bytes in buffer. */
+    char buffer[FILTER_OUTPUT_SIZE]; /**< Bytes not written yet. */
+} filter_output;
+
+/**
+ * @brief A filter of a chain.
+ */
+typedef struct filter
+{
+    filter_kind kind;       /**< Kind of filter. */
+    const char* name;       /**< Name of the command, for the messages. */
+    struct filter* next;    /**< Filter that gets the lines, NULL for the output. */
+    filter_output* output;  /**< Output of the chain. */
+    char** files;           /**< File operands, only the first filter has them. */
+    int file_count;         /**< Number of files. */
+    const char* input_name; /**< File being read, for the prefixes of grep. */
+    bool done;              /**< Needs no more of the current input (head has its lines). */
+    bool finished;          /**< Needs no more input at all (grep -q matched). */
+    bool failed;            /**< A file could not be read. */
+    bool report;            /**< The errors of the arguments are printed. */
+
+    char* literal;         /**< grep: the fixed pattern, or a text every match of regex contains, NULL for none. */
+    size_t literal_length; /**< grep: length of literal. */
+    regex_t regex;         /**< grep: compiled regular expression. */
+    bool has_regex;        /**< grep: the pattern is regex, it must be freed. */
+    bool invert;           /**< grep -v. */
+    bool count;            /**< grep -c. */
+    bool quiet;            /**< grep -q. */
+    bool numbers;          /**< grep -n. */
+    uint64_t line;         /**< grep: lines of the current input so far, for -n. */
+    uint64_t matches;      /**< grep: selected lines of the current input. */
+    bool matched;          /**< grep: some input had a selected line. */
+
+    bool fields[3];     /**< wc: lines, words and bytes selected. */
+    uint64_t counts[3]; /**< wc: counts of the current input. */
+    uint64_t totals[3]; /**< wc: counts of every file. */
+    int width;          /**< wc: width of the numbers. */
+    bool in_word;       /**< wc: the last byte was part of a word. */
+
+    uint64_t limit;       /**< head, tail: number of lines; tail +N: first line. */
+    bool from;            /**< tail -n +N. */
+    uint64_t seen;        /**< head, tail +N: lines of the current input so far. */
+    char* kept;           /**< tail: the end of the input. */
+    size_t kept_used;     /**< tail: bytes in kept. */
+    size_t kept_capacity; /**< tail: size of kept. */
+} filter;
+
+/**
+ * @brief A chain of filters.
+ */
+typedef struct
+{
+    filter filters[FILTER_MAX]; /**< The filters, in the order of the pipeline. */
+    int count;                  /**< Number of filters. */
+    filter_output output;       /**< Output of the last filter. */
+} filter_chain;
+
+/**
+ * @brief The builtin-filters option.
+ */
+static bool filters_on = false;
+
+/**
+ * @brief This function writes a whole buffer, retrying on EINTR.
+ * @return 0 on success, -1 on error.
+ */
+static int write_all(int fd, const char* data, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t written = write(fd, data, length);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return -1;
+        data += written;
+        length -= (size_t)written;
+    }
+    return 0;
+}
+
+/**
+ * @brief This function writes what is left in the output buffer.
+ */
+static void output_flush(filter_output* output)
+{
+    if (output->used > 0 && !output->broken && write_all(output->fd, output->buffer, output->used) != 0)
+        output->broken = true;
+    output->used = 0;
+}
+
+/**
+ * @brief This function adds bytes to the output, a block larger than the buffer is written directly.
+ */
+static void output_write(filter_output* output, const char* data, size_t length)
+{
+    if (output->broken)
+        return;
+    if (output->used + length > sizeof(output->buffer))
+    {
+        output_flush(output);
+        if (length >= sizeof(output->buffer))
+        {
+            if (!output->broken && write_all(output->fd, data, length) != 0)
+                output->broken = true;
+            return;
+        }
+    }
+    memcpy(output->buffer + output->used, data, length);
+    output->used += length;
+}
+
+/**
+ * @brief This function counts the newlines of a block.
+ * @note Eight bytes at a time in a 64-bit word, without depending on the vectorizer: a byte of w ^ "\n\n..." is zero
+ * only for a newline, and the exact test ~(((x & 0x7f..) + 0x7f..) | x | 0x7f..) leaves its high bit. Shifted to the
+ * low bit every byte of the sum counts up to 255 words, then the eight bytes are added at once. A memchr() per line
+ * costs a call for every line.
+ */
+static uint64_t count_newlines(const char* data, const char* end)
+{
+    const uint64_t ones = 0x0101010101010101u;
+    const uint64_t low = 0x7F7F7F7F7F7F7F7Fu;
+    const uint64_t pairs = 0x00FF00FF00FF00FFu;
+    uint64_t count = 0;
+
+    while (end - data >= 8)
+    {
+        size_t words = (size_t)(end - data) / 8;
+        if (words > 255)
+            words = 255;
+
+        uint64_t sums = 0;
+        for (size_t i = 0; i < words; i++, data += 8)
+        {
+            uint64_t word;
+            memcpy(&word, data, sizeof(word));
+            word ^= ones * '\n';
+            sums += ~(((word & low) + low) | word | low) >> 7;
+        }
+
+        // Bytes a pares de 16 bits y después la suma de los cuatro en los 16 bits altos
+        sums = (sums & pairs) + ((sums >> 8) & pairs);
+        count += (sums * 0x0001000100010001u) >> 48;
+    }
+    while (data < end)
+        count += *data++ == '\n';
+    return count;
+}
+
+static void filter_push(filter* self, const char* data, size_t length);
+
+/**
+ * @brief This function gives lines to the next filter, or to the output.
+ */
+static void emit(filter* self, const char* data, size_t length)
+{
+    if (length == 0)
+        return;
+    if (self->next)
+        filter_push(self->next, data, length);
+    else
+        output_write(self->output, data, length);
+}
+
+/**
+ * @brief This function gives lines to the next filter with a final newline, as the programs print the last line.
+ */
+static void emit_lines(filter* self, const char* start, const char* stop)
+{
+    emit(self, start, (size_t)(stop - start));
+    if (stop > start && stop[-1] != '\n')
+        emit(self, "\n", 1);
+}
+
+/**
+ * @brief This function finds the first match of the pattern of grep in a block.
+ * @return The match, NULL if there is none.
+ */
+static const char* grep_find(const filter* self, const char* data, const char* end)
+{
+    if (!self->has_regex)
+        return memmem(data, (size_t)(end - data), self->literal, self->literal_length);
+
+    // REG_STARTEND: el bloque no termina en '\0'; con REG_NEWLINE ninguna coincidencia cruza un salto de línea
+    regmatch_t match = {.rm_so = 0, .rm_eo = (regoff_t)(end - data)};
+    if (!self->literal)
+        return regexec(&self->regex, data, 1, &match, REG_STARTEND) == 0 ? data + match.rm_so : NULL;
+
+    // Solo las líneas con el texto obligatorio pasan por regexec()
+    const char* p = data;
+    while (p < end && (p = memmem(p, (size_t)(end - p), self->literal, self->literal_length)) != NULL)
+    {
+        const char* previous = memrchr(data, '\n', (size_t)(p - data));
+        const char* start = previous ? previous + 1 : data;
+        const char* newline = memchr(p, '\n', (size_t)(end - p));
+        const char* stop = newline ? newline : end;
+        match.rm_so = 0;
+        match.rm_eo = (regoff_t)(stop - start);
+        if (regexec(&self->regex, start, 1, &match, REG_STARTEND) == 0)
+            return start + match.rm_so;
+        p = newline ? newline + 1 : end;
+    }
+    return NULL;
+}
+
+/**
+ * @brief This function handles the lines grep selected: it counts them or emits them with their prefixes.
+ */
+static void grep_select(filter* self, const char* start, const char* stop)
+{
+    uint64_t lines = count_newlines(start, stop) + (stop > start && stop[-1] != '\n');
+    if (lines == 0)
+        return;
+    self->matches += lines;
+    self->matched = true;
+
+    if (self->quiet)
+    {
+        self->finished = true;
+        return;
+    }
+    if (self->count)
+    {
+        self->line += lines;
+        return;
+    }
+
+    bool names = self->file_count > 1;
+    if (!names && !self->numbers)
+    {
+        self->line += lines;
+        emit_lines(self, start, stop);
+        return;
+    }
+
+    // Con prefijos, línea por línea
+    while (start < stop)
+    {
+        const char* newline = memchr(start, '\n', (size_t)(stop - start));
+        const char* end = newline ? newline + 1 : stop;
+        char prefix[32];
+        self->line++;
+        if (names)
+        {
+            emit(self, self->input_name, strlen(self->input_name));
+            emit(self, ":", 1);
+        }
+        if (self->numbers)
+            emit(self, prefix, (size_t)snprintf(prefix, sizeof(prefix), "%" PRIu64 ":", self->line));
+        emit_lines(self, start, end);
+        start = end;
+    }
+}
+
+/**
+ * @brief grep: the pattern is searched in the whole block, only the lines around a match are delimited.
+ */
+static void grep_push(filter* self, const char* data, size_t length)
+{
+    const char* p = data;
+    const char* end = data + length;
+
+    while (p < end && !self->finished)
+    {
+        const char* match = grep_find(self, p, end);
+        const char* line_start = end;
+        const char* line_end = end;
+        if (match)
+        {
+            const char* previous = memrchr(p, '\n', (size_t)(match - p));
+            const char* newline = memchr(match, '\n', (size_t)(end - match));
+            line_start = previous ? previous + 1 : p;
+            line_end = newline ? newline + 1 : end;
+        }
+
+        // Con -v se eligen las líneas entre coincidencias, de una vez
+        if (self->invert)
+        {
+            grep_select(self, p, line_start);
+            if (match)
+                self->line++;
+        }
+        else
+        {
+            if (self->numbers)
+                self->line += count_newlines(p, line_start);
+            if (match)
+                grep_select(self, line_start, line_end);
+        }
+        p = line_end;
+    }
+}
+
+/**
+ * @brief wc: the newlines are counted with memchr(), the words only if they were asked for.
+ */
+static void wc_push(filter* self, const char* data, size_t length)
+{
+    self->counts[0] += count_newlines(data, data + length);
+    self->counts[2] += length;
+    if (!self->fields[1])
+        return;
+
+    bool in_word = self->in_word;
+    uint64_t words = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        bool space = isspace((unsigned char)data[i]);
+        words += !space && !in_word;
+        in_word = !space;
+    }
+    self->in_word = in_word;
+    self->counts[1] += words;
+}
+
+/**
+ * @brief head: the lines up to the limit, then the filter needs no more input.
+ */
+static void head_push(filter* self, const char* data, size_t length)
+{
+    const char* p = data;
+    const char* end = data + length;
+    while (self->seen < self->limit && p < end)
+    {
+        const char* newline = memchr(p, '\n', (size_t)(end - p));
+        p = newline ? newline + 1 : end;
+        self->seen++;
+    }
+    emit(self, data, (size_t)(p - data));
+    if (self->seen >= self->limit)
+        self->done = true;
+}
+
+/**
+ * @brief This function returns where the last lines of a block start.
+ * @param data The block.
+ * @param length The size of the block.
+ * @param lines The number of lines.
+ * @return The offset of the first of the last lines, 0 if the block has fewer.
+ */
+static size_t last_lines(const char* data, size_t length, uint64_t lines)
+{
+    if (lines == 0)
+        return length;
+
+    // El salto de línea final no empieza otra línea
+    size_t end = length > 0 && data[length - 1] == '\n' ? length - 1 : length;
+    uint64_t found = 0;
+    while (end > 0)
+    {
+        const char* newline = memrchr(data, '\n', end);
+        if (!newline)
+            return 0;
+        if (++found == lines)
+            return (size_t)(newline - data) + 1;
+        end = (size_t)(newline - data);
+    }
+    return 0;
+}
+
+/**
+ * @brief tail: +N skips the first lines, otherwise the end of the input is kept and trimmed when the buffer is full.
+ */
+static void tail_push(filter* self, const char* data, size_t length)
+{
+    if (self->from)
+    {
+        const char* p = data;
+        const char* end = data + length;
+        while (self->seen + 1 < self->limit && p < end)
+        {
+            const char* newline = memchr(p, '\n', (size_t)(end - p));
+            p = newline ? newline + 1 : end;
+            self->seen++;
+        }
+        emit(self, p, (size_t)(end - p));
+        return;
+    }
+
+    if (self->kept_used + length > self->kept_capacity)
+    {
+        // Lo que no está entre las últimas líneas no hace falta
+        size_t start = last_lines(self->kept, self->kept_used, self->limit);
+        if (start > 0)
+        {
+            memmove(self->kept, self->kept + start, self->kept_used - start);
+            self->kept_used -= start;
+        }
+
+        if (self->kept_used + length > self->kept_capacity)
+        {
+            size_t capacity = self->kept_capacity ? self->kept_capacity : FILTER_BLOCK_SIZE;
+            while (capacity < 2 * (self->kept_used + length))
+                capacity *= 2;
+            char* larger = realloc(self->kept, capacity);
+            if (!larger)
+            {
+                fprintf(stderr, "%s: No hay memoria para las líneas\n", self->name);
+                self->failed = true;
+                self->finished = true;
+                return;
+            }
+            self->kept = larger;
+            self->kept_capacity = capacity;
+        }
+    }
+    memcpy(self->kept + self->kept_used, data, length);
+    self->kept_used += length;
+}
+
+/**
+ * @brief This function gives a block of whole lines to a filter.
+ */
+static void filter_push(filter* self, const char* data, size_t length)
+{
+    if (self->done || self->finished)
+        return;
+
+    switch (self->kind)
+    {
+    case FILTER_GREP:
+        grep_push(self, data, length);
+        break;
+    case FILTER_WC:
+        wc_push(self, data, length);
+        break;
+    case FILTER_HEAD:
+        head_push(self, data, length);
+        break;
+    case FILTER_TAIL:
+        tail_push(self, data, length);
+        break;
+    }
+}
+
+/**
+ * @brief This function prints counts of wc.
+ */
+static void wc_print(filter* self, const uint64_t counts[3], const char* name)
+{
+    char line[96];
+    size_t length = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        if (self->fields[i])
+            length += (size_t)snprintf(line + length, sizeof(line) - length, "%s%*" PRIu64, length ? " " : "",
+                                       self->width, counts[i]);
+    }
+    emit(self, line, length);
+    if (name)
+    {
+        emit(self, " ", 1);
+        emit(self, name, strlen(name));
+    }
+    emit(self, "\n", 1);
+}
+
+/**
+ * @brief This function starts an input of the first filter: it resets its counts and prints the header of head and
+ * tail when there are several files.
+ */
+static void filter_begin(filter* self, const char* name, int index)
+{
+    self->input_name = name;
+    self->done = self->kind == FILTER_HEAD && self->limit == 0;
+    self->line = 0;
+    self->matches = 0;
+    self->seen = 0;
+    self->in_word = false;
+    self->kept_used = 0;
+    memset(self->counts, 0, sizeof(self->counts));
+
+    if ((self->kind == FILTER_HEAD || self->kind == FILTER_TAIL) && self->file_count > 1)
+    {
+        if (index > 0)
+            emit(self, "\n", 1);
+        emit(self, "==> ", 4);
+        emit(self, name, strlen(name));
+        emit(self, " <==\n", 5);
+    }
+}
+
+/**
+ * @brief This function ends an input: grep -c, wc and tail print what they kept.
+ */
+static void filter_end(filter* self, const char* name)
+{
+    switch (self->kind)
+    {
+    case FILTER_GREP:
+        if (self->count && !self->quiet)
+        {
+            char number[32];
+            if (self->file_count > 1)
+            {
+                emit(self, name, strlen(name));
+                emit(self, ":", 1);
+            }
+            emit(self, number, (size_t)snprintf(number, sizeof(number), "%" PRIu64 "\n", self->matches));
+        }
+        break;
+    case FILTER_WC:
+        wc_print(self, self->counts, name);
+        for (int i = 0; i < 3; i++)
+            self->totals[i] += self->counts[i];
+        break;
+    case FILTER_HEAD:
+        break;
+    case FILTER_TAIL:
+        if (!self->from && self->kept)
+        {
+            size_t start = last_lines(self->kept, self->kept_used, self->limit);
+            emit(self, self->kept + start, self->kept_used - start);
+        }
+        break;
+    }
+}
+
+/**
+ * @brief This function tells whether the chain needs no more input.
+ * @param current true for the rest of the current input, false for the next files.
+ */
+static bool chain_stopped(const filter_chain* chain, bool current)
+{
+    if (chain->output.broken)
+        return true;
+    for (int i = 0; i < chain->count; i++)
+    {
+        const filter* self = &chain->filters[i];
+        if (self->finished || (self->done && (current || i > 0)))
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief tail -n N on a regular file: the newlines are searched from the end of the file and the input is moved to the
+ * first of the last lines, so only they are read.
+ * @note Without a regular file (a pipe, the terminal) or on a read error the whole input is read, as before.
+ */
+static void tail_seek(const filter* self, int fd)
+{
+    struct stat file;
+    off_t begin = lseek(fd, 0, SEEK_CUR);
+    if (fstat(fd, &file) != 0 || !S_ISREG(file.st_mode) || begin < 0 || file.st_size <= begin)
+        return;
+
+    char block[16 * 1024];
+    off_t end = file.st_size;
+    bool last = true;
+    uint64_t found = 0;
+    while (end > begin && self->limit > 0)
+    {
+        size_t size = end - begin > (off_t)sizeof(block) ? sizeof(block) : (size_t)(end - begin);
+        off_t start = end - (off_t)size;
+        if (pread(fd, block, size, start) != (ssize_t)size)
+            return;
+
+        // El salto de línea final no empieza otra línea
+        size_t length = size;
+        if (last && block[length - 1] == '\n')
+            length--;
+        last = false;
+
+        const char* newline;
+        while ((newline = memrchr(block, '\n', length)) != NULL)
+        {
+            if (++found == self->limit)
+            {
+                lseek(fd, start + (newline - block) + 1, SEEK_SET);
+                return;
+            }
+            length = (size_t)(newline - block);
+        }
+        end = start;
+    }
+
+    // tail -n 0 no muestra nada
+    if (self->limit == 0)
+        lseek(fd, 0, SEEK_END);
+}
+
+/**
+ * @brief This function reads an input to the end and gives its lines to the first filter.
+ * @return 0 on success, -1 on a read error (already reported).
+ */
+static int chain_feed(filter_chain* chain, int fd, const char* name)
+{
+    size_t capacity = FILTER_BLOCK_SIZE;
+    size_t used = 0;
+    char* buffer = malloc(capacity);
+    if (!buffer)
+    {
+        fprintf(stderr, "%s: No hay memoria para leer %s\n", chain->filters[0].name, name);
+        return -1;
+    }
+
+    int result = 0;
+    while (!chain_stopped(chain, true))
+    {
+        // Una línea más larga que el buffer lo agranda
+        if (used == capacity)
+        {
+            char* larger = realloc(buffer, capacity * 2);
+            if (!larger)
+            {
+                fprintf(stderr, "%s: %s: línea demasiado larga\n", chain->filters[0].name, name);
+                result = -1;
+                break;
+            }
+            buffer = larger;
+            capacity *= 2;
+        }
+
+        ssize_t bytes = read(fd, buffer + used, capacity - used);
+        if (bytes < 0 && errno == EINTR)
+            continue;
+        if (bytes < 0)
+        {
+            fprintf(stderr, "%s: %s: %s\n", chain->filters[0].name, name, strerror(errno));
+            result = -1;
+        }
+        if (bytes <= 0)
+            break;
+
+        const char* newline = memrchr(buffer + used, '\n', (size_t)bytes);
+        used += (size_t)bytes;
+        if (!newline)
+            continue;
+
+        size_t whole = (size_t)(newline - buffer) + 1;
+        filter_push(&chain->filters[0], buffer, whole);
+        memmove(buffer, buffer + whole, used - whole);
+        used -= whole;
+    }
+
+    // La última línea sin salto de línea
+    if (used > 0 && !chain_stopped(chain, true))
+        filter_push(&chain->filters[0], buffer, used);
+    free(buffer);
+    return result;
+}
+
+/**
+ * @brief This function returns the number of digits of a number, the width of the columns of wc.
+ */
+static int digits(uint64_t number)
+{
+    int count = 1;
+    while (number >= 10)
+    {
+        number /= 10;
+        count++;
+    }
+    return count;
+}
+
+/**
+ * @brief This function sets the width of the columns of wc as the program does: from the size of the files, 7 for the
+ * input or a file that is not regular, none for a single count.
+ */
+static void wc_width(filter* self)
+{
+    int fields = self->fields[0] + self->fields[1] + self->fields[2];
+    self->width = 7;
+    if (self->file_count == 0)
+    {
+        self->width = fields == 1 ? 1 : 7;
+        return;
+    }
+    if (fields == 1 && self->file_count == 1)
+    {
+        self->width = 1;
+        return;
+    }
+
+    uint64_t total = 0;
+    for (int i = 0; i < self->file_count; i++)
+    {
+        struct stat file;
+        if (stat(self->files[i], &file) != 0 || !S_ISREG(file.st_mode))
+            return;
+        total += (uint64_t)file.st_size;
+    }
+    self->width = digits(total);
+}
+
+/**
+ * @brief This function runs a chain on an input and an output.
+ * @return The exit status of the last filter.
+ */
+static int chain_run(filter_chain* chain, int input, int output)
+{
+    filter* first = &chain->filters[0];
+    chain->output.fd = output;
+    chain->output.used = 0;
+    chain->output.broken = false;
+    for (int i = 0; i < chain->count; i++)
+    {
+        if (chain->filters[i].kind == FILTER_WC)
+            wc_width(&chain->filters[i]);
+    }
+
+    if (first->file_count == 0)
+    {
+        filter_begin(first, "(entrada estándar)", 0);
+        if (first->kind == FILTER_TAIL && !first->from)
+            tail_seek(first, input);
+        if (chain_feed(chain, input, "(entrada estándar)") != 0)
+            first->failed = true;
+        filter_end(first, NULL);
+    }
+
+    for (int i = 0; i < first->file_count && !chain_stopped(chain, false); i++)
+    {
+        const char* name = first->files[i];
+        bool standard = strcmp(name, "-") == 0;
+        int fd = standard ? input : open(name, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            fprintf(stderr, "%s: %s: %s\n", first->name, name, strerror(errno));
+            first->failed = true;
+            continue;
+        }
+
+        filter_begin(first, name, i);
+        if (first->kind == FILTER_TAIL && !first->from)
+            tail_seek(first, fd);
+        if (chain_feed(chain, fd, name) != 0)
+            first->failed = true;
+        filter_end(first, name);
+        if (!standard)
+            close(fd);
+    }
+    if (first->kind == FILTER_WC && first->file_count > 1)
+        wc_print(first, first->totals, "total");
+
+    for (int i = 1; i < chain->count; i++)
+        filter_end(&chain->filters[i], NULL);
+    output_flush(&chain->output);
+
+    const filter* last = &chain->filters[chain->count - 1];
+    if (last->kind == FILTER_GREP)
+        return last->failed ? 2 : last->matched ? 0 : 1;
+    return last->failed ? 1 : 0;
+}
+
+/**
+ * @brief This function reports an error of the arguments, unless the filter is only being checked.
+ * @return -1, for the parsers.
+ */
+static int parse_error(const filter* self, const char* format, ...)
+{
+    if (self->report)
+    {
+        va_list arguments;
+        va_start(arguments, format);
+        vfprintf(stderr, format, arguments);
+        va_end(arguments);
+    }
+    return -1;
+}
+
+/**
+ * @brief This function reports an option the filter does not support.
+ * @return -1, for the parsers.
+ */
+static int unsupported(const filter* self, const char* option)
+{
+    return parse_error(self, "%s: opción no soportada por el filtro interno: %s (set +o builtin-filters usa el "
+                       "programa)\n", self->name, option);
+}
+
+/**
+ * @brief This function checks the file operands: the programs take an option after them as an option too, the
+ * filters do not, so it is reported instead of opening a file with its name.
+ * @return 0 if no operand looks like an option, -1 otherwise (reported with report).
+ */
+static int check_operands(const filter* self, char* files[], int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (files[i][0] == '-' && files[i][1] != '\0')
+            return unsupported(self, files[i]);
+    }
+    return 0;
+}
+
+/**
+ * @brief This function parses the number of lines of head and tail: "N", or "+N" for tail.
+ * @return 0 on success, -1 if it is not a number.
+ */
+static int parse_lines(filter* self, const char* text)
+{
+    self->from = self->kind == FILTER_TAIL && text[0] == '+';
+    if (text[0] == '+')
+        text++;
+
+    char* end;
+    errno = 0;
+    unsigned long long lines = strtoull(text, &end, 10);
+    if (!isdigit((unsigned char)text[0]) || *end != '\0' || errno != 0)
+        return parse_error(self, "%s: número de líneas inválido: %s\n", self->name, text);
+    self->limit = lines;
+    return 0;
+}
+
+/**
+ * @brief This function returns the end of a bracket expression.
+ * @param p The "[" that starts it.
+ * @return The character after its "]", the end of the pattern if it has none.
+ */
+static const char* bracket_end(const char* p)
+{
+    p++;
+    if (*p == '^')
+        p++;
+    if (*p == ']')
+        p++;
+    while (*p && *p != ']')
+    {
+        // [:clase:], [.símbolo.] y [=equivalencia=] tienen su propio "]"
+        if (*p == '[' && p[1] && strchr(":.=", p[1]))
+        {
+            const char closing[3] = {p[1], ']', '\0'};
+            const char* end = strstr(p + 2, closing);
+            p = end ? end + 2 : p + 1;
+            continue;
+        }
+        p++;
+    }
+    return *p ? p + 1 : p;
+}
+
+/**
+ * @brief This function tells whether a quantifier follows an atom: then the atom can be missing from a match.
+ */
+static bool quantified(const char* p, bool extended)
+{
+    if (extended)
+        return *p && strchr("*+?{", *p);
+    return *p == '*' || (p[0] == '\\' && p[1] && strchr("{+?", p[1]));
+}
+
+/**
+ * @brief This function finds the longest run of ordinary characters that every match of an expression contains.
+ * @details The run ends at anything that is not one character matching itself, a character with a quantifier is left
+ * out, and the search stops at the first group, whose contents could be optional. With alternatives there is no
+ * text common to every match.
+ * @param pattern The expression, already compiled.
+ * @param extended true for an extended expression (-E).
+ * @param length Where to store the length of the run.
+ * @return A copy of the run, NULL if there is none or memory runs out.
+ */
+static char* grep_literal(const char* pattern, bool extended, size_t* length)
+{
+    if (extended ? strchr(pattern, '|') != NULL : strstr(pattern, "\\|") != NULL)
+        return NULL;
+
+    const char* best = NULL;
+    size_t best_length = 0;
+    const char* run = pattern;
+    size_t run_length = 0;
+    const char* p = pattern;
+    while (*p)
+    {
+        const char* next = p + 1;
+        bool ordinary = false;
+        if (*p == '\\')
+        {
+            if (p[1] == '(')
+                break;
+            const char* interval = p[1] == '{' ? strstr(p, "\\}") : NULL;
+            next = interval ? interval + 2 : p[1] ? p + 2 : p + 1;
+        }
+        else if (*p == '[')
+        {
+            next = bracket_end(p);
+        }
+        else if (extended && *p == '(')
+        {
+            break;
+        }
+        else if (extended && *p == '{')
+        {
+            const char* interval = strchr(p, '}');
+            next = interval ? interval + 1 : p + 1;
+        }
+        else
+        {
+            // En una expresión básica +?(){} son caracteres comunes, pero cortar el texto nunca está mal
+            ordinary = !strchr(".*^$+?(){}", *p) && !quantified(next, extended);
+        }
+
+        if (ordinary)
+        {
+            if (run_length == 0)
+                run = p;
+            if (++run_length > best_length)
+            {
+                best = run;
+                best_length = run_length;
+            }
+        }
+        else
+        {
+            run_length = 0;
+        }
+        p = next;
+    }
+
+    if (best_length == 0)
+        return NULL;
+    *length = best_length;
+    return strndup(best, best_length);
+}
+
+/**
+ * @brief This function compiles the pattern of grep: without special characters it is a fixed string.
+ * @return 0 on success, -1 on error (already reported).
+ */
+static int grep_compile(filter* self, const char* pattern, char mode, bool ignore_case)
+{
+    const char* special = mode == 'E' ? "\\.[]*^$+?(){}|" : "\\.[]*^$";
+    bool fixed = mode == 'F' || strpbrk(pattern, special) == NULL;
+    if (fixed && !ignore_case && pattern[0] != '\0')
+    {
+        self->literal = strdup(pattern);
+        self->literal_length = strlen(pattern);
+        return self->literal ? 0 : parse_error(self, "grep: No hay memoria para el patrón\n");
+    }
+
+    // Un texto fijo sin distinguir mayúsculas: la expresión con sus caracteres especiales escapados
+    char* escaped = NULL;
+    if (fixed && mode == 'F')
+    {
+        escaped = malloc(2 * strlen(pattern) + 1);
+        if (!escaped)
+            return parse_error(self, "grep: No hay memoria para el patrón\n");
+        char* q = escaped;
+        for (const char* p = pattern; *p; p++)
+        {
+            if (strchr("\\.[*^$", *p))
+                *q++ = '\\';
+            *q++ = *p;
+        }
+        *q = '\0';
+        pattern = escaped;
+    }
+
+    int flags = REG_NEWLINE | (mode == 'E' ? REG_EXTENDED : 0) | (ignore_case ? REG_ICASE : 0);
+    int error = regcomp(&self->regex, pattern, flags);
+    free(escaped);
+    if (error != 0)
+    {
+        char message[256];
+        regerror(error, &self->regex, message, sizeof(message));
+        return parse_error(self, "grep: %s\n", message);
+    }
+    self->has_regex = true;
+
+    // Sin distinguir mayúsculas el texto obligatorio no sirve para memmem()
+    if (!ignore_case)
+        self->literal = grep_literal(pattern, mode == 'E', &self->literal_length);
+    return 0;
+}
+
+/**
+ * @brief grep [-F | -E | -G] [-i] [-v] [-c] [-n] [-q] [-e] PATTERN [file]...
+ */
+static int parse_grep(filter* self, int argc, char* args[])
+{
+    char mode = 'G';
+    bool ignore_case = false;
+    const char* pattern = NULL;
+    bool ended = false;
+    int i = 1;
+
+    for (; i < argc && args[i][0] == '-' && args[i][1] != '\0'; i++)
+    {
+        if (strcmp(args[i], "--") == 0)
+        {
+            ended = true;
+            i++;
+            break;
+        }
+        for (const char* option = args[i] + 1; *option; option++)
+        {
+            switch (*option)
+            {
+            case 'F':
+            case 'E':
+            case 'G':
+                mode = *option;
+                break;
+            case 'i':
+                ignore_case = true;
+                break;
+            case 'v':
+                self->invert = true;
+                break;
+            case 'c':
+                self->count = true;
+                break;
+            case 'n':
+                self->numbers = true;
+                break;
+            case 'q':
+                self->quiet = true;
+                break;
+            case 'e':
+                // Varios patrones son alternativas: eso lo hace el programa
+                if (pattern)
+                    return unsupported(self, "-e repetido");
+
+                // -e PATRÓN o -ePATRÓN
+                pattern = option[1] ? option + 1 : i + 1 < argc ? args[++i] : NULL;
+                if (!pattern)
+                    return parse_error(self, "grep: falta el patrón de -e\n");
+                option += strlen(option) - 1;
+                break;
+            default:
+            {
+                char text[3] = {'-', *option, '\0'};
+                return unsupported(self, text);
+            }
+            }
+        }
+    }
+
+    if (!pattern)
+    {
+        if (i >= argc)
+            return parse_error(self, "Uso: grep [-F | -E] [-i] [-v] [-c] [-n] [-q] PATRÓN [archivo]...\n");
+        pattern = args[i++];
+    }
+
+    self->files = &args[i];
+    self->file_count = argc - i;
+    if (!ended && check_operands(self, self->files, self->file_count) != 0)
+        return -1;
+    return grep_compile(self, pattern, mode, ignore_case);
+}
+
+/**
+ * @brief wc [-l] [-w] [-c] [file]...
+ */
+static int parse_wc(filter* self, int argc, char* args[])
+{
+    int i = 1;
+    for (; i < argc && args[i][0] == '-' && args[i][1] != '\0'; i++)
+    {
+        for (const char* option = args[i] + 1; *option; option++)
+        {
+            const char* fields = "lwc";
+            const char* field = strchr(fields, *option);
+            if (!field)
+            {
+                char text[3] = {'-', *option, '\0'};
+                return unsupported(self, text);
+            }
+            self->fields[field - fields] = true;
+        }
+    }
+
+    if (!self->fields[0] && !self->fields[1] && !self->fields[2])
+        self->fields[0] = self->fields[1] = self->fields[2] = true;
+    self->files = &args[i];
+    self->file_count = argc - i;
+    return check_operands(self, self->files, self->file_count);
+}
+
+/**
+ * @brief head [-n N | -N] [file]... and tail [-n N | -n +N | -N] [file]...
+ */
+static int parse_lines_filter(filter* self, int argc, char* args[])
+{
+    self->limit = 10;
+    int i = 1;
+    if (i < argc && strcmp(args[i], "-n") == 0)
+    {
+        if (i + 1 >= argc || parse_lines(self, args[i + 1]) != 0)
+            return -1;
+        i += 2;
+    }
+    else if (i < argc && strncmp(args[i], "-n", 2) == 0)
+    {
+        if (parse_lines(self, args[i] + 2) != 0)
+            return -1;
+        i++;
+    }
+    else if (i < argc && args[i][0] == '-' && isdigit((unsigned char)args[i][1]))
+    {
+        if (parse_lines(self, args[i] + 1) != 0)
+            return -1;
+        i++;
+    }
+
+    self->files = &args[i];
+    self->file_count = argc - i;
+    return check_operands(self, self->files, self->file_count);
+}
+
+/**
+ * @brief This function parses one filter.
+ * @return 0 on success, -1 on error (already reported).
+ */
+static int filter_parse(filter* self, int argc, char* args[], bool report)
+{
+    static const char* const names[] = {"grep", "wc", "head", "tail"};
+
+    memset(self, 0, sizeof(*self));
+    self->report = report;
+    for (size_t kind = 0; kind < sizeof(names) / sizeof(names[0]); kind++)
+    {
+        if (strcmp(args[0], names[kind]) != 0)
+            continue;
+
+        self->kind = (filter_kind)kind;
+        self->name = names[kind];
+        switch (self->kind)
+        {
+        case FILTER_GREP:
+            return parse_grep(self, argc, args);
+        case FILTER_WC:
+            return parse_wc(self, argc, args);
+        case FILTER_HEAD:
+        case FILTER_TAIL:
+            return parse_lines_filter(self, argc, args);
+        }
+    }
+
+    return parse_error(self, "%s: no es un filtro\n", args[0]);
+}
+
+/**
+ * @brief This function releases what the filters of a chain allocated.
+ */
+static void chain_free(filter_chain* chain)
+{
+    for (int i = 0; i < chain->count; i++)
+    {
+        filter* self = &chain->filters[i];
+        free(self->literal);
+        if (self->has_regex)
+            regfree(&self->regex);
+        free(self->kept);
+    }
+    free(chain);
+}
+
+/**
+ * @brief This function builds the chain of a stage: the filters are separated by "|" arguments.
+ * @param argc The number of arguments.
+ * @param args The arguments.
+ * @param report false to only check the arguments, without printing their errors.
+ * @return The chain, NULL if an argument is invalid (reported with report).
+ */
+static filter_chain* chain_parse(int argc, char* args[], bool report)
+{
+    filter_chain* chain = calloc(1, sizeof(filter_chain));
+    if (!chain)
+    {
+        if (report)
+            fprintf(stderr, "%s: No hay memoria para el filtro\n", args[0]);
+        return NULL;
+    }
+
+    int start = 0;
+    while (start < argc)
+    {
+        int end = start;
+        while (end < argc && strcmp(args[end], "|") != 0)
+            end++;
+
+        if (chain->count == FILTER_MAX || end == start)
+        {
+            if (report)
+                fprintf(stderr, "%s: demasiados filtros\n", args[0]);
+            chain_free(chain);
+            return NULL;
+        }
+
+        // Los filtros siguientes leen las líneas del anterior, no archivos
+        filter* self = &chain->filters[chain->count++];
+        if (filter_parse(self, end - start, &args[start], report) != 0 ||
+            (chain->count > 1 && self->file_count > 0 &&
+             parse_error(self, "%s: después de otro filtro no lee archivos\n", self->name) != 0))
+        {
+            chain_free(chain);
+            return NULL;
+        }
+        self->output = &chain->output;
+        if (chain->count > 1)
+            chain->filters[chain->count - 2].next = self;
+        start = end + 1;
+    }
+    return chain;
+}
+
+/**
+ * @brief A filter run by the shell itself, or in the child of the last stage of a pipeline.
+ */
+static int filter_run(int argc, char* args[])
+{
+    filter_chain* chain = chain_parse(argc, args, true);
+    if (!chain)
+        return 2;
+
+    // La shell no recibe Ctrl+C ni Ctrl+Z: un filtro que leería la terminal corre como programa
+    if (chain->filters[0].file_count == 0 && jobs_interactive() && isatty(STDIN_FILENO))
+    {
+        chain_free(chain);
+        external_command(args);
+        return last_command_status();
+    }
+
+    // Lo pendiente de stdio va antes que lo que el filtro escribe en el descriptor
+    fflush(stdout);
+    int status = chain_run(chain, STDIN_FILENO, STDOUT_FILENO);
+    chain_free(chain);
+    return status;
+}
+
+/**
+ * @brief A stage of filters on a pipeline thread.
+ */
+static int filter_run_fd(const builtin_command* self, int argc, char* args[], int input, int output)
+{
+    (void)self;
+    filter_chain* chain = chain_parse(argc, args, true);
+    if (!chain)
+        return 2;
+    int status = chain_run(chain, input, output);
+    chain_free(chain);
+    return status;
+}
+
+/**
+ * @brief The arguments of a filter are checked before it gets a thread, an error is reported by its process.
+ */
+static bool filter_pipeline_safe(int argc, char* args[])
+{
+    return filters_joinable(argc, args, true);
+}
+
+/**
+ * @brief The filters, registered while the option is on.
+ */
+static const builtin_command filter_commands[] = {
+    {"grep", "[-F | -E] [-i] [-v] [-c] [-n] [-q] PATRÓN [archivo]...",
+     "Muestra las líneas que contienen un patrón (filtro interno)", BUILTIN_PIPELINE | BUILTIN_INPUT, filter_run,
+     filter_run_fd, filter_pipeline_safe, NULL},
+    {"wc", "[-l] [-w] [-c] [archivo]...", "Cuenta líneas, palabras y bytes (filtro interno)",
+     BUILTIN_PIPELINE | BUILTIN_INPUT, filter_run, filter_run_fd, filter_pipeline_safe, NULL},
+    {"head", "[-n N] [archivo]...", "Muestra las primeras líneas (filtro interno)", BUILTIN_PIPELINE | BUILTIN_INPUT,
+     filter_run, filter_run_fd, filter_pipeline_safe, NULL},
+    {"tail", "[-n N | -n +N] [archivo]...", "Muestra las últimas líneas (filtro interno)",
+     BUILTIN_PIPELINE | BUILTIN_INPUT, filter_run, filter_run_fd, filter_pipeline_safe, NULL},
+};
+
+bool filters_enabled(void)
+{
+    return filters_on;
+}
+
+int filters_enable(bool enable)
+{
+    size_t count = sizeof(filter_commands) / sizeof(filter_commands[0]);
+    if (enable && !filters_on && builtin_register(filter_commands, count) != 0)
+    {
+        builtin_unregister(filter_commands, count);
+        return -1;
+    }
+    if (!enable && filters_on)
+        builtin_unregister(filter_commands, count);
+    filters_on = enable;
+    return 0;
+}
+
+bool filters_joinable(int argc, char* args[], bool first)
+{
+    if (!filters_on || argc == 0)
+        return false;
+
+    bool known = false;
+    for (size_t i = 0; i < sizeof(filter_commands) / sizeof(filter_commands[0]); i++)
+        known = known || strcmp(args[0], filter_commands[i].name) == 0;
+    if (!known)
+        return false;
+
+    // Solo el análisis: los errores los informa la etapa cuando corre
+    filter_chain* chain = chain_parse(argc, args, false);
+    bool valid = chain && (first || chain->filters[0].file_count == 0);
+    if (chain)
+        chain_free(chain);
+    return valid;
+}
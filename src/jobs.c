@@ -0,0 +1,695 @@
+/**
+ * @file jobs.c
+ * @brief This file contains the implementation of the job control.
+ * @details Jobs are kept in a small table indexed by their number. The foreground job is waited for with
+ * wait4(-pgid, WUNTRACED), so a stop of any of its processes (Ctrl+Z) gives the terminal back to the shell at once.
+ * The background jobs are only collected with WNOHANG, process by process, so the shell never reaps a child it did
+ * not start (the git process of the prompt, for example). In the event loop every background process also has a
+ * pidfd, so its end is reported at the prompt as soon as it happens. wait4() also gives the resource usage of every
+ * foreground process, which the time command asks for with jobs_record_usage().
+ */
+#include "jobs.h"
+#include "builtins.h"
+#include "prompt.h"
+#include "reactor.h"
+#include "trace.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/pidfd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+
+/**
+ * @brief A process of a job.
+ */
+typedef struct
+{
+    pid_t pid;    /**< Process id. */
+    bool done;    /**< The process finished. */
+    bool stopped; /**< The process is stopped. */
+    int status;   /**< Status reported by waitpid(). */
+    int pidfd;    /**< pidfd registered in the event loop, -1 if none. */
+} job_process;
+
+/**
+ * @brief A job: a command or a pipeline.
+ */
+typedef struct
+{
+    int number;              /**< Job number, 0 for a free entry. */
+    pid_t pgid;              /**< Process group. */
+    job_process* processes;  /**< Processes, the last one gives the exit status. */
+    size_t count;            /**< Number of processes. */
+    char* command;           /**< Command line. */
+    bool notified;           /**< The stop was already reported. */
+    bool has_modes;          /**< modes holds the terminal modes of the job. */
+    struct termios modes;    /**< Terminal modes of the job when it was stopped. */
+} job;
+
+/**
+ * @brief Jobs, the entry i holds the job number i + 1.
+ */
+static job* job_table = NULL;
+
+/**
+ * @brief Number of entries of job_table.
+ */
+static size_t job_capacity = 0;
+
+/**
+ * @brief Number of the current job (the last one started or stopped), 0 for none.
+ */
+static int job_current = 0;
+
+/**
+ * @brief The shell does job control.
+ */
+static bool job_control = false;
+
+/**
+ * @brief Process group of the shell.
+ */
+static pid_t shell_pgid = 0;
+
+/**
+ * @brief Terminal modes of the shell, restored after every foreground job.
+ */
+static struct termios shell_modes;
+
+/**
+ * @brief Signals the shell ignores or handles itself, restored in the children.
+ */
+static const int job_signals[] = {SIGINT, SIGQUIT, SIGTSTP, SIGTTIN, SIGTTOU, SIGCHLD};
+
+/**
+ * @brief Where jobs_foreground() records the usage of the processes that end, NULL if nobody asked for it.
+ */
+static job_usage* usage_records = NULL;
+
+/**
+ * @brief Number of entries of usage_records.
+ */
+static size_t usage_capacity = 0;
+
+/**
+ * @brief Number of entries stored in usage_records.
+ */
+static size_t* usage_count = NULL;
+
+void jobs_init(void)
+{
+    if (!isatty(STDIN_FILENO))
+        return;
+
+    // Si la shell arrancó en segundo plano, esperar a que le den la terminal
+    pid_t pgid;
+    while (tcgetpgrp(STDIN_FILENO) != (pgid = getpgrp()))
+        kill(-pgid, SIGTTIN);
+
+    struct sigaction ignore;
+    memset(&ignore, 0, sizeof(ignore));
+    ignore.sa_handler = SIG_IGN;
+    sigemptyset(&ignore.sa_mask);
+    sigaction(SIGTTIN, &ignore, NULL);
+    sigaction(SIGTTOU, &ignore, NULL);
+
+    // La shell en su propio grupo (ya lo es si es líder de sesión)
+    shell_pgid = getpid();
+    if (getpgrp() != shell_pgid && setpgid(0, shell_pgid) != 0)
+    {
+        perror("Error: No se pudo crear el grupo de procesos de la shell");
+        return;
+    }
+
+    tcsetpgrp(STDIN_FILENO, shell_pgid);
+    tcgetattr(STDIN_FILENO, &shell_modes);
+    job_control = true;
+}
+
+bool jobs_interactive(void)
+{
+    return job_control;
+}
+
+void job_child_setup(pid_t pgid, bool foreground)
+{
+    if (job_control)
+    {
+        pid_t pid = getpid();
+        if (pgid == 0)
+            pgid = pid;
+        setpgid(pid, pgid);
+
+        // SIGTTOU todavía se ignora: el hijo puede tomar la terminal aunque esté en segundo plano
+        if (foreground)
+            tcsetpgrp(STDIN_FILENO, pgid);
+
+        // El hijo no hace control de trabajos: sus propios hijos quedan en el grupo del trabajo
+        job_control = false;
+    }
+
+    struct sigaction defaults;
+    memset(&defaults, 0, sizeof(defaults));
+    defaults.sa_handler = SIG_DFL;
+    sigemptyset(&defaults.sa_mask);
+    for (size_t i = 0; i < sizeof(job_signals) / sizeof(job_signals[0]); i++)
+        sigaction(job_signals[i], &defaults, NULL);
+
+    sigset_t empty;
+    sigemptyset(&empty);
+    sigprocmask(SIG_SETMASK, &empty, NULL);
+}
+
+void job_parent_setup(pid_t pid, pid_t pgid)
+{
+    if (job_control)
+        setpgid(pid, pgid == 0 ? pid : pgid);
+}
+
+/**
+ * @brief This function returns a job by its number, NULL if it does not exist.
+ */
+static job* find_job(int number)
+{
+    if (number <= 0 || (size_t)number > job_capacity || job_table[number - 1].number == 0)
+        return NULL;
+    return &job_table[number - 1];
+}
+
+/**
+ * @brief This function closes the pidfd of a process, if it has one.
+ */
+static void close_pidfd(job_process* process)
+{
+    if (process->pidfd >= 0)
+    {
+        reactor_remove(process->pidfd);
+        close(process->pidfd);
+        process->pidfd = -1;
+    }
+}
+
+/**
+ * @brief This function frees the entry of a job.
+ */
+static void remove_job(job* j)
+{
+    if (job_current == j->number)
+        job_current = 0;
+    for (size_t i = 0; i < j->count; i++)
+        close_pidfd(&j->processes[i]);
+    free(j->processes);
+    free(j->command);
+    memset(j, 0, sizeof(*j));
+
+    // El trabajo actual pasa a ser el de número más alto
+    for (size_t i = job_capacity; i > 0 && job_current == 0; i--)
+        job_current = job_table[i - 1].number;
+}
+
+/**
+ * @brief This function records a status reported by waitpid() for a process of a job.
+ * @return true if the process belongs to the job.
+ */
+static bool update_process(job* j, pid_t pid, int status)
+{
+    for (size_t i = 0; i < j->count; i++)
+    {
+        job_process* process = &j->processes[i];
+        if (process->pid != pid)
+            continue;
+
+        if (WIFSTOPPED(status))
+        {
+            process->stopped = true;
+        }
+        else if (WIFCONTINUED(status))
+        {
+            process->stopped = false;
+        }
+        else
+        {
+            process->done = true;
+            process->stopped = false;
+            close_pidfd(process);
+        }
+        process->status = status;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief This function tells whether every process of a job finished.
+ */
+static bool job_finished(const job* j)
+{
+    for (size_t i = 0; i < j->count; i++)
+    {
+        if (!j->processes[i].done)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief This function tells whether a job is stopped: every process left is stopped.
+ */
+static bool job_stopped(const job* j)
+{
+    bool stopped = false;
+    for (size_t i = 0; i < j->count; i++)
+    {
+        if (!j->processes[i].done && !j->processes[i].stopped)
+            return false;
+        stopped = stopped || j->processes[i].stopped;
+    }
+    return stopped;
+}
+
+/**
+ * @brief This function converts a status of waitpid() to an exit status of the shell.
+ */
+static int exit_status(int status)
+{
+    if (WIFEXITED(status))
+        return WEXITSTATUS(status);
+    if (WIFSIGNALED(status))
+        return 128 + WTERMSIG(status);
+    if (WIFSTOPPED(status))
+        return 128 + WSTOPSIG(status);
+    return 0;
+}
+
+/**
+ * @brief This function sends a signal to every process of a job.
+ */
+static void signal_job(const job* j, int signum)
+{
+    if (job_control)
+    {
+        kill(-j->pgid, signum);
+        return;
+    }
+    for (size_t i = 0; i < j->count; i++)
+    {
+        if (!j->processes[i].done)
+            kill(j->processes[i].pid, signum);
+    }
+}
+
+/**
+ * @brief This function marks the processes of a job as running again and sends them SIGCONT.
+ */
+static void continue_job(job* j)
+{
+    for (size_t i = 0; i < j->count; i++)
+        j->processes[i].stopped = false;
+    j->notified = false;
+    signal_job(j, SIGCONT);
+}
+
+int jobs_add(pid_t pgid, const pid_t* pids, size_t count, char* const words[], const char* separator)
+{
+    // El número es el menor libre, como en bash
+    size_t index = 0;
+    while (index < job_capacity && job_table[index].number != 0)
+        index++;
+
+    if (index == job_capacity)
+    {
+        size_t capacity = job_capacity ? job_capacity * 2 : 8;
+        job* table = realloc(job_table, capacity * sizeof(job));
+        if (table)
+        {
+            memset(table + job_capacity, 0, (capacity - job_capacity) * sizeof(job));
+            job_table = table;
+            job_capacity = capacity;
+        }
+    }
+
+    size_t length = 1;
+    for (size_t i = 0; words[i]; i++)
+        length += strlen(words[i]) + strlen(separator);
+
+    job_process* processes = calloc(count, sizeof(job_process));
+    char* command = malloc(length);
+    if (index == job_capacity || !processes || !command)
+    {
+        perror("Error: No se pudo registrar el trabajo");
+        free(processes);
+        free(command);
+        for (size_t i = 0; i < count; i++)
+        {
+            kill(pids[i], SIGKILL);
+            waitpid(pids[i], NULL, 0);
+        }
+        return -1;
+    }
+
+    // Las etapas de un pipeline conservan los espacios alrededor del "|": se recortan
+    size_t used = 0;
+    for (size_t i = 0; words[i]; i++)
+    {
+        const char* word = words[i] + strspn(words[i], " ");
+        size_t word_length = strlen(word);
+        while (word_length > 0 && word[word_length - 1] == ' ')
+            word_length--;
+
+        if (i > 0)
+        {
+            memcpy(command + used, separator, strlen(separator));
+            used += strlen(separator);
+        }
+        memcpy(command + used, word, word_length);
+        used += word_length;
+    }
+    command[used] = '\0';
+    for (size_t i = 0; i < count; i++)
+    {
+        processes[i].pid = pids[i];
+        processes[i].pidfd = -1;
+    }
+
+    job* j = &job_table[index];
+    j->number = (int)index + 1;
+    j->pgid = pgid;
+    j->processes = processes;
+    j->count = count;
+    j->command = command;
+    return j->number;
+}
+
+bool jobs_exists(int number)
+{
+    return find_job(number) != NULL;
+}
+
+void jobs_record_usage(job_usage* usages, size_t capacity, size_t* count)
+{
+    usage_records = usages;
+    usage_capacity = usages ? capacity : 0;
+    usage_count = usages ? count : NULL;
+}
+
+/**
+ * @brief This function records the usage of a process of the foreground job that ended, if it was asked for.
+ */
+static void record_usage(const job* j, pid_t pid, int status, const struct rusage* usage)
+{
+    if (!usage_records || *usage_count >= usage_capacity || WIFSTOPPED(status) || WIFCONTINUED(status))
+        return;
+
+    for (size_t i = 0; i < j->count; i++)
+    {
+        if (j->processes[i].pid != pid)
+            continue;
+
+        job_usage* record = &usage_records[(*usage_count)++];
+        record->stage = i;
+        record->status = exit_status(status);
+        clock_gettime(CLOCK_MONOTONIC, &record->end);
+        record->usage = *usage;
+        return;
+    }
+}
+
+int jobs_foreground(int number, bool resume)
+{
+    job* j = find_job(number);
+    if (!j)
+        return 1;
+
+    if (job_control)
+    {
+        tcsetpgrp(STDIN_FILENO, j->pgid);
+        if (resume && j->has_modes)
+            tcsetattr(STDIN_FILENO, TCSADRAIN, &j->modes);
+    }
+    if (resume)
+        continue_job(j);
+
+    uint64_t trace_start = trace_begin();
+    while (!job_finished(j) && !job_stopped(j))
+    {
+        // Sin control de trabajos no hay grupo propio: se espera proceso por proceso
+        pid_t target = j->pgid > 0 ? -j->pgid : 0;
+        for (size_t i = 0; !job_control && i < j->count; i++)
+        {
+            if (!j->processes[i].done && !j->processes[i].stopped)
+            {
+                target = j->processes[i].pid;
+                break;
+            }
+        }
+
+        int status;
+        struct rusage usage;
+        pid_t pid = wait4(target, &status, WUNTRACED, &usage);
+        if (pid < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            // Nadie más que esperar (ECHILD): dar el trabajo por terminado
+            for (size_t i = 0; i < j->count; i++)
+                j->processes[i].done = true;
+            break;
+        }
+        record_usage(j, pid, status, &usage);
+        update_process(j, pid, status);
+    }
+    trace_end("wait", trace_start, j->pgid, j->number, j->command);
+
+    if (job_control)
+    {
+        // Recuperar la terminal y sus modos (el programa pudo dejarla en modo crudo)
+        tcsetpgrp(STDIN_FILENO, shell_pgid);
+        j->has_modes = tcgetattr(STDIN_FILENO, &j->modes) == 0;
+        tcsetattr(STDIN_FILENO, TCSADRAIN, &shell_modes);
+    }
+
+    int status = exit_status(j->processes[j->count - 1].status);
+
+    if (!job_finished(j))
+    {
+        for (size_t i = 0; i < j->count; i++)
+        {
+            if (j->processes[i].stopped)
+                status = exit_status(j->processes[i].status);
+        }
+        job_current = j->number;
+        j->notified = true;
+        printf("\n[%d]+  Detenido\t\t%s\n", j->number, j->command);
+        return status;
+    }
+
+    int last = j->processes[j->count - 1].status;
+    if (WIFSIGNALED(last) && WTERMSIG(last) == SIGINT)
+        printf("\n");
+    else if (WIFSIGNALED(last) && WTERMSIG(last) != SIGPIPE)
+        printf("%s%s\n", strsignal(WTERMSIG(last)), WCOREDUMP(last) ? " (core generado)" : "");
+
+    remove_job(j);
+    return status;
+}
+
+/**
+ * @brief This function is called from the event loop when a background process ends.
+ */
+static void job_exited(int fd, uint32_t events, void* data)
+{
+    (void)fd;
+    (void)events;
+    (void)data;
+    if (jobs_reap(true) > 0)
+        show_prompt();
+}
+
+/**
+ * @brief This function registers a pidfd for every running process of a job.
+ * @note Without pidfds (old kernels) the end is still reported through SIGCHLD.
+ */
+static void watch_job(job* j)
+{
+    if (!job_control)
+        return;
+
+    for (size_t i = 0; i < j->count; i++)
+    {
+        job_process* process = &j->processes[i];
+        if (process->done || process->pidfd >= 0)
+            continue;
+
+        process->pidfd = pidfd_open(process->pid, 0);
+        if (process->pidfd >= 0 && reactor_add(process->pidfd, EPOLLIN, job_exited, NULL) != 0)
+        {
+            close(process->pidfd);
+            process->pidfd = -1;
+        }
+    }
+}
+
+void jobs_background(int number, bool resume)
+{
+    job* j = find_job(number);
+    if (!j)
+        return;
+
+    watch_job(j);
+
+    job_current = j->number;
+    if (resume)
+    {
+        continue_job(j);
+        printf("[%d]+ %s &\n", j->number, j->command);
+    }
+    else
+    {
+        printf("[%d] %d\n", j->number, j->processes[j->count - 1].pid);
+    }
+}
+
+int jobs_reap(bool at_prompt)
+{
+    int reported = 0;
+
+    for (size_t index = 0; index < job_capacity; index++)
+    {
+        job* j = &job_table[index];
+        if (j->number == 0)
+            continue;
+
+        for (size_t i = 0; i < j->count; i++)
+        {
+            int status;
+            job_process* process = &j->processes[i];
+            if (process->done)
+                continue;
+
+            pid_t pid = waitpid(process->pid, &status, WNOHANG | WUNTRACED | WCONTINUED);
+            if (pid == process->pid)
+            {
+                update_process(j, pid, status);
+            }
+            else if (pid < 0 && errno == ECHILD)
+            {
+                // Ya no es hijo de la shell: darlo por terminado (y soltar su pidfd)
+                process->done = true;
+                close_pidfd(process);
+            }
+        }
+
+        const char* state = NULL;
+        if (job_finished(j))
+        {
+            int status = exit_status(j->processes[j->count - 1].status);
+            state = status == 0 ? "Hecho" : "Salida";
+        }
+        else if (job_stopped(j) && !j->notified)
+        {
+            j->notified = true;
+            state = "Detenido";
+        }
+
+        // Sin terminal los trabajos se recogen en silencio
+        if (state && job_control)
+        {
+            if (at_prompt && reported == 0)
+                printf("\n");
+            printf("[%d]%c  %s\t\t%s\n", j->number, j->number == job_current ? '+' : ' ', state, j->command);
+            reported++;
+        }
+        if (job_finished(j))
+            remove_job(j);
+    }
+
+    if (reported > 0)
+        fflush(stdout);
+    return reported;
+}
+
+/**
+ * @brief This function parses the job argument of fg and bg: "%n", "n" or nothing for the current job.
+ * @return The job number, 0 if it does not exist.
+ */
+static int parse_job(const char* argument)
+{
+    if (!argument)
+        return find_job(job_current) ? job_current : 0;
+
+    if (argument[0] == '%')
+        argument++;
+    char* end;
+    long number = strtol(argument, &end, 10);
+    if (*argument == '\0' || *end != '\0' || number <= 0 || number > (long)job_capacity)
+        return 0;
+    return find_job((int)number) ? (int)number : 0;
+}
+
+int jobs_command(char* args[])
+{
+    if (strcmp(args[0], "jobs") == 0)
+    {
+        jobs_reap(false);
+        for (size_t index = 0; index < job_capacity; index++)
+        {
+            const job* j = &job_table[index];
+            if (j->number != 0)
+                printf("[%d]%c  %s\t\t%s\n", j->number, j->number == job_current ? '+' : ' ',
+                       job_stopped(j) ? "Detenido" : "Ejecutando", j->command);
+        }
+        return 0;
+    }
+
+    if (!job_control)
+    {
+        printf("%s: No hay control de trabajos\n", args[0]);
+        return 1;
+    }
+
+    int number = parse_job(args[1]);
+    if (number == 0)
+    {
+        printf("%s: %s: No existe ese trabajo\n", args[0], args[1] ? args[1] : "actual");
+        return 1;
+    }
+
+    if (strcmp(args[0], "fg") == 0)
+    {
+        printf("%s\n", find_job(number)->command);
+        fflush(stdout);
+        return jobs_foreground(number, true);
+    }
+
+    jobs_background(number, true);
+    return 0;
+}
+
+/**
+ * @brief Adapter of jobs_command() to the registry.
+ */
+static int jobs_builtin(int argc, char* args[])
+{
+    (void)argc;
+    return jobs_command(args);
+}
+
+/**
+ * @brief Commands of the job control.
+ */
+static const builtin_command job_commands[] = {
+    {"jobs", "", "Lista los trabajos en segundo plano y detenidos", BUILTIN_PARENT, jobs_builtin, NULL, NULL, NULL},
+    {"fg", "[%n]", "Pasa un trabajo al primer plano", BUILTIN_PARENT, jobs_builtin, NULL, NULL, NULL},
+    {"bg", "[%n]", "Continúa un trabajo detenido en segundo plano", BUILTIN_PARENT, jobs_builtin, NULL, NULL, NULL},
+};
+
+void jobs_register_builtins(void)
+{
+    builtin_register(job_commands, sizeof(job_commands) / sizeof(job_commands[0]));
+}
@@ -0,0 +1,476 @@
+/**
+ * @file json_query.c
+ * @brief This file contains the implementation of the compiled JSON path queries.
+ * @details The paths of a query are merged into a trie of steps. Every step keeps the hash of its key, and each node
+ * keeps an open addressing table of its children, so evaluating the query walks each object of the document once,
+ * hashing every key a single time, no matter how many paths look into that object.
+ */
+#include "json_query.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Index of a step whose key is not a valid array index.
+ */
+#define NO_INDEX (-1L)
+
+/**
+ * @brief A node of the query trie: the step that leads to it and the steps that follow.
+ */
+typedef struct
+{
+    char* key;           /**< Key of the step, already unescaped. */
+    size_t key_length;   /**< Length of the key. */
+    uint32_t hash;       /**< Hash of the key. */
+    long index;          /**< Array index of the step or NO_INDEX. */
+    size_t* children;    /**< Indexes of the children in the node array. */
+    size_t child_count;  /**< Number of children. */
+    size_t* table;       /**< Hash table of the children: 0 is empty, i + 1 is children[i]. */
+    size_t table_mask;   /**< Size of the table minus one. */
+    size_t* paths;       /**< Ids of the paths ending at this node. */
+    size_t path_count;   /**< Number of paths ending at this node. */
+} query_node;
+
+/**
+ * @brief A compiled query.
+ */
+struct json_query
+{
+    query_node* nodes; /**< Trie nodes, nodes[0] is the document root. */
+    size_t node_count; /**< Number of nodes. */
+    size_t path_count; /**< Number of compiled paths. */
+};
+
+/**
+ * @brief FNV-1a hash of a key.
+ * @param key The key.
+ * @param length The length of the key.
+ * @return The hash.
+ */
+static uint32_t hash_key(const char* key, size_t length)
+{
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= (unsigned char)key[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/**
+ * @brief Converts a key to an array index.
+ * @param key The key.
+ * @param length The length of the key.
+ * @return The index or NO_INDEX if the key is not a canonical non negative integer.
+ */
+static long key_to_index(const char* key, size_t length)
+{
+    long index = 0;
+
+    if (length == 0 || length > 9 || (length > 1 && key[0] == '0'))
+    {
+        return NO_INDEX;
+    }
+
+    for (size_t i = 0; i < length; i++)
+    {
+        if (key[i] < '0' || key[i] > '9')
+        {
+            return NO_INDEX;
+        }
+        index = index * 10 + (key[i] - '0');
+    }
+
+    return index;
+}
+
+/**
+ * @brief Returns the child of a node for a step, creating it if needed.
+ * @param query The query being compiled.
+ * @param parent Index of the parent node.
+ * @param key The key of the step, ownership is taken.
+ * @param length The length of the key.
+ * @return Index of the child node, 0 on allocation failure.
+ */
+static size_t add_step(json_query* query, size_t parent, char* key, size_t length)
+{
+    query_node* node = &query->nodes[parent];
+
+    for (size_t i = 0; i < node->child_count; i++)
+    {
+        query_node* child = &query->nodes[node->children[i]];
+        if (child->key_length == length && memcmp(child->key, key, length) == 0)
+        {
+            free(key);
+            return node->children[i];
+        }
+    }
+
+    query_node* nodes = realloc(query->nodes, sizeof(query_node) * (query->node_count + 1));
+    if (!nodes)
+    {
+        free(key);
+        return 0;
+    }
+    query->nodes = nodes;
+
+    size_t* children = realloc(query->nodes[parent].children, sizeof(size_t) * (query->nodes[parent].child_count + 1));
+    if (!children)
+    {
+        free(key);
+        return 0;
+    }
+    query->nodes[parent].children = children;
+
+    size_t index = query->node_count++;
+    query_node* child = &query->nodes[index];
+    memset(child, 0, sizeof(*child));
+    child->key = key;
+    child->key_length = length;
+    child->hash = hash_key(key, length);
+    child->index = key_to_index(key, length);
+
+    node = &query->nodes[parent];
+    node->children[node->child_count++] = index;
+
+    return index;
+}
+
+/**
+ * @brief Copies a JSON Pointer reference token, unescaping "~1" and "~0".
+ * @param token Start of the token.
+ * @param length Length of the escaped token.
+ * @param out_length The length of the unescaped key.
+ * @return The key or NULL if the token is invalid.
+ */
+static char* unescape_pointer_token(const char* token, size_t length, size_t* out_length)
+{
+    char* key = malloc(length + 1);
+    size_t j = 0;
+
+    if (!key)
+    {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < length; i++)
+    {
+        if (token[i] == '~')
+        {
+            if (i + 1 >= length || (token[i + 1] != '0' && token[i + 1] != '1'))
+            {
+                free(key);
+                return NULL;
+            }
+            key[j++] = token[i + 1] == '0' ? '~' : '/';
+            i++;
+        }
+        else
+        {
+            key[j++] = token[i];
+        }
+    }
+    key[j] = '\0';
+    *out_length = j;
+
+    return key;
+}
+
+/**
+ * @brief Adds a path to the trie.
+ * @param query The query being compiled.
+ * @param path The path.
+ * @param id The id of the path.
+ * @return true on success.
+ */
+static bool compile_path(json_query* query, const char* path, size_t id)
+{
+    size_t node = 0;
+    const char* cursor = path;
+
+    if (*cursor == '/')
+    {
+        // JSON Pointer: "/a/b~1c/0"
+        while (*cursor == '/')
+        {
+            const char* token = ++cursor;
+            size_t length = strcspn(token, "/");
+            size_t key_length = 0;
+            char* key = unescape_pointer_token(token, length, &key_length);
+
+            if (!key || (node = add_step(query, node, key, key_length)) == 0)
+            {
+                return false;
+            }
+            cursor = token + length;
+        }
+    }
+    else if (strcmp(cursor, ".") != 0)
+    {
+        // Dotted path: "a.b[0].c"
+        while (*cursor != '\0')
+        {
+            const char* token = cursor;
+            size_t length = 0;
+
+            if (*cursor == '[')
+            {
+                token = ++cursor;
+                length = strcspn(token, "]");
+                if (token[length] != ']' || key_to_index(token, length) == NO_INDEX)
+                {
+                    return false;
+                }
+                cursor = token + length + 1;
+            }
+            else
+            {
+                length = strcspn(token, ".[");
+                if (length == 0)
+                {
+                    return false;
+                }
+                cursor = token + length;
+            }
+
+            char* key = strndup(token, length);
+            if (!key || (node = add_step(query, node, key, length)) == 0)
+            {
+                return false;
+            }
+
+            if (*cursor == '.')
+            {
+                cursor++;
+                if (*cursor == '\0')
+                {
+                    return false;
+                }
+            }
+            else if (*cursor != '\0' && *cursor != '[')
+            {
+                return false;
+            }
+        }
+    }
+
+    size_t* paths = realloc(query->nodes[node].paths, sizeof(size_t) * (query->nodes[node].path_count + 1));
+    if (!paths)
+    {
+        return false;
+    }
+    paths[query->nodes[node].path_count++] = id;
+    query->nodes[node].paths = paths;
+
+    return true;
+}
+
+/**
+ * @brief Builds the hash table of the children of every node.
+ * @param query The query being compiled.
+ * @return true on success.
+ */
+static bool build_tables(json_query* query)
+{
+    for (size_t n = 0; n < query->node_count; n++)
+    {
+        query_node* node = &query->nodes[n];
+        size_t size = 2;
+
+        if (node->child_count == 0)
+        {
+            continue;
+        }
+
+        while (size < node->child_count * 2)
+        {
+            size *= 2;
+        }
+
+        node->table = calloc(size, sizeof(size_t));
+        if (!node->table)
+        {
+            return false;
+        }
+        node->table_mask = size - 1;
+
+        for (size_t i = 0; i < node->child_count; i++)
+        {
+            size_t slot = query->nodes[node->children[i]].hash & node->table_mask;
+            while (node->table[slot] != 0)
+            {
+                slot = (slot + 1) & node->table_mask;
+            }
+            node->table[slot] = i + 1;
+        }
+    }
+
+    return true;
+}
+
+json_query* json_query_compile(const char* const paths[], size_t count)
+{
+    json_query* query = calloc(1, sizeof(json_query));
+
+    if (!query || !paths)
+    {
+        free(query);
+        return NULL;
+    }
+
+    query->nodes = calloc(1, sizeof(query_node));
+    if (!query->nodes)
+    {
+        free(query);
+        return NULL;
+    }
+    query->node_count = 1;
+    query->path_count = count;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!paths[i] || !compile_path(query, paths[i], i))
+        {
+            json_query_free(query);
+            return NULL;
+        }
+    }
+
+    if (!build_tables(query))
+    {
+        json_query_free(query);
+        return NULL;
+    }
+
+    return query;
+}
+
+/**
+ * @brief Finds the child of a node whose key matches an object member name.
+ * @param query The query.
+ * @param node The node.
+ * @param name The member name.
+ * @return The child node or NULL.
+ */
+static const query_node* find_child(const json_query* query, const query_node* node, const char* name)
+{
+    uint32_t hash = 2166136261u;
+    size_t length = 0;
+
+    for (; name[length] != '\0'; length++)
+    {
+        hash ^= (unsigned char)name[length];
+        hash *= 16777619u;
+    }
+
+    for (size_t slot = hash & node->table_mask; node->table[slot] != 0; slot = (slot + 1) & node->table_mask)
+    {
+        const query_node* child = &query->nodes[node->children[node->table[slot] - 1]];
+        if (child->hash == hash && child->key_length == length && memcmp(child->key, name, length) == 0)
+        {
+            return child;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Resolves the paths under a node for an item of the document.
+ * @param query The query.
+ * @param node The node matched by the item.
+ * @param item The item.
+ * @param results The results array.
+ * @param found Number of paths found so far.
+ */
+static void visit(const json_query* query, const query_node* node, cJSON* item, cJSON* results[], size_t* found)
+{
+    for (size_t i = 0; i < node->path_count; i++)
+    {
+        // Con claves repetidas gana la primera, como en cJSON_GetObjectItem
+        if (!results[node->paths[i]])
+        {
+            results[node->paths[i]] = item;
+            (*found)++;
+        }
+    }
+
+    if (node->child_count == 0)
+    {
+        return;
+    }
+
+    if (cJSON_IsObject(item))
+    {
+        for (cJSON* child = item->child; child && *found < query->path_count; child = child->next)
+        {
+            const query_node* next = child->string ? find_child(query, node, child->string) : NULL;
+            if (next)
+            {
+                visit(query, next, child, results, found);
+            }
+        }
+    }
+    else if (cJSON_IsArray(item))
+    {
+        long index = 0;
+        for (cJSON* child = item->child; child && *found < query->path_count; child = child->next, index++)
+        {
+            for (size_t i = 0; i < node->child_count; i++)
+            {
+                const query_node* next = &query->nodes[node->children[i]];
+                if (next->index == index)
+                {
+                    visit(query, next, child, results, found);
+                }
+            }
+        }
+    }
+}
+
+size_t json_query_eval(const json_query* query, const cJSON* root, cJSON* results[])
+{
+    size_t found = 0;
+
+    if (!query || !results)
+    {
+        return 0;
+    }
+
+    memset(results, 0, sizeof(cJSON*) * query->path_count);
+
+    if (root)
+    {
+        visit(query, &query->nodes[0], (cJSON*)root, results, &found);
+    }
+
+    return found;
+}
+
+size_t json_query_count(const json_query* query)
+{
+    return query ? query->path_count : 0;
+}
+
+void json_query_free(json_query* query)
+{
+    if (!query)
+    {
+        return;
+    }
+
+    for (size_t n = 0; n < query->node_count; n++)
+    {
+        free(query->nodes[n].key);
+        free(query->nodes[n].children);
+        free(query->nodes[n].table);
+        free(query->nodes[n].paths);
+    }
+    free(query->nodes);
+    free(query);
+}
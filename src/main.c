@@ -13,6 +13,9 @@
  */
 int main(int argc, char* argv[])
 {
+    // SHELLTER_TRACE=archivo.json graba una traza de la sesión
+    trace_init();
+    commands_init();
 
     if (argc >= 2)
     {
@@ -22,9 +25,15 @@ int main(int argc, char* argv[])
         {
             char* line = (char*)malloc(sizeof(char) * 1024);
 
+            // Los here-documents siguen en el mismo archivo
+            redirect_input(file);
+
             while (fgets(line, 1024, file) != NULL)
             {
                 execute_command(line);
+                STATS_COUNT(STATS_COMMANDS, 1);
+                if (last_command_status() != 0)
+                    STATS_COUNT(STATS_FAILURES, 1);
             }
 
             fclose(file);
@@ -38,9 +47,21 @@ int main(int argc, char* argv[])
         }
     }
 
+    // Las señales y el control de trabajos se preparan una sola vez
+    manage_signals();
+
+    // En una terminal el bucle de eventos atiende la entrada, las señales, los trabajos y el monitor
+    if (signals_in_reactor() && reactor_add(STDIN_FILENO, EPOLLIN, input_ready, NULL) == 0)
+    {
+        show_prompt();
+        while (reactor_dispatch(-1) >= 0)
+            ;
+        perror("Error en el bucle de eventos");
+        exit(EXIT_FAILURE);
+    }
+
     while (1)
     {
-        manage_signals();
         get_command();
     }
 
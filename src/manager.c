@@ -2,24 +2,82 @@
  * @file manager.c
  * @brief This file contains the implementation of the functions that manage the commands.
  */
+#define _GNU_SOURCE // pipe2()
 #include "manager.h"
+#include <errno.h>
 
 /**
- * @brief Global variable for the job id.
+ * @brief time is measuring a command: every stage of a pipeline gets its own process, with its own usage.
  */
-static int job_id = 0;
+static bool timing = false;
 
 /**
  * @brief This function gets the command from the user.
  */
 void get_command(void)
 {
+    jobs_reap(false);
     show_prompt();
     char* command = (char*)malloc(sizeof(char) * 256);
 
-    fgets(command, 256, stdin);
+    if (fgets(command, 256, stdin) == NULL)
+    {
+        // Ctrl+D: fin de la entrada
+        printf("\n");
+        exit(EXIT_SUCCESS);
+    }
+
+    process_command(command);
+    free(command);
+}
+
+/**
+ * @brief This function reads the command from the terminal when the event loop reports input.
+ * @note The terminal is in canonical mode: one read() returns one line.
+ */
+void input_ready(int fd, uint32_t events, void* data)
+{
+    (void)events;
+    (void)data;
+    char command[256];
+
+    ssize_t length = read(fd, command, sizeof(command) - 1);
+    if (length < 0 && (errno == EINTR || errno == EAGAIN))
+        return;
+    if (length <= 0)
+    {
+        // Ctrl+D o la terminal se cerró
+        printf("\n");
+        exit(EXIT_SUCCESS);
+    }
+    command[length] = '\0';
+
+    // Ctrl+C tiene que poder cortar read_file --follow o el paginador, que corren en la shell
+    signals_command_begin();
+    process_command(command);
+    signals_command_end();
+    jobs_reap(false);
+    show_prompt();
+}
 
+/**
+ * @brief This function runs a command entered by the user.
+ */
+void process_command(char* command)
+{
+    prompt_input_received();
+    STATS_COUNT(STATS_COMMANDS, 1);
+
+    // El código de salida y la duración se muestran en el próximo prompt
+    struct timespec start;
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
     execute_command(command);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (last_command_status() != 0)
+        STATS_COUNT(STATS_FAILURES, 1);
+    prompt_set_status(last_command_status(),
+                      (long)(end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000);
 }
 
 /**
@@ -37,56 +95,198 @@ void execute_command(char* command)
 
     command[strcspn(command, "\n")] = '\0';
 
+    // "time" como prefijo mide todo lo que sigue
+    char* line = command + strspn(command, " \t");
+    if (strncmp(line, "time", 4) == 0 && (line[4] == ' ' || line[4] == '\t' || line[4] == '\0'))
+    {
+        time_command(line + 4);
+        return;
+    }
+
+    STATS_TIMER(parse_start);
+    uint64_t trace_start = trace_begin();
     check_flags(command, &background, &pipes, &input, &output);
 
+    // Los pipelines y las redirecciones separan las palabras más adelante
+    if (!pipes && !input && !output)
+        argc = tokenizer(command, args);
+    STATS_RECORD(STATS_PARSE, parse_start);
+    trace_end("parse", trace_start, 0, 0, NULL);
+
     // Pipeline management
     if (pipes)
     {
-        run_pipelines(command, args);
+        run_pipelines(command, args, background);
         return;
     }
 
     // I/O management
     if (input || output)
     {
-        io_redirection(command, args, &input, &output);
+        io_redirection(command, args);
         return;
     }
 
-    argc = tokenizer(command, args);
-
     if (background)
     {
+        // Vaciar stdio antes: el hijo heredaría y repetiría lo pendiente
+        fflush(stdout);
+        STATS_TIMER(fork_start);
+        uint64_t fork_trace = trace_begin();
         pid_t pid = fork();
-        job_id++;
 
         if (pid < 0)
         {
             perror("fork error");
-            background = false;
-            exit(EXIT_FAILURE);
         }
         else if (pid == 0)
         {
-            // Proceso hijo, ejecutar el comando
-            printf("[%d] %d\n", job_id, getpid());
+            // Proceso hijo, ejecutar el comando en su propio grupo, sin la terminal
+            // _exit(): exit() devolvería el offset del archivo del modo batch, que el padre comparte
+            job_child_setup(0, false);
             internal_commands(argc, args, background);
             fflush(stdout);
-            show_prompt();
-            exit(0);
+            trace_flush();
+            _exit(last_command_status());
         }
         else
         {
-            // Proceso padre, retornar al shell
-            return;
+            // Proceso padre, registrar el trabajo y retornar al shell
+            STATS_RECORD(STATS_FORK, fork_start);
+            STATS_COUNT(STATS_FORKS, 1);
+            trace_end("fork", fork_trace, pid, 0, args[0]);
+            job_parent_setup(pid, 0);
+            jobs_background(jobs_add(pid, &pid, 1, args, " "), false);
+            set_command_status(0);
         }
     }
     else
     {
+        STATS_TIMER(command_start);
         internal_commands(argc, args, background);
+        if (argc > 0)
+            STATS_RECORD_COMMAND(args[0], command_start);
     }
 }
 
+/**
+ * @brief This function returns the seconds between two instants.
+ */
+static double elapsed_seconds(const struct timespec* start, const struct timespec* end)
+{
+    return (double)(end->tv_sec - start->tv_sec) + (double)(end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/**
+ * @brief This function returns a time of a struct rusage in seconds.
+ */
+static double timeval_seconds(const struct timeval* time)
+{
+    return (double)time->tv_sec + (double)time->tv_usec / 1e6;
+}
+
+/**
+ * @brief This function prints a line of the report of time.
+ */
+static void print_usage_line(double real, double user, double sys, const struct rusage* usage, const char* label)
+{
+    fprintf(stderr, "%8.3fs %8.3fs %8.3fs %7ld KB %7ld/%-7ld %7ld/%-7ld  %s\n", real, user, sys, usage->ru_maxrss,
+            usage->ru_nvcsw, usage->ru_nivcsw, usage->ru_minflt, usage->ru_majflt, label);
+}
+
+/**
+ * @brief This function runs a command and reports the resources it used.
+ * @note The shell itself is measured with getrusage(), for the internal commands that do not fork.
+ */
+void time_command(char* command)
+{
+    job_usage usages[MAX_ARGS];
+    size_t count = 0;
+    char* labels[MAX_ARGS];
+    int stages = 0;
+
+    // execute_command() parte la línea: los nombres de las etapas salen de una copia
+    char* line = strdup(command);
+    if (line)
+    {
+        line[strcspn(line, "\n&<>")] = '\0';
+        for (char* stage = strtok(line, "|"); stage && stages < MAX_ARGS; stage = strtok(NULL, "|"))
+        {
+            stage += strspn(stage, " \t");
+            size_t length = strlen(stage);
+            while (length > 0 && (stage[length - 1] == ' ' || stage[length - 1] == '\t'))
+                stage[--length] = '\0';
+            labels[stages++] = stage;
+        }
+    }
+
+    struct rusage self_start;
+    struct rusage self_end;
+    struct timespec start;
+    struct timespec end;
+    getrusage(RUSAGE_SELF, &self_start);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    jobs_record_usage(usages, MAX_ARGS, &count);
+    timing = true;
+    execute_command(command);
+    timing = false;
+    jobs_record_usage(NULL, 0, NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    getrusage(RUSAGE_SELF, &self_end);
+
+    // El total suma los procesos y lo que gastó la propia shell
+    struct rusage total;
+    memset(&total, 0, sizeof(total));
+    double user = timeval_seconds(&self_end.ru_utime) - timeval_seconds(&self_start.ru_utime);
+    double sys = timeval_seconds(&self_end.ru_stime) - timeval_seconds(&self_start.ru_stime);
+    total.ru_maxrss = count == 0 ? self_end.ru_maxrss : 0;
+    total.ru_nvcsw = self_end.ru_nvcsw - self_start.ru_nvcsw;
+    total.ru_nivcsw = self_end.ru_nivcsw - self_start.ru_nivcsw;
+    total.ru_minflt = self_end.ru_minflt - self_start.ru_minflt;
+    total.ru_majflt = self_end.ru_majflt - self_start.ru_majflt;
+
+    // La salida del comando va antes que el informe
+    fflush(stdout);
+
+    // "RSS máx" ocupa un byte más de lo que se ve
+    fprintf(stderr, "%9s %9s %9s %11s %15s %15s  %s\n", "real", "usuario", "sistema", "RSS máx", "cambios vol/inv",
+            "fallos men/may", "etapa");
+
+    // Una línea por etapa, en el orden del pipeline
+    for (size_t stage = 0; count > 1 && stage < count; stage++)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            if (usages[i].stage != stage)
+                continue;
+
+            char label[32];
+            snprintf(label, sizeof(label), "[%zu]", stage + 1);
+            print_usage_line(elapsed_seconds(&start, &usages[i].end), timeval_seconds(&usages[i].usage.ru_utime),
+                             timeval_seconds(&usages[i].usage.ru_stime), &usages[i].usage,
+                             (int)stage < stages ? labels[stage] : label);
+        }
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const struct rusage* usage = &usages[i].usage;
+        user += timeval_seconds(&usage->ru_utime);
+        sys += timeval_seconds(&usage->ru_stime);
+        if (usage->ru_maxrss > total.ru_maxrss)
+            total.ru_maxrss = usage->ru_maxrss;
+        total.ru_nvcsw += usage->ru_nvcsw;
+        total.ru_nivcsw += usage->ru_nivcsw;
+        total.ru_minflt += usage->ru_minflt;
+        total.ru_majflt += usage->ru_majflt;
+    }
+    print_usage_line(elapsed_seconds(&start, &end), user, sys, &total, "total");
+
+    free(line);
+}
+
 /**
  * @brief This function tokenizes the command.
  * @return the number of arguments.
@@ -118,10 +318,14 @@ int tokenizer(char* command, char* args[])
  */
 void check_flags(char* command, bool* background, bool* pipes, bool* input, bool* output)
 {
-    if (strchr(command, '&') != NULL)
+    // Solo un "&" al final es segundo plano: "&>" y "2>&1" son redirecciones
+    size_t length = strlen(command);
+    while (length > 0 && (command[length - 1] == ' ' || command[length - 1] == '\t'))
+        length--;
+    if (length > 0 && command[length - 1] == '&' && (length < 2 || command[length - 2] != '>'))
     {
         *background = true;
-        command[strcspn(command, "&")] = '\0';
+        command[length - 1] = '\0';
     }
     else
     {
@@ -156,21 +360,100 @@ void check_flags(char* command, bool* background, bool* pipes, bool* input, bool
     }
 }
 
+/**
+ * @brief This function closes, in a child, the pipe ends that belong to the stages running on threads.
+ * @param fds The descriptors handed to the threads.
+ * @param count The number of descriptors.
+ * @param redirections The redirections of the stage: a here-document may have reused the number of a descriptor
+ * that a thread already closed.
+ * @note A program loses them in exec() (they are O_CLOEXEC), an internal command does not: reading its input it
+ * would keep the write end of its own pipe open and never see the end of the data.
+ */
+static void close_thread_descriptors(const int fds[], int count, const redirect_list* redirections)
+{
+    for (int i = 0; i < count; i++)
+    {
+        bool reused = false;
+        for (size_t r = 0; r < redirections->count; r++)
+        {
+            const redirection* item = &redirections->items[r];
+            reused = reused || (item->kind == REDIRECT_MEMORY && item->source == fds[i]);
+        }
+        if (!reused)
+            close(fds[i]);
+    }
+}
+
+/**
+ * @brief This function joins to a filter the filters of the next stages, as "|" arguments: they run as one stage that
+ * passes the lines in memory (see filters.h).
+ * @param commands The stages after the filter.
+ * @param count The number of those stages.
+ * @param args The arguments of the filter, the next ones are added.
+ * @param argc The number of arguments, updated.
+ * @param words Where to copy the words of the joined stages.
+ * @param size The size of words.
+ * @return The number of stages joined.
+ * @note A stage with a redirection is not joined, it is never parsed here: its here-documents are read once.
+ */
+static int join_filters(char* commands[], int count, char* args[], int* argc, char* words, size_t size)
+{
+    int joined = 0;
+    size_t used = 0;
+    while (joined < count && !strpbrk(commands[joined], "<>"))
+    {
+        size_t length = strlen(commands[joined]) + 1;
+        if (used + length > size)
+            break;
+
+        char* copy = memcpy(words + used, commands[joined], length);
+        char* stage[MAX_ARGS];
+        int stage_argc = 0;
+        char* state = NULL;
+        for (char* word = strtok_r(copy, " \t\n", &state); word && stage_argc < MAX_ARGS - 1;
+             word = strtok_r(NULL, " \t\n", &state))
+            stage[stage_argc++] = word;
+        stage[stage_argc] = NULL;
+
+        if (!filters_joinable(stage_argc, stage, false) || *argc + 1 + stage_argc >= MAX_ARGS)
+            break;
+
+        args[(*argc)++] = "|";
+        memcpy(&args[*argc], stage, sizeof(char*) * (size_t)stage_argc);
+        *argc += stage_argc;
+        used += length;
+        joined++;
+    }
+    args[*argc] = NULL;
+    return joined;
+}
+
 /**
  * @brief This function runs the pipelines.
  */
-void run_pipelines(char* command, char* args[])
+void run_pipelines(char* command, char* args[], bool background)
 {
     char* tokens;
     char* commands[MAX_ARGS];
+    pid_t pids[MAX_ARGS];
+    pthread_t threads[MAX_ARGS];
+    int thread_fds[2 * MAX_ARGS];
+    int thread_fd_count = 0;
     int argc = 0;
-    int i = 0;
-    int pipefd[2];
-    pid_t pid;
+    int started = 0;
+    int launched = 0;
+    int thread_count = 0;
+    pid_t pgid = 0;
+    STATS_TIMER(setup_start);
+#ifdef SHELLTER_STATS
+    // Cada proceso se mide desde su fork() hasta que jobs_foreground() lo recoge
+    char stage_names[MAX_ARGS][STATS_NAME_LENGTH];
+    uint64_t stage_starts[MAX_ARGS];
+#endif
 
     tokens = strtok(command, "|");
 
-    while (tokens != NULL)
+    while (tokens != NULL && argc < MAX_ARGS - 1)
     {
         commands[argc] = tokens;
         argc++;
@@ -179,123 +462,279 @@ void run_pipelines(char* command, char* args[])
 
     commands[argc] = NULL;
 
-    int fd_in = 0;
+    int fd_in = STDIN_FILENO;
 
-    for (i = 0; i < argc; i++)
+    // Lanzar todas las etapas antes de esperar: si no, una etapa que escribe mucho se bloquea en el pipe
+    for (int i = 0; i < argc; i++)
     {
-        pipe(pipefd);
-        pid = fork();
+        int pipefd[2] = {-1, -1};
+
+        // Cada etapa puede tener sus redirecciones; los here-documents se leen antes del fork
+        redirect_list redirections;
+        int stage_argc = redirect_parse(commands[i], args, MAX_ARGS, &redirections);
+        if (stage_argc < 0)
+            break;
+
+        // "grep x | wc -l": los filtros seguidos son una sola etapa, sin pipes entre ellos
+        char joined_words[REDIRECT_WORDS];
+        int joined = 0;
+        if (redirections.count == 0 && filters_joinable(stage_argc, args, true))
+            joined = join_filters(&commands[i + 1], argc - i - 1, args, &stage_argc, joined_words,
+                                  sizeof(joined_words));
+        i += joined;
+
+        // O_CLOEXEC: los hijos que ejecutan un programa no se quedan con los pipes de las etapas en threads
+        if (i < argc - 1 && pipe2(pipefd, O_CLOEXEC) != 0)
+        {
+            perror("pipe error");
+            redirect_close(&redirections);
+            break;
+        }
+
+        // Un comando interno que escribe en el pipe corre en un thread de la shell, sin fork. En segundo plano el
+        // trabajo tiene que poder seguir sin la shell, y time mide cada etapa por su proceso
+        const builtin_command* threaded = pipefd[1] >= 0 && !background && !timing && redirections.count == 0
+                                              ? builtin_threadable(stage_argc, args, fd_in == STDIN_FILENO)
+                                              : NULL;
+        if (threaded && stage_start(threaded, stage_argc, args, fd_in, pipefd[1], &threads[thread_count]) == 0)
+        {
+            if (fd_in != STDIN_FILENO)
+                thread_fds[thread_fd_count++] = fd_in;
+            thread_fds[thread_fd_count++] = pipefd[1];
+            thread_count++;
+            launched += 1 + joined;
+            fd_in = pipefd[0];
+            continue;
+        }
+
+        fflush(stdout);
+        STATS_TIMER(fork_start);
+        uint64_t fork_trace = trace_begin();
+        pid_t pid = fork();
 
         if (pid < 0)
         {
             perror("fork error");
-            exit(EXIT_FAILURE);
+            redirect_close(&redirections);
+            if (pipefd[0] >= 0)
+            {
+                close(pipefd[0]);
+                close(pipefd[1]);
+            }
+            break;
         }
         else if (pid == 0)
         {
-            dup2(fd_in, 0);
+            job_child_setup(pgid, !background);
 
-            if (i < argc - 1)
+            if (fd_in != STDIN_FILENO)
             {
-                dup2(pipefd[1], 1);
+                dup2(fd_in, STDIN_FILENO);
+                close(fd_in);
             }
 
-            close(pipefd[0]);
+            if (pipefd[1] >= 0)
+            {
+                dup2(pipefd[1], STDOUT_FILENO);
+                close(pipefd[1]);
+                close(pipefd[0]);
+            }
+            close_thread_descriptors(thread_fds, thread_fd_count, &redirections);
+
+            // Después de los pipes: "2>&1" copia la salida ya conectada a la etapa siguiente
+            if (redirect_apply(&redirections, false) != 0)
+            {
+                trace_flush();
+                _exit(EXIT_FAILURE);
+            }
 
-            tokenizer(commands[i], args);
-            internal_commands(argc, args, false);
-            exit(0);
+            // Un programa reemplaza al hijo: exec() cierra los pipes de las etapas en threads, que son O_CLOEXEC
+            if (stage_argc > 0 && !is_builtin(args[0]))
+            {
+                trace_flush();
+                execvp(args[0], args);
+                perror("execvp error");
+                _exit(EXIT_FAILURE);
+            }
+            internal_commands(stage_argc, args, false);
+            fflush(stdout);
+            trace_flush();
+            _exit(last_command_status());
         }
         else
         {
-            wait(NULL);
-            close(pipefd[1]);
+            STATS_RECORD(STATS_FORK, fork_start);
+            STATS_COUNT(STATS_FORKS, 1);
+            trace_end("fork", fork_trace, pid, 0, commands[i]);
+            redirect_close(&redirections);
+            if (pgid == 0)
+                pgid = pid;
+            job_parent_setup(pid, pgid);
+#ifdef SHELLTER_STATS
+            snprintf(stage_names[started], STATS_NAME_LENGTH, "%s", stage_argc > 0 ? args[0] : "");
+            stage_starts[started] = fork_start;
+#endif
+            pids[started++] = pid;
+            launched += 1 + joined;
+
+            if (fd_in != STDIN_FILENO)
+                close(fd_in);
+            if (pipefd[1] >= 0)
+                close(pipefd[1]);
             fd_in = pipefd[0];
         }
     }
-}
 
-/**
- * @brief This function handles the input output redirection.
- */
-void io_redirection(char* command, char* args[], bool* input, bool* output)
-{
-    char* input_file = NULL;
-    char* output_file = NULL;
-    int argc = 0;
+    if (fd_in >= 0 && fd_in != STDIN_FILENO)
+        close(fd_in);
+    STATS_RECORD(STATS_PIPELINE_SETUP, setup_start);
+
+    // Sin procesos los threads terminan solos: el último pipe ya no tiene lector
+    if (started == 0)
+    {
+        for (int i = 0; i < thread_count; i++)
+            stage_wait(threads[i]);
+        set_command_status(1);
+        return;
+    }
 
-    char* token = strtok(command, " ");
+    commands[launched] = NULL;
+    int job = jobs_add(pgid, pids, (size_t)started, commands, " | ");
 
-    while (token != NULL)
+    if (background)
     {
-        if (strcmp(token, "<") == 0)
-        {
-            token = strtok(NULL, " ");
-            input_file = token;
-        }
-        else if (strcmp(token, ">") == 0)
+        jobs_background(job, false);
+        set_command_status(0);
+    }
+    else
+    {
+#ifdef SHELLTER_STATS
+        // Bajo time el registro es de time_command(): las etapas quedan sin histograma propio
+        job_usage usages[MAX_ARGS];
+        size_t count = 0;
+        if (!timing)
+            jobs_record_usage(usages, MAX_ARGS, &count);
+#endif
+        int status = jobs_foreground(job, false);
+#ifdef SHELLTER_STATS
+        if (!timing)
         {
-            token = strtok(NULL, " ");
-            output_file = token;
+            jobs_record_usage(NULL, 0, NULL);
+            for (size_t i = 0; i < count; i++)
+            {
+                uint64_t end = (uint64_t)usages[i].end.tv_sec * 1000000000u + (uint64_t)usages[i].end.tv_nsec;
+                if (stage_names[usages[i].stage][0] != '\0')
+                    stats_record_command(stage_names[usages[i].stage], end - stage_starts[usages[i].stage]);
+            }
         }
-        else
+#endif
+
+        // Si el trabajo se detuvo, un thread puede estar bloqueado en su pipe: sigue cuando el trabajo vuelva
+        bool stopped = jobs_exists(job);
+        for (int i = 0; i < thread_count; i++)
         {
-            args[argc++] = token;
+            if (stopped)
+                pthread_detach(threads[i]);
+            else
+                stage_wait(threads[i]);
         }
-        token = strtok(NULL, " ");
+        set_command_status(status);
     }
+}
 
-    args[argc] = NULL;
+/**
+ * @brief This function runs an internal command (or none, as in "> file") with its redirections, in the shell itself.
+ * @note Without a fork, cd or watch_config change the shell and echo costs an open() and a few dup2().
+ */
+static void builtin_redirection(int argc, char* args[], redirect_list* redirections)
+{
+    // Lo pendiente de stdio va a la terminal, no al archivo
+    fflush(stdout);
+
+    uint64_t trace_start = trace_begin();
+    bool redirected = redirect_apply(redirections, true) == 0;
+    trace_end("redirection", trace_start, 0, 0, NULL);
+
+    if (redirected)
+    {
+        internal_commands(argc, args, false);
+        fflush(stdout);
+    }
+    else
+    {
+        set_command_status(1);
+    }
 
-    int saved_stdout = dup(fileno(stdout));
-    int saved_stdin = dup(fileno(stdin));
+    redirect_restore(redirections);
+}
 
+/**
+ * @brief This function runs an external command with its redirections, in a child.
+ */
+static void external_redirection(char* args[], redirect_list* redirections)
+{
+    fflush(stdout);
+    STATS_TIMER(fork_start);
+    uint64_t fork_trace = trace_begin();
     pid_t pid = fork();
 
     if (pid < 0)
     {
         perror("fork error");
-        exit(EXIT_FAILURE);
+        return;
     }
     else if (pid == 0)
     {
-        if (*input)
-        {
-            int fd_in = open(input_file, O_RDONLY);
-            if (fd_in < 0)
-            {
-                perror("open input file");
-                exit(EXIT_FAILURE);
-            }
-            dup2(fd_in, fileno(stdin));
-            close(fd_in);
-        }
-        if (*output)
+        uint64_t exec_trace = trace_begin();
+        job_child_setup(0, true);
+
+        uint64_t redirection_trace = trace_begin();
+        if (redirect_apply(redirections, false) != 0)
         {
-            int fd_out = open(output_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-            if (fd_out < 0)
-            {
-                perror("open output file");
-                exit(EXIT_FAILURE);
-            }
-            dup2(fd_out, fileno(stdout));
-            close(fd_out);
+            trace_flush();
+            _exit(EXIT_FAILURE);
         }
+        trace_end("redirection", redirection_trace, 0, 0, NULL);
+        trace_end("exec", exec_trace, 0, 0, args[0]);
+        trace_flush();
         execvp(args[0], args);
-        internal_commands(argc, args, false);
-    }
 
-    if (*input)
-    {
-        fflush(stdin);
-        dup2(saved_stdin, fileno(stdin));
-        close(saved_stdin);
+        perror("execvp error");
+        _exit(EXIT_FAILURE);
     }
 
-    if (*output)
+    // Las redirecciones solo existen en el hijo: el shell espera al trabajo sin tocar sus descriptores
+    STATS_RECORD(STATS_FORK, fork_start);
+    STATS_COUNT(STATS_FORKS, 1);
+    trace_end("fork", fork_trace, pid, 0, args[0]);
+    job_parent_setup(pid, 0);
+    set_command_status(jobs_foreground(jobs_add(pid, &pid, 1, args, " "), false));
+}
+
+/**
+ * @brief This function handles the input output redirection.
+ */
+void io_redirection(char* command, char* args[])
+{
+    redirect_list redirections;
+    int argc = redirect_parse(command, args, MAX_ARGS, &redirections);
+    if (argc < 0)
     {
-        fflush(stdout);
-        dup2(saved_stdout, fileno(stdout));
-        close(saved_stdout);
+        set_command_status(2);
+        return;
     }
+
+    // Los archivos se abren en la shell: el comando los comparte y se sabe cuánto leyó o escribió
+    STATS_TIMER(command_start);
+    if (redirect_open(&redirections) != 0)
+        set_command_status(1);
+    else if (argc == 0 || is_builtin(args[0]))
+        builtin_redirection(argc, args, &redirections);
+    else
+        external_redirection(args, &redirections);
+    if (argc > 0)
+        STATS_RECORD_COMMAND(args[0], command_start);
+
+    STATS_COUNT(STATS_REDIRECTED_BYTES, redirect_bytes(&redirections));
+    redirect_close(&redirections);
 }
@@ -0,0 +1,333 @@
+/**
+ * @file matcher.c
+ * @brief This file contains the implementation of the name and content matchers of search_config.
+ * @details Globs use a Shift-And automaton: every pattern is a run of states, state i meaning "the first i
+ * characters of the pattern matched". All the runs are laid side by side in one bit vector, so one shift and one
+ * mask per character of the name advance every pattern at once. A "*" is a state that loops on any character.
+ */
+#include "matcher.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Files up to this size are read into a buffer instead of mapped.
+ */
+#define SMALL_FILE_SIZE (16 * 1024)
+
+struct glob_set
+{
+    size_t words;         /**< Number of 64-bit words of each state vector. */
+    uint64_t* initial;    /**< First state of every pattern. */
+    uint64_t* final;      /**< Last state of every pattern. */
+    uint64_t* loops;      /**< States that loop on any character ("*"). */
+    uint64_t* characters; /**< For each byte, the states entered by reading it (256 vectors). */
+};
+
+struct text_finder
+{
+    size_t length; /**< Length of the pattern. */
+    size_t anchor; /**< Position of the rarest byte of the pattern. */
+    char pattern[]; /**< The pattern. */
+};
+
+/**
+ * @brief This function parses one element of a glob: a character, "?" or a class.
+ * @param pattern The pattern, at the element.
+ * @param accepted Output: the bytes accepted by the element.
+ * @return The pattern after the element.
+ */
+static const char* parse_element(const char* pattern, bool accepted[256])
+{
+    memset(accepted, 0, 256 * sizeof(bool));
+
+    if (*pattern == '?')
+    {
+        memset(accepted, 1, 256 * sizeof(bool));
+        return pattern + 1;
+    }
+
+    if (*pattern == '[')
+    {
+        const char* p = pattern + 1;
+        bool negated = *p == '!' || *p == '^';
+        if (negated)
+            p++;
+
+        // "]" al principio de la clase es un carácter más
+        const char* start = p;
+        while (*p && (*p != ']' || p == start))
+        {
+            unsigned char low = (unsigned char)*p;
+            unsigned char high = low;
+            if (p[1] == '-' && p[2] && p[2] != ']')
+            {
+                high = (unsigned char)p[2];
+                p += 2;
+            }
+            for (unsigned int c = low; c <= high; c++)
+                accepted[c] = true;
+            p++;
+        }
+
+        if (*p == ']')
+        {
+            if (negated)
+            {
+                for (int c = 0; c < 256; c++)
+                    accepted[c] = !accepted[c];
+            }
+            return p + 1;
+        }
+
+        // Clase sin cerrar: "[" es un carácter común
+        memset(accepted, 0, 256 * sizeof(bool));
+        accepted['['] = true;
+        return pattern + 1;
+    }
+
+    if (*pattern == '\\' && pattern[1])
+        pattern++;
+    accepted[(unsigned char)*pattern] = true;
+    return pattern + 1;
+}
+
+/**
+ * @brief This function sets a bit of a state vector.
+ */
+static void set_state(uint64_t* vector, size_t state)
+{
+    vector[state / 64] |= (uint64_t)1 << (state % 64);
+}
+
+glob_set* glob_set_compile(const char* const patterns[], size_t count)
+{
+    bool accepted[256];
+
+    // Contar los estados: uno inicial más uno por elemento que consume un carácter
+    size_t states = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        states++;
+        for (const char* p = patterns[i]; *p;)
+        {
+            if (*p == '*')
+            {
+                p++;
+                continue;
+            }
+            p = parse_element(p, accepted);
+            states++;
+        }
+    }
+
+    glob_set* set = calloc(1, sizeof(glob_set));
+    if (!set)
+        return NULL;
+
+    set->words = states / 64 + 1;
+    set->initial = calloc(set->words * 259, sizeof(uint64_t));
+    if (!set->initial)
+    {
+        free(set);
+        return NULL;
+    }
+    set->final = set->initial + set->words;
+    set->loops = set->final + set->words;
+    set->characters = set->loops + set->words;
+
+    size_t state = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        set_state(set->initial, state);
+        for (const char* p = patterns[i]; *p;)
+        {
+            if (*p == '*')
+            {
+                set_state(set->loops, state);
+                p++;
+                continue;
+            }
+
+            p = parse_element(p, accepted);
+            state++;
+            for (int c = 0; c < 256; c++)
+            {
+                if (accepted[c])
+                    set_state(set->characters + (size_t)c * set->words, state);
+            }
+        }
+        set_state(set->final, state);
+        state++;
+    }
+
+    return set;
+}
+
+bool glob_set_match(const glob_set* set, const char* name)
+{
+    uint64_t stack[8];
+    uint64_t* active = set->words <= 8 ? stack : malloc(set->words * sizeof(uint64_t));
+    if (!active)
+        return false;
+
+    memcpy(active, set->initial, set->words * sizeof(uint64_t));
+
+    for (const unsigned char* c = (const unsigned char*)name; *c; c++)
+    {
+        // active = ((active << 1) & characters[c]) | (active & loops)
+        const uint64_t* characters = set->characters + (size_t)*c * set->words;
+        uint64_t carry = 0;
+        uint64_t any = 0;
+        for (size_t w = 0; w < set->words; w++)
+        {
+            uint64_t current = active[w];
+            active[w] = (((current << 1) | carry) & characters[w]) | (current & set->loops[w]);
+            carry = current >> 63;
+            any |= active[w];
+        }
+        if (!any)
+            break;
+    }
+
+    bool matched = false;
+    for (size_t w = 0; w < set->words && !matched; w++)
+        matched = (active[w] & set->final[w]) != 0;
+
+    if (active != stack)
+        free(active);
+    return matched;
+}
+
+void glob_set_free(glob_set* set)
+{
+    if (set)
+    {
+        free(set->initial);
+        free(set);
+    }
+}
+
+/**
+ * @brief This function estimates how common a byte is in configuration files.
+ * @return A higher value for more common bytes.
+ */
+static int byte_frequency(unsigned char c)
+{
+    if (strchr(" \"etaoinsr", c) && c != '\0')
+        return 6;
+    if (strchr(":,{}[]\n\t", c) && c != '\0')
+        return 5;
+    if (c >= 'a' && c <= 'z')
+        return 4;
+    if (c >= '0' && c <= '9')
+        return 3;
+    if (c >= 'A' && c <= 'Z')
+        return 2;
+    if (c >= 0x20 && c < 0x7F)
+        return 1;
+    return 0;
+}
+
+text_finder* text_finder_compile(const char* pattern, size_t length)
+{
+    text_finder* finder = malloc(sizeof(text_finder) + length + 1);
+    if (!finder)
+        return NULL;
+
+    memcpy(finder->pattern, pattern, length);
+    finder->pattern[length] = '\0';
+    finder->length = length;
+    finder->anchor = 0;
+
+    // memchr busca el byte menos frecuente, así se detiene en pocos candidatos
+    for (size_t i = 1; i < length; i++)
+    {
+        if (byte_frequency((unsigned char)pattern[i]) < byte_frequency((unsigned char)pattern[finder->anchor]))
+            finder->anchor = i;
+    }
+
+    return finder;
+}
+
+const char* text_finder_find(const text_finder* finder, const char* data, size_t length)
+{
+    if (finder->length == 0)
+        return data;
+    if (length < finder->length)
+        return NULL;
+
+    char anchor = finder->pattern[finder->anchor];
+    const char* p = data + finder->anchor;
+    const char* end = data + length - (finder->length - finder->anchor - 1);
+
+    while (p < end && (p = memchr(p, anchor, (size_t)(end - p))) != NULL)
+    {
+        const char* start = p - finder->anchor;
+        if (memcmp(start, finder->pattern, finder->length) == 0)
+            return start;
+        p++;
+    }
+
+    return NULL;
+}
+
+bool text_finder_file(const text_finder* finder, int fd)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+        return false;
+
+    size_t size = (size_t)st.st_size;
+    if (size > SMALL_FILE_SIZE)
+    {
+        void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED)
+        {
+            madvise(map, size, MADV_SEQUENTIAL);
+            bool found = text_finder_find(finder, map, size) != NULL;
+            munmap(map, size);
+            return found;
+        }
+    }
+
+    // Archivos chicos (o que no se pueden mapear): leer por bloques conservando length - 1 bytes entre lecturas
+    char buffer[SMALL_FILE_SIZE];
+    size_t keep = finder->length > 0 ? finder->length - 1 : 0;
+    size_t used = 0;
+    ssize_t bytes;
+
+    if (keep >= sizeof(buffer) / 2)
+    {
+        // Patrón enorme: no entra en el buffer, se lee el archivo completo
+        char* content = malloc(size ? size : 1);
+        size_t total = 0;
+        while (content && total < size && (bytes = read(fd, content + total, size - total)) > 0)
+            total += (size_t)bytes;
+        bool found = content && text_finder_find(finder, content, total) != NULL;
+        free(content);
+        return found;
+    }
+
+    while ((bytes = read(fd, buffer + used, sizeof(buffer) - used)) > 0)
+    {
+        used += (size_t)bytes;
+        if (text_finder_find(finder, buffer, used))
+            return true;
+        if (used > keep)
+        {
+            memmove(buffer, buffer + used - keep, keep);
+            used = keep;
+        }
+    }
+
+    return finder->length == 0;
+}
+
+void text_finder_free(text_finder* finder)
+{
+    free(finder);
+}
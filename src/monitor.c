@@ -3,12 +3,19 @@
  * @brief This file contains the implementation of the functions that manage the monitor.
  */
 #include "monitor.h"
+#include "builtins.h"
+#include <errno.h>
 
 /**
  * @brief The PID of the monitor.
  */
 pid_t monitor_pid = -1; // PID del monitor
 
+/**
+ * @brief Output buffer reused to serialize the metric values.
+ */
+static cJSON_Writer* metric_writer = NULL;
+
 /**
  * @brief This function starts the Prometheus monitor.
  */
@@ -21,13 +28,16 @@ void start_monitor()
     }
 
     // Crear un proceso hijo para el monitor
+    fflush(stdout);
+    STATS_TIMER(fork_start);
     monitor_pid = fork();
     if (monitor_pid == 0)
     {
-        // Este es el proceso hijo
+        // Este es el proceso hijo, en su propio grupo para que el Ctrl+C del prompt no lo detenga
+        job_child_setup(0, false);
         execl("bin/metrics", "bin/metrics", NULL); // Ejecutar el programa de monitoreo
         perror("Error al iniciar el monitor");     // Imprimir un mensaje de error si execl() falla
-        exit(EXIT_FAILURE);
+        _exit(EXIT_FAILURE);
     }
     else if (monitor_pid < 0)
     {
@@ -35,10 +45,21 @@ void start_monitor()
     }
     else
     {
+        STATS_RECORD(STATS_FORK, fork_start);
+        STATS_COUNT(STATS_FORKS, 1);
+        job_parent_setup(monitor_pid, 0);
         printf("Monitor iniciado con PID %d\n", monitor_pid);
     }
 }
 
+/**
+ * @brief This function checks whether the monitor is running.
+ */
+bool monitor_is_running(void)
+{
+    return monitor_pid > 0;
+}
+
 /**
  * @brief This function stops the Prometheus monitor.
  */
@@ -61,17 +82,149 @@ void stop_monitor()
     }
 }
 
+/**
+ * @brief State of the live view of the metrics.
+ */
+static struct
+{
+    int fifo;        /**< FIFO registered in the event loop, -1 if the live view is off. */
+    int timer;       /**< Timer that warns when no sample arrives, -1 if none. */
+    cJSON* settings; /**< Settings loaded when the live view started. */
+} monitor_live = {-1, -1, NULL};
+
+static void live_sample(int fd, uint32_t events, void* data);
+
+/**
+ * @brief This function opens the FIFO without blocking and registers it in the event loop.
+ * @return 0 on success, -1 on error.
+ */
+static int open_live_fifo(void)
+{
+    // Sin O_NONBLOCK el open() esperaría a que el monitor abra la FIFO para escribir
+    monitor_live.fifo = open(MONITOR_FIFO, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (monitor_live.fifo < 0)
+        return -1;
+
+    if (reactor_add(monitor_live.fifo, EPOLLIN, live_sample, NULL) != 0)
+    {
+        close(monitor_live.fifo);
+        monitor_live.fifo = -1;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief This function ends the live view.
+ */
+static void stop_live(void)
+{
+    reactor_remove(monitor_live.fifo);
+    close(monitor_live.fifo);
+    reactor_timer_remove(monitor_live.timer);
+    cJSON_Delete(monitor_live.settings);
+    monitor_live.fifo = -1;
+    monitor_live.timer = -1;
+    monitor_live.settings = NULL;
+}
+
+/**
+ * @brief This function prints a sample of the live view, called from the event loop.
+ */
+static void live_sample(int fd, uint32_t events, void* data)
+{
+    (void)events;
+    (void)data;
+    char buffer[BUFFER_SIZE];
+
+    ssize_t bytes_read = read(fd, buffer, BUFFER_SIZE - 1);
+    if (bytes_read > 0)
+    {
+        buffer[bytes_read] = '\0';
+        printf("\n");
+        STATS_TIMER(sample_start);
+        procesar_muestra(buffer, (size_t)bytes_read, monitor_live.settings);
+        STATS_RECORD(STATS_MONITOR_SAMPLE, sample_start);
+        reactor_timer_set(monitor_live.timer, MONITOR_LIVE_TIMEOUT_MS, 0);
+        show_prompt();
+        return;
+    }
+    if (bytes_read < 0 && (errno == EAGAIN || errno == EINTR))
+        return;
+
+    // El monitor cerró la FIFO: abrirla de nuevo para esperar al próximo
+    reactor_remove(fd);
+    close(fd);
+    if (open_live_fifo() != 0)
+    {
+        perror("\nError al abrir la FIFO");
+        monitor_live.fifo = -1;
+        stop_live();
+        show_prompt();
+    }
+}
+
+/**
+ * @brief This function warns that the monitor sends no samples, called from the event loop.
+ */
+static void live_timeout(int fd, uint32_t events, void* data)
+{
+    (void)fd;
+    (void)events;
+    (void)data;
+    printf("\nEl monitor no envió métricas en %d s\n", MONITOR_LIVE_TIMEOUT_MS / 1000);
+    show_prompt();
+}
+
 /**
  * @brief This function some metrics from the Prometheus monitor.
  */
-void status_monitor(void)
+void status_monitor(const char* option)
 {
+    if (option && strcmp(option, "-stop") == 0)
+    {
+        if (monitor_live.fifo < 0)
+        {
+            printf("Las métricas no se están mostrando en vivo\n");
+            return;
+        }
+        stop_live();
+        printf("Vista en vivo de las métricas detenida\n");
+        return;
+    }
+
+    if (option && strcmp(option, "-live") == 0)
+    {
+        if (monitor_live.fifo >= 0)
+        {
+            printf("Las métricas ya se muestran en vivo\n");
+            return;
+        }
+        if (!jobs_interactive())
+        {
+            printf("status_monitor -live: Requiere una terminal\n");
+            return;
+        }
+
+        monitor_live.settings = cargar_settings("../settings.json");
+        if (open_live_fifo() != 0)
+        {
+            perror("Error al abrir la FIFO");
+            cJSON_Delete(monitor_live.settings);
+            monitor_live.settings = NULL;
+            return;
+        }
+        monitor_live.timer = reactor_timer(MONITOR_LIVE_TIMEOUT_MS, 0, live_timeout, NULL);
+        printf("Mostrando las métricas en vivo (status_monitor -stop para terminar)\n");
+        return;
+    }
+
     // Cargar "settings.json"
     cJSON* settings = cargar_settings("../settings.json");
 
     // Procesar la FIFO con las configuraciones cargadas
     printf("Cargando estadisticas...\n");
-    procesar_fifo("/tmp/monitor_pipe", settings);
+    procesar_fifo(MONITOR_FIFO, settings);
 
     // Liberar memoria usada por cJSON
     cJSON_Delete(settings);
@@ -103,8 +256,8 @@ cJSON* cargar_settings(const char* settings_path)
         exit(EXIT_FAILURE);
     }
 
-    fread(content, 1, length, settings_file);
-    content[length] = '\0'; // Asegurarse de que la cadena termine en NULL
+    size_t bytes_read = fread(content, 1, length - 1, settings_file);
+    content[bytes_read] = '\0'; // Asegurarse de que la cadena termine en NULL
     fclose(settings_file);
 
     // Parsear el JSON
@@ -140,19 +293,9 @@ void procesar_fifo(const char* fifo_path, cJSON* settings)
         if (bytes_read > 0)
         {
             buffer[bytes_read] = '\0';
-
-            cJSON* metricas = cJSON_Parse(buffer);
-            if (!metricas)
-            {
-                fprintf(stderr, "Error al parsear JSON de la FIFO: %s\n", cJSON_GetErrorPtr());
-                continue;
-            }
-
-            cJSON* filtrado = filtrar_metricas(metricas, settings);
-            imprimir_metricas(filtrado);
-
-            cJSON_Delete(metricas);
-            cJSON_Delete(filtrado);
+            STATS_TIMER(sample_start);
+            procesar_muestra(buffer, (size_t)bytes_read, settings);
+            STATS_RECORD(STATS_MONITOR_SAMPLE, sample_start);
         }
         else if (bytes_read == 0)
         {
@@ -168,65 +311,182 @@ void procesar_fifo(const char* fifo_path, cJSON* settings)
     close(fifo_fd);
 }
 
+/**
+ * @brief This function filters and prints one sample of the monitor.
+ */
+void procesar_muestra(char* buffer, size_t length, cJSON* settings)
+{
+    // El productor puede enviar las muestras como JSON o como CBOR
+    if (cbor_is_frame((const unsigned char*)buffer, length))
+    {
+        cJSON* filtrado = filtrar_metricas_cbor((const unsigned char*)buffer, length, settings);
+        if (!filtrado)
+        {
+            fprintf(stderr, "Error al decodificar CBOR de la FIFO\n");
+            return;
+        }
+        imprimir_metricas(filtrado);
+        cJSON_Delete(filtrado);
+        return;
+    }
+
+    // Los strings se decodifican dentro del buffer, que vive hasta liberar las métricas
+    cJSON* metricas = cJSON_ParseInSitu(buffer, length + 1);
+    if (!metricas)
+    {
+        fprintf(stderr, "Error al parsear JSON de la FIFO: %s\n", cJSON_GetErrorPtr());
+        return;
+    }
+
+    cJSON* filtrado = filtrar_metricas(metricas, settings);
+    imprimir_metricas(filtrado);
+
+    cJSON_Delete(metricas);
+    cJSON_Delete(filtrado);
+}
+
+/**
+ * @brief Settings flags that enable each group of metrics.
+ */
+static const char* const flags_metricas[] = {"collect_cpu",     "collect_memory",  "collect_disk",
+                                             "collect_network", "collect_process", "collect_fragmentation"};
+
+/**
+ * @brief Number of settings flags.
+ */
+#define CANTIDAD_FLAGS (sizeof(flags_metricas) / sizeof(flags_metricas[0]))
+
+/**
+ * @brief Metrics reported by the monitor, in the order they are printed.
+ */
+static const char* const nombres_metricas[] = {
+    "cpu_usage_percentage",    "memory_usage_percentage", "disk_reads",           "disk_writes",
+    "disk_read_time_seconds",  "disk_write_time_seconds", "network_bandwidth_rx", "network_bandwidth_tx",
+    "network_packet_ratio",    "running_processes_count", "context_switches_total", "memory_fragmentation",
+    "policy_counter_first",    "policy_counter_best",     "policy_counter_worst"};
+
+/**
+ * @brief Index in flags_metricas of the flag that enables each metric.
+ */
+static const size_t grupo_metricas[] = {0, 1, 2, 2, 2, 2, 3, 3, 3, 4, 4, 5, 5, 5, 5};
+
+/**
+ * @brief Number of metrics.
+ */
+#define CANTIDAD_METRICAS (sizeof(nombres_metricas) / sizeof(nombres_metricas[0]))
+
+/**
+ * @brief Query over the settings flags, compiled on first use.
+ */
+static json_query* consulta_flags = NULL;
+
+/**
+ * @brief Query over the metrics, compiled on first use.
+ */
+static json_query* consulta_metricas = NULL;
+
+/**
+ * @brief This function compiles the queries over the settings and the metrics the first time it is called.
+ * @return true if the queries are available.
+ */
+static bool compilar_consultas(void)
+{
+    if (!consulta_flags)
+    {
+        consulta_flags = json_query_compile(flags_metricas, CANTIDAD_FLAGS);
+    }
+    if (!consulta_metricas)
+    {
+        consulta_metricas = json_query_compile(nombres_metricas, CANTIDAD_METRICAS);
+    }
+    if (!consulta_flags || !consulta_metricas)
+    {
+        fprintf(stderr, "Error al compilar las consultas de métricas\n");
+        return false;
+    }
+
+    return true;
+}
+
 /**
  * @brief This function filters the metrics according to the settings.
+ * @note Flags and metrics are resolved with queries compiled once, in a single pass over each document.
  */
 cJSON* filtrar_metricas(cJSON* metricas, cJSON* settings)
 {
+    cJSON* flags[CANTIDAD_FLAGS];
+    cJSON* valores[CANTIDAD_METRICAS];
     cJSON* filtrado = cJSON_CreateObject();
 
-    // Verificar qué métricas se deben incluir según los flags en settings.json
-    if (cJSON_IsTrue(cJSON_GetObjectItem(settings, "collect_cpu")))
+    if (!compilar_consultas())
     {
-        cJSON_AddItemToObject(filtrado, "cpu_usage_percentage",
-                              cJSON_Duplicate(cJSON_GetObjectItem(metricas, "cpu_usage_percentage"), 1));
+        return filtrado;
     }
 
-    if (cJSON_IsTrue(cJSON_GetObjectItem(settings, "collect_memory")))
+    json_query_eval(consulta_flags, settings, flags);
+    json_query_eval(consulta_metricas, metricas, valores);
+
+    // Verificar qué métricas se deben incluir según los flags en settings.json
+    for (size_t i = 0; i < CANTIDAD_METRICAS; i++)
     {
-        cJSON_AddItemToObject(filtrado, "memory_usage_percentage",
-                              cJSON_Duplicate(cJSON_GetObjectItem(metricas, "memory_usage_percentage"), 1));
+        if (cJSON_IsTrue(flags[grupo_metricas[i]]) && valores[i])
+        {
+            cJSON_AddItemToObject(filtrado, nombres_metricas[i], cJSON_Duplicate(valores[i], 1));
+        }
     }
 
-    if (cJSON_IsTrue(cJSON_GetObjectItem(settings, "collect_disk")))
+    return filtrado;
+}
+
+/**
+ * @brief This function filters the metrics of a CBOR frame according to the settings.
+ * @note Numeric metrics are read straight from the frame; only frames with other values are decoded into a tree.
+ */
+cJSON* filtrar_metricas_cbor(const unsigned char* frame, size_t length, cJSON* settings)
+{
+    cbor_field campos[CANTIDAD_METRICAS];
+    cJSON* flags[CANTIDAD_FLAGS];
+
+    for (size_t i = 0; i < CANTIDAD_METRICAS; i++)
     {
-        cJSON_AddItemToObject(filtrado, "disk_reads", cJSON_Duplicate(cJSON_GetObjectItem(metricas, "disk_reads"), 1));
-        cJSON_AddItemToObject(filtrado, "disk_writes",
-                              cJSON_Duplicate(cJSON_GetObjectItem(metricas, "disk_writes"), 1));
-        cJSON_AddItemToObject(filtrado, "disk_read_time_seconds",
-                              cJSON_Duplicate(cJSON_GetObjectItem(metricas, "disk_read_time_seconds"), 1));
-        cJSON_AddItemToObject(filtrado, "disk_write_time_seconds",
-                              cJSON_Duplicate(cJSON_GetObjectItem(metricas, "disk_write_time_seconds"), 1));
+        campos[i].name = nombres_metricas[i];
     }
 
-    if (cJSON_IsTrue(cJSON_GetObjectItem(settings, "collect_network")))
+    if (!cbor_decode_record(frame, length, campos, CANTIDAD_METRICAS))
     {
-        cJSON_AddItemToObject(filtrado, "network_bandwidth_rx",
-                              cJSON_Duplicate(cJSON_GetObjectItem(metricas, "network_bandwidth_rx"), 1));
-        cJSON_AddItemToObject(filtrado, "network_bandwidth_tx",
-                              cJSON_Duplicate(cJSON_GetObjectItem(metricas, "network_bandwidth_tx"), 1));
-        cJSON_AddItemToObject(filtrado, "network_packet_ratio",
-                              cJSON_Duplicate(cJSON_GetObjectItem(metricas, "network_packet_ratio"), 1));
+        // Camino lento: la muestra tiene valores que no son números
+        cJSON* metricas = cbor_decode(frame, length, NULL);
+        if (!metricas)
+        {
+            return NULL;
+        }
+        cJSON* filtrado = filtrar_metricas(metricas, settings);
+        cJSON_Delete(metricas);
+        return filtrado;
     }
 
-    if (cJSON_IsTrue(cJSON_GetObjectItem(settings, "collect_process")))
+    cJSON* filtrado = cJSON_CreateObject();
+    if (!compilar_consultas())
     {
-        cJSON_AddItemToObject(filtrado, "running_processes_count",
-                              cJSON_Duplicate(cJSON_GetObjectItem(metricas, "running_processes_count"), 1));
-        cJSON_AddItemToObject(filtrado, "context_switches_total",
-                              cJSON_Duplicate(cJSON_GetObjectItem(metricas, "context_switches_total"), 1));
+        return filtrado;
     }
 
-    if (cJSON_IsTrue(cJSON_GetObjectItem(settings, "collect_fragmentation")))
+    json_query_eval(consulta_flags, settings, flags);
+
+    for (size_t i = 0; i < CANTIDAD_METRICAS; i++)
     {
-        cJSON_AddItemToObject(filtrado, "memory_fragmentation",
-                              cJSON_Duplicate(cJSON_GetObjectItem(metricas, "memory_fragmentation"), 1));
-        cJSON_AddItemToObject(filtrado, "policy_counter_first",
-                              cJSON_Duplicate(cJSON_GetObjectItem(metricas, "policy_counter_first"), 1));
-        cJSON_AddItemToObject(filtrado, "policy_counter_best",
-                              cJSON_Duplicate(cJSON_GetObjectItem(metricas, "policy_counter_best"), 1));
-        cJSON_AddItemToObject(filtrado, "policy_counter_worst",
-                              cJSON_Duplicate(cJSON_GetObjectItem(metricas, "policy_counter_worst"), 1));
+        if (cJSON_IsTrue(flags[grupo_metricas[i]]) && campos[i].present)
+        {
+            // Como en el camino JSON: un booleano sigue siendo booleano
+            if (campos[i].boolean)
+            {
+                cJSON_AddBoolToObject(filtrado, nombres_metricas[i], campos[i].value != 0);
+            }
+            else
+            {
+                cJSON_AddNumberToObject(filtrado, nombres_metricas[i], campos[i].value);
+            }
+        }
     }
 
     return filtrado;
@@ -239,13 +499,65 @@ void imprimir_metricas(cJSON* filtrado)
 {
     printf(COLOR_TITLE "=== Métricas del Sistema ===\n" COLOR_RESET);
 
+    // El buffer se reutiliza entre muestras para no reservar memoria por cada valor
+    if (!metric_writer)
+    {
+        metric_writer = cJSON_CreateWriter(0);
+    }
+
     cJSON* item;
     cJSON_ArrayForEach(item, filtrado)
     {
         const char* key = item->string;
-        const char* value = cJSON_PrintUnformatted(item);
-        printf(COLOR_KEY "%-25s: " COLOR_VALUE "%s\n" COLOR_RESET, key, value);
-        free((void*)value);
+        const char* value = metric_writer ? cJSON_WriterPrint(metric_writer, item, false) : NULL;
+        printf(COLOR_KEY "%-25s: " COLOR_VALUE "%s\n" COLOR_RESET, key, value ? value : "null");
     }
     printf("\n");
 }
+
+/**
+ * @brief start_monitor.
+ */
+static int start_monitor_command(int argc, char* args[])
+{
+    (void)argc;
+    (void)args;
+    start_monitor();
+    return 0;
+}
+
+/**
+ * @brief stop_monitor.
+ */
+static int stop_monitor_command(int argc, char* args[])
+{
+    (void)argc;
+    (void)args;
+    stop_monitor();
+    return 0;
+}
+
+/**
+ * @brief status_monitor [-live | -stop].
+ */
+static int status_monitor_command(int argc, char* args[])
+{
+    (void)argc;
+    status_monitor(args[1]);
+    return 0;
+}
+
+/**
+ * @brief Commands of the monitor.
+ */
+static const builtin_command monitor_commands[] = {
+    {"start_monitor", "", "Inicia el monitor del sistema", BUILTIN_PARENT, start_monitor_command, NULL, NULL, NULL},
+    {"stop_monitor", "", "Detiene el monitor del sistema", BUILTIN_PARENT, stop_monitor_command, NULL, NULL, NULL},
+    {"status_monitor", "[-live | -stop]", "Muestra las métricas del monitor", BUILTIN_PARENT, status_monitor_command,
+     NULL, NULL, NULL},
+};
+
+void monitor_register_builtins(void)
+{
+    builtin_register(monitor_commands, sizeof(monitor_commands) / sizeof(monitor_commands[0]));
+}
@@ -0,0 +1,177 @@
+/**
+ * @file plugins.c
+ * @brief This file contains the implementation of the loader of plugins.
+ * @details Every command enabled gets a builtin_command that points to its entry of the plugin (data), which the
+ * handlers look up to call it. The libraries are opened with RTLD_LOCAL, so two plugins can have symbols with the
+ * same name, and RTLD_NOW, so a missing symbol fails in enable and not in the middle of a script.
+ */
+#include "plugins.h"
+#include "builtins.h"
+#include "shellter_plugin.h"
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * @brief A command enabled from a plugin.
+ */
+typedef struct enabled_command
+{
+    builtin_command command;      /**< Entry of the registry. */
+    char* path;                   /**< Library it comes from. */
+    struct enabled_command* next; /**< Next command enabled. */
+} enabled_command;
+
+/**
+ * @brief Commands enabled, the last one first.
+ */
+static enabled_command* enabled = NULL;
+
+/**
+ * @brief This function runs a command of a plugin on the descriptors of the shell.
+ */
+static int plugin_run(int argc, char* args[])
+{
+    const struct shellter_builtin_v1* entry = builtin_find(args[0])->data;
+    struct shellter_io_v1 io = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+
+    // Lo pendiente de stdio va antes que lo que el plugin escriba en el descriptor
+    fflush(stdout);
+    return entry->run(argc, args, &io);
+}
+
+/**
+ * @brief This function runs a thread safe command of a plugin as a stage of a pipeline.
+ */
+static int plugin_run_fd(const builtin_command* self, int argc, char* args[], int input, int output)
+{
+    const struct shellter_builtin_v1* entry = self->data;
+    struct shellter_io_v1 io = {input, output, STDERR_FILENO};
+    return entry->run(argc, args, &io);
+}
+
+/**
+ * @brief This function registers a command of a plugin.
+ * @return 0 on success, -1 on error (already reported).
+ */
+static int enable_entry(const char* path, const struct shellter_builtin_v1* table, const char* name)
+{
+    const struct shellter_builtin_v1* entry = table;
+    while (entry->name && strcmp(entry->name, name) != 0)
+        entry++;
+
+    if (!entry->name)
+    {
+        printf("enable: %s: no tiene el comando %s\n", path, name);
+        return -1;
+    }
+    if (entry->abi != SHELLTER_PLUGIN_ABI || !entry->run)
+    {
+        printf("enable: %s: versión del ABI %u no soportada (se esperaba %d)\n", name, entry->abi, SHELLTER_PLUGIN_ABI);
+        return -1;
+    }
+    if (builtin_find(name))
+    {
+        printf("enable: %s: ya es un comando interno\n", name);
+        return -1;
+    }
+
+    enabled_command* command = calloc(1, sizeof(enabled_command));
+    char* copy = strdup(path);
+    if (!command || !copy)
+    {
+        perror("enable");
+        free(command);
+        free(copy);
+        return -1;
+    }
+
+    bool thread_safe = entry->flags & SHELLTER_PLUGIN_THREAD_SAFE;
+    command->command = (builtin_command){entry->name,
+                                        entry->usage ? entry->usage : "",
+                                        entry->summary ? entry->summary : "",
+                                        thread_safe ? BUILTIN_PIPELINE | BUILTIN_INPUT : 0,
+                                        plugin_run,
+                                        thread_safe ? plugin_run_fd : NULL,
+                                        NULL,
+                                        entry};
+    command->path = copy;
+
+    if (builtin_register(&command->command, 1) != 0)
+    {
+        free(command->path);
+        free(command);
+        return -1;
+    }
+    command->next = enabled;
+    enabled = command;
+    return 0;
+}
+
+/**
+ * @brief enable [-f library name...]: loads commands from a plugin, without arguments it lists the loaded ones.
+ */
+static int enable_command(int argc, char* args[])
+{
+    if (argc == 1)
+    {
+        for (const enabled_command* command = enabled; command; command = command->next)
+            printf("enable -f %s %s\n", command->path, command->command.name);
+        return 0;
+    }
+
+    if (argc < 4 || strcmp(args[1], "-f") != 0)
+    {
+        printf("Uso: enable [-f <biblioteca> <comando>...]\n");
+        return 1;
+    }
+
+    // Sin "/" dlopen() buscaría en las rutas del sistema y no en el directorio actual, como la shell
+    char path[4096];
+    snprintf(path, sizeof(path), "%s%s", strchr(args[2], '/') ? "" : "./", args[2]);
+
+    void* library = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!library)
+    {
+        printf("enable: %s\n", dlerror());
+        return 1;
+    }
+
+    const struct shellter_builtin_v1* table = dlsym(library, SHELLTER_PLUGIN_SYMBOL);
+    if (!table)
+    {
+        printf("enable: %s: no es un plugin de shellter (falta %s)\n", path, SHELLTER_PLUGIN_SYMBOL);
+        dlclose(library);
+        return 1;
+    }
+
+    int status = 0;
+    int loaded = 0;
+    for (int i = 3; i < argc; i++)
+    {
+        if (enable_entry(path, table, args[i]) == 0)
+            loaded++;
+        else
+            status = 1;
+    }
+
+    // Los comandos registrados apuntan a la biblioteca: queda abierta mientras viva la shell
+    if (loaded == 0)
+        dlclose(library);
+    return status;
+}
+
+/**
+ * @brief Commands of the plugins.
+ */
+static const builtin_command plugin_commands[] = {
+    {"enable", "[-f <biblioteca> <comando>...]", "Carga comandos internos de un plugin (.so)", BUILTIN_PARENT,
+     enable_command, NULL, NULL, NULL},
+};
+
+void plugins_register_builtins(void)
+{
+    builtin_register(plugin_commands, sizeof(plugin_commands) / sizeof(plugin_commands[0]));
+}
@@ -1,23 +1,334 @@
 /**
  * @file prompt.c
  * @brief This file contains the implementation of the function that shows the prompt.
+ * @details The prompt is rendered once into a buffer and only rendered again when the directory or the status of the
+ * last command change. User and hostname are read the first time. There are two buffers: the new prompt is rendered
+ * into the one not in use and then published, so a signal handler that writes the prompt never sees a half-rendered
+ * buffer. On a terminal the slow segments (see segments.h) are drawn on the right side of the line and repainted in
+ * place, saving and restoring the cursor, so they never move what the user is typing.
  */
 #include "prompt.h"
+#include "segments.h"
+#include <pthread.h>
+#include <pwd.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/ioctl.h>
+
+/**
+ * @brief Rendered prompts, preceded by a newline for the signal handlers.
+ */
+static char* prompt_buffers[2] = {NULL, NULL};
+
+/**
+ * @brief Length of each rendered prompt, newline included.
+ */
+static size_t prompt_lengths[2] = {0, 0};
+
+/**
+ * @brief Buffer in use, -1 until the first render.
+ */
+static volatile sig_atomic_t prompt_current = -1;
+
+/**
+ * @brief User name, read once.
+ */
+static char* prompt_user = NULL;
+
+/**
+ * @brief Hostname, read once.
+ */
+static char prompt_hostname[HOSTNAME_MAX];
+
+/**
+ * @brief Current directory, read again by prompt_update_cwd().
+ */
+static char* prompt_directory = NULL;
+
+/**
+ * @brief Exit status of the last command.
+ */
+static int prompt_status = 0;
+
+/**
+ * @brief Duration of the last command in milliseconds.
+ */
+static long prompt_duration_ms = 0;
+
+/**
+ * @brief Columns of the terminal, 0 if stdout is not a terminal or the size must be read again.
+ */
+static volatile sig_atomic_t prompt_columns = 0;
+
+/**
+ * @brief The first prompt was shown (the segments worker is started then).
+ */
+static bool prompt_started = false;
+
+/**
+ * @brief State of the right side of the prompt, protected by paint_lock.
+ */
+static struct
+{
+    pthread_mutex_t paint_lock; /**< Serializes the repaints with the end of the prompt. */
+    bool waiting;               /**< The prompt is on screen waiting for input. */
+    bool enabled;               /**< stdout is a terminal and the worker is running. */
+    size_t column;              /**< Column where the segments start, 0 if none are shown. */
+} right_side = {.paint_lock = PTHREAD_MUTEX_INITIALIZER};
+
+/**
+ * @brief This function handles SIGWINCH: the size of the terminal is read again on the next prompt.
+ */
+static void prompt_resize_handler(int signum)
+{
+    (void)signum;
+    prompt_columns = 0;
+}
+
+/**
+ * @brief This function renders the prompt into the buffer not in use and publishes it.
+ */
+static void render_prompt(void)
+{
+    if (!prompt_user)
+    {
+        const char* user = getenv("USER");
+        struct passwd* entry = user ? NULL : getpwuid(getuid());
+        prompt_user = strdup(user ? user : entry ? entry->pw_name : "");
+        if (gethostname(prompt_hostname, sizeof(prompt_hostname)) != 0)
+            prompt_hostname[0] = '\0';
+        prompt_hostname[sizeof(prompt_hostname) - 1] = '\0';
+    }
+    if (!prompt_directory)
+    {
+        // getcwd(NULL, 0) reserva lo necesario: el directorio no se trunca
+        prompt_directory = getcwd(NULL, 0);
+    }
+
+    // Código de salida si no es 0 y duración si el comando tardó
+    char status[64] = "";
+    size_t status_length = 0;
+    if (prompt_status != 0)
+        status_length += (size_t)snprintf(status, sizeof(status), " " ANSI_RED "[%d]", prompt_status);
+    if (prompt_duration_ms >= PROMPT_DURATION_MIN_MS)
+    {
+        if (prompt_duration_ms < 1000)
+            snprintf(status + status_length, sizeof(status) - status_length, " " ANSI_YELLOW "%ldms",
+                     prompt_duration_ms);
+        else
+            snprintf(status + status_length, sizeof(status) - status_length, " " ANSI_YELLOW "%.1fs",
+                     (double)prompt_duration_ms / 1000.0);
+    }
+
+    const char* user = prompt_user ? prompt_user : "";
+    const char* directory = prompt_directory ? prompt_directory : "";
+    int next = prompt_current == 0 ? 1 : 0;
+    int length = snprintf(NULL, 0, "\n" ANSI_GREEN "%s@%s" ANSI_BLUE ":~%s%s" ANSI_RESET "$ ", user, prompt_hostname,
+                          directory, status);
+
+    if (length > 0)
+    {
+        char* buffer = realloc(prompt_buffers[next], (size_t)length + 1);
+        if (buffer)
+        {
+            snprintf(buffer, (size_t)length + 1, "\n" ANSI_GREEN "%s@%s" ANSI_BLUE ":~%s%s" ANSI_RESET "$ ", user,
+                     prompt_hostname, directory, status);
+            prompt_buffers[next] = buffer;
+            prompt_lengths[next] = (size_t)length;
+            prompt_current = next;
+        }
+    }
+}
+
+/**
+ * @brief This function returns the columns of the terminal, 0 if stdout is not a terminal.
+ */
+static size_t terminal_columns(void)
+{
+    if (prompt_columns == 0)
+    {
+        struct winsize window;
+        if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &window) == 0)
+            prompt_columns = window.ws_col;
+    }
+    return (size_t)prompt_columns;
+}
+
+/**
+ * @brief This function appends the segments, drawn on the right side of the line, to a buffer.
+ * @param buffer The output buffer.
+ * @param size Size of the buffer.
+ * @param clear Column whose content must be erased first, 0 for none.
+ * @return The length written. Must be called with paint_lock held.
+ */
+static size_t render_right_side(char* buffer, size_t size, size_t clear)
+{
+    char segments_text[SEGMENTS_MAX];
+    size_t width;
+    size_t segments_length = segments_render(segments_text, &width);
+    size_t columns = terminal_columns();
+    int length = 0;
+
+    // Guardar el cursor, dibujar en la derecha y volver a donde estaba el usuario
+    size_t column = segments_length > 0 && columns > width + PROMPT_RIGHT_MARGIN ? columns - width : 0;
+    if (clear > 0 || column > 0)
+    {
+        length = snprintf(buffer, size, "\0337");
+        if (clear > 0)
+            length += snprintf(buffer + length, size - (size_t)length, "\033[%zuG\033[K", clear);
+        if (column > 0)
+            length += snprintf(buffer + length, size - (size_t)length, "\033[%zuG%s", column, segments_text);
+        length += snprintf(buffer + length, size - (size_t)length, "\0338");
+    }
+
+    right_side.column = column;
+    return (size_t)length < size ? (size_t)length : size - 1;
+}
+
+/**
+ * @brief This function repaints the segments of the prompt on screen, called from the segments worker.
+ */
+static void repaint_right_side(void)
+{
+    char buffer[SEGMENTS_MAX + 64];
+
+    pthread_mutex_lock(&right_side.paint_lock);
+    if (right_side.waiting)
+    {
+        size_t length = render_right_side(buffer, sizeof(buffer), right_side.column);
+        ssize_t written = write(STDOUT_FILENO, buffer, length);
+        (void)written;
+    }
+    pthread_mutex_unlock(&right_side.paint_lock);
+}
+
+/**
+ * @brief fork() handlers: the child (background jobs) has no segments worker, it writes the plain prompt.
+ */
+static void prompt_fork_prepare(void)
+{
+    pthread_mutex_lock(&right_side.paint_lock);
+}
+
+static void prompt_fork_parent(void)
+{
+    pthread_mutex_unlock(&right_side.paint_lock);
+}
+
+static void prompt_fork_child(void)
+{
+    right_side.enabled = false;
+    right_side.waiting = false;
+    pthread_mutex_unlock(&right_side.paint_lock);
+}
 
 /**
  * @brief This function shows the prompt.
  */
 void show_prompt(void)
 {
-    char hostname[HOSTNAME_MAX];
-    char directory[DIRECTORY_MAX];
-    char* user;
-
-    user = getenv("USER");
-    gethostname(hostname, sizeof(hostname));
-    getcwd(directory, 100);
+    if (!prompt_started)
+    {
+        prompt_started = true;
+        if (prompt_current < 0)
+            render_prompt();
 
-    printf(ANSI_GREEN "%s@%s" ANSI_BLUE ":~%s" ANSI_RESET "$ ", user, hostname, directory);
+        // Los segmentos lentos solo tienen sentido en una terminal
+        if (isatty(STDOUT_FILENO) && segments_start(repaint_right_side) == 0)
+        {
+            pthread_atfork(prompt_fork_prepare, prompt_fork_parent, prompt_fork_child);
+            signal(SIGWINCH, prompt_resize_handler);
+            right_side.enabled = true;
+        }
+    }
 
+    // La salida pendiente de stdio va antes que el prompt
     fflush(stdout);
+
+    if (prompt_current < 0)
+        return;
+
+    const char* prompt = prompt_buffers[prompt_current] + 1;
+    size_t prompt_length = prompt_lengths[prompt_current] - 1;
+
+    if (!right_side.enabled)
+    {
+        ssize_t written = write(STDOUT_FILENO, prompt, prompt_length);
+        (void)written;
+        return;
+    }
+
+    // Prompt y segmentos (con los valores que haya) en una sola escritura
+    segments_request(prompt_directory ? prompt_directory : "");
+
+    pthread_mutex_lock(&right_side.paint_lock);
+    char* line = malloc(prompt_length + SEGMENTS_MAX + 64);
+    if (line)
+    {
+        memcpy(line, prompt, prompt_length);
+        size_t length = prompt_length + render_right_side(line + prompt_length, SEGMENTS_MAX + 64, 0);
+        ssize_t written = write(STDOUT_FILENO, line, length);
+        (void)written;
+        free(line);
+    }
+    else
+    {
+        ssize_t written = write(STDOUT_FILENO, prompt, prompt_length);
+        (void)written;
+    }
+    right_side.waiting = true;
+    pthread_mutex_unlock(&right_side.paint_lock);
+}
+
+/**
+ * @brief This function shows the prompt on a new line from a signal handler.
+ */
+void show_prompt_signal_safe(void)
+{
+    int current = prompt_current;
+
+    if (current >= 0)
+    {
+        ssize_t written = write(STDOUT_FILENO, prompt_buffers[current], prompt_lengths[current]);
+        (void)written;
+    }
+    else
+    {
+        ssize_t written = write(STDOUT_FILENO, "\n$ ", 3);
+        (void)written;
+    }
+}
+
+/**
+ * @brief This function renders the prompt again after a change of directory.
+ */
+void prompt_update_cwd(void)
+{
+    free(prompt_directory);
+    prompt_directory = getcwd(NULL, 0);
+    render_prompt();
+}
+
+/**
+ * @brief This function stops the repaints of the segments once the user entered a command.
+ */
+void prompt_input_received(void)
+{
+    pthread_mutex_lock(&right_side.paint_lock);
+    right_side.waiting = false;
+    pthread_mutex_unlock(&right_side.paint_lock);
+}
+
+/**
+ * @brief This function records the status and duration of the last command for the next prompt.
+ */
+void prompt_set_status(int status, long duration_ms)
+{
+    if (status == prompt_status && duration_ms < PROMPT_DURATION_MIN_MS && prompt_duration_ms < PROMPT_DURATION_MIN_MS)
+        return;
+
+    prompt_status = status;
+    prompt_duration_ms = duration_ms;
+    render_prompt();
 }
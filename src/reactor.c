@@ -0,0 +1,184 @@
+/**
+ * @file reactor.c
+ * @brief This file contains the implementation of the event loop of the shell.
+ * @details The callbacks are kept in a table indexed by file descriptor. Every registration gets a generation number
+ * that is stored in the epoll event next to the descriptor, so an event returned in the same batch as the removal of
+ * its descriptor (or of a new descriptor with the same number) is recognized as stale and dropped.
+ */
+#include "reactor.h"
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+/**
+ * @brief Maximum number of events read by one epoll_wait().
+ */
+#define REACTOR_BATCH 32
+
+/**
+ * @brief Callback registered for a file descriptor.
+ */
+typedef struct
+{
+    reactor_callback callback; /**< Callback, NULL if the descriptor is not registered. */
+    void* data;                /**< Pointer passed to the callback. */
+    uint32_t generation;       /**< Generation of the registration. */
+    bool timer;                /**< The descriptor is a timerfd, its expirations are read before the callback. */
+} reactor_handler;
+
+/**
+ * @brief The epoll instance, -1 until the first registration.
+ */
+static int reactor_fd = -1;
+
+/**
+ * @brief Handlers, indexed by file descriptor.
+ */
+static reactor_handler* reactor_handlers = NULL;
+
+/**
+ * @brief Number of entries of reactor_handlers.
+ */
+static size_t reactor_capacity = 0;
+
+/**
+ * @brief Generation of the last registration.
+ */
+static uint32_t reactor_generation = 0;
+
+int reactor_add(int fd, uint32_t events, reactor_callback callback, void* data)
+{
+    if (fd < 0 || !callback)
+        return -1;
+
+    if (reactor_fd < 0)
+    {
+        reactor_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (reactor_fd < 0)
+            return -1;
+    }
+
+    if ((size_t)fd >= reactor_capacity)
+    {
+        size_t capacity = reactor_capacity ? reactor_capacity : 16;
+        while (capacity <= (size_t)fd)
+            capacity *= 2;
+        reactor_handler* handlers = realloc(reactor_handlers, capacity * sizeof(reactor_handler));
+        if (!handlers)
+            return -1;
+        memset(handlers + reactor_capacity, 0, (capacity - reactor_capacity) * sizeof(reactor_handler));
+        reactor_handlers = handlers;
+        reactor_capacity = capacity;
+    }
+
+    uint32_t generation = ++reactor_generation;
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.u64 = (uint64_t)generation << 32 | (uint32_t)fd;
+
+    int operation = reactor_handlers[fd].callback ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    if (epoll_ctl(reactor_fd, operation, fd, &event) != 0 &&
+        (operation == EPOLL_CTL_ADD || errno != ENOENT || epoll_ctl(reactor_fd, EPOLL_CTL_ADD, fd, &event) != 0))
+        return -1;
+
+    reactor_handlers[fd].callback = callback;
+    reactor_handlers[fd].data = data;
+    reactor_handlers[fd].generation = generation;
+    reactor_handlers[fd].timer = false;
+    return 0;
+}
+
+void reactor_remove(int fd)
+{
+    if (fd < 0 || (size_t)fd >= reactor_capacity || !reactor_handlers[fd].callback)
+        return;
+
+    epoll_ctl(reactor_fd, EPOLL_CTL_DEL, fd, NULL);
+    memset(&reactor_handlers[fd], 0, sizeof(reactor_handler));
+}
+
+/**
+ * @brief This function converts milliseconds to a timespec.
+ */
+static struct timespec milliseconds(long ms)
+{
+    struct timespec time = {.tv_sec = ms / 1000, .tv_nsec = (ms % 1000) * 1000000};
+    return time;
+}
+
+int reactor_timer(long delay_ms, long interval_ms, reactor_callback callback, void* data)
+{
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    if (reactor_add(fd, EPOLLIN, callback, data) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    reactor_handlers[fd].timer = true;
+    reactor_timer_set(fd, delay_ms, interval_ms);
+    return fd;
+}
+
+void reactor_timer_set(int fd, long delay_ms, long interval_ms)
+{
+    struct itimerspec spec = {.it_interval = milliseconds(interval_ms), .it_value = milliseconds(delay_ms)};
+    timerfd_settime(fd, 0, &spec, NULL);
+
+    // Una expiración anterior que nadie leyó no debe disparar el callback
+    uint64_t expirations;
+    ssize_t bytes = read(fd, &expirations, sizeof(expirations));
+    (void)bytes;
+}
+
+void reactor_timer_remove(int fd)
+{
+    if (fd < 0)
+        return;
+    reactor_remove(fd);
+    close(fd);
+}
+
+int reactor_dispatch(int timeout_ms)
+{
+    if (reactor_fd < 0)
+        return -1;
+
+    struct epoll_event events[REACTOR_BATCH];
+    int count = epoll_wait(reactor_fd, events, REACTOR_BATCH, timeout_ms);
+    if (count < 0)
+        return errno == EINTR ? 0 : -1;
+
+    int run = 0;
+    for (int i = 0; i < count; i++)
+    {
+        int fd = (int)(uint32_t)events[i].data.u64;
+        uint32_t generation = (uint32_t)(events[i].data.u64 >> 32);
+        reactor_handler* handler = &reactor_handlers[fd];
+
+        // Un callback anterior del mismo lote pudo quitar (o reemplazar) este descriptor
+        if (!handler->callback || handler->generation != generation)
+            continue;
+
+        // Los timers se leen aquí: el callback solo ve la expiración (si fue rearmado, no hay nada que leer)
+        if (handler->timer)
+        {
+            uint64_t expirations;
+            if (read(fd, &expirations, sizeof(expirations)) != (ssize_t)sizeof(expirations))
+                continue;
+        }
+
+        handler->callback(fd, events[i].events, handler->data);
+        run++;
+    }
+
+    return run;
+}
@@ -0,0 +1,742 @@
+/**
+ * @file reader.c
+ * @brief This file contains the implementation of the read_file command.
+ */
+#define _GNU_SOURCE // splice() y memrchr()
+#include "reader.h"
+#include "jobs.h"
+#include "json_query.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+
+/**
+ * @brief Size of the buffer used when the file can't be sent with sendfile() or splice().
+ */
+#define COPY_BUFFER_SIZE (64 * 1024)
+
+/**
+ * @brief Maximum number of bytes of one sendfile()/splice() call.
+ */
+#define SEND_CHUNK_SIZE (1 << 30)
+
+/**
+ * @brief Interval of the checks of --follow when no event arrives.
+ */
+#define FOLLOW_POLL_MS 1000
+
+/**
+ * @brief Number of parsed JSON files kept in the cache.
+ */
+#define JSON_CACHE_SIZE 8
+
+/**
+ * @brief A parsed JSON file, valid while the file keeps its identity and modification time.
+ */
+typedef struct
+{
+    dev_t device;          /**< Device of the file. */
+    ino_t inode;           /**< Inode of the file. */
+    struct timespec mtime; /**< Modification time of the file. */
+    off_t size;            /**< Size of the file. */
+    char* buffer;          /**< Content of the file, the tree points into it (in-situ parsing). */
+    cJSON* root;           /**< Parsed tree, NULL if the entry is empty. */
+    unsigned long used;    /**< Last use, for the LRU replacement. */
+} json_cache_entry;
+
+/**
+ * @brief Cache of parsed JSON files.
+ */
+static json_cache_entry json_cache[JSON_CACHE_SIZE];
+
+/**
+ * @brief Counter of uses of the cache.
+ */
+static unsigned long json_cache_clock = 0;
+
+/**
+ * @brief Writer reused to render the JSON output.
+ */
+static cJSON_Writer* json_writer = NULL;
+
+/**
+ * @brief A range of a file with a lazy index of its lines.
+ * @note The bytes are read with pread() on demand: a file that shrinks while it is paged only shows fewer lines.
+ */
+typedef struct
+{
+    int fd;               /**< The file. */
+    off_t base;           /**< First byte of the range. */
+    size_t size;          /**< Size of the range. */
+    size_t* lines;        /**< Offset of the start of each indexed line, relative to base. */
+    size_t line_count;    /**< Number of indexed lines. */
+    size_t line_capacity; /**< Capacity of lines. */
+    bool complete;        /**< Every line is indexed. */
+} line_index;
+
+/**
+ * @brief This function writes all the bytes of a buffer to a descriptor.
+ * @return 0 on success, -1 on error.
+ */
+static int write_all(int fd, const char* data, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t written = write(fd, data, length);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        data += written;
+        length -= (size_t)written;
+    }
+    return 0;
+}
+
+/**
+ * @brief This function copies a byte range of a file to a descriptor.
+ * @param output The descriptor.
+ * @param fd The file.
+ * @param start First byte.
+ * @param end End of the range (exclusive).
+ * @return 0 on success, -1 on error.
+ * @note sendfile() is tried first, then splice() (output is a pipe) and then a plain read()/write() loop.
+ */
+static int send_range(int output, int fd, off_t start, off_t end)
+{
+    off_t offset = start;
+    bool use_sendfile = true;
+    bool use_splice = true;
+
+    while (offset < end)
+    {
+        size_t chunk = (size_t)(end - offset) < SEND_CHUNK_SIZE ? (size_t)(end - offset) : SEND_CHUNK_SIZE;
+        ssize_t sent = -1;
+
+        if (use_sendfile)
+        {
+            sent = sendfile(output, fd, &offset, chunk);
+            if (sent < 0 && (errno == EINVAL || errno == ENOSYS))
+            {
+                use_sendfile = false;
+                continue;
+            }
+        }
+        else if (use_splice)
+        {
+            loff_t splice_offset = offset;
+            sent = splice(fd, &splice_offset, output, NULL, chunk, SPLICE_F_MOVE);
+            if (sent < 0 && (errno == EINVAL || errno == ENOSYS))
+            {
+                use_splice = false;
+                continue;
+            }
+            if (sent > 0)
+                offset = (off_t)splice_offset;
+        }
+        else
+        {
+            char buffer[COPY_BUFFER_SIZE];
+            sent = pread(fd, buffer, chunk < sizeof(buffer) ? chunk : sizeof(buffer), offset);
+            if (sent > 0)
+            {
+                if (write_all(output, buffer, (size_t)sent) != 0)
+                    return -1;
+                offset += sent;
+            }
+        }
+
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (sent == 0)
+            break; // El archivo se achicó mientras se copiaba
+    }
+
+    return 0;
+}
+
+/**
+ * @brief This function copies a file that is not regular (pipe, device) to a descriptor.
+ */
+static int copy_stream(int output, int fd)
+{
+    char buffer[COPY_BUFFER_SIZE];
+    ssize_t bytes;
+
+    while ((bytes = read(fd, buffer, sizeof(buffer))) != 0)
+    {
+        if (bytes < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (write_all(output, buffer, (size_t)bytes) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief This function finds the next newline of a range of a file.
+ * @param offset First byte to look at.
+ * @param end End of the range (exclusive).
+ * @return Offset of the newline, end if there is none or the file got shorter.
+ */
+static off_t next_newline(int fd, off_t offset, off_t end)
+{
+    char buffer[COPY_BUFFER_SIZE];
+
+    while (offset < end)
+    {
+        size_t chunk = (size_t)(end - offset) < sizeof(buffer) ? (size_t)(end - offset) : sizeof(buffer);
+        ssize_t bytes = pread(fd, buffer, chunk, offset);
+        if (bytes < 0 && errno == EINTR)
+            continue;
+        if (bytes <= 0)
+            return end;
+
+        const char* newline = memchr(buffer, '\n', (size_t)bytes);
+        if (newline)
+            return offset + (newline - buffer);
+        offset += bytes;
+    }
+    return end;
+}
+
+/**
+ * @brief This function finds the last newline of a range of a file, reading it backwards.
+ * @param start First byte of the range.
+ * @param end End of the range (exclusive).
+ * @return Offset of the newline, -1 if there is none or the file got shorter.
+ */
+static off_t previous_newline(int fd, off_t start, off_t end)
+{
+    char buffer[COPY_BUFFER_SIZE];
+
+    while (end > start)
+    {
+        size_t chunk = (size_t)(end - start) < sizeof(buffer) ? (size_t)(end - start) : sizeof(buffer);
+        ssize_t bytes = pread(fd, buffer, chunk, end - (off_t)chunk);
+        if (bytes < 0 && errno == EINTR)
+            continue;
+        if (bytes < (ssize_t)chunk)
+            return -1;
+
+        const char* newline = memrchr(buffer, '\n', chunk);
+        if (newline)
+            return end - (off_t)chunk + (newline - buffer);
+        end -= (off_t)chunk;
+    }
+    return -1;
+}
+
+/**
+ * @brief This function finds the end of the first lines of a range of a file.
+ * @param lines The number of lines.
+ * @return Offset after the last byte of the lines.
+ */
+static off_t skip_lines(int fd, off_t offset, off_t end, long lines)
+{
+    while (lines > 0 && offset < end)
+    {
+        off_t newline = next_newline(fd, offset, end);
+        if (newline >= end)
+            return end;
+        offset = newline + 1;
+        lines--;
+    }
+    return offset;
+}
+
+/**
+ * @brief This function finds the start of the last lines of a range of a file, reading it backwards.
+ * @param lines The number of lines.
+ * @return Offset of the first byte of the lines.
+ */
+static off_t last_lines(int fd, off_t start, off_t end, long lines)
+{
+    // El salto de línea final no abre una línea nueva
+    char last;
+    if (end > start && pread(fd, &last, 1, end - 1) == 1 && last == '\n')
+        end--;
+
+    while (lines > 0)
+    {
+        off_t newline = previous_newline(fd, start, end);
+        if (newline < 0)
+            return start;
+        end = newline;
+        lines--;
+    }
+    return end + 1;
+}
+
+/**
+ * @brief This function indexes the lines of a range up to a line.
+ * @param index The index.
+ * @param line The line that must be indexed, SIZE_MAX for all of them.
+ */
+static void index_lines(line_index* index, size_t line)
+{
+    off_t end = index->base + (off_t)index->size;
+
+    while (!index->complete && index->line_count <= line)
+    {
+        size_t start = 0;
+        if (index->line_count > 0)
+        {
+            off_t previous = index->base + (off_t)index->lines[index->line_count - 1];
+            off_t newline = next_newline(index->fd, previous, end);
+            if (newline + 1 >= end)
+            {
+                index->complete = true;
+                break;
+            }
+            start = (size_t)(newline + 1 - index->base);
+        }
+        else if (index->size == 0)
+        {
+            index->complete = true;
+            break;
+        }
+
+        if (index->line_count == index->line_capacity)
+        {
+            size_t capacity = index->line_capacity ? index->line_capacity * 2 : 1024;
+            size_t* lines = realloc(index->lines, capacity * sizeof(size_t));
+            if (!lines)
+            {
+                index->complete = true;
+                break;
+            }
+            index->lines = lines;
+            index->line_capacity = capacity;
+        }
+        index->lines[index->line_count++] = start;
+    }
+}
+
+/**
+ * @brief This function appends bytes to the frame of the pager.
+ */
+static void frame_append(char** frame, size_t* length, size_t* capacity, const char* data, size_t size)
+{
+    if (*length + size > *capacity)
+    {
+        size_t new_capacity = *capacity ? *capacity : 4096;
+        while (new_capacity < *length + size)
+            new_capacity *= 2;
+        char* grown = realloc(*frame, new_capacity);
+        if (!grown)
+            return;
+        *frame = grown;
+        *capacity = new_capacity;
+    }
+    memcpy(*frame + *length, data, size);
+    *length += size;
+}
+
+/**
+ * @brief This function shows a range of a file in a pager on the terminal.
+ * @param name Name shown in the status line.
+ * @param fd The file.
+ * @param start First byte of the range.
+ * @param end End of the range (exclusive).
+ * @note Keys: space/f next page, b previous page, enter/j/down next line, k/up previous line, g/G top/bottom, q quit.
+ */
+static void run_pager(const char* name, int fd, off_t start, off_t end)
+{
+    struct winsize window;
+    size_t rows = 24;
+    size_t columns = 80;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &window) == 0 && window.ws_row > 1 && window.ws_col > 0)
+    {
+        rows = window.ws_row;
+        columns = window.ws_col;
+    }
+    size_t page = rows - 1;
+
+    size_t size = (size_t)(end - start);
+    line_index index = {fd, start, size, NULL, 0, 0, false};
+    index_lines(&index, page);
+
+    // Una línea se corta al ancho de la terminal: se lee un byte más para no partir un carácter UTF-8
+    char* text = malloc(columns + 1);
+    if (!text || (index.complete && index.line_count <= page))
+    {
+        // Entra en una pantalla: no hace falta paginar
+        send_range(STDOUT_FILENO, fd, start, end);
+        free(text);
+        free(index.lines);
+        return;
+    }
+
+    struct termios saved;
+    struct termios raw;
+    tcgetattr(STDIN_FILENO, &saved);
+    raw = saved;
+    raw.c_lflag &= ~(tcflag_t)(ICANON | ECHO);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+
+    char* frame = NULL;
+    size_t frame_capacity = 0;
+    size_t top = 0;
+    bool running = true;
+
+    while (running)
+    {
+        index_lines(&index, top + page);
+        size_t frame_length = 0;
+        frame_append(&frame, &frame_length, &frame_capacity, "\033[H\033[J", 6);
+
+        for (size_t line = top; line < top + page && line < index.line_count; line++)
+        {
+            size_t line_start = index.lines[line];
+            size_t line_end = line + 1 < index.line_count ? index.lines[line + 1] : size;
+            size_t wanted = line_end - line_start < columns + 1 ? line_end - line_start : columns + 1;
+            ssize_t bytes = pread(fd, text, wanted, start + (off_t)line_start);
+            size_t length = bytes > 0 ? (size_t)bytes : 0;
+            if (length > 0 && text[length - 1] == '\n')
+                length--;
+
+            // Cortar las líneas largas al ancho de la terminal sin partir un carácter UTF-8
+            if (length > columns)
+            {
+                length = columns;
+                while (length > 0 && ((unsigned char)text[length] & 0xC0) == 0x80)
+                    length--;
+            }
+            frame_append(&frame, &frame_length, &frame_capacity, text, length);
+            frame_append(&frame, &frame_length, &frame_capacity, "\r\n", 2);
+        }
+
+        char status[256];
+        size_t last = top + page < index.line_count ? top + page : index.line_count;
+        int status_length = snprintf(status, sizeof(status),
+                                     "\033[7m %s: líneas %zu-%zu%s (espacio/b: página, j/k: línea, q: salir) \033[0m",
+                                     name, top + 1, last, index.complete ? "" : "+");
+        if (status_length > 0)
+            frame_append(&frame, &frame_length, &frame_capacity, status,
+                         (size_t)status_length < sizeof(status) ? (size_t)status_length : sizeof(status) - 1);
+        write_all(STDOUT_FILENO, frame, frame_length);
+
+        // Ctrl+C interrumpe read() con EINTR y cierra el paginador, como q
+        char key[3];
+        ssize_t bytes = read(STDIN_FILENO, key, sizeof(key));
+        if (bytes <= 0)
+            break;
+
+        size_t bottom = 0;
+        char command = key[0];
+        if (bytes == 3 && key[0] == '\033' && key[1] == '[')
+            command = key[2] == 'A' ? 'k' : key[2] == 'B' ? 'j' : key[2] == '6' ? ' ' : key[2] == '5' ? 'b' : 0;
+
+        switch (command)
+        {
+        case ' ':
+        case 'f':
+            top += page;
+            break;
+        case 'b':
+            top = top > page ? top - page : 0;
+            break;
+        case '\n':
+        case 'j':
+            top++;
+            break;
+        case 'k':
+            top = top > 0 ? top - 1 : 0;
+            break;
+        case 'g':
+            top = 0;
+            break;
+        case 'G':
+            index_lines(&index, SIZE_MAX);
+            bottom = index.line_count > page ? index.line_count - page : 0;
+            top = bottom;
+            break;
+        case 'q':
+            running = false;
+            break;
+        default:
+            break;
+        }
+
+        // No pasar del final del archivo
+        index_lines(&index, top + page);
+        if (index.complete)
+        {
+            bottom = index.line_count > page ? index.line_count - page : 0;
+            if (top > bottom)
+                top = bottom;
+        }
+    }
+
+    write_all(STDOUT_FILENO, "\r\033[K", 4);
+    tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+    free(frame);
+    free(text);
+    free(index.lines);
+}
+
+/**
+ * @brief This function prints what is appended to a file until it is interrupted, removed or renamed.
+ * @param output The descriptor the content is written to.
+ * @param path The path to the file.
+ * @param fd The file.
+ * @param offset Bytes already printed.
+ */
+static void follow_file(int output, const char* path, int fd, off_t offset)
+{
+    int watch = inotify_init1(IN_CLOEXEC);
+    if (watch < 0 || inotify_add_watch(watch, path, IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF) < 0)
+    {
+        perror("inotify");
+        if (watch >= 0)
+            close(watch);
+        return;
+    }
+
+    _Alignas(struct inotify_event) char events[4096];
+    bool running = true;
+
+    while (running)
+    {
+        struct pollfd descriptor = {watch, POLLIN, 0};
+
+        // Ctrl+C interrumpe poll() con EINTR y termina el seguimiento. El timeout cubre los sistemas de archivos
+        // que no generan eventos (NFS, overlay)
+        int ready = poll(&descriptor, 1, FOLLOW_POLL_MS);
+        if (ready < 0)
+            break;
+
+        ssize_t length = ready > 0 ? read(watch, events, sizeof(events)) : 0;
+        for (ssize_t position = 0; length > 0 && position < length;)
+        {
+            const struct inotify_event* event = (const struct inotify_event*)(const void*)(events + position);
+            position += (ssize_t)(sizeof(struct inotify_event) + event->len);
+            if (event->mask & (IN_MOVE_SELF | IN_DELETE_SELF | IN_IGNORED))
+                running = false;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+            break;
+        if (st.st_size < offset)
+        {
+            fprintf(stderr, "read_file: %s: archivo truncado\n", path);
+            offset = 0;
+        }
+        if (st.st_size > offset && send_range(output, fd, offset, st.st_size) == 0)
+            offset = st.st_size;
+        if (st.st_nlink == 0)
+            running = false; // Se borró el archivo (el descriptor abierto evita IN_DELETE_SELF)
+    }
+
+    close(watch);
+}
+
+/**
+ * @brief This function returns the parsed tree of a JSON file, from the cache if the file didn't change.
+ * @param path The path to the file.
+ * @param fd The open file.
+ * @param st The status of the file.
+ * @return The tree (owned by the cache), NULL if the file can't be read or is not valid JSON.
+ */
+static const cJSON* cached_json(const char* path, int fd, const struct stat* st)
+{
+    json_cache_entry* entry = &json_cache[0];
+
+    for (size_t i = 0; i < JSON_CACHE_SIZE; i++)
+    {
+        json_cache_entry* candidate = &json_cache[i];
+        if (candidate->root && candidate->device == st->st_dev && candidate->inode == st->st_ino &&
+            candidate->size == st->st_size && candidate->mtime.tv_sec == st->st_mtim.tv_sec &&
+            candidate->mtime.tv_nsec == st->st_mtim.tv_nsec)
+        {
+            candidate->used = ++json_cache_clock;
+            return candidate->root;
+        }
+        // Reemplazar la entrada vacía o la usada hace más tiempo
+        if (!candidate->root || (entry->root && candidate->used < entry->used))
+            entry = candidate;
+    }
+
+    size_t size = (size_t)st->st_size;
+    char* buffer = malloc(size + 1);
+    if (!buffer)
+        return NULL;
+
+    size_t total = 0;
+    ssize_t bytes;
+    while (total < size && (bytes = pread(fd, buffer + total, size - total, (off_t)total)) != 0)
+    {
+        if (bytes < 0 && errno == EINTR)
+            continue;
+        if (bytes < 0)
+            break;
+        total += (size_t)bytes;
+    }
+    buffer[total] = '\0';
+
+    const char* error = NULL;
+    cJSON* root = cJSON_ParseInSituWithOpts(buffer, total + 1, &error, true);
+    if (!root)
+    {
+        printf("Error: %s no es un JSON válido (posición %ld)\n", path, error ? (long)(error - buffer) : 0L);
+        free(buffer);
+        return NULL;
+    }
+
+    cJSON_Delete(entry->root);
+    free(entry->buffer);
+    entry->device = st->st_dev;
+    entry->inode = st->st_ino;
+    entry->mtime = st->st_mtim;
+    entry->size = st->st_size;
+    entry->buffer = buffer;
+    entry->root = root;
+    entry->used = ++json_cache_clock;
+    return root;
+}
+
+/**
+ * @brief This function pretty-prints a JSON file or one of its values.
+ * @param path The path to the file.
+ * @param fd The open file.
+ * @param st The status of the file.
+ * @param key Path of the value, NULL for the whole document.
+ * @return 0 on success, -1 on error.
+ * @note Strings are printed without quotes so scripts can use the value directly.
+ */
+static int read_json(const char* path, int fd, const struct stat* st, const char* key)
+{
+    const cJSON* root = cached_json(path, fd, st);
+    if (!root)
+        return -1;
+
+    const cJSON* item = root;
+    if (key)
+    {
+        const char* const paths[] = {key};
+        json_query* query = json_query_compile(paths, 1);
+        cJSON* result = NULL;
+
+        if (query)
+            json_query_eval(query, root, &result);
+        json_query_free(query);
+
+        if (!result)
+        {
+            printf("Error: La clave %s no existe en %s\n", key, path);
+            return -1;
+        }
+        item = result;
+    }
+
+    if (cJSON_IsString(item))
+    {
+        printf("%s\n", cJSON_GetStringValue(item));
+        return 0;
+    }
+
+    if (!json_writer)
+        json_writer = cJSON_CreateWriter(0);
+    if (!json_writer || !cJSON_WriterAppend(json_writer, item, true))
+        return -1;
+
+    fflush(stdout);
+    return cJSON_WriterFlush(json_writer, STDOUT_FILENO) ? 0 : -1;
+}
+
+int read_file(const char* path, const read_options* options)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        fflush(stdout);
+        dprintf(options->output, "Error: No se puede abrir el archivo %s\n", path);
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+
+    if (options->json)
+    {
+        int result = S_ISREG(st.st_mode) ? read_json(path, fd, &st, options->key) : -1;
+        close(fd);
+        return result;
+    }
+
+    // Lo que está en el buffer de stdio tiene que salir antes que el contenido
+    fflush(stdout);
+    dprintf(options->output, "Contenido de %s:\n", path);
+
+    if (!S_ISREG(st.st_mode))
+    {
+        copy_stream(options->output, fd);
+        close(fd);
+        write_all(options->output, "\n", 1);
+        return 0;
+    }
+
+    // Los rangos se buscan con pread(): un archivo que se achica mientras tanto no puede tirar la shell con SIGBUS
+    off_t size = st.st_size;
+    off_t start = 0;
+    off_t end = size;
+    if (options->first_line > 1)
+        start = skip_lines(fd, 0, size, options->first_line - 1);
+    if (options->last_line > 0)
+    {
+        long skipped = options->first_line > 1 ? options->first_line - 1 : 0;
+        end = skip_lines(fd, start, size, options->last_line - skipped);
+    }
+    if (options->head >= 0)
+    {
+        off_t head_end = skip_lines(fd, start, size, options->head);
+        end = head_end < end ? head_end : end;
+    }
+    if (options->tail >= 0)
+    {
+        off_t tail_start = last_lines(fd, start, end, options->tail);
+        start = tail_start > start ? tail_start : start;
+    }
+    if (end < start)
+        end = start;
+
+    // Un script lanzado desde una terminal también tiene una terminal: solo se pagina en la shell interactiva
+    bool page = !options->follow && options->output == STDOUT_FILENO && jobs_interactive() && isatty(STDIN_FILENO) &&
+                isatty(STDOUT_FILENO);
+    if (page)
+        run_pager(path, fd, start, end);
+    else
+        send_range(options->output, fd, start, end);
+
+    if (options->follow)
+        follow_file(options->output, path, fd, size);
+
+    close(fd);
+    write_all(options->output, "\n", 1);
+    return 0;
+}
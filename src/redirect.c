@@ -0,0 +1,497 @@
+/**
+ * @file redirect.c
+ * @brief This file contains the implementation of the redirections of a command.
+ * @details The command is scanned once: the words are copied to the list (so an operator glued to a word, as in
+ * "echo hi>f", still ends the word) and every operator becomes a redirection with its operand. The quotes are only
+ * removed from the operands (a file with spaces, a here-string), the arguments keep them as with tokenizer().
+ */
+#define _GNU_SOURCE
+#include "redirect.h"
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Where the bodies of the here-documents are read from, NULL for stdin.
+ */
+static FILE* heredoc_source = NULL;
+
+void redirect_input(FILE* source)
+{
+    heredoc_source = source;
+}
+
+/**
+ * @brief This function tells whether a character separates words.
+ */
+static bool is_blank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n';
+}
+
+/**
+ * @brief This function tells whether a word ends at a position: a blank, an operator or the end of the command.
+ */
+static bool word_ends(const char* p)
+{
+    return *p == '\0' || is_blank(*p) || *p == '<' || *p == '>' || (*p == '&' && p[1] == '>');
+}
+
+/**
+ * @brief This function reports a syntax error and releases what was parsed.
+ * @return -1, for redirect_parse().
+ */
+static int syntax_error(redirect_list* list, const char* message)
+{
+    fprintf(stderr, "Error de sintaxis: %s\n", message);
+    redirect_close(list);
+    return -1;
+}
+
+/**
+ * @brief This function copies the next word of the command to the list.
+ * @param cursor Position in the command, moved past the word.
+ * @param list The list that keeps the copy.
+ * @param used Bytes of list->words in use.
+ * @param operand true for the operand of an operator: an opening quote runs to the closing one and is removed.
+ * @return The copy, NULL if there is no word (or no room, then *cursor does not move).
+ */
+static char* next_word(const char** cursor, redirect_list* list, size_t* used, bool operand)
+{
+    const char* p = *cursor;
+    while (is_blank(*p))
+        p++;
+
+    char quote = operand && (*p == '"' || *p == '\'') ? *p++ : '\0';
+    char* word = list->words + *used;
+    size_t length = 0;
+    while (*p != '\0' && (quote ? *p != quote : !word_ends(p)))
+    {
+        if (*used + length + 1 >= REDIRECT_WORDS)
+            return NULL;
+        word[length++] = *p++;
+    }
+
+    if (quote)
+    {
+        if (*p != quote)
+            return NULL;
+        p++;
+    }
+    else if (length == 0)
+    {
+        return NULL;
+    }
+
+    word[length] = '\0';
+    *used += length + 1;
+    *cursor = p;
+    return word;
+}
+
+/**
+ * @brief This function keeps a text in a descriptor open for reading from its start.
+ * @return The descriptor (O_CLOEXEC), -1 on error (already reported).
+ * @note Up to PIPE_BUF bytes it is a pipe: the text fits in its buffer, so the write never blocks and there is
+ * nothing to reset. A longer text goes to a memfd, which has no size limit.
+ */
+static int memory_file(const char* text, size_t length)
+{
+    if (length <= PIPE_BUF)
+    {
+        int pipefd[2];
+        if (pipe2(pipefd, O_CLOEXEC) != 0)
+        {
+            perror("pipe error");
+            return -1;
+        }
+        ssize_t written = length > 0 ? write(pipefd[1], text, length) : 0;
+        close(pipefd[1]);
+        if (written != (ssize_t)length)
+        {
+            perror("Error: No se pudo escribir el here-document");
+            close(pipefd[0]);
+            return -1;
+        }
+        return pipefd[0];
+    }
+
+    int fd = memfd_create("shellter-heredoc", MFD_CLOEXEC);
+    if (fd < 0)
+    {
+        perror("memfd_create error");
+        return -1;
+    }
+    for (size_t written = 0; written < length;)
+    {
+        ssize_t result = write(fd, text + written, length - written);
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result <= 0)
+        {
+            perror("Error: No se pudo escribir el here-document");
+            close(fd);
+            return -1;
+        }
+        written += (size_t)result;
+    }
+    lseek(fd, 0, SEEK_SET);
+    return fd;
+}
+
+/**
+ * @brief This function reads the body of a here-document, up to the line with the delimiter.
+ * @param delimiter The delimiter.
+ * @param size Where to store the length of the body.
+ * @return The descriptor with the body, -1 on error (already reported).
+ */
+static int read_heredoc(const char* delimiter, uint64_t* size)
+{
+    FILE* source = heredoc_source ? heredoc_source : stdin;
+    bool prompt = !heredoc_source && isatty(STDIN_FILENO);
+    size_t delimiter_length = strlen(delimiter);
+    char* body = NULL;
+    size_t length = 0;
+    size_t capacity = 0;
+    char* line = NULL;
+    size_t line_capacity = 0;
+
+    while (1)
+    {
+        if (prompt)
+        {
+            printf("> ");
+            fflush(stdout);
+        }
+
+        ssize_t read = getline(&line, &line_capacity, source);
+        if (read < 0)
+        {
+            fprintf(stderr, "Aviso: here-document terminado por el fin de la entrada (se esperaba \"%s\")\n",
+                    delimiter);
+            break;
+        }
+
+        size_t content = (size_t)read;
+        if (content > 0 && line[content - 1] == '\n')
+            content--;
+        if (content == delimiter_length && memcmp(line, delimiter, content) == 0)
+            break;
+
+        if (length + (size_t)read > capacity)
+        {
+            size_t grown = capacity ? capacity : 256;
+            while (grown < length + (size_t)read)
+                grown *= 2;
+            char* larger = realloc(body, grown);
+            if (!larger)
+            {
+                perror("Error: No hay memoria para el here-document");
+                free(body);
+                free(line);
+                return -1;
+            }
+            body = larger;
+            capacity = grown;
+        }
+        memcpy(body + length, line, (size_t)read);
+        length += (size_t)read;
+    }
+
+    int fd = memory_file(body, length);
+    *size = length;
+    free(body);
+    free(line);
+    return fd;
+}
+
+/**
+ * @brief This function parses the number of a descriptor, the operand of ">&" and "<&".
+ * @return The descriptor, -1 if it is not a number.
+ */
+static int parse_descriptor(const char* word)
+{
+    char* end;
+    long fd = strtol(word, &end, 10);
+    if (*word == '\0' || *end != '\0' || fd < 0 || fd > INT_MAX)
+        return -1;
+    return (int)fd;
+}
+
+int redirect_parse(const char* command, char* args[], int max_args, redirect_list* list)
+{
+    const char* p = command;
+    size_t used = 0;
+    int argc = 0;
+    list->count = 0;
+
+    while (1)
+    {
+        while (is_blank(*p))
+            p++;
+        if (*p == '\0')
+            break;
+
+        // "2>" o "&>": el prefijo va pegado al operador
+        int target = -1;
+        bool both = false;
+        if (isdigit((unsigned char)p[0]) && (p[1] == '<' || p[1] == '>'))
+        {
+            target = p[0] - '0';
+            p++;
+        }
+        else if (p[0] == '&' && p[1] == '>')
+        {
+            both = true;
+            p++;
+        }
+
+        if (*p != '<' && *p != '>')
+        {
+            char* word = next_word(&p, list, &used, false);
+            if (!word)
+                return syntax_error(list, "la línea es demasiado larga");
+            if (argc >= max_args - 1)
+                return syntax_error(list, "demasiados argumentos");
+            args[argc++] = word;
+            continue;
+        }
+
+        if (list->count + (both ? 2 : 1) > REDIRECT_MAX)
+            return syntax_error(list, "demasiadas redirecciones");
+
+        redirection* item = &list->items[list->count];
+        memset(item, 0, sizeof(*item));
+        item->source = -1;
+        item->saved = -1;
+
+        bool input = *p == '<';
+        bool heredoc = false;
+        if (strncmp(p, "<<<", 3) == 0)
+        {
+            p += 3;
+            item->kind = REDIRECT_MEMORY;
+        }
+        else if (strncmp(p, "<<", 2) == 0)
+        {
+            p += 2;
+            item->kind = REDIRECT_MEMORY;
+            heredoc = true;
+        }
+        else if (strncmp(p, "<&", 2) == 0 || strncmp(p, ">&", 2) == 0)
+        {
+            p += 2;
+            item->kind = REDIRECT_DUP;
+        }
+        else if (strncmp(p, ">>", 2) == 0)
+        {
+            p += 2;
+            item->kind = REDIRECT_OPEN;
+            item->flags = O_WRONLY | O_CREAT | O_APPEND;
+        }
+        else
+        {
+            p++;
+            item->kind = REDIRECT_OPEN;
+            item->flags = input ? O_RDONLY : O_WRONLY | O_CREAT | O_TRUNC;
+        }
+        item->target = target >= 0 ? target : input ? STDIN_FILENO : STDOUT_FILENO;
+
+        if (both && item->kind != REDIRECT_OPEN)
+            return syntax_error(list, "\"&>\" solo admite un archivo");
+
+        char* operand = next_word(&p, list, &used, true);
+        if (!operand)
+            return syntax_error(list, "falta el archivo de la redirección");
+
+        if (item->kind == REDIRECT_DUP)
+        {
+            item->source = parse_descriptor(operand);
+            if (item->source < 0)
+                return syntax_error(list, "descriptor inválido");
+        }
+        else if (heredoc)
+        {
+            // Here-document: el cuerpo son las líneas siguientes de la entrada
+            item->source = read_heredoc(operand, &item->size);
+        }
+        else if (item->kind == REDIRECT_MEMORY)
+        {
+            // Here-string: la palabra y un salto de línea
+            size_t length = strlen(operand);
+            operand[length] = '\n';
+            item->source = memory_file(operand, length + 1);
+            operand[length] = '\0';
+            item->size = length + 1;
+        }
+        else
+        {
+            item->path = operand;
+            item->source = -1;
+        }
+
+        if (item->kind == REDIRECT_MEMORY && item->source < 0)
+            return syntax_error(list, "no se pudo guardar el here-document");
+        list->count++;
+
+        // "&>archivo" es ">archivo 2>&1"
+        if (both)
+        {
+            redirection* error = &list->items[list->count++];
+            memset(error, 0, sizeof(*error));
+            error->kind = REDIRECT_DUP;
+            error->target = STDERR_FILENO;
+            error->source = STDOUT_FILENO;
+            error->saved = -1;
+        }
+    }
+
+    args[argc] = NULL;
+    return argc;
+}
+
+int redirect_open(redirect_list* list)
+{
+    for (size_t i = 0; i < list->count; i++)
+    {
+        redirection* item = &list->items[i];
+        if (item->kind != REDIRECT_OPEN)
+            continue;
+
+        int fd = open(item->path, item->flags | O_CLOEXEC, 0644);
+        if (fd < 0)
+        {
+            perror(item->path);
+            return -1;
+        }
+
+        // Lejos de los descriptores que el comando redirige ("3> a" no puede recibir el 3 de otro archivo)
+        item->source = fcntl(fd, F_DUPFD_CLOEXEC, 10);
+        close(fd);
+        if (item->source < 0)
+        {
+            perror(item->path);
+            return -1;
+        }
+
+        struct stat file;
+        item->size = (item->flags & O_ACCMODE) != O_RDONLY && fstat(item->source, &file) == 0 && file.st_size > 0
+                         ? (uint64_t)file.st_size
+                         : 0;
+    }
+    return 0;
+}
+
+int redirect_apply(redirect_list* list, bool save)
+{
+    for (size_t i = 0; i < list->count; i++)
+    {
+        redirection* item = &list->items[i];
+
+        int fd = item->source;
+        bool opened = item->kind == REDIRECT_OPEN && fd < 0;
+        if (opened)
+        {
+            fd = open(item->path, item->flags | O_CLOEXEC, 0644);
+            if (fd < 0)
+            {
+                perror(item->path);
+                return -1;
+            }
+        }
+
+        // La copia es O_CLOEXEC: ningún hijo de un comando interno la hereda
+        if (save)
+        {
+            item->saved = fcntl(item->target, F_DUPFD_CLOEXEC, 10);
+            if (item->saved < 0 && errno != EBADF)
+            {
+                perror("Error: No se pudo guardar el descriptor");
+                if (opened)
+                    close(fd);
+                return -1;
+            }
+        }
+
+        int result = fd == item->target ? 0 : dup2(fd, item->target);
+        if (opened)
+            close(fd);
+        if (result < 0)
+        {
+            fprintf(stderr, "%d: %s\n", fd, strerror(errno));
+            if (item->saved >= 0)
+                close(item->saved);
+            item->saved = -1;
+            return -1;
+        }
+        item->applied = true;
+    }
+    return 0;
+}
+
+void redirect_restore(redirect_list* list)
+{
+    for (size_t i = list->count; i > 0; i--)
+    {
+        redirection* item = &list->items[i - 1];
+        if (!item->applied)
+            continue;
+
+        // Sin copia el descriptor no existía antes
+        if (item->saved >= 0)
+        {
+            dup2(item->saved, item->target);
+            close(item->saved);
+        }
+        else
+        {
+            close(item->target);
+        }
+        item->saved = -1;
+        item->applied = false;
+    }
+}
+
+void redirect_close(redirect_list* list)
+{
+    for (size_t i = 0; i < list->count; i++)
+    {
+        redirection* item = &list->items[i];
+        if (item->kind != REDIRECT_DUP && item->source >= 0)
+        {
+            close(item->source);
+            item->source = -1;
+        }
+    }
+}
+
+uint64_t redirect_bytes(const redirect_list* list)
+{
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < list->count; i++)
+    {
+        const redirection* item = &list->items[i];
+        struct stat file;
+        if (item->kind == REDIRECT_MEMORY)
+        {
+            bytes += item->size;
+        }
+        else if (item->kind == REDIRECT_OPEN && item->source >= 0 && fstat(item->source, &file) == 0 &&
+                 S_ISREG(file.st_mode))
+        {
+            // Lo leído es la posición del archivo compartido con el comando, lo escrito es lo que el archivo creció
+            off_t position = lseek(item->source, 0, SEEK_CUR);
+            if ((item->flags & O_ACCMODE) == O_RDONLY)
+                bytes += position > 0 ? (uint64_t)position : 0;
+            else if ((uint64_t)file.st_size > item->size)
+                bytes += (uint64_t)file.st_size - item->size;
+        }
+    }
+    return bytes;
+}
@@ -0,0 +1,798 @@
+/**
+ * @file search.c
+ * @brief This file contains the implementation of the parallel configuration file search.
+ */
+#include "search.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief Size of the getdents64 buffer of each thread.
+ */
+#define DENTS_BUFFER_SIZE (64 * 1024)
+
+/**
+ * @brief Size of the output buffer of each thread in streaming mode.
+ */
+#define OUTPUT_BUFFER_SIZE (64 * 1024)
+
+/**
+ * @brief Prefix of every match, the same the shell always printed.
+ */
+#define MATCH_PREFIX "Archivo de configuración encontrado: "
+
+/**
+ * @brief Directory entry as returned by getdents64.
+ */
+struct linux_dirent64
+{
+    uint64_t d_ino;           /**< Inode number. */
+    int64_t d_off;            /**< Offset to the next entry. */
+    unsigned short d_reclen;  /**< Size of this entry. */
+    unsigned char d_type;     /**< File type. */
+    char d_name[];            /**< File name. */
+};
+
+/**
+ * @brief A directory to walk. Nodes form a tree up to the root so paths are only built when printing.
+ */
+typedef struct search_dir
+{
+    struct search_dir* parent; /**< Parent directory, NULL for the root. */
+    atomic_int refs;           /**< The node itself plus its live children. */
+    atomic_int fd_users;       /**< Reader plus children not yet opened relative to fd. */
+    int fd;                    /**< Open descriptor of the directory. */
+    int depth;                 /**< Depth below the root, 0 for the root. */
+    size_t name_length;        /**< Length of the name. */
+    char name[];               /**< Name relative to the parent (the full path for the root). */
+} search_dir;
+
+/**
+ * @brief Work-stealing deque: the owner pushes and pops at the bottom, thieves steal from the top.
+ */
+typedef struct
+{
+    pthread_mutex_t lock; /**< Protects the deque. */
+    search_dir** items;   /**< Ring buffer of directories. */
+    size_t head;          /**< Index of the oldest item. */
+    size_t count;         /**< Number of items. */
+    size_t capacity;      /**< Size of the ring buffer. */
+} work_deque;
+
+/**
+ * @brief Output of a worker: a fixed buffer in streaming mode or a list of lines in sorted mode.
+ */
+typedef struct
+{
+    char* buffer;     /**< Streaming buffer. */
+    size_t length;    /**< Bytes used in the streaming buffer. */
+    char** lines;     /**< Collected lines in sorted mode. */
+    size_t lines_count;    /**< Number of collected lines. */
+    size_t lines_capacity; /**< Capacity of the lines array. */
+} worker_output;
+
+/**
+ * @brief State shared by the workers of one search.
+ */
+typedef struct
+{
+    work_deque deques[SEARCH_MAX_THREADS]; /**< One deque per worker. */
+    worker_output outputs[SEARCH_MAX_THREADS]; /**< One output per worker. */
+    size_t threads;                        /**< Number of workers. */
+    const search_options* options;         /**< Search options. */
+    atomic_long pending;                   /**< Directories queued or being read. */
+    atomic_long matches;                   /**< Files found. */
+    atomic_int idle;                       /**< Workers waiting for work. */
+    pthread_mutex_t idle_lock;             /**< Protects the idle condition. */
+    pthread_cond_t idle_cond;              /**< Signaled when there is work or the search ends. */
+    pthread_mutex_t output_lock;           /**< Serializes writes to stdout. */
+} search_state;
+
+/**
+ * @brief Arguments of a worker thread.
+ */
+typedef struct
+{
+    search_state* state; /**< Shared state. */
+    size_t id;           /**< Index of the worker. */
+} worker_args;
+
+/**
+ * @brief This function checks whether a file name has a configuration extension.
+ * @param name The file name.
+ * @return true for ".config" and ".json" files.
+ */
+static bool is_config_file(const char* name)
+{
+    const char* ext = strrchr(name, '.');
+
+    return ext && (strcmp(ext, ".config") == 0 || strcmp(ext, ".json") == 0);
+}
+
+/**
+ * @brief Pushes a directory at the bottom of a deque.
+ * @param deque The deque.
+ * @param dir The directory.
+ * @return true on success.
+ */
+static bool deque_push(work_deque* deque, search_dir* dir)
+{
+    bool ok = true;
+
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count == deque->capacity)
+    {
+        size_t capacity = deque->capacity ? deque->capacity * 2 : 64;
+        search_dir** items = malloc(sizeof(search_dir*) * capacity);
+        if (items)
+        {
+            for (size_t i = 0; i < deque->count; i++)
+            {
+                items[i] = deque->items[(deque->head + i) % deque->capacity];
+            }
+            free(deque->items);
+            deque->items = items;
+            deque->head = 0;
+            deque->capacity = capacity;
+        }
+        else
+        {
+            ok = false;
+        }
+    }
+    if (ok)
+    {
+        deque->items[(deque->head + deque->count) % deque->capacity] = dir;
+        deque->count++;
+    }
+    pthread_mutex_unlock(&deque->lock);
+
+    return ok;
+}
+
+/**
+ * @brief Pops the newest directory of a deque (owner side, depth first).
+ * @param deque The deque.
+ * @return The directory or NULL if empty.
+ */
+static search_dir* deque_pop(work_deque* deque)
+{
+    search_dir* dir = NULL;
+
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count > 0)
+    {
+        deque->count--;
+        dir = deque->items[(deque->head + deque->count) % deque->capacity];
+    }
+    pthread_mutex_unlock(&deque->lock);
+
+    return dir;
+}
+
+/**
+ * @brief Steals the oldest directory of a deque (thief side, biggest subtrees first).
+ * @param deque The deque.
+ * @return The directory or NULL if empty.
+ */
+static search_dir* deque_steal(work_deque* deque)
+{
+    search_dir* dir = NULL;
+
+    if (pthread_mutex_trylock(&deque->lock) != 0)
+    {
+        return NULL;
+    }
+    if (deque->count > 0)
+    {
+        dir = deque->items[deque->head];
+        deque->head = (deque->head + 1) % deque->capacity;
+        deque->count--;
+    }
+    pthread_mutex_unlock(&deque->lock);
+
+    return dir;
+}
+
+/**
+ * @brief Creates a directory node.
+ * @param parent The parent node.
+ * @param name The name of the directory.
+ * @param length The length of the name.
+ * @return The node or NULL if memory runs out.
+ */
+static search_dir* new_dir(search_dir* parent, const char* name, size_t length)
+{
+    search_dir* dir = malloc(sizeof(search_dir) + length + 1);
+
+    if (!dir)
+    {
+        return NULL;
+    }
+
+    dir->parent = parent;
+    atomic_init(&dir->refs, 1);
+    atomic_init(&dir->fd_users, 0);
+    dir->fd = -1;
+    dir->depth = parent ? parent->depth + 1 : 0;
+    dir->name_length = length;
+    memcpy(dir->name, name, length);
+    dir->name[length] = '\0';
+
+    if (parent)
+    {
+        atomic_fetch_add(&parent->refs, 1);
+        atomic_fetch_add(&parent->fd_users, 1);
+    }
+
+    return dir;
+}
+
+/**
+ * @brief Releases one user of the descriptor of a directory, closing it with the last one.
+ * @param dir The directory.
+ */
+static void release_fd(search_dir* dir)
+{
+    if (atomic_fetch_sub(&dir->fd_users, 1) == 1 && dir->fd >= 0)
+    {
+        close(dir->fd);
+        dir->fd = -1;
+    }
+}
+
+/**
+ * @brief Releases a reference to a directory node, freeing the ancestors that are no longer needed.
+ * @param dir The directory.
+ */
+static void release_dir(search_dir* dir)
+{
+    while (dir && atomic_fetch_sub(&dir->refs, 1) == 1)
+    {
+        search_dir* parent = dir->parent;
+        free(dir);
+        dir = parent;
+    }
+}
+
+/**
+ * @brief Builds the path of an entry by walking up the directory nodes.
+ * @param dir The directory of the entry.
+ * @param name The name of the entry, can be NULL for the directory itself.
+ * @return The path (free it with free()), NULL if memory runs out.
+ */
+static char* build_path(const search_dir* dir, const char* name)
+{
+    size_t name_length = name ? strlen(name) : 0;
+    size_t length = name ? name_length : 0;
+
+    for (const search_dir* d = dir; d; d = d->parent)
+    {
+        length += d->name_length + (d != dir || name ? 1 : 0);
+    }
+
+    char* path = malloc(length + 1);
+    if (!path)
+    {
+        return NULL;
+    }
+
+    size_t end = length;
+    path[end] = '\0';
+    if (name)
+    {
+        end -= name_length;
+        memcpy(path + end, name, name_length);
+        path[--end] = '/';
+    }
+    for (const search_dir* d = dir; d; d = d->parent)
+    {
+        end -= d->name_length;
+        memcpy(path + end, d->name, d->name_length);
+        if (d->parent)
+        {
+            path[--end] = '/';
+        }
+    }
+
+    return path;
+}
+
+/**
+ * @brief Writes the streaming buffer of a worker to stdout.
+ * @param state The search state.
+ * @param output The output of the worker.
+ */
+static void flush_output(search_state* state, worker_output* output)
+{
+    size_t written = 0;
+
+    pthread_mutex_lock(&state->output_lock);
+    while (written < output->length)
+    {
+        ssize_t result = write(STDOUT_FILENO, output->buffer + written, output->length - written);
+        if (result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (result <= 0)
+        {
+            break;
+        }
+        written += (size_t)result;
+    }
+    pthread_mutex_unlock(&state->output_lock);
+
+    output->length = 0;
+}
+
+/**
+ * @brief Emits a line of output of a worker.
+ * @param state The search state.
+ * @param output The output of the worker.
+ * @param prefix The prefix of the line.
+ * @param path The path printed after the prefix.
+ */
+static void emit_line(search_state* state, worker_output* output, const char* prefix, const char* path)
+{
+    size_t prefix_length = strlen(prefix);
+    size_t path_length = strlen(path);
+    size_t length = prefix_length + path_length + 1;
+
+    if (state->options->sorted)
+    {
+        if (output->lines_count == output->lines_capacity)
+        {
+            size_t capacity = output->lines_capacity ? output->lines_capacity * 2 : 256;
+            char** lines = realloc(output->lines, sizeof(char*) * capacity);
+            if (!lines)
+            {
+                return;
+            }
+            output->lines = lines;
+            output->lines_capacity = capacity;
+        }
+
+        char* line = malloc(length + 1);
+        if (line)
+        {
+            snprintf(line, length + 1, "%s%s\n", prefix, path);
+            output->lines[output->lines_count++] = line;
+        }
+        return;
+    }
+
+    if (output->length + length > OUTPUT_BUFFER_SIZE)
+    {
+        flush_output(state, output);
+    }
+    if (length > OUTPUT_BUFFER_SIZE)
+    {
+        // Línea más grande que el buffer: se escribe directamente
+        pthread_mutex_lock(&state->output_lock);
+        dprintf(STDOUT_FILENO, "%s%s\n", prefix, path);
+        pthread_mutex_unlock(&state->output_lock);
+        return;
+    }
+
+    memcpy(output->buffer + output->length, prefix, prefix_length);
+    memcpy(output->buffer + output->length + prefix_length, path, path_length);
+    output->buffer[output->length + length - 1] = '\n';
+    output->length += length;
+}
+
+/**
+ * @brief Checks whether a regular file matches the name and content filters of the search.
+ * @param state The search state.
+ * @param dir The directory of the file.
+ * @param name The file name.
+ * @return true if the file must be printed.
+ */
+static bool matches_file(const search_state* state, const search_dir* dir, const char* name)
+{
+    const search_options* options = state->options;
+
+    if (options->max_depth >= 0 && dir->depth + 1 > options->max_depth)
+    {
+        return false;
+    }
+    if (options->names ? !glob_set_match(options->names, name) : !is_config_file(name))
+    {
+        return false;
+    }
+    if (!options->contains)
+    {
+        return true;
+    }
+
+    int fd = openat(dir->fd, name, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+    bool found = text_finder_file(options->contains, fd);
+    close(fd);
+
+    return found;
+}
+
+/**
+ * @brief Queues a directory to be walked and wakes an idle worker.
+ * @param state The search state.
+ * @param id Index of the worker that found it.
+ * @param dir The directory.
+ */
+static void queue_dir(search_state* state, size_t id, search_dir* dir)
+{
+    atomic_fetch_add(&state->pending, 1);
+
+    if (!deque_push(&state->deques[id], dir))
+    {
+        atomic_fetch_sub(&state->pending, 1);
+        release_fd(dir->parent);
+        release_dir(dir);
+        return;
+    }
+
+    if (atomic_load(&state->idle) > 0)
+    {
+        pthread_mutex_lock(&state->idle_lock);
+        pthread_cond_signal(&state->idle_cond);
+        pthread_mutex_unlock(&state->idle_lock);
+    }
+}
+
+/**
+ * @brief Opens a directory relative to its parent.
+ * @param dir The directory.
+ * @return The descriptor or -1.
+ */
+static int open_dir(search_dir* dir)
+{
+    int flags = O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC;
+    int fd = openat(dir->parent->fd, dir->name, flags);
+
+    if (fd < 0 && (errno == EMFILE || errno == ENFILE))
+    {
+        // Sin descriptores libres: se abre por el path completo
+        char* path = build_path(dir, NULL);
+        if (path)
+        {
+            fd = open(path, flags);
+            free(path);
+        }
+    }
+
+    return fd;
+}
+
+/**
+ * @brief Reads a directory, queueing its subdirectories and emitting its configuration files.
+ * @param state The search state.
+ * @param id Index of the worker.
+ * @param dir The directory.
+ * @param dents Buffer for getdents64.
+ */
+static void walk_dir(search_state* state, size_t id, search_dir* dir, char* dents)
+{
+    worker_output* output = &state->outputs[id];
+
+    if (dir->parent)
+    {
+        dir->fd = open_dir(dir);
+        release_fd(dir->parent);
+    }
+
+    if (dir->fd < 0)
+    {
+        char* path = build_path(dir, NULL);
+        if (path)
+        {
+            emit_line(state, output, "Error: No se puede abrir el directorio ", path);
+            free(path);
+        }
+        release_dir(dir);
+        return;
+    }
+
+    atomic_fetch_add(&dir->fd_users, 1);
+
+    long bytes;
+    while ((bytes = syscall(SYS_getdents64, dir->fd, dents, DENTS_BUFFER_SIZE)) > 0)
+    {
+        for (long offset = 0; offset < bytes;)
+        {
+            struct linux_dirent64* entry = (struct linux_dirent64*)(dents + offset);
+            unsigned char type = entry->d_type;
+            offset += entry->d_reclen;
+
+            if (entry->d_name[0] == '.' &&
+                (entry->d_name[1] == '\0' || (entry->d_name[1] == '.' && entry->d_name[2] == '\0')))
+            {
+                continue;
+            }
+
+            if (type == DT_UNKNOWN)
+            {
+                // Algunos sistemas de archivos (NFS, XFS viejos) no informan el tipo
+                struct stat st;
+                if (fstatat(dir->fd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+                {
+                    continue;
+                }
+                type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+            }
+
+            if (type == DT_DIR)
+            {
+                if (state->options->max_depth >= 0 && dir->depth + 1 >= state->options->max_depth)
+                {
+                    continue;
+                }
+
+                search_dir* child = new_dir(dir, entry->d_name, strlen(entry->d_name));
+                if (child)
+                {
+                    queue_dir(state, id, child);
+                }
+            }
+            else if (type == DT_REG && matches_file(state, dir, entry->d_name))
+            {
+                char* path = build_path(dir, entry->d_name);
+                if (path)
+                {
+                    emit_line(state, output, MATCH_PREFIX, path);
+                    free(path);
+                }
+                atomic_fetch_add(&state->matches, 1);
+            }
+        }
+    }
+
+    release_fd(dir);
+    release_dir(dir);
+}
+
+/**
+ * @brief Finds work for a worker: its own newest directory or the oldest of another worker.
+ * @param state The search state.
+ * @param id Index of the worker.
+ * @return A directory or NULL if there is nothing to do right now.
+ */
+static search_dir* find_work(search_state* state, size_t id)
+{
+    search_dir* dir = deque_pop(&state->deques[id]);
+
+    for (size_t i = 1; !dir && i < state->threads; i++)
+    {
+        dir = deque_steal(&state->deques[(id + i) % state->threads]);
+    }
+
+    return dir;
+}
+
+/**
+ * @brief Main loop of a worker thread.
+ * @param arg The worker arguments.
+ * @return NULL.
+ */
+static void* worker(void* arg)
+{
+    worker_args* args = arg;
+    search_state* state = args->state;
+    char* dents = malloc(DENTS_BUFFER_SIZE);
+
+    if (!dents)
+    {
+        return NULL;
+    }
+
+    while (atomic_load(&state->pending) > 0)
+    {
+        search_dir* dir = find_work(state, args->id);
+
+        if (!dir)
+        {
+            // Sin trabajo: esperar a que otro worker encole directorios o termine la búsqueda
+            struct timespec timeout;
+            clock_gettime(CLOCK_REALTIME, &timeout);
+            timeout.tv_nsec += 1000000;
+            if (timeout.tv_nsec >= 1000000000)
+            {
+                timeout.tv_sec++;
+                timeout.tv_nsec -= 1000000000;
+            }
+
+            pthread_mutex_lock(&state->idle_lock);
+            atomic_fetch_add(&state->idle, 1);
+            if (atomic_load(&state->pending) > 0)
+            {
+                pthread_cond_timedwait(&state->idle_cond, &state->idle_lock, &timeout);
+            }
+            atomic_fetch_sub(&state->idle, 1);
+            pthread_mutex_unlock(&state->idle_lock);
+            continue;
+        }
+
+        walk_dir(state, args->id, dir, dents);
+
+        if (atomic_fetch_sub(&state->pending, 1) == 1)
+        {
+            pthread_mutex_lock(&state->idle_lock);
+            pthread_cond_broadcast(&state->idle_cond);
+            pthread_mutex_unlock(&state->idle_lock);
+        }
+    }
+
+    free(dents);
+
+    return NULL;
+}
+
+/**
+ * @brief Compares two output lines for qsort.
+ * @param a The first line.
+ * @param b The second line.
+ * @return The strcmp order.
+ */
+static int compare_lines(const void* a, const void* b)
+{
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+/**
+ * @brief Prints the collected lines of all workers in order.
+ * @param state The search state.
+ */
+static void print_sorted(search_state* state)
+{
+    size_t total = 0;
+
+    for (size_t i = 0; i < state->threads; i++)
+    {
+        total += state->outputs[i].lines_count;
+    }
+
+    char** lines = malloc(sizeof(char*) * (total ? total : 1));
+    size_t n = 0;
+    for (size_t i = 0; i < state->threads; i++)
+    {
+        for (size_t j = 0; j < state->outputs[i].lines_count; j++)
+        {
+            if (lines)
+            {
+                lines[n++] = state->outputs[i].lines[j];
+            }
+            else
+            {
+                fputs(state->outputs[i].lines[j], stdout);
+                free(state->outputs[i].lines[j]);
+            }
+        }
+        free(state->outputs[i].lines);
+    }
+
+    if (lines)
+    {
+        qsort(lines, n, sizeof(char*), compare_lines);
+        for (size_t i = 0; i < n; i++)
+        {
+            fputs(lines[i], stdout);
+            free(lines[i]);
+        }
+        free(lines);
+    }
+    fflush(stdout);
+}
+
+long search_config_files(const char* directory, const search_options* options)
+{
+    static search_state state;
+    pthread_t threads[SEARCH_MAX_THREADS];
+    worker_args args[SEARCH_MAX_THREADS];
+    size_t started = 0;
+
+    int root_fd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (root_fd < 0)
+    {
+        printf("Error: No se puede abrir el directorio %s\n", directory);
+        return -1;
+    }
+
+    search_dir* root = new_dir(NULL, directory, strlen(directory));
+    if (!root)
+    {
+        close(root_fd);
+        return -1;
+    }
+    root->fd = root_fd;
+
+    memset(&state, 0, sizeof(state));
+    state.options = options;
+    state.threads = options->threads;
+    if (state.threads == 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        state.threads = cpus > 0 ? (size_t)cpus : 1;
+    }
+    if (state.threads > SEARCH_MAX_THREADS)
+    {
+        state.threads = SEARCH_MAX_THREADS;
+    }
+
+    pthread_mutex_init(&state.idle_lock, NULL);
+    pthread_cond_init(&state.idle_cond, NULL);
+    pthread_mutex_init(&state.output_lock, NULL);
+    for (size_t i = 0; i < state.threads; i++)
+    {
+        pthread_mutex_init(&state.deques[i].lock, NULL);
+        state.outputs[i].buffer = options->sorted ? NULL : malloc(OUTPUT_BUFFER_SIZE);
+    }
+
+    // Lo que ya está en el buffer de stdio tiene que salir antes que las escrituras directas
+    fflush(stdout);
+
+    atomic_store(&state.pending, 1);
+    deque_push(&state.deques[0], root);
+
+    // Las señales tienen que llegar al thread principal, no a los workers
+    sigset_t all;
+    sigset_t saved;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &saved);
+    for (size_t i = 0; i < state.threads; i++)
+    {
+        args[i].state = &state;
+        args[i].id = i;
+        if (pthread_create(&threads[i], NULL, worker, &args[i]) != 0)
+        {
+            break;
+        }
+        started++;
+    }
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+
+    if (started == 0)
+    {
+        // Sin threads: recorrer en el thread actual
+        worker(&args[0]);
+    }
+
+    for (size_t i = 0; i < started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    if (options->sorted)
+    {
+        print_sorted(&state);
+    }
+
+    for (size_t i = 0; i < state.threads; i++)
+    {
+        if (state.outputs[i].buffer)
+        {
+            flush_output(&state, &state.outputs[i]);
+            free(state.outputs[i].buffer);
+        }
+        free(state.deques[i].items);
+        pthread_mutex_destroy(&state.deques[i].lock);
+    }
+    pthread_mutex_destroy(&state.idle_lock);
+    pthread_cond_destroy(&state.idle_cond);
+    pthread_mutex_destroy(&state.output_lock);
+
+    return atomic_load(&state.matches);
+}
@@ -0,0 +1,490 @@
+/**
+ * @file segments.c
+ * @brief This file contains the implementation of the asynchronous prompt segments.
+ */
+#define _GNU_SOURCE // pipe2()
+#include "segments.h"
+#include "monitor.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief Maximum size of the text of one segment.
+ */
+#define SEGMENT_TEXT_MAX 96
+
+/**
+ * @brief Number of directories cached by each per-directory segment.
+ */
+#define SEGMENT_CACHE_SIZE 16
+
+/**
+ * @brief Placeholder shown while a segment is computed for the first time.
+ */
+#define SEGMENT_PLACEHOLDER "\x1b[2m…\x1b[0m"
+
+/**
+ * @brief The environment, for posix_spawnp().
+ */
+extern char** environ;
+
+/**
+ * @brief A kind of segment.
+ */
+typedef struct
+{
+    const char* name;   /**< Name of the segment. */
+    bool per_directory; /**< The value depends on the current directory. */
+    long ttl_ms;        /**< Time a computed value is considered fresh. */
+    long timeout_ms;    /**< Maximum time to compute the value. */
+    void (*compute)(const char* cwd, long timeout_ms, char* text, size_t size); /**< Renders the value. */
+} segment_type;
+
+/**
+ * @brief A cached value of a segment.
+ */
+typedef struct
+{
+    char* cwd;                   /**< Directory of the value, NULL if the entry is empty. */
+    char text[SEGMENT_TEXT_MAX]; /**< Rendered value, empty if the segment doesn't apply. */
+    struct timespec computed;    /**< When the value was computed (CLOCK_MONOTONIC). */
+    unsigned long used;          /**< Last use, for the LRU replacement. */
+} segment_value;
+
+static void compute_git(const char* cwd, long timeout_ms, char* text, size_t size);
+static void compute_monitor(const char* cwd, long timeout_ms, char* text, size_t size);
+
+/**
+ * @brief The segments, in the order they are shown.
+ */
+static const segment_type segment_types[] = {
+    {"git", true, 2000, 300, compute_git},
+    {"monitor", false, 2000, 0, compute_monitor},
+};
+
+/**
+ * @brief Number of segments.
+ */
+#define SEGMENT_COUNT (sizeof(segment_types) / sizeof(segment_types[0]))
+
+/**
+ * @brief State of the worker and the cache, protected by lock.
+ */
+static struct
+{
+    pthread_mutex_t lock;                                  /**< Protects the state. */
+    pthread_cond_t wake;                                   /**< Signaled when there is a request. */
+    pthread_t thread;                                      /**< The worker. */
+    bool started;                                          /**< The worker is running. */
+    char* cwd;                                             /**< Directory of the last request. */
+    bool pending;                                          /**< There is a request not yet served. */
+    void (*repaint)(void);                                 /**< Called when the values change. */
+    segment_value values[SEGMENT_COUNT][SEGMENT_CACHE_SIZE]; /**< Cached values. */
+    unsigned long clock;                                   /**< Counter of uses of the cache. */
+} segments = {.lock = PTHREAD_MUTEX_INITIALIZER, .wake = PTHREAD_COND_INITIALIZER};
+
+/**
+ * @brief This function returns the milliseconds elapsed since a time.
+ */
+static long elapsed_ms(const struct timespec* since)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long)(now.tv_sec - since->tv_sec) * 1000 + (now.tv_nsec - since->tv_nsec) / 1000000;
+}
+
+/**
+ * @brief This function finds the cached value of a segment for a directory.
+ * @return The value, NULL if it is not cached. Must be called with the lock held.
+ */
+static segment_value* find_value(size_t segment, const char* cwd)
+{
+    for (size_t i = 0; i < SEGMENT_CACHE_SIZE; i++)
+    {
+        segment_value* value = &segments.values[segment][i];
+        if (value->cwd && (!segment_types[segment].per_directory || strcmp(value->cwd, cwd) == 0))
+            return value;
+    }
+    return NULL;
+}
+
+/**
+ * @brief This function stores a value of a segment, replacing the least recently used one.
+ * @return true if the text shown for the directory changed. Must be called with the lock held.
+ */
+static bool store_value(size_t segment, const char* cwd, const char* text)
+{
+    segment_value* value = find_value(segment, cwd);
+    bool changed = !value || strcmp(value->text, text) != 0;
+
+    if (!value)
+    {
+        value = &segments.values[segment][0];
+        for (size_t i = 1; i < SEGMENT_CACHE_SIZE && value->cwd; i++)
+        {
+            segment_value* candidate = &segments.values[segment][i];
+            if (!candidate->cwd || candidate->used < value->used)
+                value = candidate;
+        }
+        free(value->cwd);
+        value->cwd = strdup(cwd);
+    }
+
+    snprintf(value->text, sizeof(value->text), "%s", text);
+    clock_gettime(CLOCK_MONOTONIC, &value->computed);
+    value->used = ++segments.clock;
+    return changed;
+}
+
+/**
+ * @brief This function reads the first line of a file.
+ * @return true on success.
+ */
+static bool read_line(const char* path, char* line, size_t size)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    ssize_t bytes = read(fd, line, size - 1);
+    close(fd);
+    if (bytes <= 0)
+        return false;
+
+    line[bytes] = '\0';
+    line[strcspn(line, "\n")] = '\0';
+    return true;
+}
+
+/**
+ * @brief This function checks whether a repository has changes, running "git status" with a timeout.
+ * @return 1 if there are changes, 0 if not, -1 on timeout or error.
+ */
+static int git_dirty(const char* root, long timeout_ms)
+{
+    int pipefd[2];
+    if (pipe2(pipefd, O_CLOEXEC) != 0)
+        return -1;
+
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attributes;
+    sigset_t empty;
+    sigemptyset(&empty);
+
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, pipefd[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+    // El worker bloquea las señales: el hijo arranca sin máscara y en su propio grupo, lejos del Ctrl+C
+    posix_spawnattr_init(&attributes);
+    posix_spawnattr_setsigmask(&attributes, &empty);
+    posix_spawnattr_setpgroup(&attributes, 0);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETPGROUP);
+
+    char* const argv[] = {"git", "--no-optional-locks", "-C", (char*)root, "status", "--porcelain",
+                          "--untracked-files=no", NULL};
+    pid_t pid;
+    int spawned = posix_spawnp(&pid, "git", &actions, &attributes, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attributes);
+    close(pipefd[1]);
+
+    if (spawned != 0)
+    {
+        close(pipefd[0]);
+        return -1;
+    }
+
+    // Alcanza con saber si hay al menos una línea de salida
+    int result = -1;
+    struct pollfd descriptor = {pipefd[0], POLLIN, 0};
+    if (poll(&descriptor, 1, (int)timeout_ms) > 0)
+    {
+        char byte;
+        result = read(pipefd[0], &byte, 1) == 1 ? 1 : 0;
+    }
+    close(pipefd[0]);
+
+    if (result != 0)
+        kill(pid, SIGKILL);
+    while (waitpid(pid, NULL, 0) < 0 && errno == EINTR)
+    {
+    }
+    return result;
+}
+
+/**
+ * @brief This function renders the git segment: branch (or commit) and "*" if there are changes.
+ */
+static void compute_git(const char* cwd, long timeout_ms, char* text, size_t size)
+{
+    char root[PATH_MAX];
+    char path[PATH_MAX + 16];
+    struct stat st;
+
+    text[0] = '\0';
+    snprintf(root, sizeof(root), "%s", cwd);
+
+    // Buscar .git subiendo por los directorios
+    for (;;)
+    {
+        snprintf(path, sizeof(path), "%s/.git", root);
+        if (stat(path, &st) == 0)
+            break;
+
+        char* slash = strrchr(root, '/');
+        if (!slash || slash == root)
+        {
+            if (root[1] == '\0' || !slash)
+                return;
+            root[1] = '\0';
+        }
+        else
+        {
+            *slash = '\0';
+        }
+    }
+
+    // En worktrees y submódulos .git es un archivo "gitdir: <ruta>"
+    char git_dir[PATH_MAX + 16];
+    snprintf(git_dir, sizeof(git_dir), "%s", path);
+    if (S_ISREG(st.st_mode))
+    {
+        char line[PATH_MAX];
+        if (!read_line(path, line, sizeof(line)) || strncmp(line, "gitdir: ", 8) != 0)
+            return;
+        int written = line[8] == '/' ? snprintf(git_dir, sizeof(git_dir), "%s", line + 8)
+                                     : snprintf(git_dir, sizeof(git_dir), "%s/%s", root, line + 8);
+        if (written < 0 || (size_t)written >= sizeof(git_dir))
+            return;
+    }
+
+    char head[256];
+    int length = snprintf(path, sizeof(path), "%s/HEAD", git_dir);
+    if (length < 0 || (size_t)length >= sizeof(path) || !read_line(path, head, sizeof(head)))
+        return;
+
+    char branch[128];
+    if (strncmp(head, "ref: refs/heads/", 16) == 0)
+        snprintf(branch, sizeof(branch), "%.*s", (int)sizeof(branch) - 1, head + 16);
+    else
+        snprintf(branch, sizeof(branch), "%.7s", head);
+
+    int dirty = git_dirty(root, timeout_ms);
+    snprintf(text, size, "\x1b[35m(%s%s)\x1b[0m", branch, dirty > 0 ? "*" : dirty < 0 ? "?" : "");
+}
+
+/**
+ * @brief This function renders the monitor segment: CPU and memory use while the monitor is running.
+ * @note The monitor FIFO has a single reader (status_monitor), so the segment samples the same /proc files the
+ * monitor exports instead of stealing its frames.
+ */
+static void compute_monitor(const char* cwd, long timeout_ms, char* text, size_t size)
+{
+    static unsigned long long previous_total = 0;
+    static unsigned long long previous_idle = 0;
+    (void)cwd;
+    (void)timeout_ms;
+
+    text[0] = '\0';
+    if (!monitor_is_running())
+        return;
+
+    char line[256];
+    unsigned long long user, nice, system, idle, iowait, irq, softirq, steal;
+    if (!read_line("/proc/stat", line, sizeof(line)) ||
+        sscanf(line, "cpu %llu %llu %llu %llu %llu %llu %llu %llu", &user, &nice, &system, &idle, &iowait, &irq,
+               &softirq, &steal) != 8)
+        return;
+
+    unsigned long long total = user + nice + system + idle + iowait + irq + softirq + steal;
+    unsigned long long idle_total = idle + iowait;
+    unsigned long long delta_total = total - previous_total;
+    unsigned long long delta_idle = idle_total - previous_idle;
+    previous_total = total;
+    previous_idle = idle_total;
+    double cpu = delta_total > 0 ? 100.0 * (double)(delta_total - delta_idle) / (double)delta_total : 0.0;
+
+    FILE* meminfo = fopen("/proc/meminfo", "re");
+    unsigned long long mem_total = 0;
+    unsigned long long mem_available = 0;
+    if (meminfo)
+    {
+        while (fgets(line, sizeof(line), meminfo))
+        {
+            sscanf(line, "MemTotal: %llu", &mem_total);
+            sscanf(line, "MemAvailable: %llu", &mem_available);
+        }
+        fclose(meminfo);
+    }
+    double memory = mem_total > 0 ? 100.0 * (double)(mem_total - mem_available) / (double)mem_total : 0.0;
+
+    snprintf(text, size, "\x1b[36mcpu %.0f%% mem %.0f%%\x1b[0m", cpu, memory);
+}
+
+/**
+ * @brief Body of the worker: refreshes the stale segments of the requested directory.
+ */
+static void* segments_worker(void* arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&segments.lock);
+    for (;;)
+    {
+        while (!segments.pending)
+            pthread_cond_wait(&segments.wake, &segments.lock);
+        segments.pending = false;
+
+        char* cwd = strdup(segments.cwd ? segments.cwd : "");
+        bool changed = false;
+
+        for (size_t i = 0; cwd && i < SEGMENT_COUNT; i++)
+        {
+            segment_value* value = find_value(i, cwd);
+            if (value && elapsed_ms(&value->computed) < segment_types[i].ttl_ms)
+                continue;
+
+            // El cálculo puede tardar: se hace sin el lock para no frenar al prompt
+            char text[SEGMENT_TEXT_MAX];
+            pthread_mutex_unlock(&segments.lock);
+            segment_types[i].compute(cwd, segment_types[i].timeout_ms, text, sizeof(text));
+            pthread_mutex_lock(&segments.lock);
+
+            changed |= store_value(i, cwd, text);
+        }
+
+        // Solo se repinta si el prompt sigue en el mismo directorio
+        bool current = cwd && segments.cwd && strcmp(cwd, segments.cwd) == 0;
+        free(cwd);
+        if (changed && current && segments.repaint)
+        {
+            pthread_mutex_unlock(&segments.lock);
+            segments.repaint();
+            pthread_mutex_lock(&segments.lock);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief fork() handlers: the lock is taken around fork() so the child never inherits it held.
+ */
+static void segments_fork_prepare(void)
+{
+    pthread_mutex_lock(&segments.lock);
+}
+
+static void segments_fork_parent(void)
+{
+    pthread_mutex_unlock(&segments.lock);
+}
+
+static void segments_fork_child(void)
+{
+    // El worker no existe en el hijo
+    segments.started = false;
+    segments.repaint = NULL;
+    pthread_mutex_unlock(&segments.lock);
+}
+
+int segments_start(void (*repaint)(void))
+{
+    if (segments.started)
+        return 0;
+
+    segments.repaint = repaint;
+
+    // Las señales tienen que llegar al thread principal, no al worker
+    sigset_t all;
+    sigset_t saved;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &saved);
+    int created = pthread_create(&segments.thread, NULL, segments_worker, NULL);
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+
+    if (created != 0)
+        return -1;
+    pthread_detach(segments.thread);
+    pthread_atfork(segments_fork_prepare, segments_fork_parent, segments_fork_child);
+    segments.started = true;
+    return 0;
+}
+
+void segments_request(const char* cwd)
+{
+    pthread_mutex_lock(&segments.lock);
+    if (!segments.cwd || strcmp(segments.cwd, cwd) != 0)
+    {
+        free(segments.cwd);
+        segments.cwd = strdup(cwd);
+    }
+    segments.pending = true;
+    pthread_cond_signal(&segments.wake);
+    pthread_mutex_unlock(&segments.lock);
+}
+
+/**
+ * @brief This function counts the columns of a text, skipping escape codes and UTF-8 continuation bytes.
+ */
+static size_t text_width(const char* text)
+{
+    size_t width = 0;
+    for (const char* c = text; *c; c++)
+    {
+        if (*c == '\x1b')
+        {
+            while (c[1] && !((c[1] >= 'A' && c[1] <= 'Z') || (c[1] >= 'a' && c[1] <= 'z')))
+                c++;
+            if (c[1])
+                c++;
+        }
+        else if (((unsigned char)*c & 0xC0) != 0x80)
+        {
+            width++;
+        }
+    }
+    return width;
+}
+
+size_t segments_render(char* buffer, size_t* width)
+{
+    size_t length = 0;
+    buffer[0] = '\0';
+
+    pthread_mutex_lock(&segments.lock);
+    for (size_t i = 0; i < SEGMENT_COUNT; i++)
+    {
+        segment_value* value = segments.cwd ? find_value(i, segments.cwd) : NULL;
+        const char* text = value ? value->text : (segment_types[i].per_directory ? SEGMENT_PLACEHOLDER : "");
+        if (text[0] == '\0')
+            continue;
+
+        int written = snprintf(buffer + length, SEGMENTS_MAX - length, "%s%s", length > 0 ? " " : "", text);
+        if (written < 0 || (size_t)written >= SEGMENTS_MAX - length)
+            break;
+        length += (size_t)written;
+        if (value)
+            value->used = ++segments.clock;
+    }
+    pthread_mutex_unlock(&segments.lock);
+
+    buffer[length] = '\0';
+    *width = text_width(buffer);
+    return length;
+}
@@ -1,17 +1,162 @@
 /**
  * @file signals.c
  * @brief This file contains the implementation of the functions that handle the signals.
+ * @details On a terminal SIGINT, SIGTSTP, SIGQUIT and SIGCHLD are blocked and read from a signalfd registered in the
+ * event loop (see reactor.h), so nothing runs in signal context. While a job is in the foreground the terminal sends
+ * its signals to the group of the job (see jobs.h). While the shell runs a command itself SIGINT and SIGQUIT are
+ * unblocked, with a handler without SA_RESTART, so they interrupt the system call the command waits in (the poll() of
+ * read_file --follow, the read() of the pager) instead of waiting in the signalfd. Without a terminal, or if
+ * signalfd() fails, the handlers are installed with sigaction() and SA_RESTART.
  */
 #include "signals.h"
+#include "reactor.h"
+#include <string.h>
+#include <sys/signalfd.h>
+#include <time.h>
+
+/**
+ * @brief File descriptor of the signalfd, -1 if the handlers are used.
+ */
+static int signal_fd = -1;
+
+/**
+ * @brief This function does nothing: the signal only has to interrupt the system call of the command.
+ */
+static void interrupt_command(int signum)
+{
+    (void)signum;
+}
+
+/**
+ * @brief This function fills the set of the signals that interrupt a command run by the shell.
+ */
+static void command_signals(sigset_t* set)
+{
+    sigemptyset(set);
+    sigaddset(set, SIGINT);
+    sigaddset(set, SIGQUIT);
+}
+
+/**
+ * @brief This function installs a handler with SA_RESTART, so the interrupted reads are restarted.
+ */
+static void install_handler(int signum, void (*handler)(int))
+{
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(signum, &action, NULL);
+}
+
+/**
+ * @brief This function handles the signals pending in the signalfd, called from the event loop.
+ */
+static void dispatch_signals(int fd, uint32_t events, void* data)
+{
+    (void)events;
+    (void)data;
+    struct signalfd_siginfo info;
+    bool redraw = false;
+
+    while (read(fd, &info, sizeof(info)) == (ssize_t)sizeof(info))
+    {
+        if (info.ssi_signo == SIGCHLD)
+        {
+            // Un trabajo en segundo plano terminó o se detuvo
+            redraw = jobs_reap(true) > 0 || redraw;
+        }
+        else
+        {
+            // Ctrl+C, Ctrl+Z o Ctrl+\ en el prompt: la terminal ya descartó la línea
+            printf("\n");
+            redraw = true;
+        }
+    }
+
+    if (redraw)
+        show_prompt();
+}
 
 /**
  * @brief This function manages the signals.
+ * @note It is called once, when the shell starts.
  */
 void manage_signals(void)
 {
-    signal(SIGINT, signal_interrupt_handler);
-    signal(SIGTSTP, signal_stop_handler);
-    signal(SIGQUIT, signal_quit_handler);
+    jobs_init();
+
+    if (jobs_interactive())
+    {
+        sigset_t set;
+        sigemptyset(&set);
+        sigaddset(&set, SIGINT);
+        sigaddset(&set, SIGTSTP);
+        sigaddset(&set, SIGQUIT);
+        sigaddset(&set, SIGCHLD);
+
+        // Los hilos creados después heredan la máscara: las señales quedan pendientes para el signalfd
+        if (sigprocmask(SIG_BLOCK, &set, NULL) == 0)
+        {
+            signal_fd = signalfd(-1, &set, SFD_NONBLOCK | SFD_CLOEXEC);
+            if (signal_fd >= 0 && reactor_add(signal_fd, EPOLLIN, dispatch_signals, NULL) == 0)
+            {
+                // Sin SA_RESTART: poll() y read() vuelven con EINTR
+                struct sigaction action;
+                memset(&action, 0, sizeof(action));
+                action.sa_handler = interrupt_command;
+                sigemptyset(&action.sa_mask);
+                sigaction(SIGINT, &action, NULL);
+                sigaction(SIGQUIT, &action, NULL);
+                return;
+            }
+            if (signal_fd >= 0)
+                close(signal_fd);
+            signal_fd = -1;
+            sigprocmask(SIG_UNBLOCK, &set, NULL);
+        }
+    }
+
+    install_handler(SIGINT, signal_interrupt_handler);
+    install_handler(SIGTSTP, signal_stop_handler);
+    install_handler(SIGQUIT, signal_quit_handler);
+}
+
+/**
+ * @brief This function tells whether the signals are read from the event loop.
+ */
+bool signals_in_reactor(void)
+{
+    return signal_fd >= 0;
+}
+
+void signals_command_begin(void)
+{
+    if (signal_fd < 0)
+        return;
+
+    sigset_t set;
+    command_signals(&set);
+    sigprocmask(SIG_UNBLOCK, &set, NULL);
+}
+
+void signals_command_end(void)
+{
+    if (signal_fd < 0)
+        return;
+
+    sigset_t set;
+    command_signals(&set);
+    sigprocmask(SIG_BLOCK, &set, NULL);
+
+    // Un Ctrl+Z durante el comando no tiene a quién detener: descartarlo, o el signalfd mostraría otro prompt
+    sigset_t stop;
+    sigemptyset(&stop);
+    sigaddset(&stop, SIGTSTP);
+    struct timespec now = {0, 0};
+    while (sigtimedwait(&stop, NULL, &now) == SIGTSTP)
+        ;
 }
 
 /**
@@ -20,9 +165,7 @@ void manage_signals(void)
 void signal_interrupt_handler(int signum1)
 {
     (void)signum1;
-    printf("\n");
-    show_prompt();
-    fflush(stdout);
+    show_prompt_signal_safe();
 }
 
 /**
@@ -31,9 +174,7 @@ void signal_interrupt_handler(int signum1)
 void signal_stop_handler(int signum2)
 {
     (void)signum2;
-    printf("\n");
-    show_prompt();
-    fflush(stdout);
+    show_prompt_signal_safe();
 }
 
 /**
@@ -42,7 +183,5 @@ void signal_stop_handler(int signum2)
 void signal_quit_handler(int signum3)
 {
     (void)signum3;
-    printf("\n");
-    show_prompt();
-    fflush(stdout);
+    show_prompt_signal_safe();
 }
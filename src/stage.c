@@ -0,0 +1,101 @@
+/**
+ * @file stage.c
+ * @brief This file contains the implementation of the internal commands of a pipeline that run on threads.
+ * @details A stage owns a copy of its arguments and its two descriptors and frees them itself, so the shell can let it
+ * go with pthread_detach() when the job is stopped with its thread still writing.
+ */
+#include "stage.h"
+#include "commands.h"
+#include "stats.h"
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * @brief A stage: the arguments and the strings they point to follow the structure in the same allocation.
+ */
+typedef struct
+{
+    const builtin_command* command; /**< The command. */
+    int argc;                       /**< Number of arguments. */
+    int input;                      /**< Read end of the previous pipe or STDIN_FILENO. */
+    int output;                     /**< Write end of the next pipe. */
+    char* args[];                   /**< Arguments, NULL terminated. */
+} stage;
+
+/**
+ * @brief Body of the thread of a stage.
+ * @return The exit status, as an intptr_t.
+ */
+static void* stage_main(void* data)
+{
+    stage* self = data;
+
+    uint64_t trace_start = trace_begin();
+    STATS_TIMER(command_start);
+    // Sin stdio ni el estado de la shell: corre mientras la shell espera al trabajo
+    int status = self->command->run_fd(self->command, self->argc, self->args, self->input, self->output);
+    STATS_RECORD_COMMAND(self->args[0], command_start);
+    trace_end("builtin", trace_start, 0, 0, self->args[0]);
+    trace_thread_end();
+
+    // El cierre de la escritura es el fin de archivo de la etapa siguiente
+    close(self->output);
+    if (self->input != STDIN_FILENO)
+        close(self->input);
+    free(self);
+    return (void*)(intptr_t)status;
+}
+
+int stage_start(const builtin_command* command, int argc, char* args[], int input, int output, pthread_t* thread)
+{
+    size_t size = sizeof(stage) + sizeof(char*) * ((size_t)argc + 1);
+    for (int i = 0; i < argc; i++)
+        size += strlen(args[i]) + 1;
+
+    stage* self = malloc(size);
+    if (!self)
+    {
+        perror("Error: No hay memoria para la etapa");
+        return -1;
+    }
+    self->command = command;
+    self->argc = argc;
+    self->input = input;
+    self->output = output;
+
+    char* strings = (char*)&self->args[argc + 1];
+    for (int i = 0; i < argc; i++)
+    {
+        size_t length = strlen(args[i]) + 1;
+        self->args[i] = memcpy(strings, args[i], length);
+        strings += length;
+    }
+    self->args[argc] = NULL;
+
+    // Las señales tienen que llegar al thread principal, no a la etapa
+    sigset_t all;
+    sigset_t saved;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &saved);
+    int created = pthread_create(thread, NULL, stage_main, self);
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+
+    if (created != 0)
+    {
+        fprintf(stderr, "pthread_create: %s\n", strerror(created));
+        free(self);
+        return -1;
+    }
+    return 0;
+}
+
+int stage_wait(pthread_t thread)
+{
+    void* status = NULL;
+    pthread_join(thread, &status);
+    return (int)(intptr_t)status;
+}
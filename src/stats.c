@@ -0,0 +1,375 @@
+/**
+ * @file stats.c
+ * @brief This file contains the implementation of the latency histograms and counters of the shell.
+ * @details The tables are static and only touched by the main thread, except the histograms of the commands: the
+ * stages of a pipeline that run on threads record their own time there, under a lock. A value v >= 16 goes to the
+ * bucket of its exponent e (the position of its highest bit) and of its next 4 bits; values under 16 ns have a bucket
+ * each and values from 2^40 ns (about 18 minutes) on share the last one.
+ */
+#include "stats.h"
+#include "builtins.h"
+#include <cJSON.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef SHELLTER_STATS
+
+/**
+ * @brief Buckets per power of two.
+ */
+#define STATS_SUB_BUCKETS 16
+
+/**
+ * @brief Exponent of the first value that is clamped to the last bucket.
+ */
+#define STATS_MAX_EXPONENT 40
+
+/**
+ * @brief Number of buckets of a histogram.
+ */
+#define STATS_BUCKETS ((STATS_MAX_EXPONENT - 3) * STATS_SUB_BUCKETS)
+
+/**
+ * @brief Number of commands with their own histogram.
+ */
+#define STATS_MAX_COMMANDS 32
+
+/**
+ * @brief A log-linear histogram of nanoseconds.
+ */
+typedef struct
+{
+    uint64_t count;                   /**< Number of values. */
+    uint64_t sum;                     /**< Sum of the values. */
+    uint64_t min;                     /**< Smallest value. */
+    uint64_t max;                     /**< Largest value. */
+    uint32_t buckets[STATS_BUCKETS];  /**< Values per bucket. */
+} histogram;
+
+/**
+ * @brief Histogram of a command.
+ */
+typedef struct
+{
+    char name[STATS_NAME_LENGTH]; /**< Name of the command, "" for a free entry. */
+    histogram latency;            /**< Time from the start to the end of the command. */
+} command_histogram;
+
+/**
+ * @brief Histograms of the operations of the shell.
+ */
+static histogram stats_histograms[STATS_HISTOGRAMS];
+
+/**
+ * @brief Histograms of the commands, the last entry is shared by the commands that did not fit.
+ */
+static command_histogram stats_commands[STATS_MAX_COMMANDS + 1];
+
+/**
+ * @brief Serializes the histograms of the commands between the shell and the threads of the pipelines.
+ */
+static pthread_mutex_t stats_commands_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Counters.
+ */
+static uint64_t stats_counters[STATS_COUNTERS];
+
+/**
+ * @brief Names of the histograms, for the report.
+ */
+static const char* const histogram_names[STATS_HISTOGRAMS] = {"parse", "fork", "pipeline_setup", "monitor_sample"};
+
+/**
+ * @brief Names of the counters, for the report.
+ */
+static const char* const counter_names[STATS_COUNTERS] = {"commands", "forks", "failures", "redirected_bytes"};
+
+uint64_t stats_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * @brief This function returns the bucket of a value.
+ */
+static size_t bucket_index(uint64_t value)
+{
+    if (value < STATS_SUB_BUCKETS)
+        return (size_t)value;
+    if (value >> STATS_MAX_EXPONENT)
+        return STATS_BUCKETS - 1;
+
+    unsigned exponent = 63u - (unsigned)__builtin_clzll(value);
+    return (exponent - 3) * STATS_SUB_BUCKETS + (size_t)((value >> (exponent - 4)) - STATS_SUB_BUCKETS);
+}
+
+/**
+ * @brief This function returns the smallest value of a bucket.
+ */
+static uint64_t bucket_start(size_t index)
+{
+    if (index < STATS_SUB_BUCKETS)
+        return index;
+
+    unsigned exponent = (unsigned)(index / STATS_SUB_BUCKETS) + 3;
+    return (uint64_t)(STATS_SUB_BUCKETS + index % STATS_SUB_BUCKETS) << (exponent - 4);
+}
+
+/**
+ * @brief This function adds a value to a histogram.
+ */
+static void histogram_add(histogram* h, uint64_t value)
+{
+    if (h->count == 0 || value < h->min)
+        h->min = value;
+    if (value > h->max)
+        h->max = value;
+    h->count++;
+    h->sum += value;
+    h->buckets[bucket_index(value)]++;
+}
+
+/**
+ * @brief This function returns a percentile of a histogram: the largest value of the bucket that holds it.
+ * @param h The histogram.
+ * @param percentile The percentile, from 0 to 100.
+ */
+static uint64_t histogram_percentile(const histogram* h, double percentile)
+{
+    if (h->count == 0)
+        return 0;
+
+    uint64_t rank = (uint64_t)((double)h->count * percentile / 100.0 + 0.5);
+    if (rank == 0)
+        rank = 1;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < STATS_BUCKETS; i++)
+    {
+        seen += h->buckets[i];
+        if (seen >= rank)
+        {
+            uint64_t end = i + 1 < STATS_BUCKETS ? bucket_start(i + 1) - 1 : h->max;
+            if (end > h->max)
+                end = h->max;
+            return end < h->min ? h->min : end;
+        }
+    }
+    return h->max;
+}
+
+void stats_record(stats_histogram which, uint64_t nanoseconds)
+{
+    if ((unsigned)which < STATS_HISTOGRAMS)
+        histogram_add(&stats_histograms[which], nanoseconds);
+}
+
+void stats_record_command(const char* name, uint64_t nanoseconds)
+{
+    pthread_mutex_lock(&stats_commands_lock);
+
+    // Búsqueda lineal: son pocos nombres y el comando ya tardó mucho más que esto
+    size_t i = 0;
+    while (i < STATS_MAX_COMMANDS && stats_commands[i].name[0] != '\0' &&
+           strncmp(stats_commands[i].name, name, STATS_NAME_LENGTH - 1) != 0)
+        i++;
+
+    if (i < STATS_MAX_COMMANDS && stats_commands[i].name[0] == '\0')
+        snprintf(stats_commands[i].name, STATS_NAME_LENGTH, "%s", name);
+    else if (i == STATS_MAX_COMMANDS)
+        snprintf(stats_commands[i].name, STATS_NAME_LENGTH, "%s", "(otros)");
+
+    histogram_add(&stats_commands[i].latency, nanoseconds);
+    pthread_mutex_unlock(&stats_commands_lock);
+}
+
+void stats_count(stats_counter counter, uint64_t amount)
+{
+    if ((unsigned)counter < STATS_COUNTERS)
+        stats_counters[counter] += amount;
+}
+
+/**
+ * @brief This function writes a duration with its unit.
+ */
+static void format_duration(char* buffer, size_t size, uint64_t nanoseconds)
+{
+    if (nanoseconds < 1000)
+        snprintf(buffer, size, "%lluns", (unsigned long long)nanoseconds);
+    else if (nanoseconds < 1000000)
+        snprintf(buffer, size, "%.1fus", (double)nanoseconds / 1e3);
+    else if (nanoseconds < 1000000000)
+        snprintf(buffer, size, "%.1fms", (double)nanoseconds / 1e6);
+    else
+        snprintf(buffer, size, "%.2fs", (double)nanoseconds / 1e9);
+}
+
+/**
+ * @brief This function prints a line of the table of histograms.
+ */
+static void print_histogram(const char* name, const histogram* h)
+{
+    if (h->count == 0)
+        return;
+
+    uint64_t values[] = {h->sum / h->count,
+                         h->min,
+                         histogram_percentile(h, 50),
+                         histogram_percentile(h, 90),
+                         histogram_percentile(h, 99),
+                         h->max};
+    printf("%-20s %8llu", name, (unsigned long long)h->count);
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+    {
+        char duration[32];
+        format_duration(duration, sizeof(duration), values[i]);
+        printf(" %9s", duration);
+    }
+    printf("\n");
+}
+
+/**
+ * @brief This function converts a histogram to JSON.
+ */
+static cJSON* histogram_json(const histogram* h)
+{
+    cJSON* object = cJSON_CreateObject();
+    cJSON_AddNumberToObject(object, "count", (double)h->count);
+    cJSON_AddNumberToObject(object, "mean_ns", h->count ? (double)h->sum / (double)h->count : 0);
+    cJSON_AddNumberToObject(object, "min_ns", (double)h->min);
+    cJSON_AddNumberToObject(object, "p50_ns", (double)histogram_percentile(h, 50));
+    cJSON_AddNumberToObject(object, "p90_ns", (double)histogram_percentile(h, 90));
+    cJSON_AddNumberToObject(object, "p99_ns", (double)histogram_percentile(h, 99));
+    cJSON_AddNumberToObject(object, "max_ns", (double)h->max);
+    return object;
+}
+
+/**
+ * @brief This function prints everything as JSON.
+ */
+static void print_json(void)
+{
+    cJSON* root = cJSON_CreateObject();
+
+    cJSON* counters = cJSON_AddObjectToObject(root, "counters");
+    for (size_t i = 0; i < STATS_COUNTERS; i++)
+        cJSON_AddNumberToObject(counters, counter_names[i], (double)stats_counters[i]);
+
+    cJSON* histograms = cJSON_AddObjectToObject(root, "histograms");
+    for (size_t i = 0; i < STATS_HISTOGRAMS; i++)
+        cJSON_AddItemToObject(histograms, histogram_names[i], histogram_json(&stats_histograms[i]));
+
+    cJSON* commands = cJSON_AddObjectToObject(root, "commands");
+    pthread_mutex_lock(&stats_commands_lock);
+    for (size_t i = 0; i <= STATS_MAX_COMMANDS && stats_commands[i].name[0] != '\0'; i++)
+        cJSON_AddItemToObject(commands, stats_commands[i].name, histogram_json(&stats_commands[i].latency));
+    pthread_mutex_unlock(&stats_commands_lock);
+
+    char* text = cJSON_PrintUnformatted(root);
+    if (text)
+        printf("%s\n", text);
+    cJSON_free(text);
+    cJSON_Delete(root);
+}
+
+/**
+ * @brief This function prints everything as a table.
+ */
+static void print_table(void)
+{
+    for (size_t i = 0; i < STATS_COUNTERS; i++)
+        printf("%-20s %llu\n", counter_names[i], (unsigned long long)stats_counters[i]);
+
+    // Los acentos ocupan un byte más de lo que se ve
+    printf("\n%-21s %8s %9s %10s %9s %9s %9s %10s\n", "operación", "n", "media", "mín", "p50", "p90", "p99", "máx");
+    for (size_t i = 0; i < STATS_HISTOGRAMS; i++)
+        print_histogram(histogram_names[i], &stats_histograms[i]);
+    pthread_mutex_lock(&stats_commands_lock);
+    for (size_t i = 0; i <= STATS_MAX_COMMANDS && stats_commands[i].name[0] != '\0'; i++)
+        print_histogram(stats_commands[i].name, &stats_commands[i].latency);
+    pthread_mutex_unlock(&stats_commands_lock);
+}
+
+int stats_command(char* args[])
+{
+    if (!args[1])
+    {
+        print_table();
+    }
+    else if (strcmp(args[1], "-json") == 0)
+    {
+        print_json();
+    }
+    else if (strcmp(args[1], "-reset") == 0)
+    {
+        memset(stats_histograms, 0, sizeof(stats_histograms));
+        pthread_mutex_lock(&stats_commands_lock);
+        memset(stats_commands, 0, sizeof(stats_commands));
+        pthread_mutex_unlock(&stats_commands_lock);
+        memset(stats_counters, 0, sizeof(stats_counters));
+    }
+    else
+    {
+        printf("Uso: stats [-json | -reset]\n");
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief fork() handlers: a detached stage may hold the lock, "stats | cat" reads the tables in a child.
+ */
+static void stats_fork_prepare(void)
+{
+    pthread_mutex_lock(&stats_commands_lock);
+}
+
+static void stats_fork_parent(void)
+{
+    pthread_mutex_unlock(&stats_commands_lock);
+}
+
+static void stats_fork_child(void)
+{
+    pthread_mutex_unlock(&stats_commands_lock);
+}
+
+#else
+
+int stats_command(char* args[])
+{
+    printf("%s: la shell se compiló sin estadísticas (SHELLTER_STATS)\n", args[0]);
+    return 1;
+}
+
+#endif
+
+/**
+ * @brief Adapter of stats_command() to the registry.
+ */
+static int stats_builtin(int argc, char* args[])
+{
+    (void)argc;
+    return stats_command(args);
+}
+
+/**
+ * @brief Commands of the statistics.
+ */
+static const builtin_command stats_commands_table[] = {
+    {"stats", "[-json | -reset]", "Muestra las latencias y los contadores de la shell", 0, stats_builtin, NULL, NULL,
+     NULL},
+};
+
+void stats_register_builtins(void)
+{
+#ifdef SHELLTER_STATS
+    pthread_atfork(stats_fork_prepare, stats_fork_parent, stats_fork_child);
+#endif
+    builtin_register(stats_commands_table, sizeof(stats_commands_table) / sizeof(stats_commands_table[0]));
+}
@@ -0,0 +1,337 @@
+/**
+ * @file trace.c
+ * @brief This file contains the implementation of the trace of the shell.
+ * @details The file is a JSON array of trace events that every process appends to, under a record lock (fcntl()
+ * locks are per process, so they also separate the shell from its children). The array starts with the name of the
+ * shell process and every flush adds a comma and its events; the shell closes it at exit, and a background job that
+ * flushes later takes the "]" out and puts it back, so the file is valid JSON whenever nobody is writing (the format
+ * also accepts a missing "]" if the shell is killed). The buffers of the threads are chained in a list with
+ * compare-and-swap and only their own thread writes to them, except at exit and in a new child, where no other thread
+ * of the process runs. A thread that ends gives its buffer back with trace_thread_end(), the next new thread takes it
+ * instead of allocating one, so the threads of the pipelines do not grow the list.
+ */
+#define _GNU_SOURCE
+#include "trace.h"
+#include <cJSON.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief Number of spans a thread keeps before writing them.
+ */
+#define TRACE_BUFFER_EVENTS 256
+
+/**
+ * @brief Maximum length of the command of a span, longer commands are cut.
+ */
+#define TRACE_DETAIL_LENGTH 64
+
+/**
+ * @brief A span.
+ */
+typedef struct
+{
+    const char* name;                 /**< Name of the span. */
+    uint64_t start;                   /**< Start, in nanoseconds of the monotonic clock. */
+    uint64_t duration;                /**< Duration in nanoseconds. */
+    pid_t child;                      /**< Process the span is about, 0 for none. */
+    int job;                          /**< Job number, 0 for none. */
+    char detail[TRACE_DETAIL_LENGTH]; /**< Command, "" for none. */
+} trace_event;
+
+/**
+ * @brief The spans of a thread.
+ */
+typedef struct trace_buffer
+{
+    trace_event events[TRACE_BUFFER_EVENTS]; /**< Spans not written yet. */
+    size_t count;                            /**< Number of spans. */
+    pid_t tid;                               /**< Thread that owns the buffer. */
+    atomic_bool released;                    /**< Its thread ended, another one can take it. */
+    cJSON_Writer* writer;                    /**< Output buffer of the JSON, reused by every flush. */
+    struct trace_buffer* next;               /**< Next buffer of the list. */
+} trace_buffer;
+
+/**
+ * @brief The trace file, -1 if the shell is not tracing.
+ */
+static int trace_fd = -1;
+
+/**
+ * @brief The shell process, the only one that closes the array.
+ */
+static pid_t trace_owner = 0;
+
+/**
+ * @brief Buffers of every thread that recorded a span.
+ */
+static _Atomic(trace_buffer*) trace_buffers = NULL;
+
+/**
+ * @brief Buffer of the calling thread, NULL until its first span.
+ */
+static _Thread_local trace_buffer* trace_local = NULL;
+
+/**
+ * @brief This function returns the monotonic clock in nanoseconds.
+ */
+static uint64_t monotonic_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * @brief This function appends to the file with the lock taken, before the "]" if the array is already closed.
+ */
+static void append_locked(const struct iovec* parts, int count)
+{
+    struct flock lock;
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    while (fcntl(trace_fd, F_SETLKW, &lock) != 0 && errno == EINTR)
+        ;
+
+    struct stat file;
+    char tail[2];
+    bool closed = fstat(trace_fd, &file) == 0 && file.st_size >= 2 &&
+                  pread(trace_fd, tail, sizeof(tail), file.st_size - 2) == 2 && memcmp(tail, "]\n", 2) == 0;
+    if (closed && ftruncate(trace_fd, file.st_size - 2) != 0)
+        closed = false;
+
+    ssize_t written = writev(trace_fd, parts, count);
+    if (closed)
+        written = write(trace_fd, "]\n", 2);
+    (void)written;
+
+    lock.l_type = F_UNLCK;
+    fcntl(trace_fd, F_SETLK, &lock);
+}
+
+/**
+ * @brief This function appends the elements of a JSON array to the one of the file.
+ */
+static void write_events(cJSON_Writer* writer, const cJSON* events)
+{
+    const char* text = cJSON_WriterPrint(writer, events, false);
+    size_t length = cJSON_WriterGetLength(writer);
+    if (!text || length <= 2)
+        return;
+
+    struct iovec parts[2] = {{.iov_base = (void*)",\n", .iov_len = 2},
+                             {.iov_base = (void*)(text + 1), .iov_len = length - 2}};
+    append_locked(parts, 2);
+}
+
+/**
+ * @brief This function writes the spans of a buffer and empties it.
+ */
+static void flush_buffer(trace_buffer* buffer)
+{
+    if (buffer->count == 0 || trace_fd < 0)
+        return;
+
+    pid_t pid = getpid();
+    cJSON* events = cJSON_CreateArray();
+    for (size_t i = 0; i < buffer->count; i++)
+    {
+        const trace_event* event = &buffer->events[i];
+        cJSON* object = cJSON_CreateObject();
+        cJSON_AddStringToObject(object, "name", event->name);
+        cJSON_AddStringToObject(object, "cat", "shellter");
+        cJSON_AddStringToObject(object, "ph", "X");
+        cJSON_AddNumberToObject(object, "ts", (double)event->start / 1e3);
+        cJSON_AddNumberToObject(object, "dur", (double)event->duration / 1e3);
+        cJSON_AddNumberToObject(object, "pid", pid);
+        cJSON_AddNumberToObject(object, "tid", buffer->tid);
+
+        cJSON* args = cJSON_AddObjectToObject(object, "args");
+        if (event->child)
+            cJSON_AddNumberToObject(args, "child", event->child);
+        if (event->job)
+            cJSON_AddNumberToObject(args, "job", event->job);
+        if (event->detail[0])
+            cJSON_AddStringToObject(args, "command", event->detail);
+        cJSON_AddItemToArray(events, object);
+    }
+
+    write_events(buffer->writer, events);
+    cJSON_Delete(events);
+    buffer->count = 0;
+}
+
+/**
+ * @brief This function returns the buffer of the calling thread, it creates it the first time.
+ */
+static trace_buffer* local_buffer(void)
+{
+    if (trace_local)
+        return trace_local;
+
+    for (trace_buffer* buffer = atomic_load(&trace_buffers); buffer; buffer = buffer->next)
+    {
+        bool released = true;
+        if (atomic_compare_exchange_strong(&buffer->released, &released, false))
+        {
+            buffer->tid = gettid();
+            trace_local = buffer;
+            return buffer;
+        }
+    }
+
+    trace_buffer* buffer = calloc(1, sizeof(trace_buffer));
+    if (!buffer)
+        return NULL;
+    buffer->writer = cJSON_CreateWriter(0);
+    if (!buffer->writer)
+    {
+        free(buffer);
+        return NULL;
+    }
+    buffer->tid = gettid();
+
+    buffer->next = atomic_load(&trace_buffers);
+    while (!atomic_compare_exchange_weak(&trace_buffers, &buffer->next, buffer))
+        ;
+    trace_local = buffer;
+    return buffer;
+}
+
+/**
+ * @brief fork() handler: the spans inherited from the parent are written by the parent.
+ */
+static void trace_fork_child(void)
+{
+    for (trace_buffer* buffer = atomic_load(&trace_buffers); buffer; buffer = buffer->next)
+        buffer->count = 0;
+    if (trace_local)
+        trace_local->tid = gettid();
+}
+
+/**
+ * @brief exit() handler: the shell writes what is left and closes the array.
+ */
+static void trace_close(void)
+{
+    if (trace_fd < 0 || getpid() != trace_owner)
+        return;
+
+    for (trace_buffer* buffer = atomic_load(&trace_buffers); buffer; buffer = buffer->next)
+        flush_buffer(buffer);
+
+    struct iovec end = {.iov_base = (void*)"\n]\n", .iov_len = 3};
+    append_locked(&end, 1);
+    close(trace_fd);
+    trace_fd = -1;
+}
+
+/**
+ * @brief This function starts the array with the name of the shell process, for the trace viewers.
+ */
+static void write_header(void)
+{
+    cJSON* metadata = cJSON_CreateObject();
+    cJSON_AddStringToObject(metadata, "name", "process_name");
+    cJSON_AddStringToObject(metadata, "ph", "M");
+    cJSON_AddNumberToObject(metadata, "pid", trace_owner);
+    cJSON_AddNumberToObject(metadata, "tid", trace_owner);
+    cJSON_AddStringToObject(cJSON_AddObjectToObject(metadata, "args"), "name", "shellter");
+
+    char* text = cJSON_PrintUnformatted(metadata);
+    if (text)
+    {
+        struct iovec parts[2] = {{.iov_base = (void*)"[\n", .iov_len = 2}, {.iov_base = text, .iov_len = strlen(text)}};
+        append_locked(parts, 2);
+    }
+    cJSON_free(text);
+    cJSON_Delete(metadata);
+}
+
+void trace_init(void)
+{
+    const char* path = getenv(TRACE_VARIABLE);
+    if (!path || *path == '\0')
+        return;
+
+    // O_APPEND: los hijos escriben al final del mismo archivo; O_RDWR para ver si el arreglo ya se cerró
+    trace_fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (trace_fd < 0)
+    {
+        perror("Error: No se pudo abrir el archivo de la traza");
+        return;
+    }
+
+    // Otra shellter lanzada desde esta truncaría el archivo
+    unsetenv(TRACE_VARIABLE);
+
+    trace_owner = getpid();
+    write_header();
+    pthread_atfork(NULL, NULL, trace_fork_child);
+    atexit(trace_close);
+}
+
+bool trace_enabled(void)
+{
+    return trace_fd >= 0;
+}
+
+uint64_t trace_begin(void)
+{
+    return trace_fd >= 0 ? monotonic_now() : 0;
+}
+
+void trace_end(const char* name, uint64_t start, pid_t child, int job, const char* detail)
+{
+    if (start == 0 || trace_fd < 0)
+        return;
+
+    uint64_t end = monotonic_now();
+    trace_buffer* buffer = local_buffer();
+    if (!buffer)
+        return;
+    if (buffer->count == TRACE_BUFFER_EVENTS)
+        flush_buffer(buffer);
+
+    trace_event* event = &buffer->events[buffer->count++];
+    event->name = name;
+    event->start = start;
+    event->duration = end - start;
+    event->child = child;
+    event->job = job;
+
+    // Las etapas de un pipeline llegan con los espacios alrededor del "|"
+    detail = detail ? detail + strspn(detail, " ") : "";
+    size_t length = strlen(detail);
+    while (length > 0 && detail[length - 1] == ' ')
+        length--;
+    if (length >= sizeof(event->detail))
+        length = sizeof(event->detail) - 1;
+    memcpy(event->detail, detail, length);
+    event->detail[length] = '\0';
+}
+
+void trace_flush(void)
+{
+    if (trace_fd >= 0 && trace_local)
+        flush_buffer(trace_local);
+}
+
+void trace_thread_end(void)
+{
+    if (!trace_local)
+        return;
+    flush_buffer(trace_local);
+    atomic_store(&trace_local->released, true);
+    trace_local = NULL;
+}